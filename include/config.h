@@ -6,6 +6,12 @@
 #define WINDOW_WIDTH 1280
 #define WINDOW_HEIGHT 720
 
+// Dynamic resolution configuration
+#define DYNAMIC_RESOLUTION 1
+#define DYNAMIC_RES_MIN_SCALE 0.5f
+#define DYNAMIC_RES_TARGET_FPS 60.0f
+#define DYNAMIC_RES_SHARPNESS 0.4f
+
 // Terrain configuration
 #define TERRAIN_SIZE 1024
 #define TERRAIN_SCALE 100.0f
@@ -20,14 +26,106 @@
 
 // Vegetation configuration
 #define TREE_INSTANCES 1000
-#define GRASS_INSTANCES 50000
+#define GRASS_INSTANCES 50000           // Grass blades drawn per frame at most (see the grass configuration)
 #define FLOWER_INSTANCES 2000
 #define MUSHROOM_INSTANCES 500
+#define TREE_SPACING 6.0f               // Poisson-disk radius between placed instances
+#define FLOWER_SPACING 1.5f
+#define MUSHROOM_SPACING 2.5f
+
+// Worker threads for CPU culling (0 = one per extra core)
+#define WORKER_THREADS 0
+
+// Vegetation culling configuration
+#define CULL_DISTANCE_TREES 800.0f
+#define CULL_DISTANCE_FLOWERS 150.0f
+#define CULL_DISTANCE_MUSHROOMS 120.0f
+#define CULL_DISTANCE_LANTERNS 400.0f
+
+// Grass configuration: blades on a jittered grid, built into terrain-aligned chunks around the
+// camera; density is full up to GRASS_FULL_DENSITY_DISTANCE and thins out to CULL_DISTANCE_GRASS
+#define GRASS_CHUNK_SIZE 32.0f
+#define GRASS_BLADE_SPACING 0.35f
+#define GRASS_BLADE_WIDTH 0.08f
+#define GRASS_BLADE_HEIGHT 0.6f
+#define GRASS_MAX_SLOPE 0.4f
+#define GRASS_MAX_CHUNKS 160            // Resident chunk buffers (least recently used are rebuilt elsewhere)
+#define GRASS_CHUNK_BUILDS_PER_FRAME 8
+#define GRASS_FULL_DENSITY_DISTANCE 30.0f
+#define GRASS_FADE_BAND 0.05f           // Density margin over which a thinned blade shrinks away
+#define CULL_DISTANCE_GRASS 150.0f
+
+// Wind field: gust noise on a SIZE x SIZE grid around the camera, carried along by the mean
+// wind; SIZE must be a power of two
+#define WIND_FIELD_SIZE 64
+#define WIND_FIELD_SEED 0x5eedu
+#define WIND_FIELD_CELL_SIZE 5.0f       // Covers the grass cull distance either side of the camera
+#define WIND_FIELD_SPEED 8.0f           // World units per second the gusts travel per unit of wind strength
+#define WIND_FIELD_GUST_SCALE 48.0f     // World units per gust feature
+#define WIND_FIELD_GUST_STRENGTH 0.6f   // Gust variation relative to the mean wind
+#define WIND_FIELD_FLUID_ROWS 4         // Rows re-read from a coupled fluid simulation per frame
+#define WIND_FIELD_FLUID_COUPLING 1.0f
+
+// Occlusion culling configuration
+#define OCCLUSION_WIDTH 256
+#define OCCLUSION_HEIGHT 128
+#define OCCLUSION_TERRAIN_GRID 48
+#define OCCLUSION_TERRAIN_BIAS 0.05f    // Margin below the measured per-cell height error
+#define OCCLUSION_STRUCTURE_RADIUS 4.0f
+#define OCCLUSION_PROXY_SHRINK 0.5f
+
+// Impostor configuration (atlas is FRAMES x FRAMES views of FRAME_SIZE texels)
+#define IMPOSTOR_FRAMES 8
+#define IMPOSTOR_FRAME_SIZE 128
+#define IMPOSTOR_DISTANCE_TREES 250.0f
+#define IMPOSTOR_DISTANCE_STRUCTURES 400.0f
+#define IMPOSTOR_FADE_RANGE 20.0f
+#define IMPOSTOR_CACHE_DIR "cache/impostors"
+
+// Atmosphere LUTs: viewer height above the ground (km), sun movement that triggers a sky-view
+// rebuild, rows rebuilt per frame, and the sun illuminance and angular radius in the sky pass
+#define ATMOSPHERE_CACHE_DIR "cache/atmosphere"
+#define ATMOSPHERE_VIEWER_HEIGHT 0.2f
+#define ATMOSPHERE_SUN_STEP 0.0044f        // Radians (1/4 degree)
+#define ATMOSPHERE_SKY_VIEW_ROWS 6         // 18 frames per rebuild; the sun takes ~25 to move a step
+#define ATMOSPHERE_SUN_ILLUMINANCE 20.0f
+#define ATMOSPHERE_SUN_RADIUS 0.0047f      // Radians
+
+// Texture streaming (worker threads, staging pool cap, upload bytes per frame)
+#define TEXTURE_STREAM_THREADS 2
+#define TEXTURE_STREAM_STAGING_LIMIT (64 * 1024 * 1024)
+#define TEXTURE_STREAM_UPLOAD_BUDGET (4 * 1024 * 1024)
+
+// Program binary cache (keyed by shader source and driver)
+#define SHADER_CACHE_DIR "cache/shaders"
+
+// Imported mesh cache (rebuilt when the source file is newer)
+#define MESH_CACHE_DIR "cache/meshes"
+
+// Store imported meshes with half-float positions/UVs and 10_10_10_2 normals/tangents
+#define MESH_QUANTIZE 1
+
+// Mesh LOD chain: levels generated per mesh (at most MESH_MAX_LODS), triangle ratio between
+// levels, largest simplification error relative to the mesh radius, and meshes too small to bother
+#define MESH_LOD_LEVELS 4
+#define MESH_LOD_RATIO 0.5f
+#define MESH_LOD_MAX_ERROR 0.05f
+#define MESH_LOD_MIN_TRIANGLES 64
+
+// LOD selection: level 1 starts below this projected height (fraction of the viewport),
+// each further level at half the size; the bias scales the projected size (> 1 keeps detail longer)
+#define MESH_LOD_SCREEN_SIZE 0.25f
+#define MESH_LOD_BIAS 1.0f
 
 // Lighting configuration
 #define MAX_LIGHTS 64
 #define SHADOW_MAP_SIZE 4096
 
+// SSAO configuration
+#define SSAO_KERNEL_SIZE 64
+#define SSAO_SAMPLES_PER_FRAME 16
+#define SSAO_DEFAULT_QUALITY SSAO_QUALITY_HALF
+
 // Camera configuration
 #define CAMERA_FOV 60.0f
 #define CAMERA_NEAR 0.1f
@@ -47,5 +145,11 @@
 #define DAY_LENGTH 600.0f  // 10 minutes per day
 #define RAIN_PROBABILITY 0.3f
 #define FOG_PROBABILITY 0.2f
+#define WEATHER_TRANSITION_TIME 4.0f    // Seconds weather is advanced for after it changes
+#define LIGHTS_TIME_STEP (1.0f / 2880.0f) // Day fraction the sun moves before lights recompute (1/8 degree)
+
+// Simulation thread: fixed tick rate, and how many missed ticks are caught up before skipping ahead
+#define SIMULATION_TICK_RATE 60.0f
+#define SIMULATION_MAX_CATCHUP_TICKS 5
 
 #endif // CONFIG_H 
\ No newline at end of file
@@ -0,0 +1,79 @@
+#ifndef ATMOSPHERE_H
+#define ATMOSPHERE_H
+
+// No GL includes: the renderer uploads the LUTs, tools build them headless
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Forward declarations
+typedef struct ThreadPool ThreadPool;
+
+// LUT sizes (RGB float texels)
+#define ATMOSPHERE_TRANSMITTANCE_WIDTH 256
+#define ATMOSPHERE_TRANSMITTANCE_HEIGHT 64
+#define ATMOSPHERE_MULTI_SCATTERING_SIZE 32
+#define ATMOSPHERE_SKY_VIEW_WIDTH 192
+#define ATMOSPHERE_SKY_VIEW_HEIGHT 108
+
+// Integration steps
+#define ATMOSPHERE_TRANSMITTANCE_STEPS 40
+#define ATMOSPHERE_MULTI_SCATTERING_STEPS 20
+#define ATMOSPHERE_MULTI_SCATTERING_DIRECTIONS 8   // Per side of the direction grid (64 directions)
+#define ATMOSPHERE_SKY_VIEW_STEPS 32
+
+// Cache file
+#define ATMOSPHERE_CACHE_VERSION 1
+#define ATMOSPHERE_CACHE_MAGIC 0x4D544157u  // "WATM"
+
+// Planet and participating media, in kilometres (coefficients per km)
+typedef struct {
+    float bottomRadius;
+    float topRadius;
+    float rayleighScattering[3];
+    float rayleighScaleHeight;
+    float mieScattering;
+    float mieExtinction;
+    float mieScaleHeight;
+    float mieG;                 // Henyey-Greenstein asymmetry
+    float ozoneAbsorption[3];
+    float ozoneCenter;          // Tent-shaped layer
+    float ozoneWidth;
+    float groundAlbedo[3];
+} AtmosphereParams;
+
+// Precomputed sky model (Hillaire 2020). Transmittance and multiple scattering depend only on
+// the parameters, so they are built once (or loaded from the disk cache). The sky-view LUT
+// holds the sky around the viewer relative to the sun's azimuth, so it only depends on the
+// sun's elevation; it is rebuilt a few rows at a time when the sun has moved far enough.
+typedef struct Atmosphere {
+    AtmosphereParams params;
+    float viewerHeight;         // km above the ground
+
+    float* transmittance;       // Indexed by view zenith and height
+    float* multiScattering;     // Indexed by sun zenith and height
+    float* skyView;             // Indexed by azimuth from the sun and view zenith
+
+    // Sky-view rebuild: rows below skyViewRow are done
+    float skyViewElevation;     // Sun elevation (radians) of the complete LUT
+    float buildElevation;       // Of the one being built
+    int skyViewRow;
+    bool skyViewValid;          // A complete LUT exists
+
+    // Build times (ms)
+    double transmittanceTime;
+    double multiScatteringTime;
+    double skyViewTime;         // Whole last rebuild, summed over its slices
+    double sliceTime;           // Last atmosphere_buildSkyView call
+    bool fromCache;
+} Atmosphere;
+
+// Function prototypes
+void atmosphere_defaultParams(AtmosphereParams* params);
+bool atmosphere_init(Atmosphere* atmosphere, const AtmosphereParams* params, float viewerHeight, const char* cacheDir, ThreadPool* pool);
+void atmosphere_cleanup(Atmosphere* atmosphere);
+void atmosphere_beginSkyView(Atmosphere* atmosphere, float sunElevation);
+bool atmosphere_buildSkyView(Atmosphere* atmosphere, int rows, ThreadPool* pool);
+void atmosphere_sampleTransmittance(const Atmosphere* atmosphere, float radius, float cosZenith, float* transmittance);
+
+#endif // ATMOSPHERE_H
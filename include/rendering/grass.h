@@ -0,0 +1,102 @@
+#ifndef GRASS_H
+#define GRASS_H
+
+#include "wonderlands.h"
+#include "rendering/terrain.h"
+#include "rendering/occlusion_culling.h"
+#include "scene/wind_field.h"
+#include "utils/thread_pool.h"
+#include <stdint.h>
+
+// Blade mesh: a triangle strip of three segments and a tip
+#define GRASS_BLADE_VERTICES 7
+#define GRASS_NO_SLOT (-1)
+
+// One blade as uploaded: root position, then threshold, yaw, height and sway phase as unorm
+// bytes. Chunks keep their blades sorted by threshold, so drawing the first N of them is a
+// stable density cut: a blade is drawn while its threshold is below the density at its distance.
+typedef struct {
+    float position[3];
+    uint8_t threshold;
+    uint8_t yaw;
+    uint8_t height;
+    uint8_t phase;
+} GrassBlade;
+
+// One resident chunk buffer
+typedef struct {
+    int chunkX;                 // Grid coordinates, or GRASS_NO_SLOT when free
+    int chunkZ;
+    GLuint VAO;
+    GLuint instanceBuffer;
+    size_t bladeCount;
+    uint32_t thresholdCounts[257];  // Blades with a threshold below each byte value
+    float boxMin[3];
+    float boxMax[3];
+    unsigned int lastUsed;      // Frame it was last within range
+} GrassChunk;
+
+// Last frame's counts
+typedef struct {
+    size_t chunksResident;
+    size_t chunksInRange;
+    size_t chunksVisible;
+    size_t chunksCulled;        // Outside the frustum or occluded
+    size_t chunksBuilt;
+    size_t bladesInRange;       // Potential blades of the chunks in range
+    size_t bladesDrawn;
+    float densityScale;         // Below 1 when the blade budget thinned everything
+    double buildTime;           // ms
+} GrassStats;
+
+// Chunk scheduled for building this frame
+typedef struct {
+    int chunkX;
+    int chunkZ;
+    int slot;
+    float distance;
+} GrassBuild;
+
+// Grass system: chunk buffers are built on worker threads as the camera approaches and
+// recycled as it leaves, so the terrain can hold millions of potential blades while the
+// per-frame cost is bounded by the chunks in range and the GRASS_INSTANCES budget.
+typedef struct GrassSystem {
+    bool enabled;
+    
+    // Chunk grid over the terrain, and which slot holds each grid cell
+    Terrain* terrain;
+    float originX;
+    float originZ;
+    int chunksPerSide;
+    int cellsPerChunk;          // Blade grid cells per chunk side
+    int* slots;
+    GrassChunk chunks[GRASS_MAX_CHUNKS];
+    size_t chunkCapacity;       // Blades per chunk buffer
+    unsigned int frame;
+    
+    // Build scratch (one chunk's blades per build)
+    GrassBuild builds[GRASS_CHUNK_BUILDS_PER_FRAME];
+    int buildCount;
+    GrassBlade* scratch;
+    size_t* scratchCounts;
+    
+    // Visible chunks and how many of their blades to draw
+    int drawSlots[GRASS_MAX_CHUNKS];
+    size_t drawCounts[GRASS_MAX_CHUNKS];
+    int drawCount;
+    float densityScale;
+    
+    GLuint shader;
+    GLuint bladeVBO;
+    ThreadPool* pool;
+    GrassStats stats;
+} GrassSystem;
+
+// Function prototypes
+void grass_init(GrassSystem* grass, ThreadPool* pool);
+void grass_cleanup(GrassSystem* grass);
+void grass_update(GrassSystem* grass, Terrain* terrain, const float* viewProjection, const float* cameraPosition, OcclusionCuller* occlusion);
+void grass_draw(GrassSystem* grass, const WindField* windField, GLuint windTexture);
+const GrassStats* grass_getStats(const GrassSystem* grass);
+
+#endif // GRASS_H
@@ -0,0 +1,89 @@
+#ifndef IMPOSTOR_H
+#define IMPOSTOR_H
+
+#include "wonderlands.h"
+#include "scene/object.h"
+#include <stdint.h>
+
+// Cache file layout version; bump when the bake output changes
+#define IMPOSTOR_CACHE_VERSION 1
+#define IMPOSTOR_CACHE_MAGIC 0x504D4957u   // "WIMP"
+
+// Maximum number of distinct mesh/material pairs with an impostor
+#define IMPOSTOR_MAX_ATLASES 64
+
+// Header stored in front of the atlas pixels in the disk cache
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t frames;
+    uint32_t frameSize;
+    uint64_t key;
+    float center[3];
+    float radius;
+} ImpostorCacheHeader;
+
+// Octahedral atlas of one mesh/material pair, plus this frame's instances
+typedef struct ImpostorAtlas {
+    const Mesh* mesh;
+    const Material* material;
+    bool valid;                 // False if baking failed; the pair is not retried
+    uint64_t key;
+    
+    // Object-space bounding sphere the frames were rendered around
+    float center[3];
+    float radius;
+    
+    // RGBA8: albedo + coverage, object-space normal + depth
+    GLuint albedoTexture;
+    GLuint normalDepthTexture;
+    
+    // Instance model matrices queued this frame, and where they start fading in
+    float* matrices;
+    size_t instanceCount;
+    size_t instanceCapacity;
+    float fadeStart;
+} ImpostorAtlas;
+
+// Bake and draw counters
+typedef struct {
+    unsigned int atlasesBaked;
+    unsigned int atlasesLoaded;
+    float bakeTime;             // ms spent baking, total
+    float loadTime;             // ms spent reading the cache, total
+    size_t instancesDrawn;      // Last frame
+    unsigned int drawCalls;     // Last frame
+} ImpostorStats;
+
+// Impostor system
+typedef struct ImpostorSystem {
+    bool enabled;
+    ImpostorAtlas atlases[IMPOSTOR_MAX_ATLASES];
+    int atlasCount;
+    
+    // Bake target and programs
+    GLuint bakeFramebuffer;
+    GLuint bakeDepthBuffer;
+    GLuint bakeShader;
+    GLuint drawShader;
+    GLuint fallbackTexture;
+    
+    // Camera-facing quad with a per-instance matrix stream
+    GLuint quadVAO;
+    GLuint quadVBO;
+    GLuint instanceBuffer;
+    size_t instanceBufferCapacity;
+    
+    ImpostorStats stats;
+} ImpostorSystem;
+
+// Function prototypes
+void impostor_init(ImpostorSystem* system);
+void impostor_cleanup(ImpostorSystem* system);
+ImpostorAtlas* impostor_getAtlas(ImpostorSystem* system, const Mesh* mesh, const Material* material);
+void impostor_begin(ImpostorSystem* system);
+void impostor_addInstances(ImpostorSystem* system, ImpostorAtlas* atlas, const float* matrices, size_t count, float fadeStart);
+void impostor_draw(ImpostorSystem* system);
+const ImpostorStats* impostor_getStats(const ImpostorSystem* system);
+
+#endif // IMPOSTOR_H
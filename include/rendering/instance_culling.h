@@ -0,0 +1,106 @@
+#ifndef INSTANCE_CULLING_H
+#define INSTANCE_CULLING_H
+
+#include "wonderlands.h"
+#include "scene/object.h"
+#include "utils/thread_pool.h"
+#include "rendering/occlusion_culling.h"
+#include "rendering/impostor.h"
+
+// Culling configuration (chunks hold whole clusters)
+#define INSTANCE_CULL_CHUNK_SIZE 1024
+#define INSTANCE_CULL_CLUSTER_SIZE 64
+
+// Instanced object categories, each with its own distance limit
+typedef enum {
+    INSTANCE_CULL_TREES,
+    INSTANCE_CULL_FLOWERS,
+    INSTANCE_CULL_MUSHROOMS,
+    INSTANCE_CULL_LANTERNS,
+    INSTANCE_CULL_TYPE_COUNT
+} InstanceCullType;
+
+// Per-category settings and last frame's counts
+typedef struct {
+    const char* name;
+    const char* submittedCounter;
+    const char* visibleCounter;
+    const char* occludedCounter;
+    const char* impostorCounter;
+    float maxDistance;
+    float defaultRadius;        // Used when the mesh has no bounding radius
+    size_t submitted;
+    size_t visible;
+    size_t occluded;
+    size_t impostors;
+} InstanceCullCategory;
+
+// SoA bounds of one object's instances (in Morton order) plus its compacted output
+typedef struct {
+    Object* object;
+    InstanceCullType type;
+    size_t count;
+    const Transform* source;
+    uint32_t* order;            // Sorted position -> index into source
+    float* clusterBounds;       // Min xyz, max xyz per INSTANCE_CULL_CLUSTER_SIZE instances
+    float* x;
+    float* y;
+    float* z;
+    float* radius;
+    float* visibleMatrices;
+    uint8_t* visibleLods;       // Mesh level per visible instance (only for meshes with LODs)
+    float* sortedMatrices;      // Visible matrices grouped by level for upload
+    size_t visibleCount;
+    float* impostorMatrices;    // Survivors far enough to draw as impostors (may overlap the fade band)
+    size_t impostorCount;
+    GLuint shadowBuffer;        // All instances, uploaded when the set is built
+} InstanceCullSet;
+
+// Contiguous range of one set's instances, processed by a single thread
+typedef struct {
+    size_t set;
+    size_t begin;
+    size_t end;
+    size_t visible;
+    size_t occluded;
+    size_t impostors;
+} InstanceCullChunk;
+
+// Instance culler
+typedef struct InstanceCuller {
+    bool enabled;
+    InstanceCullCategory categories[INSTANCE_CULL_TYPE_COUNT];
+    
+    // Sets persist across frames and are rebuilt when an object's instances change
+    InstanceCullSet* sets;
+    size_t setCount;
+    size_t setCapacity;
+    size_t setCursor;
+    
+    InstanceCullChunk* chunks;
+    size_t chunkCount;
+    size_t chunkCapacity;
+    
+    // Frame inputs
+    float planes[6][4];
+    float cameraPosition[3];
+    float lodScale;             // Projected size of a unit radius at unit distance, times lodBias
+    
+    // Scales projected size before LOD selection (> 1 keeps detail further out)
+    float lodBias;
+    
+    // Shared workers, an optional depth buffer for cluster occlusion tests,
+    // and an optional impostor system that takes the distant survivors
+    ThreadPool* pool;
+    OcclusionCuller* occlusion;
+    ImpostorSystem* impostors;
+} InstanceCuller;
+
+// Function prototypes
+void instanceCulling_init(InstanceCuller* culler, ThreadPool* pool);
+void instanceCulling_cleanup(InstanceCuller* culler);
+void instanceCulling_begin(InstanceCuller* culler, const float* viewMatrix, const float* projectionMatrix, const float* cameraPosition, OcclusionCuller* occlusion, ImpostorSystem* impostors);
+void instanceCulling_addObjects(InstanceCuller* culler, InstanceCullType type, Object* objects, size_t count);
+void instanceCulling_execute(InstanceCuller* culler);
+
+#endif // INSTANCE_CULLING_H
@@ -0,0 +1,81 @@
+#ifndef OCCLUSION_CULLING_H
+#define OCCLUSION_CULLING_H
+
+// CPU only: no GL includes, so the rasterizer can be built and tested headless
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "utils/thread_pool.h"
+
+// Tiles are rasterized independently, one thread per tile at a time
+#define OCCLUSION_TILE_SIZE 32
+
+// Occluder triangle in screen space, set up for edge-function rasterization
+typedef struct {
+    float edgeA[3];
+    float edgeB[3];
+    float edgeC[3];
+    float depthX;
+    float depthY;
+    float depthC;
+    int minX;
+    int minY;
+    int maxX;
+    int maxY;
+} OcclusionTriangle;
+
+// World-space occluder mesh (e.g. a coarse terrain grid)
+typedef struct OcclusionMesh {
+    float* vertices;
+    size_t vertexCount;
+    unsigned int* indices;
+    size_t indexCount;
+} OcclusionMesh;
+
+// Per-frame counters
+typedef struct {
+    unsigned int trianglesSubmitted;
+    unsigned int trianglesRasterized;
+    unsigned int boxesTested;
+    unsigned int boxesOccluded;
+    float rasterizeTime;        // Milliseconds
+} OcclusionStats;
+
+// Occlusion culler
+typedef struct OcclusionCuller {
+    bool enabled;
+    int width;
+    int height;
+    int tilesX;
+    int tilesY;
+    float* depth;               // Nearest occluder depth per pixel, 0 = near, 1 = empty
+    float viewProjection[16];
+    
+    // Occluder triangles for this frame
+    OcclusionTriangle* triangles;
+    size_t triangleCount;
+    size_t triangleCapacity;
+    
+    // Per-tile triangle lists, built with a counting pass
+    uint32_t* binOffsets;
+    uint32_t* binIndices;
+    size_t binCapacity;
+    
+    ThreadPool* pool;
+    atomic_uint boxesTested;
+    atomic_uint boxesOccluded;
+    OcclusionStats stats;
+} OcclusionCuller;
+
+// Function prototypes
+void occlusion_init(OcclusionCuller* culler, int width, int height, ThreadPool* pool);
+void occlusion_cleanup(OcclusionCuller* culler);
+void occlusion_begin(OcclusionCuller* culler, const float* viewProjection);
+void occlusion_addOccluderMesh(OcclusionCuller* culler, const OcclusionMesh* mesh);
+void occlusion_addOccluderBox(OcclusionCuller* culler, const float* boxMin, const float* boxMax);
+void occlusion_rasterize(OcclusionCuller* culler);
+bool occlusion_testBox(OcclusionCuller* culler, const float* boxMin, const float* boxMax);
+const OcclusionStats* occlusion_getStats(OcclusionCuller* culler);
+void occlusion_freeMesh(OcclusionMesh* mesh);
+
+#endif // OCCLUSION_CULLING_H
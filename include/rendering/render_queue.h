@@ -0,0 +1,77 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "wonderlands.h"
+#include "scene/object.h"
+#include <stdint.h>
+
+// Pointer-to-id table size for material/mesh sort key fields (power of two)
+#define RENDER_QUEUE_ID_TABLE_SIZE 32768
+
+// Pass stored in the top bits of the sort key
+typedef enum {
+    RENDER_QUEUE_SHADOW,
+    RENDER_QUEUE_OPAQUE,
+    RENDER_QUEUE_TRANSPARENT
+} RenderQueuePass;
+
+// One submitted draw
+typedef struct {
+    Object* object;
+    Mesh* mesh;
+    const Material* material;
+    GLuint shader;
+    GLintptr objectOffset;
+    unsigned int lod;           // Mesh level for non-instanced draws (instances carry their own)
+    bool shadow;                // Instances come from the unculled shadow buffer
+} RenderItem;
+
+// Sort key plus index into the item array
+typedef struct {
+    uint64_t key;
+    uint32_t index;
+} RenderSortEntry;
+
+// Per-flush counters
+typedef struct {
+    unsigned int drawCalls;
+    unsigned int shaderChanges;
+    unsigned int materialChanges;
+    unsigned int meshChanges;
+    unsigned int instanceBufferChanges;
+    
+    // Triangles drawn at the selected LODs, and what full detail would have cost
+    size_t triangles;
+    size_t fullDetailTriangles;
+    
+    // What the same items would have cost without sorting/elision
+    unsigned int unsortedStateChanges;
+    unsigned int naiveStateChanges;
+} RenderQueueStats;
+
+// Render queue
+typedef struct RenderQueue {
+    RenderItem* items;
+    RenderSortEntry* entries;
+    RenderSortEntry* scratch;
+    size_t count;
+    size_t capacity;
+    
+    // Stable small ids for materials and meshes
+    const void** idKeys;
+    uint16_t* idValues;
+    unsigned int nextId;
+    
+    RenderQueueStats stats;
+} RenderQueue;
+
+// Function prototypes
+void renderQueue_init(RenderQueue* queue, size_t capacity);
+void renderQueue_cleanup(RenderQueue* queue);
+void renderQueue_reset(RenderQueue* queue);
+void renderQueue_submit(RenderQueue* queue, RenderQueuePass pass, GLuint shader, Object* object, float depth, unsigned int lod);
+void renderQueue_sort(RenderQueue* queue);
+void renderQueue_draw(RenderQueue* queue);
+uint64_t renderQueue_makeKey(RenderQueuePass pass, unsigned int shader, unsigned int material, unsigned int mesh, float depth);
+
+#endif // RENDER_QUEUE_H
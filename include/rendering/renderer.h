@@ -6,6 +6,26 @@
 // Forward declarations
 typedef struct SceneManager SceneManager;
 typedef struct Camera Camera;
+typedef struct RenderQueue RenderQueue;
+typedef struct InstanceCuller InstanceCuller;
+typedef struct OcclusionCuller OcclusionCuller;
+typedef struct OcclusionMesh OcclusionMesh;
+typedef struct ThreadPool ThreadPool;
+typedef struct ImpostorSystem ImpostorSystem;
+typedef struct TextureStreamer TextureStreamer;
+typedef struct SceneBvh SceneBvh;
+typedef struct GrassSystem GrassSystem;
+typedef struct WindField WindField;
+typedef struct Atmosphere Atmosphere;
+typedef struct Object Object;
+
+// SSAO quality modes
+typedef enum {
+    SSAO_QUALITY_FULL,      // Full resolution, whole kernel every frame
+    SSAO_QUALITY_HALF,      // Half resolution, rotated kernel subset, temporal
+    SSAO_QUALITY_QUARTER,   // Quarter resolution, rotated kernel subset, temporal
+    SSAO_QUALITY_COUNT
+} SSAOQuality;
 
 // Renderer configuration
 typedef struct {
@@ -29,6 +49,25 @@ typedef struct {
     float dofFocalDistance;
     float dofFocalRange;
     
+    // Output resolution (window) and internal render resolution
+    int windowWidth;
+    int windowHeight;
+    int renderWidth;
+    int renderHeight;
+    GLuint outputFramebuffer;   // Final image target (0 = window, or a headless framebuffer)
+    
+    // Dynamic resolution settings
+    bool enableDynamicResolution;
+    float renderScale;
+    float minRenderScale;
+    float targetFrameTime;
+    float sharpness;
+    float gpuFrameTime;
+    int scaleCooldown;
+    
+    // Projected-size multiplier for mesh LOD selection (> 1 keeps detail further out)
+    float lodBias;
+    
     // Framebuffers
     GLuint gBuffer;
     GLuint gPosition;
@@ -39,6 +78,7 @@ typedef struct {
     GLuint ssaoBlurBuffer;
     GLuint hdrBuffer;
     GLuint pingpongBuffers[2];
+    GLuint postBuffer;
     
     // Render targets
     GLuint depthRenderBuffer;
@@ -47,12 +87,14 @@ typedef struct {
     GLuint ssaoBlurColorBuffer;
     GLuint hdrColorBuffer;
     GLuint pingpongColorBuffers[2];
+    GLuint postColorBuffer;
     
     // Shaders
     GLuint gBufferShader;
     GLuint lightingShader;
     GLuint ssaoShader;
-    GLuint ssaoBlurShader;
+    GLuint ssaoTemporalShader;
+    GLuint ssaoUpsampleShader;
     GLuint shadowMapShader;
     GLuint skyboxShader;
     GLuint terrainShader;
@@ -63,6 +105,7 @@ typedef struct {
     GLuint postProcessShader;
     GLuint blurShader;
     GLuint compositShader;
+    GLuint upscaleShader;
     
     // Screen-space quad
     GLuint quadVAO;
@@ -72,6 +115,55 @@ typedef struct {
     GLuint ssaoKernelSize;
     vec3* ssaoKernel;
     GLuint ssaoNoiseTexture;
+    
+    // SSAO quality and temporal accumulation
+    SSAOQuality ssaoQuality;
+    int ssaoDivisor;
+    int ssaoWidth;
+    int ssaoHeight;
+    unsigned int ssaoSamplesPerFrame;
+    bool ssaoTemporal;
+    bool ssaoHistoryValid;
+    unsigned int ssaoFrame;
+    GLuint ssaoHistoryBuffers[2];
+    GLuint ssaoHistoryColorBuffers[2];
+    mat4 prevViewProjection;
+    float ssaoHistoryUvScale[2];    // Render region the history was written at (dynamic resolution)
+    
+    // Sorted draw submission for the shadow and geometry passes
+    RenderQueue* renderQueue;
+    
+    // CPU culling: shared workers, software occlusion buffer, per-instance culling
+    ThreadPool* threadPool;
+    OcclusionCuller* occlusionCuller;
+    OcclusionMesh* terrainOccluder;
+    InstanceCuller* instanceCuller;
+    
+    // Scene-wide BVH: frustum culling of whole objects, and picking
+    SceneBvh* sceneBvh;
+    unsigned int frustumFrame;
+    Object* pickedObject;
+    size_t pickedInstance;
+    
+    // Baked billboards for distant trees and structures
+    ImpostorSystem* impostors;
+    
+    // Chunked grass around the camera
+    GrassSystem* grass;
+    
+    // Wind around the camera, shared by vegetation, particles and objects; vertex shaders
+    // read it from the texture
+    WindField* windField;
+    GLuint windTexture;
+    
+    // Precomputed sky: the sky pass reads transmittance and the sky view, which is rebuilt a
+    // few rows per frame when the sun has moved
+    Atmosphere* atmosphere;
+    GLuint transmittanceTexture;
+    GLuint skyViewTexture;
+    
+    // Background texture decoding with budgeted uploads
+    TextureStreamer* textureStreamer;
 } Renderer;
 
 // Function prototypes
@@ -79,21 +171,28 @@ void renderer_init(Renderer* renderer);
 void renderer_cleanup(Renderer* renderer);
 void renderer_render(Renderer* renderer, SceneManager* scene, Camera* camera, float timeOfDay, WeatherType weather);
 void renderer_setupFramebuffers(Renderer* renderer);
+void renderer_destroyFramebuffers(Renderer* renderer);
+void renderer_resize(Renderer* renderer, int width, int height);
+void renderer_setRenderScale(Renderer* renderer, float scale);
+void renderer_updateDynamicResolution(Renderer* renderer);
+void renderer_setScreenUniforms(Renderer* renderer, GLuint shader);
 void renderer_setupShaders(Renderer* renderer);
 void renderer_setupQuad(Renderer* renderer);
 void renderer_setupSSAO(Renderer* renderer);
+void renderer_setupSSAOFramebuffers(Renderer* renderer);
+void renderer_destroySSAOFramebuffers(Renderer* renderer);
+void renderer_setSSAOQuality(Renderer* renderer, SSAOQuality quality);
 void renderer_renderShadowMaps(Renderer* renderer, SceneManager* scene);
 void renderer_geometryPass(Renderer* renderer, SceneManager* scene, Camera* camera);
 void renderer_ssaoPass(Renderer* renderer, Camera* camera);
 void renderer_lightingPass(Renderer* renderer, SceneManager* scene, Camera* camera, float timeOfDay);
 void renderer_transparencyPass(Renderer* renderer, SceneManager* scene, Camera* camera, float timeOfDay);
 void renderer_postProcessPass(Renderer* renderer);
+void renderer_upscalePass(Renderer* renderer);
 void renderer_renderScene(Renderer* renderer, SceneManager* scene, Camera* camera, bool depthOnly);
 void renderer_renderTerrain(Renderer* renderer, Terrain* terrain, Camera* camera, bool depthOnly);
 void renderer_renderWater(Renderer* renderer, Water* water, Camera* camera);
 void renderer_renderSkybox(Renderer* renderer, Skybox* skybox, Camera* camera);
-void renderer_renderObject(Renderer* renderer, Object* object, Camera* camera, bool depthOnly);
-void renderer_renderInstancedObjects(Renderer* renderer, Object* objects, size_t count, Camera* camera, bool depthOnly);
 void renderer_renderParticles(Renderer* renderer, ParticleSystem* particles, Camera* camera);
 void renderer_pick(Renderer* renderer, SceneManager* scene, Camera* camera, int x, int y);
 
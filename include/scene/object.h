@@ -6,6 +6,19 @@
 // Forward declarations
 typedef struct Mesh Mesh;
 typedef struct Material Material;
+typedef struct ImpostorAtlas ImpostorAtlas;
+
+// Surface material (matches the gbuffer shader inputs; 0 = no map)
+struct Material {
+    GLuint diffuseMap;
+    GLuint normalMap;
+    GLuint roughnessMap;
+    GLuint metallicMap;
+    GLuint aoMap;
+    float roughness;
+    float metallic;
+    float ao;
+};
 
 // Light types
 typedef enum {
@@ -38,7 +51,7 @@ typedef struct {
 } Transform;
 
 // Object structure
-typedef struct {
+typedef struct Object {
     char* name;
     Transform transform;
     Mesh* mesh;
@@ -51,6 +64,20 @@ typedef struct {
     size_t instanceCount;
     Transform* instances;
     GLuint instanceBuffer;
+    size_t visibleInstanceCount;    // Instances in instanceBuffer after culling
+    size_t visibleLodCounts[MESH_MAX_LODS];     // Of those, per mesh level, in buffer order
+    
+    // Every instance, unculled, for shadow passes (owned by the instance culler): the camera's
+    // culling says nothing about what casts shadows into the view
+    GLuint shadowInstanceBuffer;
+    size_t shadowInstanceCount;
+    
+    // Distant LOD: baked atlas shared by objects with the same mesh and material
+    ImpostorAtlas* impostor;
+    float impostorDistance;         // Mesh starts fading to the impostor here (0 = never)
+    
+    // Frame the scene BVH last found the object in the camera frustum (non-instanced objects)
+    unsigned int frustumFrame;
     
     // Animation data
     bool isAnimated;
@@ -0,0 +1,69 @@
+#ifndef SCENE_BVH_H
+#define SCENE_BVH_H
+
+#include "wonderlands.h"
+#include "scene/object.h"
+#include "utils/bvh.h"
+
+// Scene BVH configuration
+#define SCENE_BVH_CLUSTER_SIZE 64           // Instances per leaf item, in Morton order
+#define SCENE_BVH_DEFAULT_RADIUS 1.0f       // Used when the mesh has no bounding radius
+#define SCENE_BVH_REBUILD_GROWTH 1.5f       // Rebuild once refits have grown the summed node area this much
+#define SCENE_BVH_NO_INSTANCE ((size_t)-1)
+
+// One BVH primitive: a whole object, or a cluster of an instanced object's instances
+typedef struct {
+    Object* object;
+    uint32_t first;             // Into instanceOrder (clusters only)
+    uint32_t count;             // Instances in the cluster, 0 for a whole object
+} SceneBvhItem;
+
+// Query result: an object, and which of its instances for instanced objects
+typedef struct {
+    Object* object;
+    size_t instance;            // SCENE_BVH_NO_INSTANCE for whole objects
+    float distance;             // Along the ray (ray casts only)
+} SceneBvhHit;
+
+// BVH over every visible object and instance cluster of the scene. Objects are gathered
+// each frame; the tree is rebuilt when the set changes and refit for non-static objects.
+typedef struct SceneBvh {
+    Bvh bvh;
+    
+    // Objects gathered since sceneBvh_begin
+    Object** objects;
+    size_t objectCount;
+    size_t objectCapacity;
+    uint64_t signature;         // Of the gathered set; a change forces a rebuild
+    bool hasDynamic;            // Some gathered object is not static
+    
+    // Items of the last build (BVH primitive i is items[i])
+    SceneBvhItem* items;
+    uint32_t itemCount;
+    uint32_t itemCapacity;
+    uint32_t* instanceOrder;    // Per instanced object, its instance indices in Morton order
+    uint32_t instanceCount;
+    uint32_t instanceCapacity;
+    uint64_t builtSignature;
+    
+    // Query output
+    uint32_t* results;
+    size_t resultCapacity;
+    
+    // Last update (ms) and what it did
+    double buildTime;
+    double refitTime;
+    bool rebuilt;
+} SceneBvh;
+
+// Function prototypes
+void sceneBvh_init(SceneBvh* sceneBvh);
+void sceneBvh_cleanup(SceneBvh* sceneBvh);
+void sceneBvh_begin(SceneBvh* sceneBvh);
+void sceneBvh_addObjects(SceneBvh* sceneBvh, Object* objects, size_t count);
+void sceneBvh_end(SceneBvh* sceneBvh);
+size_t sceneBvh_queryFrustum(SceneBvh* sceneBvh, const float* viewProjection, const uint32_t** items);
+size_t sceneBvh_querySphere(SceneBvh* sceneBvh, const float* center, float radius, SceneBvhHit* hits, size_t maxHits);
+bool sceneBvh_raycast(SceneBvh* sceneBvh, const float* origin, const float* direction, float maxDistance, SceneBvhHit* hit);
+
+#endif // SCENE_BVH_H
@@ -7,6 +7,11 @@
 #include "rendering/water.h"
 #include "rendering/skybox.h"
 #include "rendering/particles.h"
+#include <stdint.h>
+
+// Forward declarations
+typedef struct ThreadPool ThreadPool;
+typedef struct WindField WindField;
 
 // Weather types
 typedef enum {
@@ -15,6 +20,55 @@ typedef enum {
     WEATHER_FOG
 } WeatherType;
 
+// Parts of the scene advanced by sceneManager_updateJobs
+#define SCENE_UPDATE_WEATHER     (1u << 0)
+#define SCENE_UPDATE_WIND        (1u << 1)
+#define SCENE_UPDATE_LIGHTS      (1u << 2)
+#define SCENE_UPDATE_PARTICLES   (1u << 3)
+#define SCENE_UPDATE_TERRAIN_LOD (1u << 4)
+#define SCENE_UPDATE_ALL         0x1fu
+
+// Inputs shared by the jobs of one scene update
+typedef struct {
+    float deltaTime;
+    float timeOfDay;
+    WeatherType weather;
+    vec3 cameraPosition;        // Particles and terrain LOD
+    unsigned int parts;         // SCENE_UPDATE_* bits
+    const WindField* windField; // Local wind for particles (NULL: the scene's mean wind)
+} SceneUpdate;
+
+// Scene parts whose updates are change-driven
+typedef enum {
+    SCENE_PART_WEATHER,
+    SCENE_PART_LIGHTS,
+    SCENE_PART_COUNT
+} ScenePart;
+
+// Change tracking for sceneManager_updateJobs. A part is recomputed only when its inputs
+// have moved on since it last ran, and each recompute bumps the part's version, so
+// consumers (snapshots and the render copy) redo their work only when it changes.
+typedef struct {
+    bool valid;                 // False until the first update has run every part
+    
+    // Weather runs as a timed transition after the requested weather changes
+    WeatherType weather;        // Target of the current or last transition
+    float transitionLeft;       // Seconds
+    uint32_t weatherVersion;
+    
+    // Lights, and the inputs they were last computed from
+    uint32_t lightsVersion;
+    float lightsTimeOfDay;
+    uint32_t lightsWeatherVersion;
+    uint32_t lightsLanternVersion;
+    uint32_t lanternVersion;    // Bumped by sceneManager_lanternsChanged
+    uint64_t lanternSignature;  // Lantern set and switches the lights job last saw
+    
+    // Since start
+    uint64_t recomputed[SCENE_PART_COUNT];
+    uint64_t skipped[SCENE_PART_COUNT];
+} SceneChanges;
+
 // Structure to manage the scene
 typedef struct {
     // Scene components
@@ -56,6 +110,9 @@ typedef struct {
     // Physics settings
     float windStrength;
     float windDirection;
+    
+    // What the last updates recomputed
+    SceneChanges changes;
 } SceneManager;
 
 // Function prototypes
@@ -70,5 +127,7 @@ void sceneManager_setupLights(SceneManager* scene);
 void sceneManager_updateWeather(SceneManager* scene, float deltaTime, WeatherType weather);
 void sceneManager_updateLights(SceneManager* scene, float timeOfDay);
 void sceneManager_updateWind(SceneManager* scene, float deltaTime);
+void sceneManager_updateJobs(SceneManager* scene, ThreadPool* pool, const SceneUpdate* update);
+void sceneManager_lanternsChanged(SceneManager* scene);
 
 #endif // SCENE_MANAGER_H 
\ No newline at end of file
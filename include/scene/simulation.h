@@ -0,0 +1,133 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "wonderlands.h"
+#include "scene/scene_manager.h"
+#include "scene/transform_store.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+// Slots in the snapshot triple buffer
+#define SIMULATION_SNAPSHOT_SLOTS 3
+
+// Interpolated per-object state (non-static, non-instanced objects only)
+typedef struct {
+    vec3 position;
+    vec3 rotation;
+    vec3 scale;
+    float animationTime;
+    float windFactor;
+} SimulationObjectState;
+
+// Per-light state driven by time of day and weather
+typedef struct {
+    vec3 position;
+    vec3 direction;
+    vec3 color;
+    float intensity;
+} SimulationLightState;
+
+// Render-relevant scene state captured after one tick
+typedef struct {
+    uint64_t tick;
+    double simTime;             // Seconds since the simulation started (tick * step)
+    double publishTime;         // profiler_now() when published, in ms
+    float timeOfDay;
+    WeatherType weather;
+    float weatherIntensity;
+    float windStrength;
+    float windDirection;
+    SimulationObjectState* objects;
+    SimulationLightState* lights;
+    uint32_t lightsVersion;     // SceneChanges.lightsVersion when captured
+    uint64_t partsRecomputed[SCENE_PART_COUNT];
+    uint64_t partsSkipped[SCENE_PART_COUNT];
+} SimulationState;
+
+// The two most recent ticks, published together so the renderer can interpolate between them
+typedef struct {
+    SimulationState previous;
+    SimulationState current;
+} SimulationSnapshot;
+
+// Rates and latency, measured over roughly one-second windows
+typedef struct {
+    float tickRate;             // Simulation ticks per second
+    float renderRate;           // Frames per second
+    float snapshotLatency;      // Age of the newest snapshot when the renderer picked it up (ms)
+    float tickTime;             // CPU time per tick (ms)
+    uint64_t skippedTicks;      // Ticks dropped after falling too far behind
+    
+    // Model matrices of the interpolated objects, last frame
+    size_t transformsComposed;
+    size_t transformsSkipped;   // Unchanged since the previous frame
+    float composeTime;          // ms
+    
+    // Change-driven scene parts: ticks that recomputed and skipped each, over the last window
+    uint64_t partsRecomputed[SCENE_PART_COUNT];
+    uint64_t partsSkipped[SCENE_PART_COUNT];
+    bool lightsInterpolated;    // The render copy's lights were rewritten last frame
+} SimulationStats;
+
+// Fixed-timestep simulation thread. It owns the SceneManager passed to simulation_init and
+// advances it with sceneManager_updateJobs on the shared thread pool; the renderer draws renderScene, a copy whose object and
+// light arrays are written only from interpolated snapshots. Particles follow the camera and
+// upload every frame, so they move to renderScene and are advanced on the render thread.
+typedef struct Simulation {
+    SceneManager* scene;
+    SceneManager renderScene;
+    float step;                 // Seconds per tick
+    ThreadPool* pool;           // Shared with the renderer, set by simulation_start
+    
+    // Objects whose transforms are interpolated: simulated copy -> render copy
+    Object** sourceObjects;
+    Object** renderObjects;
+    size_t objectCount;
+    TransformStore transforms;  // One per interpolated object, writing its render copy's modelMatrix
+    uint32_t lightsVersion;     // Version the render copy's lights were last interpolated from
+    
+    // Lock-free triple buffer: the writer owns backSlot, the reader frontSlot, and the
+    // third index is exchanged through middleSlot (bit 2 set when it holds an unread snapshot)
+    SimulationSnapshot slots[SIMULATION_SNAPSHOT_SLOTS];
+    atomic_uint middleSlot;
+    unsigned int backSlot;
+    unsigned int frontSlot;
+    SimulationState lastState;  // Writer's copy of the previous tick
+    
+    // Controls, set by the render thread and read once per tick
+    _Atomic float timeScale;    // Day-cycle speed multiplier (0 = paused)
+    atomic_int weather;
+    
+    // Thread
+    pthread_t thread;
+    atomic_bool running;
+    bool started;
+    double startTime;           // profiler_now() at tick 0
+    
+    // Counters (written by the simulation thread)
+    atomic_uint_fast64_t ticks;
+    atomic_uint_fast64_t skippedTicks;
+    atomic_uint_fast64_t tickTimeMicros;
+    
+    // Render-thread measurement windows
+    SimulationStats stats;
+    double windowStart;
+    uint64_t windowTicks;
+    uint64_t windowTickTime;
+    unsigned int windowFrames;
+    double windowLatency;
+    uint64_t windowRecomputed[SCENE_PART_COUNT];
+    uint64_t windowSkipped[SCENE_PART_COUNT];
+} Simulation;
+
+// Function prototypes
+bool simulation_init(Simulation* simulation, SceneManager* scene, float tickRate);
+void simulation_start(Simulation* simulation, ThreadPool* pool);
+void simulation_stop(Simulation* simulation);
+void simulation_cleanup(Simulation* simulation);
+void simulation_setControls(Simulation* simulation, float timeScale, WeatherType weather);
+float simulation_interpolate(Simulation* simulation, float* timeOfDay, WeatherType* weather);
+const SimulationStats* simulation_getStats(const Simulation* simulation);
+
+#endif // SIMULATION_H
@@ -0,0 +1,66 @@
+#ifndef TRANSFORM_STORE_H
+#define TRANSFORM_STORE_H
+
+// No GL includes: the store only fills float matrices, so tools can link it
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Forward declarations
+typedef struct ThreadPool ThreadPool;
+
+// Transform store configuration
+#define TRANSFORM_STORE_LANES 4             // Transforms composed per SIMD batch
+#define TRANSFORM_STORE_GRAIN 512           // Dirty transforms per worker task (a multiple of the lanes)
+#define TRANSFORM_STORE_PARALLEL_THRESHOLD (TRANSFORM_STORE_GRAIN * 2)
+#define TRANSFORM_STORE_INVALID UINT32_MAX
+
+// Per-transform flags
+#define TRANSFORM_STORE_STATIC (1u << 0)    // Composed once when added, then only on an explicit set
+#define TRANSFORM_STORE_DIRTY  (1u << 1)    // In the dirty list, composed by the next transformStore_compose
+
+// Transforms kept as structure-of-arrays, so dirty ones can be composed four at a time.
+// model = T * Ry * Rx * Rz * S with the rotation in degrees (x = pitch, y = yaw, z = roll),
+// column-major like Transform.modelMatrix. Each transform may also name a target matrix
+// (an object's modelMatrix, or a slot of an instance array) that receives a copy.
+typedef struct {
+    size_t count;
+    size_t capacity;
+    
+    // Inputs
+    float* positionX;
+    float* positionY;
+    float* positionZ;
+    float* rotationX;
+    float* rotationY;
+    float* rotationZ;
+    float* scaleX;
+    float* scaleY;
+    float* scaleZ;
+    uint8_t* flags;
+    
+    // Outputs: 16 floats per transform, plus the optional extra destination
+    float* matrices;
+    float** targets;
+    
+    // Transforms changed since the last compose
+    uint32_t* dirty;
+    size_t dirtyCount;
+    
+    // Last compose
+    size_t composed;
+    size_t skipped;             // Clean transforms that were not recomputed
+    double composeTime;         // ms
+} TransformStore;
+
+// Function prototypes
+bool transformStore_init(TransformStore* store, size_t capacity);
+void transformStore_cleanup(TransformStore* store);
+uint32_t transformStore_add(TransformStore* store, const float* position, const float* rotation, const float* scale,
+                            bool isStatic, float* target);
+void transformStore_set(TransformStore* store, uint32_t index, const float* position, const float* rotation, const float* scale);
+void transformStore_compose(TransformStore* store, ThreadPool* pool);
+const float* transformStore_getMatrix(const TransformStore* store, uint32_t index);
+void transform_compose(const float* position, const float* rotation, const float* scale, float* matrix);
+
+#endif // TRANSFORM_STORE_H
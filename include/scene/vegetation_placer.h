@@ -0,0 +1,103 @@
+#ifndef VEGETATION_PLACER_H
+#define VEGETATION_PLACER_H
+
+// No GL or terrain includes: terrain is read through a sampler callback, so the placer
+// also runs in tools against synthetic terrain
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Forward declarations
+typedef struct ThreadPool ThreadPool;
+
+// Placement configuration
+#define VEGETATION_MAX_BIOMES 8
+#define VEGETATION_MAX_VARIANTS 16
+#define VEGETATION_TILES_PER_SIDE 32        // Upper bound; tiles never get smaller than VEGETATION_MIN_TILE_CELLS
+#define VEGETATION_MIN_TILE_CELLS 5         // Grid cells per tile side, enough that same-phase tiles never share a neighbourhood
+#define VEGETATION_DARTS_PER_CELL 2         // Candidates thrown per grid cell
+
+// Height, slope (0 = flat, 1 = vertical) and biome index at a world position.
+// Called from worker threads, so it must only read.
+typedef void (*VegetationSampler)(void* context, float x, float z, float* height, float* slope, int* biome);
+
+// One placed plant
+typedef struct {
+    float position[3];
+    float yaw;                  // Degrees
+    float scale;
+    uint32_t priority;          // Random; the lowest ones survive thinning
+    uint8_t variant;            // Which of the layer's variants (e.g. meshes) it uses
+} VegetationPoint;
+
+// Receives the kept points: index counts from 0 within each variant. Called from worker
+// threads with distinct indices.
+typedef void (*VegetationWriter)(void* context, int variant, size_t index, const VegetationPoint* point);
+
+// Rules for one kind of plant
+typedef struct {
+    const char* name;
+    uint32_t seed;                              // World seed
+    uint32_t layer;                             // Mixed into the seed so layers differ
+    float minDistance;                          // Poisson-disk radius
+    size_t maxCount;                            // Thinned down to this many (0 = no limit)
+    float biomeDensity[VEGETATION_MAX_BIOMES];  // Chance a candidate survives in each biome
+    float minHeight;
+    float maxHeight;
+    float maxSlope;
+    float minScale;
+    float maxScale;
+    int variantCount;                           // 1..VEGETATION_MAX_VARIANTS
+} VegetationLayer;
+
+// Points of one tile (slots are laid out tile after tile)
+typedef struct {
+    uint32_t count;
+    uint32_t candidates;
+    uint32_t offsets[VEGETATION_MAX_VARIANTS];  // First output index per variant
+} VegetationTile;
+
+// Tile-parallel Poisson-disk placement. Tiles run in four phases of a 2x2 checkerboard:
+// tiles of one phase never touch, and each checks its candidates against the tiles of
+// earlier phases, so borders have no seams and the result does not depend on how many
+// threads ran the tiles.
+typedef struct {
+    const VegetationLayer* layer;
+    VegetationSampler sampler;
+    void* samplerContext;
+    
+    // Area
+    float minX;
+    float minZ;
+    float size;
+    
+    // Acceleration grid: one point at most per cell (cell size = radius / sqrt(2))
+    float cellSize;
+    int cellsPerSide;
+    int cellsPerTile;
+    int tilesPerSide;
+    uint32_t* cells;            // Slot + 1, 0 = empty
+    
+    // Points
+    VegetationTile* tiles;
+    VegetationPoint* points;    // tileCapacity slots per tile
+    uint32_t tileCapacity;
+    uint64_t keepBelow;         // Points with priority below this survive thinning
+    int phase;
+    
+    // Results
+    size_t candidates;
+    size_t accepted;
+    size_t kept;
+    size_t variantCounts[VEGETATION_MAX_VARIANTS];
+    double placeTime;           // ms
+    double writeTime;
+} VegetationPlacer;
+
+// Function prototypes
+bool vegetationPlacer_run(VegetationPlacer* placer, const VegetationLayer* layer, float minX, float minZ, float size,
+                          VegetationSampler sampler, void* samplerContext, ThreadPool* pool);
+void vegetationPlacer_write(VegetationPlacer* placer, VegetationWriter writer, void* context, ThreadPool* pool);
+void vegetationPlacer_cleanup(VegetationPlacer* placer);
+
+#endif // VEGETATION_PLACER_H
@@ -0,0 +1,65 @@
+#ifndef WIND_FIELD_H
+#define WIND_FIELD_H
+
+// No GL includes: the renderer uploads cells as a texture, tools link the CPU side alone
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Forward declarations
+typedef struct ThreadPool ThreadPool;
+
+// Batches larger than this are split across the pool
+#define WIND_FIELD_BATCH_GRAIN 4096
+
+// Velocity of a coupled fluid at a world position (x, z), in world units per second.
+// Called from the thread that runs windField_update.
+typedef void (*WindFieldFluidSampler)(void* context, float x, float z, float* velocityX, float* velocityZ);
+
+// Spatially varying wind. Gusts are frozen noise carried along by the mean wind, so the
+// cells only change where the window around the camera scrolls over new noise: each update
+// computes just the newly exposed rows and columns. Cells are stored ring-addressed in
+// noise space, which is also how the texture is sampled (with GL_REPEAT), so the upload
+// needs no reshuffling. Each cell holds four floats: gust along and across the mean wind
+// (relative to its strength) and the coupled fluid velocity (x, z).
+typedef struct WindField {
+    int size;                   // Cells per side (power of two)
+    float cellSize;
+    uint32_t seed;
+    float* cells;               // 4 floats per cell, ring-addressed
+    
+    // Window of noise-space cells that is filled in
+    int originX;
+    int originZ;
+    bool valid;
+    
+    // Mean wind and how far it has carried the noise (world = noise + scroll)
+    float windX;
+    float windZ;
+    double scroll[2];
+    double time;
+    
+    // Optional fluid coupling, refreshed a few rows per update
+    WindFieldFluidSampler fluidSampler;
+    void* fluidContext;
+    float fluidCoupling;
+    int fluidRow;
+    
+    // Set when cells changed since the renderer last uploaded them
+    bool dirty;
+    
+    // Last update
+    size_t cellsUpdated;
+    double updateTime;          // ms
+} WindField;
+
+// Function prototypes
+bool windField_init(WindField* field, int size, float cellSize, uint32_t seed);
+void windField_cleanup(WindField* field);
+void windField_setFluid(WindField* field, WindFieldFluidSampler sampler, void* context, float coupling);
+void windField_update(WindField* field, double time, const float* cameraPosition, float strength, float direction);
+void windField_sample(const WindField* field, float x, float z, float* windX, float* windZ);
+void windField_sampleBatch(const WindField* field, const float* positions, size_t stride, size_t count, float* velocities, ThreadPool* pool);
+void windField_getTextureTransform(const WindField* field, float* transform);
+
+#endif // WIND_FIELD_H
@@ -0,0 +1,29 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include "wonderlands.h"
+
+// Camera path and capture limits
+#define BENCHMARK_MAX_CAPTURES 64
+#define BENCHMARK_GPU_QUERY_LATENCY 4
+
+// Headless benchmark run: a fixed camera path rendered for a scripted number of frames
+typedef struct {
+    bool enabled;               // --headless was given
+    int width;
+    int height;
+    int frames;
+    int warmupFrames;           // Rendered but not recorded
+    float timeOfDay;
+    bool dynamicResolution;     // Off by default so every run renders the same pixels
+    const char* csvPath;
+    const char* captureDir;
+    int captureFrames[BENCHMARK_MAX_CAPTURES];
+    int captureCount;
+} BenchmarkConfig;
+
+// Function prototypes
+bool benchmark_parseArgs(int argc, char** argv, BenchmarkConfig* config);
+int benchmark_run(const BenchmarkConfig* config);
+
+#endif // BENCHMARK_H
@@ -0,0 +1,65 @@
+#ifndef BVH_H
+#define BVH_H
+
+// Kept free of GL includes so it can be built and benchmarked headless
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Build configuration
+#define BVH_SAH_BINS 16
+#define BVH_MAX_LEAF_SIZE 4
+#define BVH_STACK_SIZE 64               // Traversal depth limit (the builder stops splitting before it)
+
+// Axis-aligned box
+typedef struct {
+    float min[3];
+    float max[3];
+} BvhBox;
+
+// Tree node: a leaf holds order[first .. first + count), an inner node (count 0)
+// has its children at nodes[first] and nodes[first + 1]
+typedef struct {
+    BvhBox box;
+    uint32_t first;
+    uint32_t count;
+} BvhNode;
+
+// Build copy of a primitive box, reordered as nodes are split
+typedef struct {
+    BvhBox box;
+    float centroid[3];
+    uint32_t index;
+} BvhReference;
+
+// Bounding volume hierarchy over caller-owned primitive boxes. Children are always
+// stored after their parent, so walking the nodes backwards refits bottom-up.
+typedef struct {
+    BvhNode* nodes;
+    uint32_t nodeCount;
+    uint32_t* order;            // Leaf slots -> primitive index
+    BvhBox* boxes;              // Per primitive, updated by the caller before a refit
+    BvhReference* references;   // Build scratch
+    uint32_t count;
+    uint32_t capacity;
+    int depth;                  // Deepest level of the last build
+    float buildArea;            // Summed node surface area right after the last build
+    float area;                 // The same after the last build or refit (grows as refits loosen the tree)
+} Bvh;
+
+// Exact intersection of a ray with primitive index; returns the hit distance, or a
+// negative value for a miss. Called only for primitives whose box the ray enters before maxT.
+typedef float (*BvhRayTest)(void* context, uint32_t index, const float* origin, const float* direction, float maxT);
+
+// Function prototypes
+bool bvh_init(Bvh* bvh, uint32_t capacity);
+void bvh_cleanup(Bvh* bvh);
+void bvh_build(Bvh* bvh, uint32_t count);
+void bvh_refit(Bvh* bvh);
+void bvh_frustumFromMatrix(const float* viewProjection, float planes[6][4]);
+size_t bvh_queryFrustum(const Bvh* bvh, const float planes[6][4], uint32_t* results, size_t maxResults);
+size_t bvh_querySphere(const Bvh* bvh, const float* center, float radius, uint32_t* results, size_t maxResults);
+float bvh_raycast(const Bvh* bvh, const float* origin, const float* direction, float maxT,
+                  BvhRayTest test, void* context, uint32_t* hitIndex);
+
+#endif // BVH_H
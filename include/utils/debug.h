@@ -17,6 +17,7 @@ void debug_log(DebugMessageType type, const char* message);
 void debug_logf(DebugMessageType type, const char* format, ...);
 void debug_showImGuiWindow(bool* show);
 void debug_renderOverlay();
+void debug_toggleProfiler();
 void debug_checkGLError(const char* operation);
 
 #endif // DEBUG_H 
\ No newline at end of file
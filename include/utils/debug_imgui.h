@@ -0,0 +1,21 @@
+#ifndef DEBUG_IMGUI_H
+#define DEBUG_IMGUI_H
+
+// C entry points into the Dear ImGui debug UI (src/utils/debug_imgui.cpp).
+// Only available when external/imgui contains the ImGui sources.
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Function prototypes
+void debugImGui_init();
+void debugImGui_shutdown();
+void debugImGui_render(bool* showProfiler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DEBUG_IMGUI_H
@@ -0,0 +1,25 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include "wonderlands.h"
+
+// Offscreen GL 4.1 core context plus the framebuffer frames are rendered into.
+// The backend is chosen at build time: EGL (surfaceless, falling back to a pbuffer)
+// or OSMesa; both run on llvmpipe without a display or GPU.
+typedef struct {
+    int width;
+    int height;
+    const char* backend;
+
+    // Stands in for the window's default framebuffer
+    GLuint framebuffer;
+    GLuint colorBuffer;
+    GLuint depthBuffer;
+} HeadlessContext;
+
+// Function prototypes
+bool headless_init(HeadlessContext* context, int width, int height);
+void headless_cleanup(HeadlessContext* context);
+bool headless_readPixels(HeadlessContext* context, unsigned char* pixels);
+
+#endif // HEADLESS_H
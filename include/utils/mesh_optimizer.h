@@ -0,0 +1,69 @@
+#ifndef MESH_OPTIMIZER_H
+#define MESH_OPTIMIZER_H
+
+#include "utils/model_loader.h"
+#include <stdint.h>
+
+// Post-transform cache the index order is optimized for (Forsyth), and the FIFO size ACMR is measured with
+#define MESH_OPTIMIZER_CACHE_SIZE 32
+#define MESH_OPTIMIZER_ACMR_CACHE_SIZE 16
+
+// Overdraw pass: ACMR a cluster may give up (relative) so it can be split and drawn out of order
+#define MESH_OPTIMIZER_OVERDRAW_THRESHOLD 1.05f
+
+// Simplifier weights: attribute change per collapse, and the planes that pin open borders
+#define MESH_SIMPLIFY_ATTRIBUTE_WEIGHT 0.01
+#define MESH_SIMPLIFY_BORDER_WEIGHT 10.0
+
+// Quantized vertex: half-float position and UV, signed normalized 10_10_10_2 normal and tangent
+// (20 bytes instead of 44; attribute locations match MeshVertex)
+typedef struct {
+    uint16_t position[4];       // w = 1, padding to keep the normal 4-byte aligned
+    uint32_t normal;
+    uint32_t tangent;
+    uint16_t texCoords[2];
+} QuantizedVertex;
+
+// Before/after numbers for one mesh
+typedef struct {
+    float acmrBefore;           // Vertex shader invocations per triangle
+    float acmrAfter;
+    size_t vertexBytesBefore;
+    size_t vertexBytesAfter;
+} MeshOptimizeStats;
+
+// Function prototypes
+void meshOptimizer_optimizeVertexCache(uint32_t* indices, uint32_t numIndices, uint32_t numVertices);
+void meshOptimizer_optimizeOverdraw(uint32_t* indices, uint32_t numIndices, const MeshVertex* vertices, uint32_t numVertices, float threshold);
+uint32_t meshOptimizer_optimizeVertexFetch(MeshVertex* vertices, uint32_t* indices, uint32_t numIndices, uint32_t numVertices);
+float meshOptimizer_computeACMR(const uint32_t* indices, uint32_t numIndices, uint32_t numVertices, int cacheSize);
+uint32_t meshOptimizer_simplify(const MeshVertex* vertices, uint32_t numVertices, const uint32_t* indices, uint32_t numIndices,
+                                uint32_t targetIndices, float maxError, uint32_t* output, float* resultError);
+void meshOptimizer_quantize(const MeshVertex* vertices, uint32_t numVertices, QuantizedVertex* quantized);
+
+// IEEE half-precision conversion (round to nearest, no denormals)
+static inline uint16_t meshOptimizer_floatToHalf(float value) {
+    union { float f; uint32_t u; } bits = { value };
+    uint32_t sign = (bits.u >> 16) & 0x8000u;
+    int32_t exponent = (int32_t)((bits.u >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits.u & 0x7FFFFFu;
+    
+    if (exponent <= 0) return (uint16_t)sign;
+    if (exponent >= 31) return (uint16_t)(sign | 0x7BFFu);     // Clamp to the largest finite half
+    
+    uint32_t half = sign | ((uint32_t)exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000u) half++;                             // Carries into the exponent correctly
+    if ((half & 0x7FFFu) == 0x7C00u) half--;                    // Rounded up to infinity
+    return (uint16_t)half;
+}
+
+static inline float meshOptimizer_halfToFloat(uint16_t half) {
+    uint32_t sign = (uint32_t)(half & 0x8000u) << 16;
+    uint32_t exponent = (half >> 10) & 0x1Fu;
+    uint32_t mantissa = half & 0x3FFu;
+    union { uint32_t u; float f; } bits;
+    bits.u = exponent == 0 ? sign : sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    return bits.f;
+}
+
+#endif // MESH_OPTIMIZER_H
@@ -2,17 +2,69 @@
 #define MODEL_LOADER_H
 
 #include "wonderlands.h"
+#include <stdint.h>
+
+// Binary mesh cache (cache/meshes): header, one entry per mesh, then 16-byte aligned
+// interleaved vertices and 32-bit indices, laid out so the file can be mapped and uploaded as is
+#define MESH_CACHE_MAGIC 0x48534D57u    // "WMSH"
+#define MESH_CACHE_VERSION 5
+#define MESH_CACHE_ALIGNMENT 16
+
+// Levels of detail per mesh, including the full mesh
+#define MESH_MAX_LODS 4
+
+// Per-mesh attribute flags
+#define MESH_CACHE_NORMALS 0x1u
+#define MESH_CACHE_TEXCOORDS 0x2u
+#define MESH_CACHE_TANGENTS 0x4u
+#define MESH_CACHE_QUANTIZED 0x8u      // Vertices use the QuantizedVertex layout (mesh_optimizer.h)
+
+// Interleaved full-precision vertex, as imported
+typedef struct {
+    float position[3];
+    float normal[3];
+    float texCoords[2];
+    float tangent[3];
+} MeshVertex;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t meshCount;
+    uint32_t reserved;
+    int64_t sourceTime;         // Modification time of the source when it was imported
+    uint64_t sourceSize;
+    uint64_t settingsKey;       // Hash of the LOD, reorder and quantization settings it was built with
+} MeshCacheHeader;
 
-// Mesh structure
 typedef struct {
+    uint64_t vertexOffset;      // From the start of the file
+    uint64_t indexOffset;
+    uint32_t numVertices;
+    uint32_t numIndices;        // All levels; level i follows level i - 1
+    uint32_t flags;
+    float boundingRadius;
+    uint32_t lodCount;
+    uint32_t lodIndexCounts[MESH_MAX_LODS];
+} MeshCacheEntry;
+
+// Mesh structure
+typedef struct Mesh {
     GLuint VAO;
     GLuint VBO;
     GLuint EBO;
     unsigned int numVertices;
-    unsigned int numIndices;
+    unsigned int numIndices;    // Full-detail level
     bool hasNormals;
     bool hasTexCoords;
     bool hasTangents;
+    bool quantized;         // Half-float/10_10_10_2 attributes instead of floats
+    float boundingRadius;   // Model-space bounding sphere about the origin (0 = unknown)
+    
+    // Simplified levels share the vertex buffer; each is a range of the index buffer
+    unsigned int lodCount;
+    unsigned int lodFirstIndex[MESH_MAX_LODS];
+    unsigned int lodIndexCount[MESH_MAX_LODS];
 } Mesh;
 
 // Model structure
@@ -28,5 +80,6 @@ Model* model_load(const char* path);
 void model_cleanup(Model* model);
 void model_render(Model* model, GLuint shader);
 void model_renderMesh(Mesh* mesh, GLuint shader);
+unsigned int model_selectLod(const Mesh* mesh, float screenSize);
 
 #endif // MODEL_LOADER_H 
\ No newline at end of file
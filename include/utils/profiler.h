@@ -0,0 +1,81 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Kept free of GL/GLM includes so the C++ ImGui overlay can include it too
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Profiler configuration
+#define PROFILER_MAX_SCOPES 64
+#define PROFILER_MAX_DEPTH 16
+#define PROFILER_HISTORY 256
+#define PROFILER_MAX_GPU_SCOPES 32
+#define PROFILER_GPU_LATENCY 2
+#define PROFILER_MAX_EVENTS 128
+#define PROFILER_TRACE_FRAMES 600
+#define PROFILER_MAX_COUNTERS 128     // Distinct counter names across all systems
+
+// Where a scope was measured
+typedef enum {
+    PROFILE_CPU,
+    PROFILE_GPU
+} ProfileDomain;
+
+// Rolling statistics for one named scope (all times in milliseconds)
+typedef struct {
+    const char* name;
+    ProfileDomain domain;
+    int depth;
+    
+    // Per-frame totals, ring buffer
+    float history[PROFILER_HISTORY];
+    int historyCount;
+    int historyIndex;
+    
+    // Derived statistics
+    float last;
+    float average;
+    float p95;
+    float max;
+} ProfileScopeStats;
+
+// Per-frame counter (draw calls, state changes, ...), summed over a frame
+typedef struct {
+    const char* name;
+    double value;
+    double frameValue;
+} ProfileCounter;
+
+// One timed scope instance, as recorded for trace export
+typedef struct {
+    short scope;
+    short depth;
+    double start;
+    double duration;
+} ProfileEvent;
+
+// Function prototypes
+void profiler_init();
+void profiler_cleanup();
+void profiler_beginFrame();
+void profiler_endFrame();
+void profiler_beginCPU(const char* name);
+void profiler_endCPU();
+void profiler_beginGPU(const char* name);
+void profiler_endGPU();
+const ProfileScopeStats* profiler_getStats(int* count);
+void profiler_addCounter(const char* name, double value);
+const ProfileCounter* profiler_getCounters(int* count);
+float profiler_getCPUFrameTime();
+float profiler_getGPUFrameTime();
+bool profiler_exportChromeTrace(const char* path);
+double profiler_now();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PROFILER_H
@@ -3,21 +3,81 @@
 
 #include "wonderlands.h"
 
+// Uniform block binding points shared by every program
+#define SHADER_FRAME_BINDING 0
+#define SHADER_OBJECT_BINDING 1
+
+// Per-object ring: objects per frame segment, and segments in flight
+#define SHADER_OBJECT_RING_CAPACITY 4096
+#define SHADER_OBJECT_RING_SEGMENTS 3
+
+// Most programs the uniform location cache tracks
+#define SHADER_MAX_PROGRAMS 64
+
 typedef struct {
     GLuint program;
     char* name;
 } Shader;
 
+// std140 layout of the FrameData uniform block (see gbuffer.vert)
+typedef struct {
+    float view[16];
+    float projection[16];
+    float viewProjection[16];
+    float viewPosition[4];
+    float frameTime[4];         // x = seconds since start, y = delta seconds
+} ShaderFrameData;
+
+// Driver calls issued through the shader helpers, per frame
+typedef struct {
+    unsigned int uniformUploads;
+    unsigned int locationQueries;
+    unsigned int locationCacheHits;
+    unsigned int programBinds;
+    unsigned int programBindsSkipped;
+    unsigned int bufferUpdates;
+    unsigned int bufferBinds;
+} ShaderStats;
+
+// One vertex/fragment program of a batch load
+typedef struct {
+    const char* vertexPath;
+    const char* fragmentPath;
+    GLuint* program;            // Receives the program, or 0 on failure
+} ShaderProgramDesc;
+
+// Outcome of a batch load (time in milliseconds)
+typedef struct {
+    int programs;
+    int cached;
+    int compiled;
+    int failed;
+    bool parallel;              // Driver compiled with KHR_parallel_shader_compile
+    double time;
+} ShaderLoadStats;
+
 // Function prototypes
+void shader_loadPrograms(const ShaderProgramDesc* descs, int count, ShaderLoadStats* loadStats);
 GLuint shader_load(const char* vertexPath, const char* fragmentPath);
 GLuint shader_loadWithGeometry(const char* vertexPath, const char* geometryPath, const char* fragmentPath);
 GLuint shader_loadCompute(const char* computePath);
+void shader_delete(GLuint program);
 void shader_use(GLuint program);
+GLint shader_getUniformLocation(GLuint program, const char* name);
 void shader_setInt(GLuint program, const char* name, int value);
 void shader_setFloat(GLuint program, const char* name, float value);
 void shader_setVec2(GLuint program, const char* name, float x, float y);
 void shader_setVec3(GLuint program, const char* name, float x, float y, float z);
 void shader_setVec4(GLuint program, const char* name, float x, float y, float z, float w);
 void shader_setMat4(GLuint program, const char* name, const float* value);
+void shader_initBuffers();
+void shader_cleanup();
+void shader_updateFrameData(const float* view, const float* projection, const float* viewPosition, float time);
+bool shader_reserveObjectData(size_t count);
+GLintptr shader_writeObjectData(const float* model);
+void shader_flushObjectData();
+void shader_bindObjectData(GLintptr offset);
+const ShaderStats* shader_getStats();
+void shader_reportCounters();
 
-#endif // SHADER_LOADER_H 
\ No newline at end of file
+#endif // SHADER_LOADER_H
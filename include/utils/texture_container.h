@@ -0,0 +1,54 @@
+#ifndef TEXTURE_CONTAINER_H
+#define TEXTURE_CONTAINER_H
+
+// Kept free of GL includes so the offline texture baker can share it
+#include <stdint.h>
+
+// Baked texture container (.wtex): header, level table, then 16-byte aligned level data
+#define TEXTURE_CONTAINER_MAGIC 0x58455457u    // "WTEX"
+#define TEXTURE_CONTAINER_VERSION 1
+#define TEXTURE_CONTAINER_ALIGNMENT 16
+#define TEXTURE_CONTAINER_MAX_LEVELS 16
+#define TEXTURE_CONTAINER_EXTENSION ".wtex"
+
+// Pixel encodings
+typedef enum {
+    TEXTURE_CONTAINER_RGBA8,    // Uncompressed fallback
+    TEXTURE_CONTAINER_BC1,      // RGB, 8 bytes per 4x4 block (S3TC DXT1)
+    TEXTURE_CONTAINER_BC3,      // RGBA, 16 bytes per 4x4 block (S3TC DXT5)
+    TEXTURE_CONTAINER_BC5,      // RG, 16 bytes per 4x4 block (RGTC2), for normal maps
+    TEXTURE_CONTAINER_FORMAT_COUNT
+} TextureContainerFormat;
+
+// Header flags
+#define TEXTURE_CONTAINER_SRGB 0x1u
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;
+    uint32_t flags;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levels;
+    uint32_t faces;             // 1, or 6 for a cubemap (+X, -X, +Y, -Y, +Z, -Z)
+} TextureContainerHeader;
+
+// One entry per level and face, level-major, offsets from the start of the file
+typedef struct {
+    uint64_t offset;
+    uint64_t size;
+} TextureContainerLevel;
+
+// Bytes needed for one face of a level
+static inline uint64_t textureContainer_levelSize(uint32_t format, uint32_t width, uint32_t height) {
+    uint64_t blocks = (uint64_t)((width + 3) / 4) * ((height + 3) / 4);
+    switch (format) {
+        case TEXTURE_CONTAINER_BC1: return blocks * 8;
+        case TEXTURE_CONTAINER_BC3: return blocks * 16;
+        case TEXTURE_CONTAINER_BC5: return blocks * 16;
+        default: return (uint64_t)width * height * 4;
+    }
+}
+
+#endif // TEXTURE_CONTAINER_H
@@ -24,6 +24,7 @@ typedef struct {
 // Function prototypes
 GLuint texture_load(const char* path, bool gammaCorrection);
 GLuint texture_loadCubemap(const char* faces[6]);
+GLuint texture_loadContainer(const char* path);
 void texture_bind(GLuint texture, GLenum unit);
 
 #endif // TEXTURE_LOADER_H 
\ No newline at end of file
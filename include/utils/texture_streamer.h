@@ -0,0 +1,105 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include "wonderlands.h"
+#include <pthread.h>
+
+// Streaming limits
+#define TEXTURE_STREAM_MAX_THREADS 8
+#define TEXTURE_STREAM_MAX_LEVELS 16
+#define TEXTURE_STREAM_MAX_BLOCKS 32
+#define TEXTURE_STREAM_MAX_UPLOADS 64
+
+// Lifetime of one streamed texture
+typedef enum {
+    TEXTURE_STREAM_QUEUED,      // Waiting for a worker
+    TEXTURE_STREAM_DECODED,     // Mip chain in staging memory, waiting for the GL thread
+    TEXTURE_STREAM_UPLOADING,   // Some levels resident, smallest first
+    TEXTURE_STREAM_DONE,
+    TEXTURE_STREAM_FAILED       // Keeps the placeholder
+} TextureStreamState;
+
+// One requested 2D texture or cubemap
+typedef struct StreamedTexture {
+    GLuint texture;
+    GLenum target;
+    int faces;
+    char* paths[6];
+    bool gammaCorrection;
+    double requestTime;
+    TextureStreamState state;
+    
+    // Decoded mip chain, stored smallest level first; each level holds all faces
+    int width;
+    int height;
+    int components;
+    int levels;
+    int nextLevel;              // Next level to upload, counting down to 0
+    size_t levelOffsets[TEXTURE_STREAM_MAX_LEVELS];
+    size_t faceSizes[TEXTURE_STREAM_MAX_LEVELS];
+    int stagingBlock;
+    unsigned char* staging;
+    
+    struct StreamedTexture* next;
+} StreamedTexture;
+
+// Reusable staging allocation
+typedef struct {
+    unsigned char* data;
+    size_t capacity;
+    bool inUse;
+} TextureStagingBlock;
+
+// Streaming counters
+typedef struct {
+    unsigned int texturesRequested;
+    unsigned int texturesCompleted;
+    unsigned int texturesFailed;
+    size_t bytesUploaded;       // Last update
+    size_t stagingBytes;        // Currently held by the pool
+    double totalLatency;        // ms from request to fully resident, summed over completed textures
+} TextureStreamStats;
+
+// Texture streamer: workers decode and build mips, the GL thread uploads under a byte budget
+typedef struct TextureStreamer {
+    pthread_t threads[TEXTURE_STREAM_MAX_THREADS];
+    int threadCount;
+    pthread_mutex_t mutex;
+    pthread_cond_t workCondition;
+    pthread_cond_t stagingCondition;
+    bool running;
+    
+    // Hand-off lists (decode and ready are shared, upload is GL thread only)
+    StreamedTexture* decodeHead;
+    StreamedTexture* decodeTail;
+    StreamedTexture* readyHead;
+    StreamedTexture* readyTail;
+    StreamedTexture* uploadHead;
+    StreamedTexture* uploadTail;
+    
+    // Every request, so cleanup can free them
+    StreamedTexture** textures;
+    size_t textureCount;
+    size_t textureCapacity;
+    
+    // Staging pool shared by the workers
+    TextureStagingBlock blocks[TEXTURE_STREAM_MAX_BLOCKS];
+    size_t stagingLimit;
+    
+    // Pixel unpack buffer, orphaned every update
+    GLuint pixelBuffer;
+    size_t uploadBudget;
+    
+    TextureStreamStats stats;
+} TextureStreamer;
+
+// Function prototypes
+void textureStreamer_init(TextureStreamer* streamer, int threadCount, size_t stagingLimit, size_t uploadBudget);
+void textureStreamer_cleanup(TextureStreamer* streamer);
+GLuint textureStreamer_load(TextureStreamer* streamer, const char* path, bool gammaCorrection);
+GLuint textureStreamer_loadCubemap(TextureStreamer* streamer, const char* faces[6]);
+void textureStreamer_update(TextureStreamer* streamer);
+bool textureStreamer_isIdle(TextureStreamer* streamer);
+const TextureStreamStats* textureStreamer_getStats(const TextureStreamer* streamer);
+
+#endif // TEXTURE_STREAMER_H
@@ -0,0 +1,117 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+// Kept free of GL includes so CPU-only systems can be built and tested headless
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define THREAD_POOL_MAX_THREADS 16
+#define THREAD_POOL_MAX_EXTERNAL 4              // Non-worker threads that submit jobs (render, simulation, ...)
+#define THREAD_POOL_MAX_QUEUES (THREAD_POOL_MAX_THREADS + THREAD_POOL_MAX_EXTERNAL)
+#define THREAD_POOL_QUEUE_SIZE 256              // Jobs in flight per queue (power of two)
+#define THREAD_POOL_MAX_CONTINUATIONS 8         // Jobs that may wait on one counter
+#define THREAD_POOL_MAX_TIMERS 32               // Distinct job names timed between collections
+
+// Work item callback, called once per index in [0, count)
+typedef void (*ThreadPoolTask)(void* context, size_t index);
+
+// Range callback, called with disjoint [begin, end) slices of a job's range
+typedef void (*ThreadPoolRangeTask)(void* context, size_t begin, size_t end);
+
+// Called after every executed slice with its start and end time in nanoseconds (any thread)
+typedef void (*ThreadPoolTimingHook)(void* context, const char* name, int queue, uint64_t start, uint64_t end);
+
+// What to run; the range is split in halves while it is larger than grain
+typedef struct {
+    const char* name;           // Static string, NULL to skip timing
+    ThreadPoolRangeTask task;
+    void* context;
+    size_t count;               // Range is [0, count)
+    size_t grain;               // Largest slice run without splitting (0 = 1)
+} ThreadPoolJob;
+
+// A job slice sitting in a queue or on a counter
+typedef struct ThreadPoolEntry {
+    ThreadPoolJob job;
+    size_t begin;
+    size_t end;
+    struct ThreadPoolCounter* counter;
+    atomic_bool busy;
+} ThreadPoolEntry;
+
+// Outstanding work: submitting adds one, finishing a slice removes one. Jobs submitted
+// after a counter are held on it and queued when it drops to zero.
+typedef struct ThreadPoolCounter {
+    atomic_int pending;
+    atomic_int lock;
+    ThreadPoolEntry* continuations[THREAD_POOL_MAX_CONTINUATIONS];
+    int continuationCount;
+} ThreadPoolCounter;
+
+// Chase-Lev deque: the owner pushes and pops at the bottom, other threads steal from the top
+typedef struct {
+    atomic_long top;
+    atomic_long bottom;
+    _Atomic(ThreadPoolEntry*) slots[THREAD_POOL_QUEUE_SIZE];
+    
+    // Entries are handed out by the owning thread only
+    ThreadPoolEntry entries[THREAD_POOL_QUEUE_SIZE];
+    unsigned int nextEntry;
+} ThreadPoolQueue;
+
+// Accumulated time for one job name
+typedef struct {
+    _Atomic(const char*) name;
+    atomic_uint_fast64_t nanoseconds;
+    atomic_uint slices;
+} ThreadPoolTimer;
+
+// Collected timing for one job name
+typedef struct {
+    const char* name;
+    double time;                // Summed slice time across threads (ms)
+    unsigned int slices;
+} ThreadPoolTiming;
+
+// Work-stealing scheduler over persistent worker threads. Each worker owns a queue,
+// and so does every other thread that submits (claimed on first use). Idle workers
+// steal from the others; threads waiting on a counter run queued jobs until it clears.
+typedef struct ThreadPool {
+    pthread_t threads[THREAD_POOL_MAX_THREADS];
+    int threadCount;
+    unsigned int id;            // Tells pools apart in thread-local queue lookups
+    
+    ThreadPoolQueue queues[THREAD_POOL_MAX_QUEUES];
+    atomic_int queueCount;      // Claimed so far, by workers and submitting threads
+    pthread_t queueOwners[THREAD_POOL_MAX_QUEUES];
+    atomic_bool queueOwned[THREAD_POOL_MAX_QUEUES]; // Set once the owner above is written
+    
+    // Sleeping workers wake when workSignal moves
+    pthread_mutex_t mutex;
+    pthread_cond_t wakeCondition;
+    atomic_uint workSignal;
+    atomic_int sleepingWorkers;
+    atomic_bool running;
+    
+    // Per-job timing
+    ThreadPoolTimingHook timingHook;
+    void* timingContext;
+    ThreadPoolTimer timers[THREAD_POOL_MAX_TIMERS];
+} ThreadPool;
+
+// Function prototypes
+void threadPool_init(ThreadPool* pool, int threadCount);
+void threadPool_cleanup(ThreadPool* pool);
+void threadPool_run(ThreadPool* pool, ThreadPoolTask task, void* context, size_t count);
+void threadPool_initCounter(ThreadPoolCounter* counter);
+void threadPool_submit(ThreadPool* pool, const ThreadPoolJob* job, ThreadPoolCounter* counter);
+void threadPool_submitAfter(ThreadPool* pool, const ThreadPoolJob* job, ThreadPoolCounter* dependency, ThreadPoolCounter* counter);
+void threadPool_wait(ThreadPool* pool, ThreadPoolCounter* counter);
+void threadPool_parallelFor(ThreadPool* pool, const char* name, ThreadPoolRangeTask task, void* context, size_t count, size_t grain);
+void threadPool_setTimingHook(ThreadPool* pool, ThreadPoolTimingHook hook, void* context);
+int threadPool_collectTimings(ThreadPool* pool, ThreadPoolTiming* timings, int maxTimings);
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,77 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Kept free of GL includes: called from worker threads and the C++ ImGui overlay
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Trace configuration
+#define TRACE_MAX_THREADS 32
+#define TRACE_RING_EVENTS 65536         // Per thread, power of two (~5 s of a busy main thread)
+#define TRACE_MAX_DEPTH 32              // Open TRACE_BEGIN scopes per thread
+#define TRACE_DUMP_SECONDS 5.0
+
+// One completed scope (nanoseconds, CLOCK_MONOTONIC)
+typedef struct {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+} TraceEvent;
+
+// Open TRACE_SCOPE; closed when it goes out of scope
+typedef struct {
+    const char* name;
+    uint64_t start;             // 0 when recording was off at the start
+} TraceScope;
+
+#ifdef WONDERLANDS_TRACE
+
+// Scoped timers with nanosecond resolution, recorded into a per-thread ring buffer.
+// Names must be string literals (or otherwise outlive the trace).
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) \
+    TraceScope TRACE_CONCAT(traceScope, __LINE__) __attribute__((cleanup(trace_endScope))) = trace_beginScope(name)
+#define TRACE_BEGIN(name) trace_begin(name)
+#define TRACE_END() trace_end()
+
+// Function prototypes
+void trace_init();
+void trace_cleanup();
+void trace_setEnabled(bool enabled);
+bool trace_isEnabled();
+void trace_setThreadName(const char* name);
+uint64_t trace_now();
+TraceScope trace_beginScope(const char* name);
+void trace_endScope(TraceScope* scope);
+void trace_begin(const char* name);
+void trace_end();
+void trace_record(const char* name, uint64_t start, uint64_t end);
+void trace_recordJob(void* context, const char* name, int queue, uint64_t start, uint64_t end);
+bool trace_dump(const char* path, double seconds);
+
+#else
+
+// Compiled out: the macros vanish and the calls below fold away
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_BEGIN(name) ((void)0)
+#define TRACE_END() ((void)0)
+
+static inline void trace_init() {}
+static inline void trace_cleanup() {}
+static inline void trace_setEnabled(bool enabled) { (void)enabled; }
+static inline bool trace_isEnabled() { return false; }
+static inline void trace_setThreadName(const char* name) { (void)name; }
+static inline bool trace_dump(const char* path, double seconds) { (void)path; (void)seconds; return false; }
+
+#endif // WONDERLANDS_TRACE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRACE_H
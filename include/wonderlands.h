@@ -37,6 +37,8 @@
 #include "utils/texture_loader.h"
 #include "utils/model_loader.h"
 #include "utils/debug.h"
+#include "utils/profiler.h"
+#include "utils/trace.h"
 #include "rendering/renderer.h"
 #include "rendering/camera.h"
 #include "rendering/terrain.h"
@@ -46,5 +48,21 @@
 #include "physics/fluid_simulation.h"
 #include "scene/scene_manager.h"
 #include "scene/object.h"
+#include "scene/simulation.h"
+#include "utils/thread_pool.h"
+#include "utils/texture_streamer.h"
+#include "rendering/render_queue.h"
+#include "rendering/occlusion_culling.h"
+#include "rendering/impostor.h"
+#include "rendering/instance_culling.h"
+#include "rendering/grass.h"
+#include "rendering/atmosphere.h"
+#include "utils/bvh.h"
+#include "scene/scene_bvh.h"
+#include "scene/vegetation_placer.h"
+#include "scene/transform_store.h"
+#include "scene/wind_field.h"
+#include "utils/headless.h"
+#include "utils/benchmark.h"
 
 #endif // WONDERLANDS_H 
\ No newline at end of file
@@ -3,8 +3,10 @@
 // Global variables
 static Camera camera;
 static SceneManager sceneManager;
+static Simulation simulation;
 static Renderer renderer;
 static double lastTime = 0;
+static float frameDeltaTime = 0.0f;
 static bool keys[256];
 static bool specialKeys[256];
 static int mouseX = 0, mouseY = 0;
@@ -30,16 +32,32 @@ void update();
 void cleanup();
 
 int main(int argc, char **argv) {
+    // Offscreen benchmark run instead of the window
+    BenchmarkConfig benchmark;
+    if (benchmark_parseArgs(argc, argv, &benchmark)) {
+        return benchmark_run(&benchmark);
+    }
+    
     // Initialize GLUT and create window
     init(argc, argv);
     
     // Initialize OpenGL
     initGL();
     
-    // Initialize scene
+    // Initialize debug tools and profiler
+    debug_init();
+    
+    // Initialize scene; the simulation thread owns it from here and the renderer draws its interpolated copy
     sceneManager_init(&sceneManager);
+    if (!simulation_init(&simulation, &sceneManager, SIMULATION_TICK_RATE)) {
+        exit(1);
+    }
     renderer_init(&renderer);
+    #ifdef WONDERLANDS_TRACE
+    threadPool_setTimingHook(renderer.threadPool, trace_recordJob, NULL);
+    #endif
     camera_init(&camera, (vec3){0, 15, 0}, (vec3){0, 0, -1}, (vec3){0, 1, 0});
+    simulation_start(&simulation, renderer.threadPool);
     
     // Enter main loop
     glutMainLoop();
@@ -117,14 +135,57 @@ void initGL() {
 }
 
 void display() {
+    TRACE_SCOPE("display");
+    
     // Clear buffers
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
     
+    // Latest simulation state, interpolated between its two most recent ticks
+    profiler_beginCPU("Simulation interpolate");
+    WeatherType weather;
+    simulation_interpolate(&simulation, &timeOfDay, &weather);
+    SceneManager* scene = &simulation.renderScene;
+    SceneUpdate sceneUpdate = { frameDeltaTime, timeOfDay, weather, { camera.position[0], camera.position[1], camera.position[2] },
+                                SCENE_UPDATE_PARTICLES | SCENE_UPDATE_TERRAIN_LOD, renderer.windField };
+    sceneManager_updateJobs(scene, renderer.threadPool, &sceneUpdate);
+    profiler_endCPU();
+    
+    const SimulationStats* simulationStats = simulation_getStats(&simulation);
+    profiler_addCounter("Simulation tick rate (Hz)", simulationStats->tickRate);
+    profiler_addCounter("Render rate (Hz)", simulationStats->renderRate);
+    profiler_addCounter("Snapshot latency (ms)", simulationStats->snapshotLatency);
+    profiler_addCounter("Simulation tick (ms)", simulationStats->tickTime);
+    profiler_addCounter("Simulation ticks skipped", (double)simulationStats->skippedTicks);
+    profiler_addCounter("Transforms composed", (double)simulationStats->transformsComposed);
+    profiler_addCounter("Transforms skipped", (double)simulationStats->transformsSkipped);
+    profiler_addCounter("Transform compose (ms)", simulationStats->composeTime);
+    profiler_addCounter("Weather recomputed (ticks/s)", (double)simulationStats->partsRecomputed[SCENE_PART_WEATHER]);
+    profiler_addCounter("Weather skipped (ticks/s)", (double)simulationStats->partsSkipped[SCENE_PART_WEATHER]);
+    profiler_addCounter("Lights recomputed (ticks/s)", (double)simulationStats->partsRecomputed[SCENE_PART_LIGHTS]);
+    profiler_addCounter("Lights skipped (ticks/s)", (double)simulationStats->partsSkipped[SCENE_PART_LIGHTS]);
+    profiler_addCounter("Lights interpolated", simulationStats->lightsInterpolated ? 1.0 : 0.0);
+    
+    // Job time since the last frame, from both threads, summed over workers
+    ThreadPoolTiming jobTimings[THREAD_POOL_MAX_TIMERS];
+    int jobTimingCount = threadPool_collectTimings(renderer.threadPool, jobTimings, THREAD_POOL_MAX_TIMERS);
+    for (int i = 0; i < jobTimingCount; i++) {
+        profiler_addCounter(jobTimings[i].name, jobTimings[i].time);
+    }
+    
     // Render scene
-    renderer_render(&renderer, &sceneManager, &camera, timeOfDay, currentWeather);
+    profiler_beginCPU("renderer_render");
+    renderer_render(&renderer, scene, &camera, timeOfDay, weather);
+    profiler_endCPU();
+    
+    // Render debug overlay
+    debug_renderOverlay();
     
     // Swap buffers
+    profiler_beginCPU("Swap buffers");
     glutSwapBuffers();
+    profiler_endCPU();
+    
+    profiler_endFrame();
 }
 
 void reshape(int width, int height) {
@@ -133,6 +194,9 @@ void reshape(int width, int height) {
     
     // Update camera aspect ratio
     camera_updateProjection(&camera, width, height);
+    
+    // Reallocate render targets for the new window size
+    renderer_resize(&renderer, width, height);
 }
 
 void keyboard(unsigned char key, int x, int y) {
@@ -167,6 +231,9 @@ void keyboard(unsigned char key, int x, int y) {
         case 'l':
             renderer.showWireframe = !renderer.showWireframe;
             break;
+        case 'o':
+            renderer_setSSAOQuality(&renderer, (SSAOQuality)((renderer.ssaoQuality + 1) % SSAO_QUALITY_COUNT));
+            break;
     }
 }
 
@@ -176,6 +243,22 @@ void keyboardUp(unsigned char key, int x, int y) {
 
 void specialKeyboard(int key, int x, int y) {
     specialKeys[key] = true;
+    
+    switch (key) {
+        case GLUT_KEY_F1:
+            debug_toggleProfiler();
+            break;
+        case GLUT_KEY_F2:
+            profiler_exportChromeTrace("wonderlands_trace.json");
+            break;
+        case GLUT_KEY_F3:
+            trace_dump("wonderlands_cpu_trace.json", TRACE_DUMP_SECONDS);
+            break;
+        case GLUT_KEY_F4:
+            trace_setEnabled(!trace_isEnabled());
+            printf("CPU trace recording %s\n", trace_isEnabled() ? "on" : "off");
+            break;
+    }
 }
 
 void specialKeyboardUp(int key, int x, int y) {
@@ -187,7 +270,7 @@ void mouse(int button, int state, int x, int y) {
     if (button == GLUT_LEFT_BUTTON) {
         if (state == GLUT_DOWN) {
             // Interact with scene
-            renderer_pick(&renderer, &sceneManager, &camera, x, y);
+            renderer_pick(&renderer, &simulation.renderScene, &camera, x, y);
         }
     }
 }
@@ -226,18 +309,22 @@ void passiveMotion(int x, int y) {
     camera_rotate(&camera, deltaX * CAMERA_MOUSE_SENSITIVITY, deltaY * CAMERA_MOUSE_SENSITIVITY);
     
     // Wrap cursor if it reaches screen edge
-    if (x <= 0 || x >= WINDOW_WIDTH - 1 || y <= 0 || y >= WINDOW_HEIGHT - 1) {
-        mouseX = WINDOW_WIDTH / 2;
-        mouseY = WINDOW_HEIGHT / 2;
+    if (x <= 0 || x >= renderer.windowWidth - 1 || y <= 0 || y >= renderer.windowHeight - 1) {
+        mouseX = renderer.windowWidth / 2;
+        mouseY = renderer.windowHeight / 2;
         glutWarpPointer(mouseX, mouseY);
     }
 }
 
 void update() {
+    profiler_beginFrame();
+    TRACE_SCOPE("update");
+    
     // Calculate delta time
     double currentTime = glutGet(GLUT_ELAPSED_TIME) / 1000.0;
     float deltaTime = (float)(currentTime - lastTime);
     lastTime = currentTime;
+    frameDeltaTime = deltaTime;
     
     // Handle keyboard input for camera movement
     vec3 moveDir = {0, 0, 0};
@@ -251,21 +338,17 @@ void update() {
     // Update camera position
     camera_move(&camera, moveDir, deltaTime * CAMERA_MOVE_SPEED);
     
-    // Update time of day
-    if (!paused) {
-        timeOfDay += deltaTime * timeFactor / DAY_LENGTH;
-        if (timeOfDay >= 1.0f) timeOfDay -= 1.0f;
-    }
-    
-    // Update scene
-    sceneManager_update(&sceneManager, deltaTime, timeOfDay, currentWeather);
+    // Time of day and the scene advance on the simulation thread
+    simulation_setControls(&simulation, paused ? 0.0f : timeFactor, currentWeather);
     
     // Redisplay
     glutPostRedisplay();
 }
 
 void cleanup() {
-    // Cleanup resources
+    // Cleanup resources (the simulation thread stops first)
+    simulation_cleanup(&simulation);
     renderer_cleanup(&renderer);
     sceneManager_cleanup(&sceneManager);
+    debug_cleanup();
 } 
\ No newline at end of file
@@ -0,0 +1,533 @@
+#include "rendering/atmosphere.h"
+#include "utils/thread_pool.h"
+#include "utils/trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+#define ATMOSPHERE_PI 3.14159265358979f
+#define ATMOSPHERE_GROUND_OFFSET 0.01f  // km; keeps samples off the ground sphere
+
+// Cache file header, followed by the transmittance and multiple-scattering texels
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t transmittanceWidth;
+    uint32_t transmittanceHeight;
+    uint32_t multiScatteringSize;
+    uint32_t reserved;
+    uint64_t key;
+} AtmosphereCacheHeader;
+
+// Scattering and extinction at one altitude
+typedef struct {
+    float rayleigh[3];
+    float mie;
+    float extinction[3];
+} AtmosphereMedium;
+
+// Wall clock in milliseconds
+static double atmosphere_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static inline float atmosphere_clamp(float x, float low, float high) {
+    return x < low ? low : (x > high ? high : x);
+}
+
+static inline float atmosphere_dot(const float* a, const float* b) {
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Earth-like defaults (Bruneton 2017 / Hillaire 2020)
+void atmosphere_defaultParams(AtmosphereParams* params) {
+    memset(params, 0, sizeof(AtmosphereParams));
+    params->bottomRadius = 6360.0f;
+    params->topRadius = 6460.0f;
+    params->rayleighScattering[0] = 5.802e-3f;
+    params->rayleighScattering[1] = 13.558e-3f;
+    params->rayleighScattering[2] = 33.1e-3f;
+    params->rayleighScaleHeight = 8.0f;
+    params->mieScattering = 3.996e-3f;
+    params->mieExtinction = 4.440e-3f;
+    params->mieScaleHeight = 1.2f;
+    params->mieG = 0.8f;
+    params->ozoneAbsorption[0] = 0.650e-3f;
+    params->ozoneAbsorption[1] = 1.881e-3f;
+    params->ozoneAbsorption[2] = 0.085e-3f;
+    params->ozoneCenter = 25.0f;
+    params->ozoneWidth = 30.0f;
+    params->groundAlbedo[0] = 0.3f;
+    params->groundAlbedo[1] = 0.3f;
+    params->groundAlbedo[2] = 0.3f;
+}
+
+// Media at an altitude above the ground
+static void atmosphere_medium(const AtmosphereParams* params, float altitude, AtmosphereMedium* medium) {
+    float rayleighDensity = expf(-altitude / params->rayleighScaleHeight);
+    float mieDensity = expf(-altitude / params->mieScaleHeight);
+    float ozoneDensity = fmaxf(0.0f, 1.0f - fabsf(altitude - params->ozoneCenter) / (params->ozoneWidth * 0.5f));
+    
+    medium->mie = params->mieScattering * mieDensity;
+    for (int c = 0; c < 3; c++) {
+        medium->rayleigh[c] = params->rayleighScattering[c] * rayleighDensity;
+        medium->extinction[c] = medium->rayleigh[c] + params->mieExtinction * mieDensity + params->ozoneAbsorption[c] * ozoneDensity;
+    }
+}
+
+// Nearest non-negative distance from origin along direction to a sphere around the planet
+// centre, or -1 on a miss
+static float atmosphere_raySphere(const float* origin, const float* direction, float radius) {
+    float b = atmosphere_dot(origin, direction);
+    float c = atmosphere_dot(origin, origin) - radius * radius;
+    float discriminant = b * b - c;
+    if (discriminant < 0.0f) return -1.0f;
+    
+    float root = sqrtf(discriminant);
+    if (-b - root >= 0.0f) return -b - root;
+    if (-b + root >= 0.0f) return -b + root;
+    return -1.0f;
+}
+
+// Bilinear fetch from an RGB LUT at u, v in [0, 1] (texel centres at the ends)
+static void atmosphere_lookup(const float* lut, int width, int height, float u, float v, float* out) {
+    float x = atmosphere_clamp(u, 0.0f, 1.0f) * (width - 1);
+    float y = atmosphere_clamp(v, 0.0f, 1.0f) * (height - 1);
+    int x0 = (int)x;
+    int y0 = (int)y;
+    int x1 = x0 + 1 < width ? x0 + 1 : x0;
+    int y1 = y0 + 1 < height ? y0 + 1 : y0;
+    float tx = x - x0;
+    float ty = y - y0;
+    
+    const float* c00 = lut + ((size_t)y0 * width + x0) * 3;
+    const float* c10 = lut + ((size_t)y0 * width + x1) * 3;
+    const float* c01 = lut + ((size_t)y1 * width + x0) * 3;
+    const float* c11 = lut + ((size_t)y1 * width + x1) * 3;
+    for (int c = 0; c < 3; c++) {
+        float bottom = c00[c] + (c10[c] - c00[c]) * tx;
+        float top = c01[c] + (c11[c] - c01[c]) * tx;
+        out[c] = bottom + (top - bottom) * ty;
+    }
+}
+
+// Transmittance LUT coordinates -> radius and view zenith cosine. u spans the distances to
+// the top of the atmosphere, v the heights, so the horizon gets most of the resolution.
+static void atmosphere_transmittanceParams(const AtmosphereParams* params, float u, float v, float* radius, float* cosZenith) {
+    float bottom = params->bottomRadius;
+    float top = params->topRadius;
+    float horizon = sqrtf(top * top - bottom * bottom);
+    float rho = horizon * v;
+    *radius = sqrtf(rho * rho + bottom * bottom);
+    
+    float minDistance = top - *radius;
+    float maxDistance = rho + horizon;
+    float distance = minDistance + u * (maxDistance - minDistance);
+    *cosZenith = distance == 0.0f ? 1.0f : (horizon * horizon - rho * rho - distance * distance) / (2.0f * *radius * distance);
+    *cosZenith = atmosphere_clamp(*cosZenith, -1.0f, 1.0f);
+}
+
+// Transmittance to the top of the atmosphere from radius towards cosZenith (the inverse of
+// atmosphere_transmittanceParams; skybox.frag does the same)
+void atmosphere_sampleTransmittance(const Atmosphere* atmosphere, float radius, float cosZenith, float* transmittance) {
+    float bottom = atmosphere->params.bottomRadius;
+    float top = atmosphere->params.topRadius;
+    float horizon = sqrtf(top * top - bottom * bottom);
+    float rho = sqrtf(fmaxf(radius * radius - bottom * bottom, 0.0f));
+    float discriminant = radius * radius * (cosZenith * cosZenith - 1.0f) + top * top;
+    float distance = fmaxf(0.0f, -radius * cosZenith + sqrtf(fmaxf(discriminant, 0.0f)));
+    
+    float minDistance = top - radius;
+    float maxDistance = rho + horizon;
+    float u = (distance - minDistance) / (maxDistance - minDistance);
+    float v = rho / horizon;
+    atmosphere_lookup(atmosphere->transmittance, ATMOSPHERE_TRANSMITTANCE_WIDTH, ATMOSPHERE_TRANSMITTANCE_HEIGHT, u, v, transmittance);
+}
+
+// Sun transmittance at a point, zero where the planet is in the way
+static void atmosphere_sunTransmittance(const Atmosphere* atmosphere, const float* position, const float* sun, float* out) {
+    float radius = sqrtf(atmosphere_dot(position, position));
+    if (atmosphere_raySphere(position, sun, atmosphere->params.bottomRadius) >= 0.0f) {
+        out[0] = out[1] = out[2] = 0.0f;
+        return;
+    }
+    atmosphere_sampleTransmittance(atmosphere, radius, atmosphere_dot(position, sun) / radius, out);
+}
+
+// Transmittance rows
+static void atmosphere_transmittanceRange(void* context, size_t begin, size_t end) {
+    Atmosphere* atmosphere = (Atmosphere*)context;
+    const AtmosphereParams* params = &atmosphere->params;
+    
+    for (size_t y = begin; y < end; y++) {
+        for (int x = 0; x < ATMOSPHERE_TRANSMITTANCE_WIDTH; x++) {
+            float radius, cosZenith;
+            atmosphere_transmittanceParams(params, (float)x / (ATMOSPHERE_TRANSMITTANCE_WIDTH - 1),
+                                           (float)y / (ATMOSPHERE_TRANSMITTANCE_HEIGHT - 1), &radius, &cosZenith);
+            
+            float origin[3] = { 0.0f, radius, 0.0f };
+            float direction[3] = { sqrtf(1.0f - cosZenith * cosZenith), cosZenith, 0.0f };
+            float length = fmaxf(atmosphere_raySphere(origin, direction, params->topRadius), 0.0f);
+            float step = length / ATMOSPHERE_TRANSMITTANCE_STEPS;
+            
+            float depth[3] = { 0.0f, 0.0f, 0.0f };
+            for (int s = 0; s < ATMOSPHERE_TRANSMITTANCE_STEPS; s++) {
+                float t = (s + 0.5f) * step;
+                float position[3] = { direction[0] * t, radius + direction[1] * t, 0.0f };
+                AtmosphereMedium medium;
+                atmosphere_medium(params, sqrtf(atmosphere_dot(position, position)) - params->bottomRadius, &medium);
+                for (int c = 0; c < 3; c++) depth[c] += medium.extinction[c] * step;
+            }
+            
+            float* out = atmosphere->transmittance + (y * ATMOSPHERE_TRANSMITTANCE_WIDTH + x) * 3;
+            for (int c = 0; c < 3; c++) out[c] = expf(-depth[c]);
+        }
+    }
+}
+
+// Multiple-scattering rows: light scattered once towards a point from every direction, lit by
+// the sun at a given zenith, and the fraction f that scatters again; the infinite series of
+// further orders sums to L / (1 - f)
+static void atmosphere_multiScatteringRange(void* context, size_t begin, size_t end) {
+    Atmosphere* atmosphere = (Atmosphere*)context;
+    const AtmosphereParams* params = &atmosphere->params;
+    const int directions = ATMOSPHERE_MULTI_SCATTERING_DIRECTIONS;
+    const int size = ATMOSPHERE_MULTI_SCATTERING_SIZE;
+    
+    for (size_t y = begin; y < end; y++) {
+        for (int x = 0; x < size; x++) {
+            float cosSun = (float)x / (size - 1) * 2.0f - 1.0f;
+            float radius = params->bottomRadius + ATMOSPHERE_GROUND_OFFSET +
+                           (float)y / (size - 1) * (params->topRadius - params->bottomRadius - ATMOSPHERE_GROUND_OFFSET);
+            float origin[3] = { 0.0f, radius, 0.0f };
+            float sun[3] = { sqrtf(fmaxf(1.0f - cosSun * cosSun, 0.0f)), cosSun, 0.0f };
+            
+            float luminance[3] = { 0.0f, 0.0f, 0.0f };
+            float fraction[3] = { 0.0f, 0.0f, 0.0f };
+            for (int a = 0; a < directions; a++) {
+                for (int b = 0; b < directions; b++) {
+                    // Uniform grid over the sphere
+                    float cosTheta = 1.0f - 2.0f * (a + 0.5f) / directions;
+                    float sinTheta = sqrtf(fmaxf(1.0f - cosTheta * cosTheta, 0.0f));
+                    float phi = 2.0f * ATMOSPHERE_PI * (b + 0.5f) / directions;
+                    float direction[3] = { sinTheta * cosf(phi), cosTheta, sinTheta * sinf(phi) };
+                    
+                    float ground = atmosphere_raySphere(origin, direction, params->bottomRadius);
+                    float length = ground >= 0.0f ? ground : fmaxf(atmosphere_raySphere(origin, direction, params->topRadius), 0.0f);
+                    float step = length / ATMOSPHERE_MULTI_SCATTERING_STEPS;
+                    
+                    float throughput[3] = { 1.0f, 1.0f, 1.0f };
+                    for (int s = 0; s < ATMOSPHERE_MULTI_SCATTERING_STEPS; s++) {
+                        float t = (s + 0.5f) * step;
+                        float position[3] = { direction[0] * t, radius + direction[1] * t, direction[2] * t };
+                        AtmosphereMedium medium;
+                        atmosphere_medium(params, sqrtf(atmosphere_dot(position, position)) - params->bottomRadius, &medium);
+                        float sunTransmittance[3];
+                        atmosphere_sunTransmittance(atmosphere, position, sun, sunTransmittance);
+                        
+                        for (int c = 0; c < 3; c++) {
+                            float scattering = medium.rayleigh[c] + medium.mie;
+                            float extinction = fmaxf(medium.extinction[c], 1e-9f);
+                            float sampleTransmittance = expf(-extinction * step);
+                            float integral = (1.0f - sampleTransmittance) / extinction;
+                            luminance[c] += throughput[c] * sunTransmittance[c] * scattering / (4.0f * ATMOSPHERE_PI) * integral;
+                            fraction[c] += throughput[c] * scattering * integral;
+                            throughput[c] *= sampleTransmittance;
+                        }
+                    }
+                    
+                    // Sunlight bounced off the ground
+                    if (ground >= 0.0f) {
+                        float position[3] = { direction[0] * ground, radius + direction[1] * ground, direction[2] * ground };
+                        float up[3] = { position[0] / params->bottomRadius, position[1] / params->bottomRadius, position[2] / params->bottomRadius };
+                        float cosGround = fmaxf(atmosphere_dot(up, sun), 0.0f);
+                        float sunTransmittance[3];
+                        atmosphere_sampleTransmittance(atmosphere, params->bottomRadius, atmosphere_dot(up, sun), sunTransmittance);
+                        for (int c = 0; c < 3; c++) {
+                            luminance[c] += throughput[c] * sunTransmittance[c] * cosGround * params->groundAlbedo[c] / ATMOSPHERE_PI;
+                        }
+                    }
+                }
+            }
+            
+            // Isotropic phase over the whole sphere: the average over directions
+            float* out = atmosphere->multiScattering + (y * size + x) * 3;
+            float count = (float)(directions * directions);
+            for (int c = 0; c < 3; c++) {
+                out[c] = (luminance[c] / count) / (1.0f - fminf(fraction[c] / count, 0.99f));
+            }
+        }
+    }
+}
+
+// Sky-view rows for the sun at buildElevation: single scattering with the multiple-scattering
+// LUT added, per unit of sun illuminance. Rows are view zenith (denser near the horizon),
+// columns the azimuth from the sun (denser towards it).
+static void atmosphere_skyViewRange(void* context, size_t begin, size_t end) {
+    Atmosphere* atmosphere = (Atmosphere*)context;
+    const AtmosphereParams* params = &atmosphere->params;
+    float radius = params->bottomRadius + atmosphere->viewerHeight;
+    float origin[3] = { 0.0f, radius, 0.0f };
+    float sun[3] = { cosf(atmosphere->buildElevation), sinf(atmosphere->buildElevation), 0.0f };
+    
+    float horizonDistance = sqrtf(fmaxf(radius * radius - params->bottomRadius * params->bottomRadius, 0.0f));
+    float beta = acosf(horizonDistance / radius);
+    float zenithHorizon = ATMOSPHERE_PI - beta;
+    float g = params->mieG;
+    
+    for (size_t y = begin; y < end; y++) {
+        float v = (float)y / (ATMOSPHERE_SKY_VIEW_HEIGHT - 1);
+        float viewZenith;
+        if (v < 0.5f) {
+            float coord = 1.0f - 2.0f * v;
+            viewZenith = zenithHorizon * (1.0f - coord * coord);
+        } else {
+            float coord = 2.0f * v - 1.0f;
+            viewZenith = zenithHorizon + beta * coord * coord;
+        }
+        float cosView = cosf(viewZenith);
+        float sinView = sinf(viewZenith);
+        
+        for (int x = 0; x < ATMOSPHERE_SKY_VIEW_WIDTH; x++) {
+            float u = (float)x / (ATMOSPHERE_SKY_VIEW_WIDTH - 1);
+            float cosAzimuth = 1.0f - 2.0f * u * u;
+            float sinAzimuth = sqrtf(fmaxf(1.0f - cosAzimuth * cosAzimuth, 0.0f));
+            float direction[3] = { sinView * cosAzimuth, cosView, sinView * sinAzimuth };
+            
+            float ground = atmosphere_raySphere(origin, direction, params->bottomRadius);
+            float length = ground >= 0.0f ? ground : fmaxf(atmosphere_raySphere(origin, direction, params->topRadius), 0.0f);
+            float step = length / ATMOSPHERE_SKY_VIEW_STEPS;
+            
+            // Rayleigh and Cornette-Shanks Mie phase
+            float cosTheta = atmosphere_dot(direction, sun);
+            float rayleighPhase = 3.0f / (16.0f * ATMOSPHERE_PI) * (1.0f + cosTheta * cosTheta);
+            float miePhase = 3.0f / (8.0f * ATMOSPHERE_PI) * (1.0f - g * g) * (1.0f + cosTheta * cosTheta) /
+                             ((2.0f + g * g) * powf(1.0f + g * g - 2.0f * g * cosTheta, 1.5f));
+            
+            float luminance[3] = { 0.0f, 0.0f, 0.0f };
+            float throughput[3] = { 1.0f, 1.0f, 1.0f };
+            for (int s = 0; s < ATMOSPHERE_SKY_VIEW_STEPS; s++) {
+                float t = (s + 0.5f) * step;
+                float position[3] = { direction[0] * t, radius + direction[1] * t, direction[2] * t };
+                float height = sqrtf(atmosphere_dot(position, position));
+                AtmosphereMedium medium;
+                atmosphere_medium(params, height - params->bottomRadius, &medium);
+                
+                float sunTransmittance[3];
+                atmosphere_sunTransmittance(atmosphere, position, sun, sunTransmittance);
+                float multiScattering[3];
+                float cosSun = atmosphere_dot(position, sun) / height;
+                atmosphere_lookup(atmosphere->multiScattering, ATMOSPHERE_MULTI_SCATTERING_SIZE, ATMOSPHERE_MULTI_SCATTERING_SIZE,
+                                  cosSun * 0.5f + 0.5f,
+                                  (height - params->bottomRadius - ATMOSPHERE_GROUND_OFFSET) / (params->topRadius - params->bottomRadius - ATMOSPHERE_GROUND_OFFSET),
+                                  multiScattering);
+                
+                for (int c = 0; c < 3; c++) {
+                    float scattering = medium.rayleigh[c] + medium.mie;
+                    float source = sunTransmittance[c] * (medium.rayleigh[c] * rayleighPhase + medium.mie * miePhase) +
+                                   multiScattering[c] * scattering;
+                    float extinction = fmaxf(medium.extinction[c], 1e-9f);
+                    float sampleTransmittance = expf(-extinction * step);
+                    luminance[c] += throughput[c] * source * (1.0f - sampleTransmittance) / extinction;
+                    throughput[c] *= sampleTransmittance;
+                }
+            }
+            
+            float* out = atmosphere->skyView + (y * ATMOSPHERE_SKY_VIEW_WIDTH + x) * 3;
+            memcpy(out, luminance, sizeof(luminance));
+        }
+    }
+}
+
+// Rows [first, first + count) of a LUT; parallelFor ranges start at 0
+typedef struct {
+    ThreadPoolRangeTask task;
+    Atmosphere* atmosphere;
+    size_t first;
+} AtmosphereRows;
+
+// Offset a parallelFor range onto the LUT rows
+static void atmosphere_rowsRange(void* context, size_t begin, size_t end) {
+    AtmosphereRows* rows = (AtmosphereRows*)context;
+    rows->task(rows->atmosphere, rows->first + begin, rows->first + end);
+}
+
+// Run rows [begin, end) of a LUT, spread over the pool when there is one
+static void atmosphere_runRows(ThreadPool* pool, const char* name, ThreadPoolRangeTask task, Atmosphere* atmosphere, size_t begin, size_t end) {
+    if (!pool) {
+        task(atmosphere, begin, end);
+        return;
+    }
+    AtmosphereRows rows = { task, atmosphere, begin };
+    threadPool_parallelFor(pool, name, atmosphere_rowsRange, &rows, end - begin, 1);
+}
+
+// 64-bit FNV-1a over a byte range, continuing from hash
+static uint64_t atmosphere_hash(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Cache key: the parameters and everything that shapes the LUTs
+static uint64_t atmosphere_cacheKey(const AtmosphereParams* params) {
+    uint32_t settings[6] = { ATMOSPHERE_CACHE_VERSION, ATMOSPHERE_TRANSMITTANCE_STEPS, ATMOSPHERE_MULTI_SCATTERING_STEPS,
+                             ATMOSPHERE_MULTI_SCATTERING_DIRECTIONS, ATMOSPHERE_TRANSMITTANCE_WIDTH, ATMOSPHERE_MULTI_SCATTERING_SIZE };
+    uint64_t hash = atmosphere_hash(14695981039346656037ull, settings, sizeof(settings));
+    return atmosphere_hash(hash, params, sizeof(AtmosphereParams));
+}
+
+// Create a cache directory and its parents (existing directories are fine)
+static bool atmosphere_makeCacheDir(const char* cacheDir) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s", cacheDir);
+    
+    for (char* p = path + 1; ; p++) {
+        if (*p != '/' && *p != '\0') continue;
+        
+        char saved = *p;
+        *p = '\0';
+        if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "Failed to create atmosphere cache directory: %s\n", path);
+            return false;
+        }
+        *p = saved;
+        if (saved == '\0') break;
+    }
+    return true;
+}
+
+// Load transmittance and multiple scattering from the disk cache; false on miss or mismatch
+static bool atmosphere_loadCache(Atmosphere* atmosphere, const char* path, uint64_t key) {
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    
+    size_t transmittanceCount = (size_t)ATMOSPHERE_TRANSMITTANCE_WIDTH * ATMOSPHERE_TRANSMITTANCE_HEIGHT * 3;
+    size_t multiScatteringCount = (size_t)ATMOSPHERE_MULTI_SCATTERING_SIZE * ATMOSPHERE_MULTI_SCATTERING_SIZE * 3;
+    AtmosphereCacheHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              header.magic == ATMOSPHERE_CACHE_MAGIC &&
+              header.version == ATMOSPHERE_CACHE_VERSION &&
+              header.transmittanceWidth == ATMOSPHERE_TRANSMITTANCE_WIDTH &&
+              header.transmittanceHeight == ATMOSPHERE_TRANSMITTANCE_HEIGHT &&
+              header.multiScatteringSize == ATMOSPHERE_MULTI_SCATTERING_SIZE &&
+              header.key == key &&
+              fread(atmosphere->transmittance, sizeof(float), transmittanceCount, file) == transmittanceCount &&
+              fread(atmosphere->multiScattering, sizeof(float), multiScatteringCount, file) == multiScatteringCount;
+    fclose(file);
+    
+    if (!ok) fprintf(stderr, "Ignoring stale atmosphere cache: %s\n", path);
+    return ok;
+}
+
+// Write transmittance and multiple scattering to the disk cache
+static void atmosphere_saveCache(const Atmosphere* atmosphere, const char* cacheDir, const char* path, uint64_t key) {
+    if (!atmosphere_makeCacheDir(cacheDir)) return;
+    
+    AtmosphereCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = ATMOSPHERE_CACHE_MAGIC;
+    header.version = ATMOSPHERE_CACHE_VERSION;
+    header.transmittanceWidth = ATMOSPHERE_TRANSMITTANCE_WIDTH;
+    header.transmittanceHeight = ATMOSPHERE_TRANSMITTANCE_HEIGHT;
+    header.multiScatteringSize = ATMOSPHERE_MULTI_SCATTERING_SIZE;
+    header.key = key;
+    
+    size_t transmittanceCount = (size_t)ATMOSPHERE_TRANSMITTANCE_WIDTH * ATMOSPHERE_TRANSMITTANCE_HEIGHT * 3;
+    size_t multiScatteringCount = (size_t)ATMOSPHERE_MULTI_SCATTERING_SIZE * ATMOSPHERE_MULTI_SCATTERING_SIZE * 3;
+    FILE* file = fopen(path, "wb");
+    if (!file) return;
+    if (fwrite(&header, sizeof(header), 1, file) != 1 ||
+        fwrite(atmosphere->transmittance, sizeof(float), transmittanceCount, file) != transmittanceCount ||
+        fwrite(atmosphere->multiScattering, sizeof(float), multiScatteringCount, file) != multiScatteringCount) {
+        fprintf(stderr, "Failed to write atmosphere cache: %s\n", path);
+    }
+    fclose(file);
+}
+
+// Allocate the LUTs and build transmittance and multiple scattering on the pool, or load
+// them from cacheDir (NULL to skip the cache). The sky view is left for atmosphere_beginSkyView.
+bool atmosphere_init(Atmosphere* atmosphere, const AtmosphereParams* params, float viewerHeight, const char* cacheDir, ThreadPool* pool) {
+    TRACE_SCOPE("atmosphere_init");
+    memset(atmosphere, 0, sizeof(Atmosphere));
+    atmosphere->params = *params;
+    atmosphere->viewerHeight = viewerHeight;
+    atmosphere->skyViewRow = ATMOSPHERE_SKY_VIEW_HEIGHT;
+    
+    atmosphere->transmittance = (float*)malloc(sizeof(float) * 3 * ATMOSPHERE_TRANSMITTANCE_WIDTH * ATMOSPHERE_TRANSMITTANCE_HEIGHT);
+    atmosphere->multiScattering = (float*)malloc(sizeof(float) * 3 * ATMOSPHERE_MULTI_SCATTERING_SIZE * ATMOSPHERE_MULTI_SCATTERING_SIZE);
+    atmosphere->skyView = (float*)calloc((size_t)3 * ATMOSPHERE_SKY_VIEW_WIDTH * ATMOSPHERE_SKY_VIEW_HEIGHT, sizeof(float));
+    if (!atmosphere->transmittance || !atmosphere->multiScattering || !atmosphere->skyView) {
+        fprintf(stderr, "Failed to allocate atmosphere LUTs\n");
+        atmosphere_cleanup(atmosphere);
+        return false;
+    }
+    
+    uint64_t key = atmosphere_cacheKey(params);
+    char path[256];
+    if (cacheDir) {
+        snprintf(path, sizeof(path), "%s/%016llx.atm", cacheDir, (unsigned long long)key);
+        atmosphere->fromCache = atmosphere_loadCache(atmosphere, path, key);
+        if (atmosphere->fromCache) return true;
+    }
+    
+    // Multiple scattering reads the transmittance LUT
+    double start = atmosphere_now();
+    atmosphere_runRows(pool, "Job: transmittance LUT (ms)", atmosphere_transmittanceRange, atmosphere, 0, ATMOSPHERE_TRANSMITTANCE_HEIGHT);
+    atmosphere->transmittanceTime = atmosphere_now() - start;
+    
+    start = atmosphere_now();
+    atmosphere_runRows(pool, "Job: multi-scattering LUT (ms)", atmosphere_multiScatteringRange, atmosphere, 0, ATMOSPHERE_MULTI_SCATTERING_SIZE);
+    atmosphere->multiScatteringTime = atmosphere_now() - start;
+    
+    if (cacheDir) atmosphere_saveCache(atmosphere, cacheDir, path, key);
+    return true;
+}
+
+// Free the LUTs
+void atmosphere_cleanup(Atmosphere* atmosphere) {
+    free(atmosphere->transmittance);
+    free(atmosphere->multiScattering);
+    free(atmosphere->skyView);
+    atmosphere->transmittance = NULL;
+    atmosphere->multiScattering = NULL;
+    atmosphere->skyView = NULL;
+}
+
+// Start rebuilding the sky view for a sun elevation (radians above the horizon)
+void atmosphere_beginSkyView(Atmosphere* atmosphere, float sunElevation) {
+    atmosphere->buildElevation = sunElevation;
+    atmosphere->skyViewRow = 0;
+    atmosphere->skyViewTime = 0.0;
+}
+
+// Build up to rows more rows of the sky view (all of them if rows <= 0); true when this call
+// completed it, at which point skyView holds the LUT for skyViewElevation
+bool atmosphere_buildSkyView(Atmosphere* atmosphere, int rows, ThreadPool* pool) {
+    if (atmosphere->skyViewRow >= ATMOSPHERE_SKY_VIEW_HEIGHT) return false;
+    TRACE_SCOPE("atmosphere_buildSkyView");
+    double start = atmosphere_now();
+    
+    int begin = atmosphere->skyViewRow;
+    int end = rows > 0 && begin + rows < ATMOSPHERE_SKY_VIEW_HEIGHT ? begin + rows : ATMOSPHERE_SKY_VIEW_HEIGHT;
+    atmosphere_runRows(pool, "Job: sky-view LUT (ms)", atmosphere_skyViewRange, atmosphere, (size_t)begin, (size_t)end);
+    atmosphere->skyViewRow = end;
+    
+    atmosphere->sliceTime = atmosphere_now() - start;
+    atmosphere->skyViewTime += atmosphere->sliceTime;
+    if (end < ATMOSPHERE_SKY_VIEW_HEIGHT) return false;
+    
+    atmosphere->skyViewElevation = atmosphere->buildElevation;
+    atmosphere->skyViewValid = true;
+    return true;
+}
@@ -0,0 +1,433 @@
+#include "rendering/grass.h"
+#include "utils/profiler.h"
+#include "utils/bvh.h"
+
+// Chance a grid cell grows a blade, per biome (meadow, forest, rocky)
+static const float grassBiomeDensity[BIOME_COUNT] = { 1.0f, 0.45f, 0.1f };
+
+// Blade strip: x = side (-1..1), y = height along the blade (0..1)
+static const float grassBladeVertices[GRASS_BLADE_VERTICES * 2] = {
+    -1.0f,  0.0f,
+     1.0f,  0.0f,
+    -0.75f, 0.35f,
+     0.75f, 0.35f,
+    -0.45f, 0.7f,
+     0.45f, 0.7f,
+     0.0f,  1.0f
+};
+
+// Integer hash of a grid cell (murmur3 finalizer over the mixed inputs)
+static uint32_t grass_hash(uint32_t seed, int x, int z) {
+    uint32_t hash = seed ^ ((uint32_t)x * 0x9e3779b1u) ^ ((uint32_t)z * 0x85ebca77u);
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+// Fraction of blades drawn at a distance (same curve as grass.vert, before the budget scale)
+static float grass_density(float distance) {
+    float t = (distance - GRASS_FULL_DENSITY_DISTANCE) / (CULL_DISTANCE_GRASS - GRASS_FULL_DENSITY_DISTANCE);
+    if (t <= 0.0f) return 1.0f;
+    if (t >= 1.0f) return 0.0f;
+    return (1.0f - t) * (1.0f - t);
+}
+
+// Distance from a point to a box (0 inside)
+static float grass_boxDistance(const float* boxMin, const float* boxMax, const float* point) {
+    float sum = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        float d = 0.0f;
+        if (point[axis] < boxMin[axis]) d = boxMin[axis] - point[axis];
+        if (point[axis] > boxMax[axis]) d = point[axis] - boxMax[axis];
+        sum += d * d;
+    }
+    return sqrtf(sum);
+}
+
+// Is the box outside any frustum plane?
+static bool grass_boxOutside(const float planes[6][4], const float* boxMin, const float* boxMax) {
+    for (int p = 0; p < 6; p++) {
+        const float* plane = planes[p];
+        float x = plane[0] >= 0.0f ? boxMax[0] : boxMin[0];
+        float y = plane[1] >= 0.0f ? boxMax[1] : boxMin[1];
+        float z = plane[2] >= 0.0f ? boxMax[2] : boxMin[2];
+        if (plane[0] * x + plane[1] * y + plane[2] * z + plane[3] < 0.0f) return true;
+    }
+    return false;
+}
+
+// Generate one chunk's blades into its scratch slice, sorted by threshold (counting sort,
+// so equal thresholds keep grid order and the result is the same on every build)
+static void grass_buildTask(void* context, size_t begin, size_t end) {
+    GrassSystem* grass = (GrassSystem*)context;
+    Terrain* terrain = grass->terrain;
+    uint32_t seed = (uint32_t)terrain->seed;
+    int cells = grass->cellsPerChunk;
+    float cellSize = GRASS_CHUNK_SIZE / cells;
+    float maxX = grass->originX + terrain->size;
+    float maxZ = grass->originZ + terrain->size;
+    
+    for (size_t b = begin; b < end; b++) {
+        const GrassBuild* build = &grass->builds[b];
+        GrassBlade* blades = grass->scratch + b * grass->chunkCapacity;
+        GrassBlade* sorted = blades + grass->chunkCapacity * GRASS_CHUNK_BUILDS_PER_FRAME;
+        size_t counts[256] = { 0 };
+        size_t count = 0;
+        
+        for (int j = 0; j < cells; j++) {
+            for (int i = 0; i < cells; i++) {
+                int cellX = build->chunkX * cells + i;
+                int cellZ = build->chunkZ * cells + j;
+                uint32_t shape = grass_hash(seed, cellX, cellZ);
+                uint32_t look = grass_hash(seed ^ 0x5bd1e995u, cellX, cellZ);
+                
+                float x = grass->originX + (cellX + (shape & 0xffff) / 65536.0f) * cellSize;
+                float z = grass->originZ + (cellZ + (shape >> 16) / 65536.0f) * cellSize;
+                if (x >= maxX || z >= maxZ) continue;
+                
+                int biome = (int)terrain_getBiomeAt(terrain, x, z);
+                float chance = (look >> 24) / 256.0f;
+                if (biome < 0 || biome >= BIOME_COUNT || chance >= grassBiomeDensity[biome]) continue;
+                if (terrain_getSlope(terrain, x, z) > GRASS_MAX_SLOPE) continue;
+                float height = terrain_getHeight(terrain, x, z);
+                if (height < WATER_HEIGHT) continue;
+                
+                GrassBlade* blade = &blades[count++];
+                blade->position[0] = x;
+                blade->position[1] = height;
+                blade->position[2] = z;
+                blade->threshold = (uint8_t)(look & 0xff);
+                blade->yaw = (uint8_t)((look >> 8) & 0xff);
+                blade->height = (uint8_t)((look >> 16) & 0xff);
+                blade->phase = (uint8_t)(shape >> 24);
+                counts[blade->threshold]++;
+            }
+        }
+        
+        size_t offsets[256];
+        size_t offset = 0;
+        for (int t = 0; t < 256; t++) {
+            offsets[t] = offset;
+            offset += counts[t];
+        }
+        for (size_t i = 0; i < count; i++) {
+            sorted[offsets[blades[i].threshold]++] = blades[i];
+        }
+        grass->scratchCounts[b] = count;
+    }
+}
+
+// Pick a slot for a new chunk: a free one, else the least recently used one out of range
+static int grass_takeSlot(GrassSystem* grass) {
+    int best = GRASS_NO_SLOT;
+    for (int s = 0; s < GRASS_MAX_CHUNKS; s++) {
+        GrassChunk* chunk = &grass->chunks[s];
+        if (chunk->chunkX == GRASS_NO_SLOT) return s;
+        if (chunk->lastUsed == grass->frame) continue;
+        if (best == GRASS_NO_SLOT || chunk->lastUsed < grass->chunks[best].lastUsed) best = s;
+    }
+    
+    if (best != GRASS_NO_SLOT) {
+        GrassChunk* chunk = &grass->chunks[best];
+        grass->slots[chunk->chunkZ * grass->chunksPerSide + chunk->chunkX] = GRASS_NO_SLOT;
+        chunk->chunkX = GRASS_NO_SLOT;
+        chunk->chunkZ = GRASS_NO_SLOT;
+        chunk->bladeCount = 0;
+    }
+    return best;
+}
+
+// Build the scheduled chunks on the workers, then upload them
+static void grass_buildChunks(GrassSystem* grass) {
+    if (grass->buildCount == 0) return;
+    
+    double start = profiler_now();
+    if (grass->pool) {
+        threadPool_parallelFor(grass->pool, "Job: grass chunks (ms)", grass_buildTask, grass, (size_t)grass->buildCount, 1);
+    } else {
+        grass_buildTask(grass, 0, (size_t)grass->buildCount);
+    }
+    
+    for (int b = 0; b < grass->buildCount; b++) {
+        const GrassBuild* build = &grass->builds[b];
+        GrassChunk* chunk = &grass->chunks[build->slot];
+        const GrassBlade* blades = grass->scratch + (GRASS_CHUNK_BUILDS_PER_FRAME + b) * grass->chunkCapacity;
+        size_t count = grass->scratchCounts[b];
+        
+        // Threshold prefix counts give each density's draw count without touching the blades
+        memset(chunk->thresholdCounts, 0, sizeof(chunk->thresholdCounts));
+        for (size_t i = 0; i < count; i++) chunk->thresholdCounts[blades[i].threshold + 1]++;
+        for (int t = 1; t <= 256; t++) chunk->thresholdCounts[t] += chunk->thresholdCounts[t - 1];
+        
+        // Bounds cover the roots plus the tallest blade and its sway
+        float x0 = grass->originX + build->chunkX * GRASS_CHUNK_SIZE;
+        float z0 = grass->originZ + build->chunkZ * GRASS_CHUNK_SIZE;
+        float minY = INFINITY;
+        float maxY = -INFINITY;
+        for (size_t i = 0; i < count; i++) {
+            minY = fminf(minY, blades[i].position[1]);
+            maxY = fmaxf(maxY, blades[i].position[1]);
+        }
+        float reach = GRASS_BLADE_HEIGHT * 1.4f;
+        chunk->boxMin[0] = x0 - reach;
+        chunk->boxMin[1] = count ? minY : 0.0f;
+        chunk->boxMin[2] = z0 - reach;
+        chunk->boxMax[0] = x0 + GRASS_CHUNK_SIZE + reach;
+        chunk->boxMax[1] = count ? maxY + reach : 0.0f;
+        chunk->boxMax[2] = z0 + GRASS_CHUNK_SIZE + reach;
+        
+        if (count) {
+            glBindBuffer(GL_ARRAY_BUFFER, chunk->instanceBuffer);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(GrassBlade) * count, blades);
+        }
+        chunk->chunkX = build->chunkX;
+        chunk->chunkZ = build->chunkZ;
+        chunk->bladeCount = count;
+        chunk->lastUsed = grass->frame;
+        grass->slots[build->chunkZ * grass->chunksPerSide + build->chunkX] = build->slot;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    grass->stats.chunksBuilt = (size_t)grass->buildCount;
+    grass->stats.buildTime = profiler_now() - start;
+}
+
+// Lay the chunk grid over a terrain; all resident chunks are dropped
+static bool grass_setupGrid(GrassSystem* grass, Terrain* terrain) {
+    free(grass->slots);
+    grass->terrain = terrain;
+    grass->originX = -terrain->size * 0.5f;
+    grass->originZ = -terrain->size * 0.5f;
+    grass->chunksPerSide = (int)ceilf(terrain->size / GRASS_CHUNK_SIZE);
+    
+    size_t chunkCount = (size_t)grass->chunksPerSide * grass->chunksPerSide;
+    grass->slots = (int*)malloc(sizeof(int) * chunkCount);
+    if (!grass->slots) return false;
+    for (size_t i = 0; i < chunkCount; i++) grass->slots[i] = GRASS_NO_SLOT;
+    for (int s = 0; s < GRASS_MAX_CHUNKS; s++) {
+        grass->chunks[s].chunkX = GRASS_NO_SLOT;
+        grass->chunks[s].chunkZ = GRASS_NO_SLOT;
+        grass->chunks[s].bladeCount = 0;
+    }
+    
+    printf("Grass: %d x %d chunks of up to %zu blades (%zu potential blades)\n", grass->chunksPerSide,
+           grass->chunksPerSide, grass->chunkCapacity, chunkCount * grass->chunkCapacity);
+    return true;
+}
+
+// Initialize the grass system (chunks are built on demand by grass_update)
+void grass_init(GrassSystem* grass, ThreadPool* pool) {
+    memset(grass, 0, sizeof(GrassSystem));
+    grass->enabled = true;
+    grass->pool = pool;
+    grass->densityScale = 1.0f;
+    grass->cellsPerChunk = (int)ceilf(GRASS_CHUNK_SIZE / GRASS_BLADE_SPACING);
+    grass->chunkCapacity = (size_t)grass->cellsPerChunk * grass->cellsPerChunk;
+    
+    // Unsorted and sorted halves for every build of a frame
+    grass->scratch = (GrassBlade*)malloc(sizeof(GrassBlade) * grass->chunkCapacity * GRASS_CHUNK_BUILDS_PER_FRAME * 2);
+    grass->scratchCounts = (size_t*)calloc(GRASS_CHUNK_BUILDS_PER_FRAME, sizeof(size_t));
+    if (!grass->scratch || !grass->scratchCounts) {
+        fprintf(stderr, "Failed to allocate grass build buffers\n");
+        grass->enabled = false;
+        return;
+    }
+    
+    grass->shader = shader_load("src/shaders/grass.vert", "src/shaders/grass.frag");
+    glGenBuffers(1, &grass->bladeVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, grass->bladeVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(grassBladeVertices), grassBladeVertices, GL_STATIC_DRAW);
+    
+    // Every slot owns a VAO over the shared blade strip and its own fixed-size instance buffer
+    for (int s = 0; s < GRASS_MAX_CHUNKS; s++) {
+        GrassChunk* chunk = &grass->chunks[s];
+        chunk->chunkX = GRASS_NO_SLOT;
+        chunk->chunkZ = GRASS_NO_SLOT;
+        glGenVertexArrays(1, &chunk->VAO);
+        glGenBuffers(1, &chunk->instanceBuffer);
+        glBindVertexArray(chunk->VAO);
+        
+        glBindBuffer(GL_ARRAY_BUFFER, grass->bladeVBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        
+        glBindBuffer(GL_ARRAY_BUFFER, chunk->instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(GrassBlade) * grass->chunkCapacity, NULL, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(GrassBlade), (void*)offsetof(GrassBlade, position));
+        glVertexAttribDivisor(1, 1);
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GrassBlade), (void*)offsetof(GrassBlade, threshold));
+        glVertexAttribDivisor(2, 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Release chunk buffers and scratch memory
+void grass_cleanup(GrassSystem* grass) {
+    for (int s = 0; s < GRASS_MAX_CHUNKS; s++) {
+        if (grass->chunks[s].VAO) glDeleteVertexArrays(1, &grass->chunks[s].VAO);
+        if (grass->chunks[s].instanceBuffer) glDeleteBuffers(1, &grass->chunks[s].instanceBuffer);
+    }
+    if (grass->bladeVBO) glDeleteBuffers(1, &grass->bladeVBO);
+    if (grass->shader) shader_delete(grass->shader);
+    
+    free(grass->slots);
+    free(grass->scratch);
+    free(grass->scratchCounts);
+    grass->slots = NULL;
+    grass->scratch = NULL;
+    grass->scratchCounts = NULL;
+}
+
+// Keep the chunks around the camera resident (building the nearest missing ones, a few per
+// frame), cull whole chunks against the frustum and occlusion buffer, and pick how many
+// blades of each to draw from its distance and the per-frame blade budget
+void grass_update(GrassSystem* grass, Terrain* terrain, const float* viewProjection, const float* cameraPosition, OcclusionCuller* occlusion) {
+    GrassStats* stats = &grass->stats;
+    memset(stats, 0, sizeof(GrassStats));
+    grass->drawCount = 0;
+    grass->buildCount = 0;
+    if (!grass->enabled || !terrain || terrain->size <= 0.0f) return;
+    if (grass->terrain != terrain && !grass_setupGrid(grass, terrain)) return;
+    grass->frame++;
+    
+    // Chunks whose ground square lies within the cull distance
+    float relativeX = cameraPosition[0] - grass->originX;
+    float relativeZ = cameraPosition[2] - grass->originZ;
+    int x0 = (int)floorf((relativeX - CULL_DISTANCE_GRASS) / GRASS_CHUNK_SIZE);
+    int z0 = (int)floorf((relativeZ - CULL_DISTANCE_GRASS) / GRASS_CHUNK_SIZE);
+    int x1 = (int)floorf((relativeX + CULL_DISTANCE_GRASS) / GRASS_CHUNK_SIZE);
+    int z1 = (int)floorf((relativeZ + CULL_DISTANCE_GRASS) / GRASS_CHUNK_SIZE);
+    if (x0 < 0) x0 = 0;
+    if (z0 < 0) z0 = 0;
+    if (x1 > grass->chunksPerSide - 1) x1 = grass->chunksPerSide - 1;
+    if (z1 > grass->chunksPerSide - 1) z1 = grass->chunksPerSide - 1;
+    
+    for (int cz = z0; cz <= z1; cz++) {
+        for (int cx = x0; cx <= x1; cx++) {
+            float dx = fmaxf(fmaxf(cx * GRASS_CHUNK_SIZE - relativeX, relativeX - (cx + 1) * GRASS_CHUNK_SIZE), 0.0f);
+            float dz = fmaxf(fmaxf(cz * GRASS_CHUNK_SIZE - relativeZ, relativeZ - (cz + 1) * GRASS_CHUNK_SIZE), 0.0f);
+            float distance = sqrtf(dx * dx + dz * dz);
+            if (distance >= CULL_DISTANCE_GRASS) continue;
+            stats->chunksInRange++;
+            
+            int slot = grass->slots[cz * grass->chunksPerSide + cx];
+            if (slot != GRASS_NO_SLOT) {
+                grass->chunks[slot].lastUsed = grass->frame;
+                continue;
+            }
+            
+            // Keep the nearest missing chunks, up to a frame's worth of builds
+            int position = grass->buildCount;
+            if (position == GRASS_CHUNK_BUILDS_PER_FRAME) {
+                if (distance >= grass->builds[position - 1].distance) continue;
+                position--;
+            } else {
+                grass->buildCount++;
+            }
+            while (position > 0 && grass->builds[position - 1].distance > distance) {
+                grass->builds[position] = grass->builds[position - 1];
+                position--;
+            }
+            grass->builds[position].chunkX = cx;
+            grass->builds[position].chunkZ = cz;
+            grass->builds[position].distance = distance;
+        }
+    }
+    
+    // Slots are taken only from chunks out of range, so a full pool builds fewer chunks
+    int builds = 0;
+    for (int b = 0; b < grass->buildCount; b++) {
+        int slot = grass_takeSlot(grass);
+        if (slot == GRASS_NO_SLOT) break;
+        grass->builds[b].slot = slot;
+        grass->chunks[slot].chunkX = grass->builds[b].chunkX;
+        grass->chunks[slot].chunkZ = grass->builds[b].chunkZ;
+        grass->chunks[slot].lastUsed = grass->frame;
+        builds++;
+    }
+    grass->buildCount = builds;
+    grass_buildChunks(grass);
+    
+    // Whole-chunk culling, then a draw count per chunk from its nearest point
+    float planes[6][4];
+    bvh_frustumFromMatrix(viewProjection, planes);
+    size_t wanted = 0;
+    for (int s = 0; s < GRASS_MAX_CHUNKS; s++) {
+        GrassChunk* chunk = &grass->chunks[s];
+        if (chunk->chunkX == GRASS_NO_SLOT) continue;
+        stats->chunksResident++;
+        if (chunk->lastUsed != grass->frame || chunk->bladeCount == 0) continue;
+        stats->bladesInRange += chunk->bladeCount;
+        
+        float density = grass_density(grass_boxDistance(chunk->boxMin, chunk->boxMax, cameraPosition));
+        if (density <= 0.0f) continue;
+        if (grass_boxOutside(planes, chunk->boxMin, chunk->boxMax) ||
+            (occlusion && !occlusion_testBox(occlusion, chunk->boxMin, chunk->boxMax))) {
+            stats->chunksCulled++;
+            continue;
+        }
+        
+        int threshold = (int)ceilf(density * 255.0f);
+        grass->drawSlots[grass->drawCount] = s;
+        grass->drawCounts[grass->drawCount] = chunk->thresholdCounts[threshold > 256 ? 256 : threshold];
+        wanted += grass->drawCounts[grass->drawCount];
+        grass->drawCount++;
+    }
+    
+    // Over budget: scale every density down by the same factor (the shader applies it too,
+    // so blades shrink away in threshold order instead of whole chunks vanishing)
+    grass->densityScale = 1.0f;
+    if (wanted > GRASS_INSTANCES) {
+        grass->densityScale = (float)GRASS_INSTANCES / (float)wanted;
+        for (int d = 0; d < grass->drawCount; d++) {
+            const GrassChunk* chunk = &grass->chunks[grass->drawSlots[d]];
+            float density = grass_density(grass_boxDistance(chunk->boxMin, chunk->boxMax, cameraPosition)) * grass->densityScale;
+            int threshold = (int)ceilf(density * 255.0f);
+            grass->drawCounts[d] = chunk->thresholdCounts[threshold > 256 ? 256 : threshold];
+        }
+    }
+    
+    stats->chunksVisible = (size_t)grass->drawCount;
+    stats->densityScale = grass->densityScale;
+}
+
+// Draw the visible chunks into the bound G-buffer, swaying in the wind field
+void grass_draw(GrassSystem* grass, const WindField* windField, GLuint windTexture) {
+    if (!grass->enabled || !grass->shader || grass->drawCount == 0) return;
+    
+    GLuint shader = grass->shader;
+    shader_use(shader);
+    shader_setVec4(shader, "density", GRASS_FULL_DENSITY_DISTANCE, CULL_DISTANCE_GRASS, grass->densityScale, GRASS_FADE_BAND);
+    shader_setVec2(shader, "bladeSize", GRASS_BLADE_WIDTH, GRASS_BLADE_HEIGHT);
+    
+    float windTransform[3];
+    windField_getTextureTransform(windField, windTransform);
+    shader_setVec3(shader, "windTransform", windTransform[0], windTransform[1], windTransform[2]);
+    shader_setVec2(shader, "meanWind", windField->windX, windField->windZ);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, windTexture);
+    shader_setInt(shader, "windTexture", 0);
+    
+    // Blades are flat, so both sides are drawn
+    GLboolean cull = glIsEnabled(GL_CULL_FACE);
+    glDisable(GL_CULL_FACE);
+    for (int d = 0; d < grass->drawCount; d++) {
+        if (grass->drawCounts[d] == 0) continue;
+        glBindVertexArray(grass->chunks[grass->drawSlots[d]].VAO);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, GRASS_BLADE_VERTICES, (GLsizei)grass->drawCounts[d]);
+        grass->stats.bladesDrawn += grass->drawCounts[d];
+    }
+    glBindVertexArray(0);
+    if (cull) glEnable(GL_CULL_FACE);
+}
+
+// Get last frame's counters
+const GrassStats* grass_getStats(const GrassSystem* grass) {
+    return &grass->stats;
+}
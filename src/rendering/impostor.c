@@ -0,0 +1,522 @@
+#include "rendering/impostor.h"
+#include "utils/profiler.h"
+#include "utils/mesh_optimizer.h"
+#include <sys/stat.h>
+#include <errno.h>
+
+// Side length of a whole atlas in texels
+#define IMPOSTOR_ATLAS_SIZE (IMPOSTOR_FRAMES * IMPOSTOR_FRAME_SIZE)
+
+// Cache file path for one atlas key
+static void impostor_cachePath(uint64_t key, char* path, size_t size) {
+    snprintf(path, size, "%s/%016llx.imp", IMPOSTOR_CACHE_DIR, (unsigned long long)key);
+}
+
+// Create the cache directory and its parent (existing directories are fine)
+static bool impostor_makeCacheDir() {
+    char path[256];
+    snprintf(path, sizeof(path), "%s", IMPOSTOR_CACHE_DIR);
+    
+    for (char* p = path + 1; ; p++) {
+        if (*p != '/' && *p != '\0') continue;
+        
+        char saved = *p;
+        *p = '\0';
+        if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "Failed to create impostor cache directory: %s\n", path);
+            return false;
+        }
+        *p = saved;
+        if (saved == '\0') break;
+    }
+    return true;
+}
+
+// 64-bit FNV-1a over a byte range, continuing from hash
+static uint64_t impostor_hash(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Hash a buffer object's contents; buffer must be bound to target
+static uint64_t impostor_hashBuffer(uint64_t hash, GLenum target) {
+    GLint size = 0;
+    glGetBufferParameteriv(target, GL_BUFFER_SIZE, &size);
+    if (size <= 0) return hash;
+    
+    void* data = malloc((size_t)size);
+    if (!data) return hash;
+    glGetBufferSubData(target, 0, size, data);
+    hash = impostor_hash(hash, data, (size_t)size);
+    free(data);
+    return hash;
+}
+
+// One position from read-back vertex data (float, or half float for quantized meshes)
+static void impostor_readPosition(const unsigned char* vertex, GLint type, float* position) {
+    if (type == GL_HALF_FLOAT) {
+        uint16_t half[3];
+        memcpy(half, vertex, sizeof(half));
+        for (int axis = 0; axis < 3; axis++) position[axis] = meshOptimizer_halfToFloat(half[axis]);
+    } else {
+        memcpy(position, vertex, sizeof(float) * 3);
+    }
+}
+
+// Read back the mesh positions for its bounds, and hash geometry, material and bake settings
+static bool impostor_inspectMesh(const Mesh* mesh, const Material* material, uint64_t* key, float* center, float* radius) {
+    glBindVertexArray(mesh->VAO);
+    
+    GLint positionBuffer = 0, stride = 0, components = 0, type = GL_FLOAT;
+    GLvoid* offset = NULL;
+    glGetVertexAttribiv(0, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &positionBuffer);
+    glGetVertexAttribiv(0, GL_VERTEX_ATTRIB_ARRAY_STRIDE, &stride);
+    glGetVertexAttribiv(0, GL_VERTEX_ATTRIB_ARRAY_SIZE, &components);
+    glGetVertexAttribiv(0, GL_VERTEX_ATTRIB_ARRAY_TYPE, &type);
+    glGetVertexAttribPointerv(0, GL_VERTEX_ATTRIB_ARRAY_POINTER, &offset);
+    if (positionBuffer == 0 || components < 3) {
+        glBindVertexArray(0);
+        return false;
+    }
+    if (stride == 0) stride = components * (GLint)(type == GL_HALF_FLOAT ? sizeof(uint16_t) : sizeof(float));
+    
+    glBindBuffer(GL_ARRAY_BUFFER, (GLuint)positionBuffer);
+    GLint size = 0;
+    glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
+    unsigned char* data = size > 0 ? (unsigned char*)malloc((size_t)size) : NULL;
+    if (!data) {
+        glBindVertexArray(0);
+        return false;
+    }
+    glGetBufferSubData(GL_ARRAY_BUFFER, 0, size, data);
+    
+    // Bounding box centre, then the farthest vertex from it
+    float boxMin[3] = { INFINITY, INFINITY, INFINITY };
+    float boxMax[3] = { -INFINITY, -INFINITY, -INFINITY };
+    size_t base = (size_t)offset;
+    size_t vertexCount = size > (GLint)base ? ((size_t)size - base) / (size_t)stride : 0;
+    for (size_t i = 0; i < vertexCount; i++) {
+        float position[3];
+        impostor_readPosition(data + base + i * stride, type, position);
+        for (int axis = 0; axis < 3; axis++) {
+            boxMin[axis] = fminf(boxMin[axis], position[axis]);
+            boxMax[axis] = fmaxf(boxMax[axis], position[axis]);
+        }
+    }
+    
+    float maxDistance2 = 0.0f;
+    for (int axis = 0; axis < 3; axis++) center[axis] = (boxMin[axis] + boxMax[axis]) * 0.5f;
+    for (size_t i = 0; i < vertexCount; i++) {
+        float position[3];
+        impostor_readPosition(data + base + i * stride, type, position);
+        float dx = position[0] - center[0];
+        float dy = position[1] - center[1];
+        float dz = position[2] - center[2];
+        maxDistance2 = fmaxf(maxDistance2, dx * dx + dy * dy + dz * dz);
+    }
+    *radius = sqrtf(maxDistance2);
+    
+    // Key: vertex and index data, material inputs and everything that shapes the bake
+    uint64_t hash = impostor_hash(14695981039346656037ull, data, (size_t)size);
+    free(data);
+    if (mesh->EBO) hash = impostor_hashBuffer(hash, GL_ELEMENT_ARRAY_BUFFER);
+    
+    uint32_t settings[4] = { IMPOSTOR_CACHE_VERSION, IMPOSTOR_FRAMES, IMPOSTOR_FRAME_SIZE, mesh->numIndices };
+    hash = impostor_hash(hash, settings, sizeof(settings));
+    if (material) {
+        float scalars[3] = { material->roughness, material->metallic, material->ao };
+        hash = impostor_hash(hash, scalars, sizeof(scalars));
+        
+        if (material->diffuseMap) {
+            GLint width = 0, height = 0;
+            glBindTexture(GL_TEXTURE_2D, material->diffuseMap);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+            glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+            unsigned char* pixels = width > 0 && height > 0 ? (unsigned char*)malloc((size_t)width * height * 4) : NULL;
+            if (pixels) {
+                glPixelStorei(GL_PACK_ALIGNMENT, 1);
+                glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+                hash = impostor_hash(hash, pixels, (size_t)width * height * 4);
+                free(pixels);
+            }
+            glBindTexture(GL_TEXTURE_2D, 0);
+        }
+    }
+    
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    *key = hash;
+    return *radius > 0.0f;
+}
+
+// Allocate the two atlas textures, optionally with initial pixels
+static void impostor_createTextures(ImpostorAtlas* atlas, const void* albedo, const void* normalDepth) {
+    GLuint* textures[2] = { &atlas->albedoTexture, &atlas->normalDepthTexture };
+    const void* pixels[2] = { albedo, normalDepth };
+    
+    for (int i = 0; i < 2; i++) {
+        glGenTextures(1, textures[i]);
+        glBindTexture(GL_TEXTURE_2D, *textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        
+        // Stop before mips start mixing neighbouring frames
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 3);
+        if (pixels[i]) glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Load an atlas from the disk cache; false on miss or mismatch
+static bool impostor_loadCache(ImpostorAtlas* atlas) {
+    char path[256];
+    impostor_cachePath(atlas->key, path, sizeof(path));
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    
+    ImpostorCacheHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              header.magic == IMPOSTOR_CACHE_MAGIC &&
+              header.version == IMPOSTOR_CACHE_VERSION &&
+              header.frames == IMPOSTOR_FRAMES &&
+              header.frameSize == IMPOSTOR_FRAME_SIZE &&
+              header.key == atlas->key;
+    
+    size_t layerSize = (size_t)IMPOSTOR_ATLAS_SIZE * IMPOSTOR_ATLAS_SIZE * 4;
+    unsigned char* pixels = ok ? (unsigned char*)malloc(layerSize * 2) : NULL;
+    ok = pixels && fread(pixels, layerSize * 2, 1, file) == 1;
+    fclose(file);
+    
+    if (ok) {
+        memcpy(atlas->center, header.center, sizeof(atlas->center));
+        atlas->radius = header.radius;
+        impostor_createTextures(atlas, pixels, pixels + layerSize);
+    } else {
+        fprintf(stderr, "Ignoring stale impostor cache: %s\n", path);
+    }
+    free(pixels);
+    return ok;
+}
+
+// Write a baked atlas to the disk cache
+static void impostor_saveCache(const ImpostorAtlas* atlas) {
+    if (!impostor_makeCacheDir()) return;
+    
+    size_t layerSize = (size_t)IMPOSTOR_ATLAS_SIZE * IMPOSTOR_ATLAS_SIZE * 4;
+    unsigned char* pixels = (unsigned char*)malloc(layerSize * 2);
+    if (!pixels) return;
+    
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, atlas->albedoTexture);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glBindTexture(GL_TEXTURE_2D, atlas->normalDepthTexture);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels + layerSize);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    ImpostorCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = IMPOSTOR_CACHE_MAGIC;
+    header.version = IMPOSTOR_CACHE_VERSION;
+    header.frames = IMPOSTOR_FRAMES;
+    header.frameSize = IMPOSTOR_FRAME_SIZE;
+    header.key = atlas->key;
+    memcpy(header.center, atlas->center, sizeof(header.center));
+    header.radius = atlas->radius;
+    
+    char path[256];
+    impostor_cachePath(atlas->key, path, sizeof(path));
+    FILE* file = fopen(path, "wb");
+    if (file) {
+        if (fwrite(&header, sizeof(header), 1, file) != 1 || fwrite(pixels, layerSize * 2, 1, file) != 1) {
+            fprintf(stderr, "Failed to write impostor cache: %s\n", path);
+        }
+        fclose(file);
+    }
+    free(pixels);
+}
+
+// Render the mesh into every octahedral frame of the atlas
+static bool impostor_bake(ImpostorSystem* system, ImpostorAtlas* atlas) {
+    if (!system->bakeShader) return false;
+    impostor_createTextures(atlas, NULL, NULL);
+    
+    // Save the state the frame loop relies on
+    GLint previousFramebuffer = 0;
+    GLint viewport[4];
+    GLfloat clearColor[4];
+    GLboolean blend = glIsEnabled(GL_BLEND);
+    GLboolean cull = glIsEnabled(GL_CULL_FACE);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean depthMask = GL_TRUE;
+    glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previousFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColor);
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, system->bakeFramebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, atlas->albedoTexture, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, atlas->normalDepthTexture, 0);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    
+    if (complete) {
+        GLenum attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(2, attachments);
+        glViewport(0, 0, IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glDepthMask(GL_TRUE); // The depth clear is masked otherwise
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glDisable(GL_BLEND);
+        glDisable(GL_CULL_FACE);
+        glEnable(GL_DEPTH_TEST);
+        
+        GLuint shader = system->bakeShader;
+        const Material* material = atlas->material;
+        shader_use(shader);
+        shader_setVec4(shader, "boundingSphere", atlas->center[0], atlas->center[1], atlas->center[2], atlas->radius);
+        shader_setInt(shader, "frames", IMPOSTOR_FRAMES);
+        shader_setInt(shader, "texture_diffuse", 0);
+        texture_bind(material && material->diffuseMap ? material->diffuseMap : system->fallbackTexture, GL_TEXTURE0);
+        
+        for (int y = 0; y < IMPOSTOR_FRAMES; y++) {
+            for (int x = 0; x < IMPOSTOR_FRAMES; x++) {
+                glViewport(x * IMPOSTOR_FRAME_SIZE, y * IMPOSTOR_FRAME_SIZE, IMPOSTOR_FRAME_SIZE, IMPOSTOR_FRAME_SIZE);
+                shader_setVec2(shader, "frame", (float)x, (float)y);
+                model_renderMesh((Mesh*)atlas->mesh, shader);
+            }
+        }
+        
+        glBindTexture(GL_TEXTURE_2D, atlas->albedoTexture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, atlas->normalDepthTexture);
+        glGenerateMipmap(GL_TEXTURE_2D);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    } else {
+        fprintf(stderr, "Impostor bake framebuffer is not complete!\n");
+    }
+    
+    // Restore
+    glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)previousFramebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glClearColor(clearColor[0], clearColor[1], clearColor[2], clearColor[3]);
+    if (blend) glEnable(GL_BLEND);
+    if (cull) glEnable(GL_CULL_FACE);
+    if (!depthTest) glDisable(GL_DEPTH_TEST);
+    glDepthMask(depthMask);
+    return complete;
+}
+
+// Initialize the impostor system
+void impostor_init(ImpostorSystem* system) {
+    memset(system, 0, sizeof(ImpostorSystem));
+    system->enabled = true;
+    
+    system->bakeShader = shader_load("src/shaders/impostor_bake.vert", "src/shaders/impostor_bake.frag");
+    system->drawShader = shader_load("src/shaders/impostor.vert", "src/shaders/impostor.frag");
+    
+    // Bake target; the atlas textures are attached per bake
+    glGenFramebuffers(1, &system->bakeFramebuffer);
+    glGenRenderbuffers(1, &system->bakeDepthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, system->bakeDepthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, IMPOSTOR_ATLAS_SIZE, IMPOSTOR_ATLAS_SIZE);
+    glBindFramebuffer(GL_FRAMEBUFFER, system->bakeFramebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, system->bakeDepthBuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    
+    // Mid-grey stand-in for materials without a diffuse map
+    unsigned char grey[4] = { 160, 160, 160, 255 };
+    glGenTextures(1, &system->fallbackTexture);
+    glBindTexture(GL_TEXTURE_2D, system->fallbackTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    // Unit quad corners, expanded along the chosen frame's axes in the vertex shader
+    float corners[] = {
+        -1.0f, -1.0f,
+         1.0f, -1.0f,
+        -1.0f,  1.0f,
+         1.0f,  1.0f
+    };
+    glGenVertexArrays(1, &system->quadVAO);
+    glGenBuffers(1, &system->quadVBO);
+    glGenBuffers(1, &system->instanceBuffer);
+    glBindVertexArray(system->quadVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, system->quadVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    
+    // Instance matrices use the same locations as the instanced mesh path
+    glBindBuffer(GL_ARRAY_BUFFER, system->instanceBuffer);
+    for (int i = 0; i < 4; i++) {
+        glEnableVertexAttribArray(4 + i);
+        glVertexAttribDivisor(4 + i, 1);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Release atlases and GL objects
+void impostor_cleanup(ImpostorSystem* system) {
+    for (int i = 0; i < system->atlasCount; i++) {
+        ImpostorAtlas* atlas = &system->atlases[i];
+        if (atlas->albedoTexture) glDeleteTextures(1, &atlas->albedoTexture);
+        if (atlas->normalDepthTexture) glDeleteTextures(1, &atlas->normalDepthTexture);
+        free(atlas->matrices);
+    }
+    system->atlasCount = 0;
+    
+    shader_delete(system->bakeShader);
+    shader_delete(system->drawShader);
+    glDeleteFramebuffers(1, &system->bakeFramebuffer);
+    glDeleteRenderbuffers(1, &system->bakeDepthBuffer);
+    glDeleteTextures(1, &system->fallbackTexture);
+    glDeleteVertexArrays(1, &system->quadVAO);
+    glDeleteBuffers(1, &system->quadVBO);
+    glDeleteBuffers(1, &system->instanceBuffer);
+}
+
+// Find the atlas for a mesh/material pair, loading it from the cache or baking it on first use
+ImpostorAtlas* impostor_getAtlas(ImpostorSystem* system, const Mesh* mesh, const Material* material) {
+    if (!system->enabled || !mesh || !mesh->VAO) return NULL;
+    
+    for (int i = 0; i < system->atlasCount; i++) {
+        ImpostorAtlas* atlas = &system->atlases[i];
+        if (atlas->mesh == mesh && atlas->material == material) {
+            return atlas->valid ? atlas : NULL;
+        }
+    }
+    if (system->atlasCount >= IMPOSTOR_MAX_ATLASES) return NULL;
+    
+    ImpostorAtlas* atlas = &system->atlases[system->atlasCount++];
+    memset(atlas, 0, sizeof(ImpostorAtlas));
+    atlas->mesh = mesh;
+    atlas->material = material;
+    
+    double start = profiler_now();
+    if (!impostor_inspectMesh(mesh, material, &atlas->key, atlas->center, &atlas->radius)) {
+        fprintf(stderr, "Cannot build an impostor for a mesh without readable positions\n");
+        return NULL;
+    }
+    
+    const char* source = "loaded";
+    if (impostor_loadCache(atlas)) {
+        atlas->valid = true;
+        system->stats.atlasesLoaded++;
+        system->stats.loadTime += (float)(profiler_now() - start);
+    } else if (impostor_bake(system, atlas)) {
+        impostor_saveCache(atlas);
+        atlas->valid = true;
+        source = "baked";
+        system->stats.atlasesBaked++;
+        system->stats.bakeTime += (float)(profiler_now() - start);
+    }
+    
+    if (atlas->valid) {
+        printf("Impostor %016llx %s in %.2f ms\n", (unsigned long long)atlas->key, source, profiler_now() - start);
+    }
+    return atlas->valid ? atlas : NULL;
+}
+
+// Start a new frame of impostor instances
+void impostor_begin(ImpostorSystem* system) {
+    for (int i = 0; i < system->atlasCount; i++) {
+        system->atlases[i].instanceCount = 0;
+    }
+}
+
+// Queue instance model matrices for an atlas; they fade in over IMPOSTOR_FADE_RANGE beyond fadeStart
+void impostor_addInstances(ImpostorSystem* system, ImpostorAtlas* atlas, const float* matrices, size_t count, float fadeStart) {
+    if (!system->enabled || !atlas || count == 0) return;
+    atlas->fadeStart = fadeStart;
+    
+    if (atlas->instanceCount + count > atlas->instanceCapacity) {
+        size_t capacity = atlas->instanceCapacity ? atlas->instanceCapacity * 2 : 256;
+        while (capacity < atlas->instanceCount + count) capacity *= 2;
+        float* resized = (float*)realloc(atlas->matrices, sizeof(float) * 16 * capacity);
+        if (!resized) return;
+        atlas->matrices = resized;
+        atlas->instanceCapacity = capacity;
+    }
+    
+    memcpy(atlas->matrices + atlas->instanceCount * 16, matrices, sizeof(float) * 16 * count);
+    atlas->instanceCount += count;
+}
+
+// Draw all queued impostors into the bound G-buffer
+void impostor_draw(ImpostorSystem* system) {
+    system->stats.instancesDrawn = 0;
+    system->stats.drawCalls = 0;
+    if (!system->enabled || !system->drawShader) return;
+    
+    size_t total = 0;
+    for (int i = 0; i < system->atlasCount; i++) {
+        total += system->atlases[i].instanceCount;
+    }
+    if (total == 0) return;
+    
+    // One orphaned upload holds every atlas's instances back to back
+    glBindBuffer(GL_ARRAY_BUFFER, system->instanceBuffer);
+    if (total > system->instanceBufferCapacity) {
+        system->instanceBufferCapacity = total * 2;
+    }
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 16 * system->instanceBufferCapacity, NULL, GL_STREAM_DRAW);
+    size_t offset = 0;
+    for (int i = 0; i < system->atlasCount; i++) {
+        ImpostorAtlas* atlas = &system->atlases[i];
+        if (atlas->instanceCount == 0) continue;
+        glBufferSubData(GL_ARRAY_BUFFER, sizeof(float) * 16 * offset, sizeof(float) * 16 * atlas->instanceCount, atlas->matrices);
+        offset += atlas->instanceCount;
+    }
+    
+    GLuint shader = system->drawShader;
+    shader_use(shader);
+    shader_setInt(shader, "frames", IMPOSTOR_FRAMES);
+    shader_setFloat(shader, "fadeRange", IMPOSTOR_FADE_RANGE);
+    shader_setInt(shader, "albedoAtlas", 0);
+    shader_setInt(shader, "normalDepthAtlas", 1);
+    glBindVertexArray(system->quadVAO);
+    
+    offset = 0;
+    for (int i = 0; i < system->atlasCount; i++) {
+        ImpostorAtlas* atlas = &system->atlases[i];
+        if (atlas->instanceCount == 0) continue;
+        
+        // GL 4.1 has no base instance, so re-point the matrix stream per atlas
+        for (int column = 0; column < 4; column++) {
+            glVertexAttribPointer(4 + column, 4, GL_FLOAT, GL_FALSE, sizeof(float) * 16,
+                                  (void*)(sizeof(float) * (16 * offset + 4 * column)));
+        }
+        
+        const Material* material = atlas->material;
+        shader_setVec4(shader, "boundingSphere", atlas->center[0], atlas->center[1], atlas->center[2], atlas->radius);
+        shader_setFloat(shader, "fadeStart", atlas->fadeStart);
+        shader_setFloat(shader, "roughness", material ? material->roughness : 0.5f);
+        shader_setFloat(shader, "metallic", material ? material->metallic : 0.0f);
+        shader_setFloat(shader, "ao", material ? material->ao : 1.0f);
+        texture_bind(atlas->albedoTexture, GL_TEXTURE0);
+        texture_bind(atlas->normalDepthTexture, GL_TEXTURE1);
+        
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, (GLsizei)atlas->instanceCount);
+        system->stats.instancesDrawn += atlas->instanceCount;
+        system->stats.drawCalls++;
+        offset += atlas->instanceCount;
+    }
+    
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Get bake and draw counters
+const ImpostorStats* impostor_getStats(const ImpostorSystem* system) {
+    return &system->stats;
+}
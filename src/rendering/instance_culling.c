@@ -0,0 +1,538 @@
+#include "rendering/instance_culling.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define INSTANCE_CULL_SSE
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define INSTANCE_CULL_NEON
+#endif
+
+// Below this many instances the calling thread culls alone
+#define INSTANCE_CULL_PARALLEL_THRESHOLD (INSTANCE_CULL_CHUNK_SIZE * 2)
+
+// Initialize culler; chunks run on the given pool (NULL = calling thread only)
+void instanceCulling_init(InstanceCuller* culler, ThreadPool* pool) {
+    memset(culler, 0, sizeof(InstanceCuller));
+    culler->enabled = true;
+    culler->pool = pool;
+    culler->lodBias = MESH_LOD_BIAS;
+    
+    static const InstanceCullCategory defaults[INSTANCE_CULL_TYPE_COUNT] = {
+        { "Trees", "Trees submitted", "Trees visible", "Trees occluded", "Trees impostors", CULL_DISTANCE_TREES, 6.0f, 0, 0, 0, 0 },
+        { "Flowers", "Flowers submitted", "Flowers visible", "Flowers occluded", "Flowers impostors", CULL_DISTANCE_FLOWERS, 0.5f, 0, 0, 0, 0 },
+        { "Mushrooms", "Mushrooms submitted", "Mushrooms visible", "Mushrooms occluded", "Mushrooms impostors", CULL_DISTANCE_MUSHROOMS, 0.4f, 0, 0, 0, 0 },
+        { "Lanterns", "Lanterns submitted", "Lanterns visible", "Lanterns occluded", "Lanterns impostors", CULL_DISTANCE_LANTERNS, 1.5f, 0, 0, 0, 0 }
+    };
+    memcpy(culler->categories, defaults, sizeof(defaults));
+}
+
+// Free all sets
+void instanceCulling_cleanup(InstanceCuller* culler) {
+    for (size_t i = 0; i < culler->setCapacity; i++) {
+        InstanceCullSet* set = &culler->sets[i];
+        free(set->x);
+        free(set->y);
+        free(set->z);
+        free(set->radius);
+        free(set->order);
+        free(set->clusterBounds);
+        free(set->visibleMatrices);
+        free(set->visibleLods);
+        free(set->sortedMatrices);
+        free(set->impostorMatrices);
+        if (set->shadowBuffer) glDeleteBuffers(1, &set->shadowBuffer);
+    }
+    free(culler->sets);
+    free(culler->chunks);
+    
+    culler->sets = NULL;
+    culler->chunks = NULL;
+    culler->setCount = 0;
+    culler->setCapacity = 0;
+    culler->chunkCount = 0;
+    culler->chunkCapacity = 0;
+}
+
+// Extract normalized frustum planes (ax + by + cz + d >= 0 inside) from projection * view
+void instanceCulling_begin(InstanceCuller* culler, const float* viewMatrix, const float* projectionMatrix, const float* cameraPosition, OcclusionCuller* occlusion, ImpostorSystem* impostors) {
+    float m[16];
+    for (int col = 0; col < 4; col++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                sum += projectionMatrix[k * 4 + row] * viewMatrix[col * 4 + k];
+            }
+            m[col * 4 + row] = sum;
+        }
+    }
+    
+    // Rows of the column-major matrix
+    for (int i = 0; i < 3; i++) {
+        for (int side = 0; side < 2; side++) {
+            float sign = side == 0 ? 1.0f : -1.0f;
+            float* plane = culler->planes[i * 2 + side];
+            for (int col = 0; col < 4; col++) {
+                plane[col] = m[col * 4 + 3] + sign * m[col * 4 + i];
+            }
+            
+            float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+            if (length > 0.0f) {
+                for (int col = 0; col < 4; col++) plane[col] /= length;
+            }
+        }
+    }
+    
+    culler->cameraPosition[0] = cameraPosition[0];
+    culler->cameraPosition[1] = cameraPosition[1];
+    culler->cameraPosition[2] = cameraPosition[2];
+    culler->lodScale = projectionMatrix[5] * culler->lodBias;
+    
+    for (int type = 0; type < INSTANCE_CULL_TYPE_COUNT; type++) {
+        culler->categories[type].submitted = 0;
+        culler->categories[type].visible = 0;
+        culler->categories[type].occluded = 0;
+        culler->categories[type].impostors = 0;
+    }
+    
+    culler->occlusion = occlusion;
+    culler->impostors = impostors;
+    culler->setCursor = 0;
+    culler->chunkCount = 0;
+}
+
+// Interleave the low 16 bits of x and z into a 32-bit Morton code
+static uint32_t instanceCulling_morton(uint32_t x, uint32_t z) {
+    uint32_t code = 0;
+    for (int bit = 0; bit < 16; bit++) {
+        code |= ((x >> bit) & 1u) << (bit * 2);
+        code |= ((z >> bit) & 1u) << (bit * 2 + 1);
+    }
+    return code;
+}
+
+// Sort key for building spatially coherent clusters
+typedef struct {
+    uint32_t key;
+    uint32_t index;
+} InstanceSortKey;
+
+static int instanceCulling_compareKeys(const void* a, const void* b) {
+    const InstanceSortKey* ka = (const InstanceSortKey*)a;
+    const InstanceSortKey* kb = (const InstanceSortKey*)b;
+    if (ka->key != kb->key) return ka->key < kb->key ? -1 : 1;
+    return ka->index < kb->index ? -1 : (ka->index > kb->index ? 1 : 0);
+}
+
+// (Re)build the SoA bounds for one object's instances
+static bool instanceCulling_buildSet(InstanceCuller* culler, InstanceCullSet* set, Object* object, InstanceCullType type) {
+    free(set->x);
+    free(set->y);
+    free(set->z);
+    free(set->radius);
+    free(set->order);
+    free(set->clusterBounds);
+    free(set->visibleMatrices);
+    free(set->visibleLods);
+    free(set->sortedMatrices);
+    free(set->impostorMatrices);
+    GLuint shadowBuffer = set->shadowBuffer;
+    memset(set, 0, sizeof(InstanceCullSet));
+    set->shadowBuffer = shadowBuffer;
+    
+    size_t count = object->instanceCount;
+    size_t clusterCount = (count + INSTANCE_CULL_CLUSTER_SIZE - 1) / INSTANCE_CULL_CLUSTER_SIZE;
+    
+    // Pad to a multiple of 4 so SIMD loads never run past the end
+    size_t padded = (count + 3) & ~(size_t)3;
+    set->x = (float*)calloc(padded, sizeof(float));
+    set->y = (float*)calloc(padded, sizeof(float));
+    set->z = (float*)calloc(padded, sizeof(float));
+    set->radius = (float*)calloc(padded, sizeof(float));
+    set->order = (uint32_t*)malloc(sizeof(uint32_t) * count);
+    set->clusterBounds = (float*)malloc(sizeof(float) * 6 * clusterCount);
+    set->visibleMatrices = (float*)malloc(sizeof(float) * 16 * count);
+    if (object->impostor) set->impostorMatrices = (float*)malloc(sizeof(float) * 16 * count);
+    bool hasLods = object->mesh && object->mesh->lodCount > 1;
+    if (hasLods) {
+        set->visibleLods = (uint8_t*)malloc(count);
+        set->sortedMatrices = (float*)malloc(sizeof(float) * 16 * count);
+    }
+    InstanceSortKey* keys = (InstanceSortKey*)malloc(sizeof(InstanceSortKey) * count);
+    if (!set->x || !set->y || !set->z || !set->radius || !set->order || !set->clusterBounds || !set->visibleMatrices || (object->impostor && !set->impostorMatrices) ||
+        (hasLods && (!set->visibleLods || !set->sortedMatrices)) || !keys) {
+        fprintf(stderr, "Failed to allocate culling data for %s\n", object->name ? object->name : "object");
+        free(keys);
+        return false;
+    }
+    
+    // Order instances along a Morton curve over their XZ extent
+    float minX = INFINITY, maxX = -INFINITY, minZ = INFINITY, maxZ = -INFINITY;
+    for (size_t i = 0; i < count; i++) {
+        const float* model = object->instances[i].modelMatrix;
+        minX = fminf(minX, model[12]);
+        maxX = fmaxf(maxX, model[12]);
+        minZ = fminf(minZ, model[14]);
+        maxZ = fmaxf(maxZ, model[14]);
+    }
+    float scaleX = maxX > minX ? 65535.0f / (maxX - minX) : 0.0f;
+    float scaleZ = maxZ > minZ ? 65535.0f / (maxZ - minZ) : 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        const float* model = object->instances[i].modelMatrix;
+        keys[i].key = instanceCulling_morton((uint32_t)((model[12] - minX) * scaleX), (uint32_t)((model[14] - minZ) * scaleZ));
+        keys[i].index = (uint32_t)i;
+    }
+    qsort(keys, count, sizeof(InstanceSortKey), instanceCulling_compareKeys);
+    
+    float meshRadius = object->mesh ? object->mesh->boundingRadius : 0.0f;
+    if (meshRadius <= 0.0f) meshRadius = culler->categories[type].defaultRadius;
+    
+    for (size_t i = 0; i < count; i++) {
+        set->order[i] = keys[i].index;
+        const float* model = object->instances[keys[i].index].modelMatrix;
+        set->x[i] = model[12];
+        set->y[i] = model[13];
+        set->z[i] = model[14];
+        
+        // Largest axis scale of the instance transform
+        float scale = 0.0f;
+        for (int axis = 0; axis < 3; axis++) {
+            const float* column = &model[axis * 4];
+            float length = sqrtf(column[0] * column[0] + column[1] * column[1] + column[2] * column[2]);
+            if (length > scale) scale = length;
+        }
+        set->radius[i] = meshRadius * scale;
+        
+        // Grow the cluster box by the instance's bounding sphere
+        float* bounds = &set->clusterBounds[(i / INSTANCE_CULL_CLUSTER_SIZE) * 6];
+        if (i % INSTANCE_CULL_CLUSTER_SIZE == 0) {
+            bounds[0] = bounds[1] = bounds[2] = INFINITY;
+            bounds[3] = bounds[4] = bounds[5] = -INFINITY;
+        }
+        float center[3] = { set->x[i], set->y[i], set->z[i] };
+        for (int axis = 0; axis < 3; axis++) {
+            bounds[axis] = fminf(bounds[axis], center[axis] - set->radius[i]);
+            bounds[axis + 3] = fmaxf(bounds[axis + 3], center[axis] + set->radius[i]);
+        }
+    }
+    free(keys);
+    
+    // Unculled copy for shadow passes, staged through visibleMatrices (overwritten every frame)
+    if (!set->shadowBuffer) glGenBuffers(1, &set->shadowBuffer);
+    for (size_t i = 0; i < count; i++) {
+        memcpy(set->visibleMatrices + i * 16, object->instances[i].modelMatrix, sizeof(float) * 16);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, set->shadowBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 16 * count, set->visibleMatrices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    set->object = object;
+    set->type = type;
+    set->count = count;
+    set->source = object->instances;
+    return true;
+}
+
+// Queue the instances of a category of objects for this frame
+void instanceCulling_addObjects(InstanceCuller* culler, InstanceCullType type, Object* objects, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        Object* object = &objects[i];
+        if (!object->isInstanced) continue;
+        
+        object->visibleInstanceCount = 0;
+        object->shadowInstanceCount = 0;
+        if (!object->isVisible || !object->instances || object->instanceCount == 0) continue;
+        
+        // Sets are visited in the same order every frame
+        if (culler->setCursor >= culler->setCapacity) {
+            size_t capacity = culler->setCapacity ? culler->setCapacity * 2 : 64;
+            InstanceCullSet* sets = (InstanceCullSet*)realloc(culler->sets, sizeof(InstanceCullSet) * capacity);
+            if (!sets) return;
+            memset(sets + culler->setCapacity, 0, sizeof(InstanceCullSet) * (capacity - culler->setCapacity));
+            culler->sets = sets;
+            culler->setCapacity = capacity;
+        }
+        
+        size_t setIndex = culler->setCursor;
+        InstanceCullSet* set = &culler->sets[setIndex];
+        bool impostorChanged = (object->impostor != NULL) != (set->impostorMatrices != NULL);
+        bool lodsChanged = (object->mesh && object->mesh->lodCount > 1) != (set->visibleLods != NULL);
+        if (set->object != object || set->count != object->instanceCount || set->source != object->instances || set->type != type || impostorChanged || lodsChanged) {
+            if (!instanceCulling_buildSet(culler, set, object, type)) continue;
+        }
+        culler->setCursor++;
+        object->shadowInstanceBuffer = set->shadowBuffer;
+        object->shadowInstanceCount = set->shadowBuffer ? set->count : 0;
+        
+        // Split into chunks for the workers
+        for (size_t begin = 0; begin < set->count; begin += INSTANCE_CULL_CHUNK_SIZE) {
+            if (culler->chunkCount >= culler->chunkCapacity) {
+                size_t capacity = culler->chunkCapacity ? culler->chunkCapacity * 2 : 256;
+                InstanceCullChunk* chunks = (InstanceCullChunk*)realloc(culler->chunks, sizeof(InstanceCullChunk) * capacity);
+                if (!chunks) return;
+                culler->chunks = chunks;
+                culler->chunkCapacity = capacity;
+            }
+            
+            InstanceCullChunk* chunk = &culler->chunks[culler->chunkCount++];
+            chunk->set = setIndex;
+            chunk->begin = begin;
+            chunk->end = begin + INSTANCE_CULL_CHUNK_SIZE < set->count ? begin + INSTANCE_CULL_CHUNK_SIZE : set->count;
+            chunk->visible = 0;
+            chunk->occluded = 0;
+            chunk->impostors = 0;
+        }
+        
+        culler->categories[type].submitted += set->count;
+    }
+}
+
+// Test instances i..i+3; bit n of the result is set if instance i+n is visible
+static inline int instanceCulling_testFour(const InstanceCuller* culler, const InstanceCullSet* set, size_t i,
+                                           float maxDistance, float planeSlack) {
+#if defined(INSTANCE_CULL_SSE)
+    __m128 px = _mm_loadu_ps(set->x + i);
+    __m128 py = _mm_loadu_ps(set->y + i);
+    __m128 pz = _mm_loadu_ps(set->z + i);
+    __m128 r = _mm_loadu_ps(set->radius + i);
+    __m128 limit = _mm_sub_ps(_mm_setzero_ps(), _mm_add_ps(r, _mm_set1_ps(planeSlack)));
+    
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (int p = 0; p < 6; p++) {
+        const float* plane = culler->planes[p];
+        __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px, _mm_set1_ps(plane[0])), _mm_mul_ps(py, _mm_set1_ps(plane[1]))),
+                              _mm_add_ps(_mm_mul_ps(pz, _mm_set1_ps(plane[2])), _mm_set1_ps(plane[3])));
+        inside = _mm_and_ps(inside, _mm_cmpge_ps(d, limit));
+    }
+    
+    __m128 dx = _mm_sub_ps(px, _mm_set1_ps(culler->cameraPosition[0]));
+    __m128 dy = _mm_sub_ps(py, _mm_set1_ps(culler->cameraPosition[1]));
+    __m128 dz = _mm_sub_ps(pz, _mm_set1_ps(culler->cameraPosition[2]));
+    __m128 dist2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+    __m128 reach = _mm_add_ps(_mm_set1_ps(maxDistance), r);
+    inside = _mm_and_ps(inside, _mm_cmple_ps(dist2, _mm_mul_ps(reach, reach)));
+    
+    return _mm_movemask_ps(inside);
+#elif defined(INSTANCE_CULL_NEON)
+    float32x4_t px = vld1q_f32(set->x + i);
+    float32x4_t py = vld1q_f32(set->y + i);
+    float32x4_t pz = vld1q_f32(set->z + i);
+    float32x4_t r = vld1q_f32(set->radius + i);
+    float32x4_t limit = vnegq_f32(vaddq_f32(r, vdupq_n_f32(planeSlack)));
+    
+    uint32x4_t inside = vdupq_n_u32(0xFFFFFFFFu);
+    for (int p = 0; p < 6; p++) {
+        const float* plane = culler->planes[p];
+        float32x4_t d = vdupq_n_f32(plane[3]);
+        d = vmlaq_n_f32(d, px, plane[0]);
+        d = vmlaq_n_f32(d, py, plane[1]);
+        d = vmlaq_n_f32(d, pz, plane[2]);
+        inside = vandq_u32(inside, vcgeq_f32(d, limit));
+    }
+    
+    float32x4_t dx = vsubq_f32(px, vdupq_n_f32(culler->cameraPosition[0]));
+    float32x4_t dy = vsubq_f32(py, vdupq_n_f32(culler->cameraPosition[1]));
+    float32x4_t dz = vsubq_f32(pz, vdupq_n_f32(culler->cameraPosition[2]));
+    float32x4_t dist2 = vmlaq_f32(vmlaq_f32(vmulq_f32(dx, dx), dy, dy), dz, dz);
+    float32x4_t reach = vaddq_f32(vdupq_n_f32(maxDistance), r);
+    inside = vandq_u32(inside, vcleq_f32(dist2, vmulq_f32(reach, reach)));
+    
+    return (int)((vgetq_lane_u32(inside, 0) & 1) | (vgetq_lane_u32(inside, 1) & 2) |
+                 (vgetq_lane_u32(inside, 2) & 4) | (vgetq_lane_u32(inside, 3) & 8));
+#else
+    int mask = 0;
+    for (int lane = 0; lane < 4; lane++) {
+        float px = set->x[i + lane];
+        float py = set->y[i + lane];
+        float pz = set->z[i + lane];
+        float r = set->radius[i + lane];
+        
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++) {
+            const float* plane = culler->planes[p];
+            inside = plane[0] * px + plane[1] * py + plane[2] * pz + plane[3] >= -(r + planeSlack);
+        }
+        
+        float dx = px - culler->cameraPosition[0];
+        float dy = py - culler->cameraPosition[1];
+        float dz = pz - culler->cameraPosition[2];
+        float reach = maxDistance + r;
+        if (inside && dx * dx + dy * dy + dz * dz <= reach * reach) {
+            mask |= 1 << lane;
+        }
+    }
+    return mask;
+#endif
+}
+
+// Cull one chunk (thread pool task); survivors are written from the chunk's own offset in the output
+static void instanceCulling_processChunk(void* context, size_t chunkIndex) {
+    InstanceCuller* culler = (InstanceCuller*)context;
+    InstanceCullChunk* chunk = &culler->chunks[chunkIndex];
+    InstanceCullSet* set = &culler->sets[chunk->set];
+    float* out = set->visibleMatrices + chunk->begin * 16;
+    size_t visible = 0;
+    size_t occluded = 0;
+    size_t impostors = 0;
+    
+    // Disabled culling passes everything through the same compaction path
+    float maxDistance = culler->enabled ? culler->categories[set->type].maxDistance : INFINITY;
+    float planeSlack = culler->enabled ? 0.0f : INFINITY;
+    OcclusionCuller* occlusion = culler->enabled ? culler->occlusion : NULL;
+    
+    // Survivors past the impostor distance go to the impostor output; both lists keep
+    // the fade band so the mesh and impostor can cross-fade
+    float* impostorOut = set->impostorMatrices ? set->impostorMatrices + chunk->begin * 16 : NULL;
+    float impostorStart = set->object->impostorDistance;
+    bool useImpostors = impostorOut && culler->impostors && impostorStart > 0.0f;
+    float impostorStart2 = impostorStart * impostorStart;
+    float meshEnd2 = (impostorStart + IMPOSTOR_FADE_RANGE) * (impostorStart + IMPOSTOR_FADE_RANGE);
+    
+    // Mesh level per survivor from its projected size
+    uint8_t* lodOut = set->visibleLods ? set->visibleLods + chunk->begin : NULL;
+    const Mesh* mesh = set->object->mesh;
+    
+    for (size_t clusterBegin = chunk->begin; clusterBegin < chunk->end; clusterBegin += INSTANCE_CULL_CLUSTER_SIZE) {
+        size_t clusterEnd = clusterBegin + INSTANCE_CULL_CLUSTER_SIZE < chunk->end ? clusterBegin + INSTANCE_CULL_CLUSTER_SIZE : chunk->end;
+        
+        // Whole cluster hidden behind occluders
+        const float* bounds = &set->clusterBounds[(clusterBegin / INSTANCE_CULL_CLUSTER_SIZE) * 6];
+        if (occlusion && !occlusion_testBox(occlusion, bounds, bounds + 3)) {
+            occluded += clusterEnd - clusterBegin;
+            continue;
+        }
+        
+        for (size_t i = clusterBegin; i < clusterEnd; i += 4) {
+            int mask = instanceCulling_testFour(culler, set, i, maxDistance, planeSlack);
+            
+            // Mask off padding past the cluster
+            size_t remaining = clusterEnd - i;
+            if (remaining < 4) mask &= (1 << remaining) - 1;
+            
+            while (mask) {
+                int lane = __builtin_ctz((unsigned int)mask);
+                mask &= mask - 1;
+                const float* model = set->source[set->order[i + lane]].modelMatrix;
+                
+                if (useImpostors) {
+                    float dx = set->x[i + lane] - culler->cameraPosition[0];
+                    float dy = set->y[i + lane] - culler->cameraPosition[1];
+                    float dz = set->z[i + lane] - culler->cameraPosition[2];
+                    float dist2 = dx * dx + dy * dy + dz * dz;
+                    if (dist2 > impostorStart2) {
+                        memcpy(impostorOut + impostors * 16, model, sizeof(float) * 16);
+                        impostors++;
+                    }
+                    if (dist2 >= meshEnd2) continue;
+                }
+                
+                if (lodOut) {
+                    float dx = set->x[i + lane] - culler->cameraPosition[0];
+                    float dy = set->y[i + lane] - culler->cameraPosition[1];
+                    float dz = set->z[i + lane] - culler->cameraPosition[2];
+                    float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+                    float screenSize = distance > 0.0f ? set->radius[i + lane] * culler->lodScale / distance : INFINITY;
+                    lodOut[visible] = (uint8_t)model_selectLod(mesh, screenSize);
+                }
+                
+                memcpy(out + visible * 16, model, sizeof(float) * 16);
+                visible++;
+            }
+        }
+    }
+    
+    chunk->visible = visible;
+    chunk->occluded = occluded;
+    chunk->impostors = impostors;
+}
+
+// Cull all queued instances, compact survivors and upload them to each instanceBuffer
+void instanceCulling_execute(InstanceCuller* culler) {
+    culler->setCount = culler->setCursor;
+    
+    size_t submitted = 0;
+    for (int type = 0; type < INSTANCE_CULL_TYPE_COUNT; type++) {
+        submitted += culler->categories[type].submitted;
+    }
+    
+    if (culler->pool && submitted >= INSTANCE_CULL_PARALLEL_THRESHOLD) {
+        threadPool_run(culler->pool, instanceCulling_processChunk, culler, culler->chunkCount);
+    } else {
+        for (size_t i = 0; i < culler->chunkCount; i++) {
+            instanceCulling_processChunk(culler, i);
+        }
+    }
+    
+    // Close the gaps between chunk outputs (chunks are ordered by set, then begin)
+    for (size_t i = 0; i < culler->setCount; i++) {
+        culler->sets[i].visibleCount = 0;
+        culler->sets[i].impostorCount = 0;
+    }
+    for (size_t i = 0; i < culler->chunkCount; i++) {
+        InstanceCullChunk* chunk = &culler->chunks[i];
+        InstanceCullSet* set = &culler->sets[chunk->set];
+        if (chunk->visible > 0 && set->visibleCount != chunk->begin) {
+            memmove(set->visibleMatrices + set->visibleCount * 16,
+                    set->visibleMatrices + chunk->begin * 16,
+                    sizeof(float) * 16 * chunk->visible);
+            if (set->visibleLods) {
+                memmove(set->visibleLods + set->visibleCount, set->visibleLods + chunk->begin, chunk->visible);
+            }
+        }
+        set->visibleCount += chunk->visible;
+        
+        if (chunk->impostors > 0 && set->impostorCount != chunk->begin) {
+            memmove(set->impostorMatrices + set->impostorCount * 16,
+                    set->impostorMatrices + chunk->begin * 16,
+                    sizeof(float) * 16 * chunk->impostors);
+        }
+        set->impostorCount += chunk->impostors;
+        culler->categories[set->type].occluded += chunk->occluded;
+    }
+    
+    // Upload into freshly orphaned storage so in-flight draws are not stalled
+    for (size_t i = 0; i < culler->setCount; i++) {
+        InstanceCullSet* set = &culler->sets[i];
+        Object* object = set->object;
+        
+        object->visibleInstanceCount = set->visibleCount;
+        memset(object->visibleLodCounts, 0, sizeof(object->visibleLodCounts));
+        object->visibleLodCounts[0] = set->visibleCount;
+        culler->categories[set->type].visible += set->visibleCount;
+        culler->categories[set->type].impostors += set->impostorCount;
+        if (set->impostorCount > 0) {
+            impostor_addInstances(culler->impostors, object->impostor, set->impostorMatrices, set->impostorCount, object->impostorDistance);
+        }
+        if (set->visibleCount == 0 || !object->instanceBuffer) continue;
+        
+        // Group by level (counting sort, stable within a level) so each level draws a contiguous range
+        const float* upload = set->visibleMatrices;
+        if (set->visibleLods) {
+            size_t offsets[MESH_MAX_LODS];
+            memset(object->visibleLodCounts, 0, sizeof(object->visibleLodCounts));
+            for (size_t j = 0; j < set->visibleCount; j++) object->visibleLodCounts[set->visibleLods[j]]++;
+            size_t offset = 0;
+            for (int level = 0; level < MESH_MAX_LODS; level++) {
+                offsets[level] = offset;
+                offset += object->visibleLodCounts[level];
+            }
+            for (size_t j = 0; j < set->visibleCount; j++) {
+                memcpy(set->sortedMatrices + offsets[set->visibleLods[j]]++ * 16, set->visibleMatrices + j * 16, sizeof(float) * 16);
+            }
+            upload = set->sortedMatrices;
+        }
+        
+        glBindBuffer(GL_ARRAY_BUFFER, object->instanceBuffer);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 16 * set->count, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * 16 * set->visibleCount, upload);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    
+    for (int type = 0; type < INSTANCE_CULL_TYPE_COUNT; type++) {
+        InstanceCullCategory* category = &culler->categories[type];
+        profiler_addCounter(category->submittedCounter, (double)category->submitted);
+        profiler_addCounter(category->visibleCounter, (double)category->visible);
+        profiler_addCounter(category->occludedCounter, (double)category->occluded);
+        profiler_addCounter(category->impostorCounter, (double)category->impostors);
+    }
+}
@@ -0,0 +1,453 @@
+#include "rendering/occlusion_culling.h"
+#include "utils/profiler.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Four-wide float vectors: SSE2, NEON, or a plain array fallback
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+typedef __m128 OcclusionVec;
+static inline OcclusionVec vecSet1(float v) { return _mm_set1_ps(v); }
+static inline OcclusionVec vecSet4(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+static inline OcclusionVec vecLoad(const float* p) { return _mm_loadu_ps(p); }
+static inline void vecStore(float* p, OcclusionVec v) { _mm_storeu_ps(p, v); }
+static inline OcclusionVec vecAdd(OcclusionVec a, OcclusionVec b) { return _mm_add_ps(a, b); }
+static inline OcclusionVec vecMul(OcclusionVec a, OcclusionVec b) { return _mm_mul_ps(a, b); }
+static inline OcclusionVec vecMin(OcclusionVec a, OcclusionVec b) { return _mm_min_ps(a, b); }
+static inline OcclusionVec vecGreaterEqual(OcclusionVec a, OcclusionVec b) { return _mm_cmpge_ps(a, b); }
+static inline OcclusionVec vecAnd(OcclusionVec a, OcclusionVec b) { return _mm_and_ps(a, b); }
+static inline OcclusionVec vecSelect(OcclusionVec mask, OcclusionVec a, OcclusionVec b) {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+static inline int vecMoveMask(OcclusionVec mask) { return _mm_movemask_ps(mask); }
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+typedef float32x4_t OcclusionVec;
+static inline OcclusionVec vecSet1(float v) { return vdupq_n_f32(v); }
+static inline OcclusionVec vecSet4(float a, float b, float c, float d) {
+    float values[4] = { a, b, c, d };
+    return vld1q_f32(values);
+}
+static inline OcclusionVec vecLoad(const float* p) { return vld1q_f32(p); }
+static inline void vecStore(float* p, OcclusionVec v) { vst1q_f32(p, v); }
+static inline OcclusionVec vecAdd(OcclusionVec a, OcclusionVec b) { return vaddq_f32(a, b); }
+static inline OcclusionVec vecMul(OcclusionVec a, OcclusionVec b) { return vmulq_f32(a, b); }
+static inline OcclusionVec vecMin(OcclusionVec a, OcclusionVec b) { return vminq_f32(a, b); }
+static inline OcclusionVec vecGreaterEqual(OcclusionVec a, OcclusionVec b) { return vreinterpretq_f32_u32(vcgeq_f32(a, b)); }
+static inline OcclusionVec vecAnd(OcclusionVec a, OcclusionVec b) {
+    return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+}
+static inline OcclusionVec vecSelect(OcclusionVec mask, OcclusionVec a, OcclusionVec b) {
+    return vbslq_f32(vreinterpretq_u32_f32(mask), a, b);
+}
+static inline int vecMoveMask(OcclusionVec mask) {
+    uint32x4_t bits = vreinterpretq_u32_f32(mask);
+    return (int)((vgetq_lane_u32(bits, 0) & 1) | (vgetq_lane_u32(bits, 1) & 2) |
+                 (vgetq_lane_u32(bits, 2) & 4) | (vgetq_lane_u32(bits, 3) & 8));
+}
+#else
+typedef struct { float v[4]; } OcclusionVec;
+static inline OcclusionVec vecSet1(float v) { OcclusionVec r = {{ v, v, v, v }}; return r; }
+static inline OcclusionVec vecSet4(float a, float b, float c, float d) { OcclusionVec r = {{ a, b, c, d }}; return r; }
+static inline OcclusionVec vecLoad(const float* p) { OcclusionVec r; memcpy(r.v, p, sizeof(r.v)); return r; }
+static inline void vecStore(float* p, OcclusionVec v) { memcpy(p, v.v, sizeof(v.v)); }
+static inline OcclusionVec vecAdd(OcclusionVec a, OcclusionVec b) {
+    for (int i = 0; i < 4; i++) a.v[i] += b.v[i];
+    return a;
+}
+static inline OcclusionVec vecMul(OcclusionVec a, OcclusionVec b) {
+    for (int i = 0; i < 4; i++) a.v[i] *= b.v[i];
+    return a;
+}
+static inline OcclusionVec vecMin(OcclusionVec a, OcclusionVec b) {
+    for (int i = 0; i < 4; i++) a.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i];
+    return a;
+}
+static inline OcclusionVec vecGreaterEqual(OcclusionVec a, OcclusionVec b) {
+    for (int i = 0; i < 4; i++) a.v[i] = a.v[i] >= b.v[i] ? 1.0f : 0.0f;
+    return a;
+}
+static inline OcclusionVec vecAnd(OcclusionVec a, OcclusionVec b) {
+    for (int i = 0; i < 4; i++) a.v[i] = (a.v[i] != 0.0f && b.v[i] != 0.0f) ? 1.0f : 0.0f;
+    return a;
+}
+static inline OcclusionVec vecSelect(OcclusionVec mask, OcclusionVec a, OcclusionVec b) {
+    for (int i = 0; i < 4; i++) a.v[i] = mask.v[i] != 0.0f ? a.v[i] : b.v[i];
+    return a;
+}
+static inline int vecMoveMask(OcclusionVec mask) {
+    int bits = 0;
+    for (int i = 0; i < 4; i++) if (mask.v[i] != 0.0f) bits |= 1 << i;
+    return bits;
+}
+#endif
+
+// Vertices closer than this (clip w) reject the whole triangle or box
+#define OCCLUSION_NEAR_W 0.01f
+
+// Initialize occlusion culler with a width x height depth buffer
+void occlusion_init(OcclusionCuller* culler, int width, int height, ThreadPool* pool) {
+    memset(culler, 0, sizeof(OcclusionCuller));
+    
+    // Round up to whole tiles
+    culler->tilesX = (width + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE;
+    culler->tilesY = (height + OCCLUSION_TILE_SIZE - 1) / OCCLUSION_TILE_SIZE;
+    culler->width = culler->tilesX * OCCLUSION_TILE_SIZE;
+    culler->height = culler->tilesY * OCCLUSION_TILE_SIZE;
+    culler->pool = pool;
+    
+    culler->depth = (float*)malloc(sizeof(float) * culler->width * culler->height);
+    culler->binOffsets = (uint32_t*)calloc(culler->tilesX * culler->tilesY + 1, sizeof(uint32_t));
+    if (!culler->depth || !culler->binOffsets) {
+        fprintf(stderr, "Failed to allocate occlusion buffer\n");
+        return;
+    }
+    
+    for (int i = 0; i < culler->width * culler->height; i++) {
+        culler->depth[i] = 1.0f;
+    }
+    
+    atomic_init(&culler->boxesTested, 0);
+    atomic_init(&culler->boxesOccluded, 0);
+    culler->enabled = true;
+}
+
+// Free occlusion culler resources
+void occlusion_cleanup(OcclusionCuller* culler) {
+    free(culler->depth);
+    free(culler->triangles);
+    free(culler->binOffsets);
+    free(culler->binIndices);
+    
+    culler->depth = NULL;
+    culler->triangles = NULL;
+    culler->binOffsets = NULL;
+    culler->binIndices = NULL;
+    culler->triangleCount = 0;
+    culler->triangleCapacity = 0;
+    culler->binCapacity = 0;
+    culler->enabled = false;
+}
+
+// Start a frame: set the camera and drop last frame's occluders
+void occlusion_begin(OcclusionCuller* culler, const float* viewProjection) {
+    memcpy(culler->viewProjection, viewProjection, sizeof(culler->viewProjection));
+    culler->triangleCount = 0;
+    
+    atomic_store(&culler->boxesTested, 0);
+    atomic_store(&culler->boxesOccluded, 0);
+    culler->stats.trianglesSubmitted = 0;
+    culler->stats.trianglesRasterized = 0;
+}
+
+// World position to clip space
+static void occlusion_toClip(const OcclusionCuller* culler, const float* position, float* clip) {
+    const float* m = culler->viewProjection;
+    for (int row = 0; row < 4; row++) {
+        clip[row] = m[row] * position[0] + m[4 + row] * position[1] + m[8 + row] * position[2] + m[12 + row];
+    }
+}
+
+// Project a clip-space vertex to buffer pixels and [0, 1] depth
+static void occlusion_toScreen(const OcclusionCuller* culler, const float* clip, float* screen) {
+    float invW = 1.0f / clip[3];
+    screen[0] = (clip[0] * invW * 0.5f + 0.5f) * culler->width;
+    screen[1] = (clip[1] * invW * 0.5f + 0.5f) * culler->height;
+    screen[2] = clip[2] * invW * 0.5f + 0.5f;
+}
+
+// Set up one screen-space triangle; returns false if it covers no pixels
+static bool occlusion_setupTriangle(const OcclusionCuller* culler, const float* v0, const float* v1, const float* v2, OcclusionTriangle* tri) {
+    float area = (v1[0] - v0[0]) * (v2[1] - v0[1]) - (v2[0] - v0[0]) * (v1[1] - v0[1]);
+    if (fabsf(area) < 1e-6f) return false;
+    
+    // Accept either winding so occluders need no consistent orientation
+    if (area < 0.0f) {
+        const float* swap = v1;
+        v1 = v2;
+        v2 = swap;
+        area = -area;
+    }
+    
+    float minX = fminf(v0[0], fminf(v1[0], v2[0]));
+    float maxX = fmaxf(v0[0], fmaxf(v1[0], v2[0]));
+    float minY = fminf(v0[1], fminf(v1[1], v2[1]));
+    float maxY = fmaxf(v0[1], fmaxf(v1[1], v2[1]));
+    
+    tri->minX = (int)fmaxf(floorf(minX), 0.0f);
+    tri->minY = (int)fmaxf(floorf(minY), 0.0f);
+    tri->maxX = (int)fminf(ceilf(maxX), (float)(culler->width - 1));
+    tri->maxY = (int)fminf(ceilf(maxY), (float)(culler->height - 1));
+    if (tri->minX > tri->maxX || tri->minY > tri->maxY) return false;
+    
+    // Edge i runs from vertex i to vertex i+1; a*x + b*y + c >= 0 inside
+    const float* v[3] = { v0, v1, v2 };
+    for (int i = 0; i < 3; i++) {
+        const float* a = v[i];
+        const float* b = v[(i + 1) % 3];
+        tri->edgeA[i] = a[1] - b[1];
+        tri->edgeB[i] = b[0] - a[0];
+        tri->edgeC[i] = -(tri->edgeA[i] * a[0] + tri->edgeB[i] * a[1]);
+    }
+    
+    // Screen-space depth plane
+    float invArea = 1.0f / area;
+    tri->depthX = ((v1[2] - v0[2]) * (v2[1] - v0[1]) - (v2[2] - v0[2]) * (v1[1] - v0[1])) * invArea;
+    tri->depthY = ((v2[2] - v0[2]) * (v1[0] - v0[0]) - (v1[2] - v0[2]) * (v2[0] - v0[0])) * invArea;
+    tri->depthC = v0[2] - tri->depthX * v0[0] - tri->depthY * v0[1];
+    return true;
+}
+
+// Transform, reject and queue one world-space triangle
+static void occlusion_addTriangle(OcclusionCuller* culler, const float* p0, const float* p1, const float* p2) {
+    culler->stats.trianglesSubmitted++;
+    
+    float clip[3][4];
+    occlusion_toClip(culler, p0, clip[0]);
+    occlusion_toClip(culler, p1, clip[1]);
+    occlusion_toClip(culler, p2, clip[2]);
+    
+    // Skipping an occluder is always safe, so no near-plane clipping
+    if (clip[0][3] < OCCLUSION_NEAR_W || clip[1][3] < OCCLUSION_NEAR_W || clip[2][3] < OCCLUSION_NEAR_W) return;
+    
+    float screen[3][3];
+    for (int i = 0; i < 3; i++) {
+        occlusion_toScreen(culler, clip[i], screen[i]);
+    }
+    
+    if (culler->triangleCount >= culler->triangleCapacity) {
+        size_t capacity = culler->triangleCapacity ? culler->triangleCapacity * 2 : 4096;
+        OcclusionTriangle* triangles = (OcclusionTriangle*)realloc(culler->triangles, sizeof(OcclusionTriangle) * capacity);
+        if (!triangles) return;
+        culler->triangles = triangles;
+        culler->triangleCapacity = capacity;
+    }
+    
+    if (occlusion_setupTriangle(culler, screen[0], screen[1], screen[2], &culler->triangles[culler->triangleCount])) {
+        culler->triangleCount++;
+    }
+}
+
+// Add an indexed world-space occluder mesh
+void occlusion_addOccluderMesh(OcclusionCuller* culler, const OcclusionMesh* mesh) {
+    if (!culler->enabled || !mesh || !mesh->vertices) return;
+    
+    for (size_t i = 0; i + 2 < mesh->indexCount; i += 3) {
+        occlusion_addTriangle(culler,
+                              &mesh->vertices[mesh->indices[i] * 3],
+                              &mesh->vertices[mesh->indices[i + 1] * 3],
+                              &mesh->vertices[mesh->indices[i + 2] * 3]);
+    }
+}
+
+// Add an axis-aligned box occluder (should lie inside the real geometry)
+void occlusion_addOccluderBox(OcclusionCuller* culler, const float* boxMin, const float* boxMax) {
+    if (!culler->enabled) return;
+    
+    float corners[8][3];
+    for (int i = 0; i < 8; i++) {
+        corners[i][0] = (i & 1) ? boxMax[0] : boxMin[0];
+        corners[i][1] = (i & 2) ? boxMax[1] : boxMin[1];
+        corners[i][2] = (i & 4) ? boxMax[2] : boxMin[2];
+    }
+    
+    static const int faces[6][4] = {
+        { 0, 2, 6, 4 }, { 1, 5, 7, 3 },     // -x, +x
+        { 0, 4, 5, 1 }, { 2, 3, 7, 6 },     // -y, +y
+        { 0, 1, 3, 2 }, { 4, 6, 7, 5 }      // -z, +z
+    };
+    for (int f = 0; f < 6; f++) {
+        occlusion_addTriangle(culler, corners[faces[f][0]], corners[faces[f][1]], corners[faces[f][2]]);
+        occlusion_addTriangle(culler, corners[faces[f][0]], corners[faces[f][2]], corners[faces[f][3]]);
+    }
+}
+
+// Bin triangles into the tiles their bounds overlap (count, prefix sum, fill)
+static bool occlusion_binTriangles(OcclusionCuller* culler) {
+    int tileCount = culler->tilesX * culler->tilesY;
+    memset(culler->binOffsets, 0, sizeof(uint32_t) * (tileCount + 1));
+    
+    size_t total = 0;
+    for (size_t t = 0; t < culler->triangleCount; t++) {
+        const OcclusionTriangle* tri = &culler->triangles[t];
+        for (int ty = tri->minY / OCCLUSION_TILE_SIZE; ty <= tri->maxY / OCCLUSION_TILE_SIZE; ty++) {
+            for (int tx = tri->minX / OCCLUSION_TILE_SIZE; tx <= tri->maxX / OCCLUSION_TILE_SIZE; tx++) {
+                culler->binOffsets[ty * culler->tilesX + tx + 1]++;
+                total++;
+            }
+        }
+    }
+    
+    if (total > culler->binCapacity) {
+        uint32_t* indices = (uint32_t*)realloc(culler->binIndices, sizeof(uint32_t) * total);
+        if (!indices) return false;
+        culler->binIndices = indices;
+        culler->binCapacity = total;
+    }
+    
+    for (int i = 0; i < tileCount; i++) {
+        culler->binOffsets[i + 1] += culler->binOffsets[i];
+    }
+    
+    // Fill using a running cursor per tile, then restore the offsets
+    for (size_t t = 0; t < culler->triangleCount; t++) {
+        const OcclusionTriangle* tri = &culler->triangles[t];
+        for (int ty = tri->minY / OCCLUSION_TILE_SIZE; ty <= tri->maxY / OCCLUSION_TILE_SIZE; ty++) {
+            for (int tx = tri->minX / OCCLUSION_TILE_SIZE; tx <= tri->maxX / OCCLUSION_TILE_SIZE; tx++) {
+                culler->binIndices[culler->binOffsets[ty * culler->tilesX + tx]++] = (uint32_t)t;
+            }
+        }
+    }
+    for (int i = tileCount; i > 0; i--) {
+        culler->binOffsets[i] = culler->binOffsets[i - 1];
+    }
+    culler->binOffsets[0] = 0;
+    
+    return true;
+}
+
+// Clear and rasterize one tile (thread pool task)
+static void occlusion_rasterizeTile(void* context, size_t tileIndex) {
+    OcclusionCuller* culler = (OcclusionCuller*)context;
+    int tileX = (int)(tileIndex % culler->tilesX) * OCCLUSION_TILE_SIZE;
+    int tileY = (int)(tileIndex / culler->tilesX) * OCCLUSION_TILE_SIZE;
+    
+    for (int y = tileY; y < tileY + OCCLUSION_TILE_SIZE; y++) {
+        float* row = culler->depth + y * culler->width + tileX;
+        for (int x = 0; x < OCCLUSION_TILE_SIZE; x++) row[x] = 1.0f;
+    }
+    
+    OcclusionVec laneOffsets = vecSet4(0.5f, 1.5f, 2.5f, 3.5f);
+    OcclusionVec zero = vecSet1(0.0f);
+    
+    for (uint32_t b = culler->binOffsets[tileIndex]; b < culler->binOffsets[tileIndex + 1]; b++) {
+        const OcclusionTriangle* tri = &culler->triangles[culler->binIndices[b]];
+        
+        // Clamp to the tile; x starts on a 4-pixel boundary
+        int minX = tri->minX > tileX ? tri->minX & ~3 : tileX;
+        int maxX = tri->maxX < tileX + OCCLUSION_TILE_SIZE - 1 ? tri->maxX : tileX + OCCLUSION_TILE_SIZE - 1;
+        int minY = tri->minY > tileY ? tri->minY : tileY;
+        int maxY = tri->maxY < tileY + OCCLUSION_TILE_SIZE - 1 ? tri->maxY : tileY + OCCLUSION_TILE_SIZE - 1;
+        
+        OcclusionVec a0 = vecSet1(tri->edgeA[0]);
+        OcclusionVec a1 = vecSet1(tri->edgeA[1]);
+        OcclusionVec a2 = vecSet1(tri->edgeA[2]);
+        OcclusionVec dzdx = vecSet1(tri->depthX);
+        
+        for (int y = minY; y <= maxY; y++) {
+            float py = (float)y + 0.5f;
+            OcclusionVec rowE0 = vecSet1(tri->edgeB[0] * py + tri->edgeC[0]);
+            OcclusionVec rowE1 = vecSet1(tri->edgeB[1] * py + tri->edgeC[1]);
+            OcclusionVec rowE2 = vecSet1(tri->edgeB[2] * py + tri->edgeC[2]);
+            OcclusionVec rowZ = vecSet1(tri->depthY * py + tri->depthC);
+            float* row = culler->depth + y * culler->width;
+            
+            for (int x = minX; x <= maxX; x += 4) {
+                OcclusionVec px = vecAdd(vecSet1((float)x), laneOffsets);
+                OcclusionVec e0 = vecAdd(vecMul(a0, px), rowE0);
+                OcclusionVec e1 = vecAdd(vecMul(a1, px), rowE1);
+                OcclusionVec e2 = vecAdd(vecMul(a2, px), rowE2);
+                OcclusionVec inside = vecAnd(vecAnd(vecGreaterEqual(e0, zero), vecGreaterEqual(e1, zero)), vecGreaterEqual(e2, zero));
+                if (!vecMoveMask(inside)) continue;
+                
+                OcclusionVec z = vecAdd(vecMul(dzdx, px), rowZ);
+                OcclusionVec current = vecLoad(row + x);
+                vecStore(row + x, vecSelect(inside, vecMin(z, current), current));
+            }
+        }
+    }
+}
+
+// Bin and rasterize all queued occluders across the thread pool
+void occlusion_rasterize(OcclusionCuller* culler) {
+    if (!culler->enabled) return;
+    
+    double start = profiler_now();
+    
+    if (!occlusion_binTriangles(culler)) {
+        culler->triangleCount = 0;
+        occlusion_binTriangles(culler);
+    }
+    
+    size_t tileCount = (size_t)(culler->tilesX * culler->tilesY);
+    if (culler->pool) {
+        threadPool_run(culler->pool, occlusion_rasterizeTile, culler, tileCount);
+    } else {
+        for (size_t i = 0; i < tileCount; i++) occlusion_rasterizeTile(culler, i);
+    }
+    
+    culler->stats.trianglesRasterized = (unsigned int)culler->triangleCount;
+    culler->stats.rasterizeTime = (float)(profiler_now() - start);
+}
+
+// Test a world-space box; returns true if any part of it may be visible (thread safe)
+bool occlusion_testBox(OcclusionCuller* culler, const float* boxMin, const float* boxMax) {
+    if (!culler->enabled) return true;
+    atomic_fetch_add(&culler->boxesTested, 1);
+    
+    float minX = INFINITY, minY = INFINITY, maxX = -INFINITY, maxY = -INFINITY;
+    float nearestDepth = INFINITY;
+    for (int i = 0; i < 8; i++) {
+        float corner[3] = {
+            (i & 1) ? boxMax[0] : boxMin[0],
+            (i & 2) ? boxMax[1] : boxMin[1],
+            (i & 4) ? boxMax[2] : boxMin[2]
+        };
+        
+        float clip[4];
+        occlusion_toClip(culler, corner, clip);
+        
+        // Crossing the near plane: assume visible
+        if (clip[3] < OCCLUSION_NEAR_W) return true;
+        
+        float screen[3];
+        occlusion_toScreen(culler, clip, screen);
+        minX = fminf(minX, screen[0]);
+        maxX = fmaxf(maxX, screen[0]);
+        minY = fminf(minY, screen[1]);
+        maxY = fmaxf(maxY, screen[1]);
+        nearestDepth = fminf(nearestDepth, screen[2]);
+    }
+    
+    // Off-screen boxes are left to frustum culling
+    int x0 = (int)fmaxf(floorf(minX), 0.0f);
+    int y0 = (int)fmaxf(floorf(minY), 0.0f);
+    int x1 = (int)fminf(ceilf(maxX), (float)(culler->width - 1));
+    int y1 = (int)fminf(ceilf(maxY), (float)(culler->height - 1));
+    if (x0 > x1 || y0 > y1) return true;
+    
+    // Visible as soon as one covered pixel has no occluder in front of the box
+    OcclusionVec boxDepth = vecSet1(nearestDepth);
+    int startX = x0 & ~3;
+    for (int y = y0; y <= y1; y++) {
+        const float* row = culler->depth + y * culler->width;
+        for (int x = startX; x <= x1; x += 4) {
+            int lanes = vecMoveMask(vecGreaterEqual(vecLoad(row + x), boxDepth));
+            if (x < x0) lanes &= 0xF << (x0 - x);
+            if (x + 3 > x1) lanes &= 0xF >> (x + 3 - x1);
+            if (lanes) return true;
+        }
+    }
+    
+    atomic_fetch_add(&culler->boxesOccluded, 1);
+    return false;
+}
+
+// Counters for the current frame so far
+const OcclusionStats* occlusion_getStats(OcclusionCuller* culler) {
+    culler->stats.boxesTested = atomic_load(&culler->boxesTested);
+    culler->stats.boxesOccluded = atomic_load(&culler->boxesOccluded);
+    return &culler->stats;
+}
+
+// Free an occluder mesh
+void occlusion_freeMesh(OcclusionMesh* mesh) {
+    free(mesh->vertices);
+    free(mesh->indices);
+    mesh->vertices = NULL;
+    mesh->indices = NULL;
+    mesh->vertexCount = 0;
+    mesh->indexCount = 0;
+}
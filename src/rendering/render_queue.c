@@ -0,0 +1,415 @@
+#include "rendering/render_queue.h"
+
+// Sort key layout (most significant first)
+//   opaque/shadow: pass:2 | shader:10 | material:14 | mesh:14 | depth:24 (front to back)
+//   transparent:   pass:2 | depth:24 (back to front) | shader:10 | material:14 | mesh:14
+#define KEY_SHADER_BITS 10
+#define KEY_MATERIAL_BITS 14
+#define KEY_MESH_BITS 14
+#define KEY_DEPTH_BITS 24
+
+// Initialize render queue
+void renderQueue_init(RenderQueue* queue, size_t capacity) {
+    if (capacity == 0) capacity = 256;
+    
+    queue->items = (RenderItem*)malloc(sizeof(RenderItem) * capacity);
+    queue->entries = (RenderSortEntry*)malloc(sizeof(RenderSortEntry) * capacity);
+    queue->scratch = (RenderSortEntry*)malloc(sizeof(RenderSortEntry) * capacity);
+    queue->count = 0;
+    queue->capacity = capacity;
+    
+    queue->idKeys = (const void**)calloc(RENDER_QUEUE_ID_TABLE_SIZE, sizeof(void*));
+    queue->idValues = (uint16_t*)calloc(RENDER_QUEUE_ID_TABLE_SIZE, sizeof(uint16_t));
+    queue->nextId = 1;
+    
+    if (!queue->items || !queue->entries || !queue->scratch || !queue->idKeys || !queue->idValues) {
+        fprintf(stderr, "Failed to allocate render queue\n");
+        queue->capacity = 0;
+    }
+    
+    memset(&queue->stats, 0, sizeof(RenderQueueStats));
+}
+
+// Clean up render queue
+void renderQueue_cleanup(RenderQueue* queue) {
+    free(queue->items);
+    free(queue->entries);
+    free(queue->scratch);
+    free(queue->idKeys);
+    free(queue->idValues);
+    
+    queue->items = NULL;
+    queue->entries = NULL;
+    queue->scratch = NULL;
+    queue->idKeys = NULL;
+    queue->idValues = NULL;
+    queue->count = 0;
+    queue->capacity = 0;
+}
+
+// Start a new frame's worth of submissions
+void renderQueue_reset(RenderQueue* queue) {
+    queue->count = 0;
+}
+
+// Map a pointer to a small id that is stable across frames (0 = none)
+static unsigned int renderQueue_getId(RenderQueue* queue, const void* pointer) {
+    if (!pointer || !queue->idKeys) return 0;
+    
+    uintptr_t hash = (uintptr_t)pointer;
+    hash ^= hash >> 17;
+    hash *= 0xed5ad4bbu;
+    hash ^= hash >> 11;
+    
+    unsigned int mask = RENDER_QUEUE_ID_TABLE_SIZE - 1;
+    unsigned int slot = (unsigned int)hash & mask;
+    for (unsigned int probe = 0; probe < RENDER_QUEUE_ID_TABLE_SIZE; probe++) {
+        unsigned int index = (slot + probe) & mask;
+        if (queue->idKeys[index] == pointer) {
+            return queue->idValues[index];
+        }
+        if (queue->idKeys[index] == NULL) {
+            // Ids wrap once the key field is exhausted; that only costs sort quality
+            unsigned int id = queue->nextId++ & ((1u << KEY_MESH_BITS) - 1);
+            queue->idKeys[index] = pointer;
+            queue->idValues[index] = (uint16_t)id;
+            return id;
+        }
+    }
+    
+    return 0;
+}
+
+// Build a 64-bit sort key
+uint64_t renderQueue_makeKey(RenderQueuePass pass, unsigned int shader, unsigned int material, unsigned int mesh, float depth) {
+    if (depth < 0.0f) depth = 0.0f;
+    if (depth > 1.0f) depth = 1.0f;
+    
+    uint64_t depthBits = (uint64_t)(depth * (float)((1u << KEY_DEPTH_BITS) - 1));
+    uint64_t state = ((uint64_t)(shader & ((1u << KEY_SHADER_BITS) - 1)) << (KEY_MATERIAL_BITS + KEY_MESH_BITS)) |
+                     ((uint64_t)(material & ((1u << KEY_MATERIAL_BITS) - 1)) << KEY_MESH_BITS) |
+                     (uint64_t)(mesh & ((1u << KEY_MESH_BITS) - 1));
+    
+    uint64_t key = (uint64_t)pass << 62;
+    if (pass == RENDER_QUEUE_TRANSPARENT) {
+        // Back to front first, state second
+        uint64_t inverted = ((1u << KEY_DEPTH_BITS) - 1) - depthBits;
+        key |= inverted << 38;
+        key |= state;
+    } else {
+        // State first, front to back within equal state for early-Z
+        key |= state << KEY_DEPTH_BITS;
+        key |= depthBits;
+    }
+    
+    return key;
+}
+
+// Grow the item arrays
+static bool renderQueue_grow(RenderQueue* queue) {
+    size_t capacity = queue->capacity ? queue->capacity * 2 : 256;
+    
+    RenderItem* items = (RenderItem*)realloc(queue->items, sizeof(RenderItem) * capacity);
+    if (!items) return false;
+    queue->items = items;
+    
+    RenderSortEntry* entries = (RenderSortEntry*)realloc(queue->entries, sizeof(RenderSortEntry) * capacity);
+    if (!entries) return false;
+    queue->entries = entries;
+    
+    RenderSortEntry* scratch = (RenderSortEntry*)realloc(queue->scratch, sizeof(RenderSortEntry) * capacity);
+    if (!scratch) return false;
+    queue->scratch = scratch;
+    
+    queue->capacity = capacity;
+    return true;
+}
+
+// Submit an object; depth is the normalized view distance (0 = near, 1 = far)
+void renderQueue_submit(RenderQueue* queue, RenderQueuePass pass, GLuint shader, Object* object, float depth, unsigned int lod) {
+    if (!object || !object->mesh) return;
+    
+    if (queue->count >= queue->capacity && !renderQueue_grow(queue)) {
+        fprintf(stderr, "Render queue is full, dropping %s\n", object->name ? object->name : "object");
+        return;
+    }
+    
+    // Shadow passes never bind materials, so keep them out of the key
+    const Material* material = pass == RENDER_QUEUE_SHADOW ? NULL : object->material;
+    
+    size_t index = queue->count++;
+    RenderItem* item = &queue->items[index];
+    item->object = object;
+    item->mesh = object->mesh;
+    item->material = material;
+    item->shader = shader;
+    item->lod = lod;
+    item->shadow = pass == RENDER_QUEUE_SHADOW;
+    
+    queue->entries[index].key = renderQueue_makeKey(pass, shader,
+                                                    renderQueue_getId(queue, material),
+                                                    renderQueue_getId(queue, object->mesh),
+                                                    depth);
+    queue->entries[index].index = (uint32_t)index;
+}
+
+// LSD radix sort on the 64-bit keys, 8 bits per pass
+static void renderQueue_radixSort(RenderSortEntry* entries, RenderSortEntry* scratch, size_t count) {
+    RenderSortEntry* src = entries;
+    RenderSortEntry* dst = scratch;
+    
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t histogram[256] = {0};
+        for (size_t i = 0; i < count; i++) {
+            histogram[(src[i].key >> shift) & 0xFF]++;
+        }
+        
+        // Skip bytes every key agrees on (common for pass and high id bits)
+        if (histogram[(src[0].key >> shift) & 0xFF] == count) continue;
+        
+        size_t offset = 0;
+        for (int b = 0; b < 256; b++) {
+            size_t bucket = histogram[b];
+            histogram[b] = offset;
+            offset += bucket;
+        }
+        
+        for (size_t i = 0; i < count; i++) {
+            dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+        }
+        
+        RenderSortEntry* temp = src;
+        src = dst;
+        dst = temp;
+    }
+    
+    if (src != entries) {
+        memcpy(entries, src, sizeof(RenderSortEntry) * count);
+    }
+}
+
+// Sort submitted items by key
+void renderQueue_sort(RenderQueue* queue) {
+    if (queue->count < 2) return;
+    renderQueue_radixSort(queue->entries, queue->scratch, queue->count);
+}
+
+// Bind a material's textures and scalar fallbacks
+static void renderQueue_bindMaterial(GLuint shader, const Material* material) {
+    if (!material) {
+        shader_setInt(shader, "hasNormalMap", 0);
+        shader_setInt(shader, "hasRoughnessMap", 0);
+        shader_setInt(shader, "hasMetallicMap", 0);
+        shader_setInt(shader, "hasAOMap", 0);
+        return;
+    }
+    
+    texture_bind(material->diffuseMap, GL_TEXTURE0);
+    texture_bind(material->normalMap, GL_TEXTURE1);
+    texture_bind(material->roughnessMap, GL_TEXTURE2);
+    texture_bind(material->metallicMap, GL_TEXTURE3);
+    texture_bind(material->aoMap, GL_TEXTURE4);
+    
+    shader_setInt(shader, "hasNormalMap", material->normalMap != 0);
+    shader_setInt(shader, "hasRoughnessMap", material->roughnessMap != 0);
+    shader_setInt(shader, "hasMetallicMap", material->metallicMap != 0);
+    shader_setInt(shader, "hasAOMap", material->aoMap != 0);
+    shader_setFloat(shader, "roughness", material->roughness);
+    shader_setFloat(shader, "metallic", material->metallic);
+    shader_setFloat(shader, "ao", material->ao);
+}
+
+// Point the per-instance model matrix attributes (locations 4-7) at an instance buffer,
+// starting at a given instance (no base instance draws in GL 4.1)
+static void renderQueue_bindInstances(GLuint buffer, size_t firstInstance) {
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    for (int i = 0; i < 4; i++) {
+        glEnableVertexAttribArray(4 + i);
+        glVertexAttribPointer(4 + i, 4, GL_FLOAT, GL_FALSE, sizeof(mat4), (void*)(sizeof(mat4) * firstInstance + sizeof(float) * 4 * i));
+        glVertexAttribDivisor(4 + i, 1);
+    }
+}
+
+// Index range of a mesh level, falling back to full detail for out of range levels
+static void renderQueue_lodRange(const Mesh* mesh, unsigned int lod, unsigned int* first, unsigned int* count) {
+    if (lod < mesh->lodCount && mesh->lodIndexCount[lod] > 0) {
+        *first = mesh->lodFirstIndex[lod];
+        *count = mesh->lodIndexCount[lod];
+    } else {
+        *first = 0;
+        *count = mesh->numIndices;
+    }
+}
+
+// Count state changes the items would cause in submission order
+static unsigned int renderQueue_countUnsortedChanges(RenderQueue* queue) {
+    unsigned int changes = 0;
+    GLuint shader = 0;
+    const Material* material = NULL;
+    Mesh* mesh = NULL;
+    
+    for (size_t i = 0; i < queue->count; i++) {
+        RenderItem* item = &queue->items[i];
+        if (i == 0 || item->shader != shader) changes++;
+        if (i == 0 || item->material != material) changes++;
+        if (i == 0 || item->mesh != mesh) changes++;
+        shader = item->shader;
+        material = item->material;
+        mesh = item->mesh;
+    }
+    
+    return changes;
+}
+
+// Draw all items in key order, skipping redundant state changes
+void renderQueue_draw(RenderQueue* queue) {
+    RenderQueueStats* stats = &queue->stats;
+    memset(stats, 0, sizeof(RenderQueueStats));
+    
+    stats->unsortedStateChanges = renderQueue_countUnsortedChanges(queue);
+    stats->naiveStateChanges = (unsigned int)queue->count * 3;
+    
+    // Stage every model matrix into the object ring with a single upload
+    bool useObjectRing = shader_reserveObjectData(queue->count);
+    for (size_t i = 0; useObjectRing && i < queue->count; i++) {
+        RenderItem* item = &queue->items[i];
+        if (!item->object->isInstanced) {
+            item->objectOffset = shader_writeObjectData(item->object->transform.modelMatrix);
+        }
+    }
+    if (useObjectRing) shader_flushObjectData();
+    
+    GLuint currentShader = 0;
+    const Material* currentMaterial = NULL;
+    Mesh* currentMesh = NULL;
+    Object* currentInstances = NULL;
+    bool shaderBound = false;
+    bool materialDirty = true;
+    float currentFadeStart = -1.0f;
+    
+    for (size_t i = 0; i < queue->count; i++) {
+        RenderItem* item = &queue->items[queue->entries[i].index];
+        Object* object = item->object;
+        Mesh* mesh = item->mesh;
+        
+        if (!mesh->VAO) continue;
+        
+        // Shader: also re-sends per-program uniforms
+        if (!shaderBound || item->shader != currentShader) {
+            currentShader = item->shader;
+            shader_use(currentShader);
+            shader_setInt(currentShader, "texture_diffuse", 0);
+            shader_setInt(currentShader, "texture_normal", 1);
+            shader_setInt(currentShader, "texture_roughness", 2);
+            shader_setInt(currentShader, "texture_metallic", 3);
+            shader_setInt(currentShader, "texture_ao", 4);
+            shader_setFloat(currentShader, "fadeRange", IMPOSTOR_FADE_RANGE);
+            stats->shaderChanges++;
+            shaderBound = true;
+            
+            // Uniform state is per program, so the material must be re-sent
+            materialDirty = true;
+            currentFadeStart = -1.0f;
+        }
+        
+        if (materialDirty || item->material != currentMaterial) {
+            currentMaterial = item->material;
+            renderQueue_bindMaterial(currentShader, currentMaterial);
+            stats->materialChanges++;
+            materialDirty = false;
+        }
+        
+        // Objects with an impostor dither out where it fades in
+        float fadeStart = object->impostor ? object->impostorDistance : 0.0f;
+        if (fadeStart != currentFadeStart) {
+            currentFadeStart = fadeStart;
+            shader_setFloat(currentShader, "fadeStart", fadeStart);
+        }
+        
+        if (mesh != currentMesh) {
+            currentMesh = mesh;
+            glBindVertexArray(mesh->VAO);
+            currentInstances = NULL;
+            stats->meshChanges++;
+        }
+        
+        // Issue the draw
+        if (object->isInstanced && item->shadow) {
+            if (object->shadowInstanceCount == 0) continue;
+            
+            // Every instance at full detail: off-screen and occluded trees still cast into view
+            renderQueue_bindInstances(object->shadowInstanceBuffer, 0);
+            currentInstances = NULL;
+            stats->instanceBufferChanges++;
+            if (mesh->EBO && mesh->numIndices > 0) {
+                glDrawElementsInstanced(GL_TRIANGLES, mesh->numIndices, GL_UNSIGNED_INT, 0, (GLsizei)object->shadowInstanceCount);
+                stats->triangles += (size_t)mesh->numIndices / 3 * object->shadowInstanceCount;
+            } else {
+                glDrawArraysInstanced(GL_TRIANGLES, 0, mesh->numVertices, (GLsizei)object->shadowInstanceCount);
+                stats->triangles += (size_t)mesh->numVertices / 3 * object->shadowInstanceCount;
+            }
+            stats->fullDetailTriangles += (size_t)(mesh->numIndices ? mesh->numIndices : mesh->numVertices) / 3 * object->shadowInstanceCount;
+            stats->drawCalls++;
+        } else if (object->isInstanced) {
+            if (object->visibleInstanceCount == 0) continue;
+            
+            // The culler groups visible instances by level; one draw per non-empty level
+            if (!mesh->EBO || mesh->numIndices == 0 || mesh->lodCount < 2) {
+                if (object != currentInstances) {
+                    currentInstances = object;
+                    renderQueue_bindInstances(object->instanceBuffer, 0);
+                    stats->instanceBufferChanges++;
+                }
+                if (mesh->EBO && mesh->numIndices > 0) {
+                    glDrawElementsInstanced(GL_TRIANGLES, mesh->numIndices, GL_UNSIGNED_INT, 0, (GLsizei)object->visibleInstanceCount);
+                    stats->triangles += (size_t)mesh->numIndices / 3 * object->visibleInstanceCount;
+                } else {
+                    glDrawArraysInstanced(GL_TRIANGLES, 0, mesh->numVertices, (GLsizei)object->visibleInstanceCount);
+                    stats->triangles += (size_t)mesh->numVertices / 3 * object->visibleInstanceCount;
+                }
+                stats->fullDetailTriangles += (size_t)(mesh->numIndices ? mesh->numIndices : mesh->numVertices) / 3 * object->visibleInstanceCount;
+                stats->drawCalls++;
+                continue;
+            }
+            
+            size_t firstInstance = 0;
+            for (unsigned int level = 0; level < MESH_MAX_LODS; level++) {
+                size_t instances = object->visibleLodCounts[level];
+                if (instances == 0) continue;
+                
+                renderQueue_bindInstances(object->instanceBuffer, firstInstance);
+                currentInstances = firstInstance == 0 ? object : NULL;
+                stats->instanceBufferChanges++;
+                
+                unsigned int first, count;
+                renderQueue_lodRange(mesh, level, &first, &count);
+                glDrawElementsInstanced(GL_TRIANGLES, count, GL_UNSIGNED_INT, (void*)(sizeof(GLuint) * first), (GLsizei)instances);
+                stats->triangles += (size_t)count / 3 * instances;
+                stats->fullDetailTriangles += (size_t)mesh->numIndices / 3 * instances;
+                stats->drawCalls++;
+                firstInstance += instances;
+            }
+        } else {
+            if (useObjectRing) {
+                shader_bindObjectData(item->objectOffset);
+            } else {
+                shader_setMat4(currentShader, "model", object->transform.modelMatrix);
+            }
+            
+            if (mesh->EBO && mesh->numIndices > 0) {
+                unsigned int first, count;
+                renderQueue_lodRange(mesh, item->lod, &first, &count);
+                glDrawElements(GL_TRIANGLES, count, GL_UNSIGNED_INT, (void*)(sizeof(GLuint) * first));
+                stats->triangles += count / 3;
+                stats->fullDetailTriangles += mesh->numIndices / 3;
+            } else {
+                glDrawArrays(GL_TRIANGLES, 0, mesh->numVertices);
+                stats->triangles += mesh->numVertices / 3;
+                stats->fullDetailTriangles += mesh->numVertices / 3;
+            }
+            stats->drawCalls++;
+        }
+    }
+    
+    glBindVertexArray(0);
+}
@@ -1,6 +1,30 @@
 #include "rendering/renderer.h"
 #include "scene/scene_manager.h"
 #include "rendering/camera.h"
+#include "rendering/render_queue.h"
+#include "rendering/instance_culling.h"
+#include "rendering/occlusion_culling.h"
+#include "rendering/impostor.h"
+#include "rendering/grass.h"
+#include "scene/wind_field.h"
+#include "rendering/atmosphere.h"
+#include "scene/scene_bvh.h"
+#include "utils/thread_pool.h"
+#include "utils/texture_streamer.h"
+
+// Clamped, filtered RGB16F texture for an atmosphere LUT (pixels may be NULL)
+static GLuint renderer_createLutTexture(int width, int height, const float* pixels) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, pixels);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return texture;
+}
 
 // Initialize renderer
 void renderer_init(Renderer* renderer) {
@@ -22,6 +46,30 @@ void renderer_init(Renderer* renderer) {
     renderer->dofFocalDistance = 20.0f;
     renderer->dofFocalRange = 10.0f;
     
+    // Start at the compiled-in window size until the first reshape arrives
+    renderer->windowWidth = WINDOW_WIDTH;
+    renderer->windowHeight = WINDOW_HEIGHT;
+    renderer->renderWidth = WINDOW_WIDTH;
+    renderer->renderHeight = WINDOW_HEIGHT;
+    renderer->outputFramebuffer = 0;
+    
+    // Dynamic resolution
+    renderer->enableDynamicResolution = DYNAMIC_RESOLUTION;
+    renderer->renderScale = 1.0f;
+    renderer->minRenderScale = DYNAMIC_RES_MIN_SCALE;
+    renderer->targetFrameTime = 1000.0f / DYNAMIC_RES_TARGET_FPS;
+    renderer->sharpness = DYNAMIC_RES_SHARPNESS;
+    renderer->gpuFrameTime = 0.0f;
+    renderer->scaleCooldown = 0;
+    
+    // Mesh LOD selection
+    renderer->lodBias = MESH_LOD_BIAS;
+    
+    // SSAO quality (targets are created by renderer_setupFramebuffers)
+    renderer->ssaoDivisor = 0;
+    renderer->ssaoFrame = 0;
+    renderer_setSSAOQuality(renderer, SSAO_DEFAULT_QUALITY);
+    
     // Setup framebuffers
     renderer_setupFramebuffers(renderer);
     
@@ -33,57 +81,156 @@ void renderer_init(Renderer* renderer) {
     
     // Setup SSAO
     renderer_setupSSAO(renderer);
+    
+    // Shared per-frame and per-object uniform buffers
+    shader_initBuffers();
+    
+    // Texture streaming (textures requested through it show a placeholder until resident)
+    renderer->textureStreamer = (TextureStreamer*)malloc(sizeof(TextureStreamer));
+    textureStreamer_init(renderer->textureStreamer, TEXTURE_STREAM_THREADS, TEXTURE_STREAM_STAGING_LIMIT, TEXTURE_STREAM_UPLOAD_BUDGET);
+    
+    // Setup render queue
+    renderer->renderQueue = (RenderQueue*)malloc(sizeof(RenderQueue));
+    renderQueue_init(renderer->renderQueue, 1024);
+    
+    // Worker threads shared by the CPU culling systems
+    renderer->threadPool = (ThreadPool*)malloc(sizeof(ThreadPool));
+    threadPool_init(renderer->threadPool, WORKER_THREADS);
+    
+    // Setup occlusion and vegetation culling
+    renderer->occlusionCuller = (OcclusionCuller*)malloc(sizeof(OcclusionCuller));
+    occlusion_init(renderer->occlusionCuller, OCCLUSION_WIDTH, OCCLUSION_HEIGHT, renderer->threadPool);
+    renderer->terrainOccluder = (OcclusionMesh*)calloc(1, sizeof(OcclusionMesh));
+    renderer->instanceCuller = (InstanceCuller*)malloc(sizeof(InstanceCuller));
+    instanceCulling_init(renderer->instanceCuller, renderer->threadPool);
+    
+    // Scene BVH (built on the first frame)
+    renderer->sceneBvh = (SceneBvh*)malloc(sizeof(SceneBvh));
+    sceneBvh_init(renderer->sceneBvh);
+    renderer->frustumFrame = 0;
+    renderer->pickedObject = NULL;
+    renderer->pickedInstance = SCENE_BVH_NO_INSTANCE;
+    
+    // Setup impostors (atlases are baked or loaded on first use)
+    renderer->impostors = (ImpostorSystem*)malloc(sizeof(ImpostorSystem));
+    impostor_init(renderer->impostors);
+    
+    // Grass chunks are built around the camera on the shared workers
+    renderer->grass = (GrassSystem*)malloc(sizeof(GrassSystem));
+    grass_init(renderer->grass, renderer->threadPool);
+    
+    // Wind field and its texture (filled on the first frame)
+    renderer->windField = (WindField*)malloc(sizeof(WindField));
+    windField_init(renderer->windField, WIND_FIELD_SIZE, WIND_FIELD_CELL_SIZE, WIND_FIELD_SEED);
+    glGenTextures(1, &renderer->windTexture);
+    glBindTexture(GL_TEXTURE_2D, renderer->windTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, WIND_FIELD_SIZE, WIND_FIELD_SIZE, 0, GL_RGBA, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    
+    // Atmosphere LUTs, built on the workers or loaded from the cache, and a first sky view
+    // (replaced once the sun direction is known)
+    renderer->atmosphere = (Atmosphere*)malloc(sizeof(Atmosphere));
+    AtmosphereParams atmosphereParams;
+    atmosphere_defaultParams(&atmosphereParams);
+    if (atmosphere_init(renderer->atmosphere, &atmosphereParams, ATMOSPHERE_VIEWER_HEIGHT, ATMOSPHERE_CACHE_DIR, renderer->threadPool)) {
+        atmosphere_beginSkyView(renderer->atmosphere, 0.5f);
+        atmosphere_buildSkyView(renderer->atmosphere, 0, renderer->threadPool);
+        printf("Atmosphere LUTs: transmittance %.1f ms, multiple scattering %.1f ms%s, sky view %.1f ms\n",
+               renderer->atmosphere->transmittanceTime, renderer->atmosphere->multiScatteringTime,
+               renderer->atmosphere->fromCache ? " (cached)" : "", renderer->atmosphere->skyViewTime);
+    }
+    renderer->transmittanceTexture = renderer_createLutTexture(ATMOSPHERE_TRANSMITTANCE_WIDTH, ATMOSPHERE_TRANSMITTANCE_HEIGHT,
+                                                               renderer->atmosphere->transmittance);
+    renderer->skyViewTexture = renderer_createLutTexture(ATMOSPHERE_SKY_VIEW_WIDTH, ATMOSPHERE_SKY_VIEW_HEIGHT,
+                                                         renderer->atmosphere->skyView);
 }
 
 // Clean up renderer resources
 void renderer_cleanup(Renderer* renderer) {
-    // Delete framebuffers
-    glDeleteFramebuffers(1, &renderer->gBuffer);
-    glDeleteFramebuffers(1, &renderer->ssaoBuffer);
-    glDeleteFramebuffers(1, &renderer->ssaoBlurBuffer);
-    glDeleteFramebuffers(1, &renderer->hdrBuffer);
-    glDeleteFramebuffers(2, renderer->pingpongBuffers);
-    
-    // Delete textures
-    glDeleteTextures(1, &renderer->gPosition);
-    glDeleteTextures(1, &renderer->gNormal);
-    glDeleteTextures(1, &renderer->gAlbedo);
-    glDeleteTextures(1, &renderer->gMaterial);
-    glDeleteTextures(1, &renderer->ssaoColorBuffer);
-    glDeleteTextures(1, &renderer->ssaoBlurColorBuffer);
-    glDeleteTextures(1, &renderer->hdrColorBuffer);
-    glDeleteTextures(2, renderer->pingpongColorBuffers);
+    // Delete render targets
+    renderer_destroyFramebuffers(renderer);
     glDeleteTextures(1, &renderer->ssaoNoiseTexture);
     
-    // Delete renderbuffers
-    glDeleteRenderbuffers(1, &renderer->depthRenderBuffer);
-    
     // Delete VAO and VBO
     glDeleteVertexArrays(1, &renderer->quadVAO);
     glDeleteBuffers(1, &renderer->quadVBO);
     
     // Delete shaders
-    glDeleteProgram(renderer->gBufferShader);
-    glDeleteProgram(renderer->lightingShader);
-    glDeleteProgram(renderer->ssaoShader);
-    glDeleteProgram(renderer->ssaoBlurShader);
-    glDeleteProgram(renderer->shadowMapShader);
-    glDeleteProgram(renderer->skyboxShader);
-    glDeleteProgram(renderer->terrainShader);
-    glDeleteProgram(renderer->waterShader);
-    glDeleteProgram(renderer->vegetationShader);
-    glDeleteProgram(renderer->instancedShader);
-    glDeleteProgram(renderer->particleShader);
-    glDeleteProgram(renderer->postProcessShader);
-    glDeleteProgram(renderer->blurShader);
-    glDeleteProgram(renderer->compositShader);
+    shader_delete(renderer->gBufferShader);
+    shader_delete(renderer->lightingShader);
+    shader_delete(renderer->ssaoShader);
+    shader_delete(renderer->ssaoTemporalShader);
+    shader_delete(renderer->ssaoUpsampleShader);
+    shader_delete(renderer->shadowMapShader);
+    shader_delete(renderer->skyboxShader);
+    shader_delete(renderer->terrainShader);
+    shader_delete(renderer->waterShader);
+    shader_delete(renderer->vegetationShader);
+    shader_delete(renderer->instancedShader);
+    shader_delete(renderer->particleShader);
+    shader_delete(renderer->postProcessShader);
+    shader_delete(renderer->blurShader);
+    shader_delete(renderer->compositShader);
+    shader_delete(renderer->upscaleShader);
     
     // Free SSAO kernel
     free(renderer->ssaoKernel);
+    
+    // Free render queue
+    renderQueue_cleanup(renderer->renderQueue);
+    free(renderer->renderQueue);
+    
+    // Stop texture streaming
+    textureStreamer_cleanup(renderer->textureStreamer);
+    free(renderer->textureStreamer);
+    
+    // Free impostor atlases
+    impostor_cleanup(renderer->impostors);
+    free(renderer->impostors);
+    
+    // Free grass chunks
+    grass_cleanup(renderer->grass);
+    free(renderer->grass);
+    
+    // Free the wind field
+    windField_cleanup(renderer->windField);
+    free(renderer->windField);
+    glDeleteTextures(1, &renderer->windTexture);
+    
+    // Free the atmosphere LUTs
+    atmosphere_cleanup(renderer->atmosphere);
+    free(renderer->atmosphere);
+    glDeleteTextures(1, &renderer->transmittanceTexture);
+    glDeleteTextures(1, &renderer->skyViewTexture);
+    
+    // Free culling systems, then stop the workers
+    sceneBvh_cleanup(renderer->sceneBvh);
+    free(renderer->sceneBvh);
+    instanceCulling_cleanup(renderer->instanceCuller);
+    free(renderer->instanceCuller);
+    occlusion_cleanup(renderer->occlusionCuller);
+    free(renderer->occlusionCuller);
+    occlusion_freeMesh(renderer->terrainOccluder);
+    free(renderer->terrainOccluder);
+    threadPool_cleanup(renderer->threadPool);
+    free(renderer->threadPool);
+    
+    // Release uniform buffers and cached uniform tables
+    shader_cleanup();
 }
 
 // Setup framebuffers
+// Targets are allocated at the window size; the dynamic resolution controller
+// renders into the lower-left renderWidth x renderHeight region of them, so a
+// scale change never reallocates anything.
 void renderer_setupFramebuffers(Renderer* renderer) {
+    int width = renderer->windowWidth;
+    int height = renderer->windowHeight;
+    
     // Create G-buffer
     glGenFramebuffers(1, &renderer->gBuffer);
     glBindFramebuffer(GL_FRAMEBUFFER, renderer->gBuffer);
@@ -91,7 +238,7 @@ void renderer_setupFramebuffers(Renderer* renderer) {
     // Position buffer
     glGenTextures(1, &renderer->gPosition);
     glBindTexture(GL_TEXTURE_2D, renderer->gPosition);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderer->gPosition, 0);
@@ -99,7 +246,7 @@ void renderer_setupFramebuffers(Renderer* renderer) {
     // Normal buffer
     glGenTextures(1, &renderer->gNormal);
     glBindTexture(GL_TEXTURE_2D, renderer->gNormal);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, renderer->gNormal, 0);
@@ -107,7 +254,7 @@ void renderer_setupFramebuffers(Renderer* renderer) {
     // Albedo buffer
     glGenTextures(1, &renderer->gAlbedo);
     glBindTexture(GL_TEXTURE_2D, renderer->gAlbedo);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, renderer->gAlbedo, 0);
@@ -115,7 +262,7 @@ void renderer_setupFramebuffers(Renderer* renderer) {
     // Material properties buffer (Roughness, Metallic, AO)
     glGenTextures(1, &renderer->gMaterial);
     glBindTexture(GL_TEXTURE_2D, renderer->gMaterial);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT3, GL_TEXTURE_2D, renderer->gMaterial, 0);
@@ -132,7 +279,7 @@ void renderer_setupFramebuffers(Renderer* renderer) {
     // Depth renderbuffer
     glGenRenderbuffers(1, &renderer->depthRenderBuffer);
     glBindRenderbuffer(GL_RENDERBUFFER, renderer->depthRenderBuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, WINDOW_WIDTH, WINDOW_HEIGHT);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderer->depthRenderBuffer);
     
     // Check if framebuffer is complete
@@ -140,39 +287,8 @@ void renderer_setupFramebuffers(Renderer* renderer) {
         fprintf(stderr, "G-Buffer framebuffer is not complete!\n");
     }
     
-    // Create SSAO framebuffer
-    glGenFramebuffers(1, &renderer->ssaoBuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, renderer->ssaoBuffer);
-    
-    // SSAO color buffer
-    glGenTextures(1, &renderer->ssaoColorBuffer);
-    glBindTexture(GL_TEXTURE_2D, renderer->ssaoColorBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderer->ssaoColorBuffer, 0);
-    
-    // Check SSAO framebuffer
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        fprintf(stderr, "SSAO framebuffer is not complete!\n");
-    }
-    
-    // Create SSAO blur framebuffer
-    glGenFramebuffers(1, &renderer->ssaoBlurBuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, renderer->ssaoBlurBuffer);
-    
-    // SSAO blur color buffer
-    glGenTextures(1, &renderer->ssaoBlurColorBuffer);
-    glBindTexture(GL_TEXTURE_2D, renderer->ssaoBlurColorBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderer->ssaoBlurColorBuffer, 0);
-    
-    // Check SSAO blur framebuffer
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-        fprintf(stderr, "SSAO blur framebuffer is not complete!\n");
-    }
+    // Create SSAO framebuffers
+    renderer_setupSSAOFramebuffers(renderer);
     
     // Create HDR framebuffer
     glGenFramebuffers(1, &renderer->hdrBuffer);
@@ -181,7 +297,7 @@ void renderer_setupFramebuffers(Renderer* renderer) {
     // HDR color buffer
     glGenTextures(1, &renderer->hdrColorBuffer);
     glBindTexture(GL_TEXTURE_2D, renderer->hdrColorBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -203,7 +319,7 @@ void renderer_setupFramebuffers(Renderer* renderer) {
     for (int i = 0; i < 2; i++) {
         glBindFramebuffer(GL_FRAMEBUFFER, renderer->pingpongBuffers[i]);
         glBindTexture(GL_TEXTURE_2D, renderer->pingpongColorBuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, WINDOW_WIDTH, WINDOW_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width, height, 0, GL_RGBA, GL_FLOAT, NULL);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -215,27 +331,271 @@ void renderer_setupFramebuffers(Renderer* renderer) {
         }
     }
     
+    // Create post-process output framebuffer (LDR, sampled by the upscale pass)
+    glGenFramebuffers(1, &renderer->postBuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, renderer->postBuffer);
+    
+    glGenTextures(1, &renderer->postColorBuffer);
+    glBindTexture(GL_TEXTURE_2D, renderer->postColorBuffer);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderer->postColorBuffer, 0);
+    
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "Post-process framebuffer is not complete!\n");
+    }
+    
     // Unbind framebuffer
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
+// Destroy all screen-sized render targets
+void renderer_destroyFramebuffers(Renderer* renderer) {
+    // Delete framebuffers
+    glDeleteFramebuffers(1, &renderer->gBuffer);
+    glDeleteFramebuffers(1, &renderer->hdrBuffer);
+    glDeleteFramebuffers(2, renderer->pingpongBuffers);
+    glDeleteFramebuffers(1, &renderer->postBuffer);
+    
+    // Delete textures
+    glDeleteTextures(1, &renderer->gPosition);
+    glDeleteTextures(1, &renderer->gNormal);
+    glDeleteTextures(1, &renderer->gAlbedo);
+    glDeleteTextures(1, &renderer->gMaterial);
+    glDeleteTextures(1, &renderer->hdrColorBuffer);
+    glDeleteTextures(2, renderer->pingpongColorBuffers);
+    glDeleteTextures(1, &renderer->postColorBuffer);
+    
+    // Delete renderbuffers
+    glDeleteRenderbuffers(1, &renderer->depthRenderBuffer);
+    
+    // Delete SSAO targets
+    renderer_destroySSAOFramebuffers(renderer);
+}
+
+// Setup SSAO render targets at the resolution of the current quality mode
+void renderer_setupSSAOFramebuffers(Renderer* renderer) {
+    int width = renderer->windowWidth;
+    int height = renderer->windowHeight;
+    
+    renderer->ssaoWidth = (width + renderer->ssaoDivisor - 1) / renderer->ssaoDivisor;
+    renderer->ssaoHeight = (height + renderer->ssaoDivisor - 1) / renderer->ssaoDivisor;
+    
+    // Create SSAO framebuffer
+    glGenFramebuffers(1, &renderer->ssaoBuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, renderer->ssaoBuffer);
+    
+    // SSAO color buffer (R: occlusion, G: linear view depth for upsampling)
+    glGenTextures(1, &renderer->ssaoColorBuffer);
+    glBindTexture(GL_TEXTURE_2D, renderer->ssaoColorBuffer);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, renderer->ssaoWidth, renderer->ssaoHeight, 0, GL_RG, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderer->ssaoColorBuffer, 0);
+    
+    // Check SSAO framebuffer
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "SSAO framebuffer is not complete!\n");
+    }
+    
+    // Create SSAO history framebuffers for temporal accumulation
+    glGenFramebuffers(2, renderer->ssaoHistoryBuffers);
+    glGenTextures(2, renderer->ssaoHistoryColorBuffers);
+    
+    for (int i = 0; i < 2; i++) {
+        glBindFramebuffer(GL_FRAMEBUFFER, renderer->ssaoHistoryBuffers[i]);
+        glBindTexture(GL_TEXTURE_2D, renderer->ssaoHistoryColorBuffers[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, renderer->ssaoWidth, renderer->ssaoHeight, 0, GL_RG, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderer->ssaoHistoryColorBuffers[i], 0);
+        
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            fprintf(stderr, "SSAO history framebuffer %d is not complete!\n", i);
+        }
+    }
+    
+    // Create SSAO upsample framebuffer (full resolution, read by the lighting pass)
+    glGenFramebuffers(1, &renderer->ssaoBlurBuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, renderer->ssaoBlurBuffer);
+    
+    glGenTextures(1, &renderer->ssaoBlurColorBuffer);
+    glBindTexture(GL_TEXTURE_2D, renderer->ssaoBlurColorBuffer);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R16F, width, height, 0, GL_RED, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, renderer->ssaoBlurColorBuffer, 0);
+    
+    // Check SSAO upsample framebuffer
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "SSAO upsample framebuffer is not complete!\n");
+    }
+    
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    
+    // New targets hold no usable history
+    renderer->ssaoHistoryValid = false;
+}
+
+// Destroy SSAO render targets
+void renderer_destroySSAOFramebuffers(Renderer* renderer) {
+    glDeleteFramebuffers(1, &renderer->ssaoBuffer);
+    glDeleteFramebuffers(2, renderer->ssaoHistoryBuffers);
+    glDeleteFramebuffers(1, &renderer->ssaoBlurBuffer);
+    
+    glDeleteTextures(1, &renderer->ssaoColorBuffer);
+    glDeleteTextures(2, renderer->ssaoHistoryColorBuffers);
+    glDeleteTextures(1, &renderer->ssaoBlurColorBuffer);
+}
+
+// Switch SSAO quality mode, reallocating its targets if the resolution changes
+void renderer_setSSAOQuality(Renderer* renderer, SSAOQuality quality) {
+    int oldDivisor = renderer->ssaoDivisor;
+    
+    switch (quality) {
+        case SSAO_QUALITY_FULL:
+            renderer->ssaoDivisor = 1;
+            renderer->ssaoSamplesPerFrame = SSAO_KERNEL_SIZE;
+            renderer->ssaoTemporal = false;
+            break;
+        case SSAO_QUALITY_QUARTER:
+            renderer->ssaoDivisor = 4;
+            renderer->ssaoSamplesPerFrame = SSAO_SAMPLES_PER_FRAME;
+            renderer->ssaoTemporal = true;
+            break;
+        case SSAO_QUALITY_HALF:
+        default:
+            quality = SSAO_QUALITY_HALF;
+            renderer->ssaoDivisor = 2;
+            renderer->ssaoSamplesPerFrame = SSAO_SAMPLES_PER_FRAME;
+            renderer->ssaoTemporal = true;
+            break;
+    }
+    renderer->ssaoQuality = quality;
+    renderer->ssaoHistoryValid = false;
+    
+    // Only reallocate once the targets exist and their size actually changes
+    if (oldDivisor != 0 && oldDivisor != renderer->ssaoDivisor) {
+        renderer_destroySSAOFramebuffers(renderer);
+        renderer_setupSSAOFramebuffers(renderer);
+    }
+}
+
+// Handle a window resize: reallocate targets and recompute the render size
+void renderer_resize(Renderer* renderer, int width, int height) {
+    if (width <= 0 || height <= 0) return;
+    
+    if (width != renderer->windowWidth || height != renderer->windowHeight) {
+        renderer->windowWidth = width;
+        renderer->windowHeight = height;
+        
+        renderer_destroyFramebuffers(renderer);
+        renderer_setupFramebuffers(renderer);
+    }
+    
+    renderer_setRenderScale(renderer, renderer->renderScale);
+}
+
+// Set the internal render scale (fraction of the window size per axis)
+void renderer_setRenderScale(Renderer* renderer, float scale) {
+    if (scale < renderer->minRenderScale) scale = renderer->minRenderScale;
+    if (scale > 1.0f) scale = 1.0f;
+    
+    renderer->renderScale = scale;
+    renderer->renderWidth = (int)(renderer->windowWidth * scale + 0.5f);
+    renderer->renderHeight = (int)(renderer->windowHeight * scale + 0.5f);
+    if (renderer->renderWidth < 1) renderer->renderWidth = 1;
+    if (renderer->renderHeight < 1) renderer->renderHeight = 1;
+}
+
+// Pick a new render scale from the measured GPU frame time
+void renderer_updateDynamicResolution(Renderer* renderer) {
+    // Exponential moving average to filter out single-frame spikes
+    float sample = profiler_getGPUFrameTime();
+    if (sample > 0.0f) {
+        if (renderer->gpuFrameTime <= 0.0f) {
+            renderer->gpuFrameTime = sample;
+        } else {
+            renderer->gpuFrameTime += (sample - renderer->gpuFrameTime) * 0.1f;
+        }
+    }
+    
+    if (!renderer->enableDynamicResolution || renderer->gpuFrameTime <= 0.0f) {
+        return;
+    }
+    
+    // Give the GPU a few frames to settle after every change
+    if (renderer->scaleCooldown > 0) {
+        renderer->scaleCooldown--;
+        return;
+    }
+    
+    float target = renderer->targetFrameTime;
+    float frameTime = renderer->gpuFrameTime;
+    
+    // Only react outside a dead band, otherwise we oscillate around the target
+    if (frameTime < target * 0.95f && frameTime > target * 0.8f) {
+        return;
+    }
+    if (frameTime <= target * 0.8f && renderer->renderScale >= 1.0f) {
+        return;
+    }
+    
+    // GPU cost scales with pixel count, i.e. with the square of the scale
+    float newScale = renderer->renderScale * sqrtf(target / frameTime);
+    
+    // Drop quickly, recover slowly
+    float maxStep = frameTime > target ? 0.1f : 0.02f;
+    if (newScale > renderer->renderScale + maxStep) newScale = renderer->renderScale + maxStep;
+    if (newScale < renderer->renderScale - maxStep) newScale = renderer->renderScale - maxStep;
+    
+    renderer_setRenderScale(renderer, newScale);
+    renderer->scaleCooldown = 8;
+}
+
+// Set the uniforms a full-screen pass needs to address the active render region
+void renderer_setScreenUniforms(Renderer* renderer, GLuint shader) {
+    float uvScaleX = (float)renderer->renderWidth / renderer->windowWidth;
+    float uvScaleY = (float)renderer->renderHeight / renderer->windowHeight;
+    
+    shader_setVec2(shader, "uvScale", uvScaleX, uvScaleY);
+    shader_setVec2(shader, "texelSize", 1.0f / renderer->windowWidth, 1.0f / renderer->windowHeight);
+}
+
 // Setup shaders
 void renderer_setupShaders(Renderer* renderer) {
-    // Load shaders
-    renderer->gBufferShader = shader_load("src/shaders/gbuffer.vert", "src/shaders/gbuffer.frag");
-    renderer->lightingShader = shader_load("src/shaders/lighting.vert", "src/shaders/lighting.frag");
-    renderer->ssaoShader = shader_load("src/shaders/ssao.vert", "src/shaders/ssao.frag");
-    renderer->ssaoBlurShader = shader_load("src/shaders/ssao_blur.vert", "src/shaders/ssao_blur.frag");
-    renderer->shadowMapShader = shader_load("src/shaders/shadow_map.vert", "src/shaders/shadow_map.frag");
-    renderer->skyboxShader = shader_load("src/shaders/skybox.vert", "src/shaders/skybox.frag");
-    renderer->terrainShader = shader_load("src/shaders/terrain.vert", "src/shaders/terrain.frag");
-    renderer->waterShader = shader_load("src/shaders/water.vert", "src/shaders/water.frag");
-    renderer->vegetationShader = shader_load("src/shaders/vegetation.vert", "src/shaders/vegetation.frag");
-    renderer->instancedShader = shader_load("src/shaders/instanced.vert", "src/shaders/instanced.frag");
-    renderer->particleShader = shader_load("src/shaders/particle.vert", "src/shaders/particle.frag");
-    renderer->postProcessShader = shader_load("src/shaders/post_process.vert", "src/shaders/post_process.frag");
-    renderer->blurShader = shader_load("src/shaders/blur.vert", "src/shaders/blur.frag");
-    renderer->compositShader = shader_load("src/shaders/composit.vert", "src/shaders/composit.frag");
+    // Load all programs as one batch so cache misses compile in parallel where the driver can
+    const ShaderProgramDesc programs[] = {
+        { "src/shaders/gbuffer.vert", "src/shaders/gbuffer.frag", &renderer->gBufferShader },
+        { "src/shaders/lighting.vert", "src/shaders/lighting.frag", &renderer->lightingShader },
+        { "src/shaders/ssao.vert", "src/shaders/ssao.frag", &renderer->ssaoShader },
+        { "src/shaders/ssao.vert", "src/shaders/ssao_temporal.frag", &renderer->ssaoTemporalShader },
+        { "src/shaders/ssao.vert", "src/shaders/ssao_upsample.frag", &renderer->ssaoUpsampleShader },
+        { "src/shaders/shadow_map.vert", "src/shaders/shadow_map.frag", &renderer->shadowMapShader },
+        { "src/shaders/skybox.vert", "src/shaders/skybox.frag", &renderer->skyboxShader },
+        { "src/shaders/terrain.vert", "src/shaders/terrain.frag", &renderer->terrainShader },
+        { "src/shaders/water.vert", "src/shaders/water.frag", &renderer->waterShader },
+        { "src/shaders/vegetation.vert", "src/shaders/vegetation.frag", &renderer->vegetationShader },
+        { "src/shaders/instanced.vert", "src/shaders/instanced.frag", &renderer->instancedShader },
+        { "src/shaders/particle.vert", "src/shaders/particle.frag", &renderer->particleShader },
+        { "src/shaders/post_process.vert", "src/shaders/post_process.frag", &renderer->postProcessShader },
+        { "src/shaders/blur.vert", "src/shaders/blur.frag", &renderer->blurShader },
+        { "src/shaders/composit.vert", "src/shaders/composit.frag", &renderer->compositShader },
+        { "src/shaders/upscale.vert", "src/shaders/upscale.frag", &renderer->upscaleShader }
+    };
+    
+    ShaderLoadStats stats;
+    shader_loadPrograms(programs, (int)(sizeof(programs) / sizeof(programs[0])), &stats);
+    printf("Shaders: %d programs in %.1f ms (%d cached, %d compiled%s, %d failed)\n",
+           stats.programs, stats.time, stats.cached, stats.compiled,
+           stats.parallel ? " in parallel" : "", stats.failed);
 }
 
 // Setup screen-space quad
@@ -263,9 +623,14 @@ void renderer_setupQuad(Renderer* renderer) {
 // Setup SSAO
 void renderer_setupSSAO(Renderer* renderer) {
     // Generate SSAO kernel
-    renderer->ssaoKernelSize = 64;
+    renderer->ssaoKernelSize = SSAO_KERNEL_SIZE;
     renderer->ssaoKernel = malloc(sizeof(vec3) * renderer->ssaoKernelSize);
     
+    // Interleave radii so that every contiguous per-frame subset of
+    // SSAO_SAMPLES_PER_FRAME samples spans the whole hemisphere radius range
+    unsigned int subsets = renderer->ssaoKernelSize / SSAO_SAMPLES_PER_FRAME;
+    if (subsets == 0) subsets = 1;
+    
     for (unsigned int i = 0; i < renderer->ssaoKernelSize; i++) {
         vec3 sample = {
             (float)rand() / RAND_MAX * 2.0f - 1.0f,
@@ -274,7 +639,16 @@ void renderer_setupSSAO(Renderer* renderer) {
         };
         
         // Normalize
-        float scale = (float)i / renderer->ssaoKernelSize;
+        float length = sqrtf(sample[0] * sample[0] + sample[1] * sample[1] + sample[2] * sample[2]);
+        if (length > 0.0f) {
+            sample[0] /= length;
+            sample[1] /= length;
+            sample[2] /= length;
+        }
+        
+        // Scale towards the center, ordered by rank within the subset
+        unsigned int rank = (i % SSAO_SAMPLES_PER_FRAME) * subsets + i / SSAO_SAMPLES_PER_FRAME;
+        float scale = (float)rank / renderer->ssaoKernelSize;
         scale = 0.1f + scale * scale * 0.9f; // Lerp
         
         sample[0] *= scale;
@@ -307,31 +681,430 @@ void renderer_setupSSAO(Renderer* renderer) {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    
+    // Upload the kernel once; each frame selects a subset with sampleOffset
+    shader_use(renderer->ssaoShader);
+    glUniform3fv(shader_getUniformLocation(renderer->ssaoShader, "samples"), renderer->ssaoKernelSize, (const GLfloat*)renderer->ssaoKernel);
+    shader_use(0);
+}
+
+// Multiply two column-major 4x4 matrices: out = a * b
+static void renderer_multiplyMatrices(const float* a, const float* b, float* out) {
+    for (int col = 0; col < 4; col++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                sum += a[k * 4 + row] * b[col * 4 + k];
+            }
+            out[col * 4 + row] = sum;
+        }
+    }
+}
+
+// World-space box around an object from its mesh radius and largest scale axis
+static void renderer_objectBounds(const Object* object, float fallbackRadius, float shrink, float* boxMin, float* boxMax) {
+    float radius = object->mesh && object->mesh->boundingRadius > 0.0f ? object->mesh->boundingRadius : fallbackRadius;
+    float scale = fmaxf(object->transform.scale[0], fmaxf(object->transform.scale[1], object->transform.scale[2]));
+    float extent = radius * scale * shrink;
+    
+    for (int axis = 0; axis < 3; axis++) {
+        boxMin[axis] = object->transform.position[axis] - extent;
+        boxMax[axis] = object->transform.position[axis] + extent;
+    }
+}
+
+// Cell-local coordinates in [0, 1] to test along one axis: the cell edges, every heightmap texel
+// line inside the cell, and the midpoints between them. Returns the count written.
+static int renderer_terrainOccluderSamples(float cellStart, float cellSize, float texelSize, float* coords) {
+    int count = 0;
+    float previous = 0.0f;
+    coords[count++] = 0.0f;
+    for (float texel = ceilf(cellStart / texelSize) * texelSize; texel < cellStart + cellSize; texel += texelSize) {
+        float u = (texel - cellStart) / cellSize;
+        if (u <= previous) continue;
+        coords[count++] = (previous + u) * 0.5f;
+        coords[count++] = u;
+        previous = u;
+    }
+    coords[count++] = (previous + 1.0f) * 0.5f;
+    coords[count++] = 1.0f;
+    return count;
+}
+
+// Height of an occluder cell above the terrain at cell-local (u, v). Corners are ordered
+// (x, z), (x + 1, z), (x, z + 1), (x + 1, z + 1) and split along the index buffer's diagonal.
+static float renderer_terrainOccluderGap(Terrain* terrain, const float* corners, int x, int z, float u, float v) {
+    float step = terrain->size / OCCLUSION_TERRAIN_GRID;
+    float half = terrain->size * 0.5f;
+    float plane = u + v <= 1.0f
+        ? corners[0] + u * (corners[1] - corners[0]) + v * (corners[2] - corners[0])
+        : corners[3] + (1.0f - u) * (corners[2] - corners[3]) + (1.0f - v) * (corners[1] - corners[3]);
+    return plane - terrain_getHeight(terrain, -half + (x + u) * step, -half + (z + v) * step);
+}
+
+// Largest height the occluder grid's triangles sit above the terrain in each cell; false if out of memory
+static bool renderer_terrainOccluderErrors(Terrain* terrain, const float* vertices, float* cellError) {
+    int grid = OCCLUSION_TERRAIN_GRID;
+    int side = grid + 1;
+    float step = terrain->size / grid;
+    float texelSize = terrain->size / (terrain->heightMapSize > 1 ? terrain->heightMapSize - 1 : 1);
+    int maxSamples = 2 * ((int)(step / texelSize) + 2) + 3;
+    float* us = (float*)malloc(sizeof(float) * maxSamples * 2);
+    if (!us) return false;
+    float* vs = us + maxSamples;
+    
+    for (int z = 0; z < grid; z++) {
+        int vCount = renderer_terrainOccluderSamples(z * step, step, texelSize, vs);
+        for (int x = 0; x < grid; x++) {
+            int uCount = renderer_terrainOccluderSamples(x * step, step, texelSize, us);
+            
+            float corners[4] = {
+                vertices[(z * side + x) * 3 + 1],
+                vertices[(z * side + x + 1) * 3 + 1],
+                vertices[((z + 1) * side + x) * 3 + 1],
+                vertices[((z + 1) * side + x + 1) * 3 + 1]
+            };
+            
+            // The gap is bilinear inside each texel, so it peaks at texel corners or on the diagonal
+            // where the two triangles meet; test both
+            float error = 0.0f;
+            for (int j = 0; j < vCount; j++) {
+                for (int i = 0; i < uCount; i++) {
+                    error = fmaxf(error, renderer_terrainOccluderGap(terrain, corners, x, z, us[i], vs[j]));
+                }
+                error = fmaxf(error, renderer_terrainOccluderGap(terrain, corners, x, z, 1.0f - vs[j], vs[j]));
+            }
+            for (int i = 0; i < uCount; i++) {
+                error = fmaxf(error, renderer_terrainOccluderGap(terrain, corners, x, z, us[i], 1.0f - us[i]));
+            }
+            cellError[z * grid + x] = error;
+        }
+    }
+    free(us);
+    return true;
+}
+
+// Build a coarse occluder grid over the terrain, lowered so it stays under the real surface
+static void renderer_buildTerrainOccluder(OcclusionMesh* mesh, Terrain* terrain) {
+    int grid = OCCLUSION_TERRAIN_GRID;
+    int side = grid + 1;
+    
+    mesh->vertices = (float*)malloc(sizeof(float) * 3 * side * side);
+    mesh->indices = (unsigned int*)malloc(sizeof(unsigned int) * 6 * grid * grid);
+    if (!mesh->vertices || !mesh->indices) {
+        occlusion_freeMesh(mesh);
+        return;
+    }
+    
+    // Terrain covers size x size world units centred on the origin
+    float half = terrain->size * 0.5f;
+    float step = terrain->size / grid;
+    for (int z = 0; z < side; z++) {
+        for (int x = 0; x < side; x++) {
+            float* vertex = &mesh->vertices[(z * side + x) * 3];
+            vertex[0] = -half + x * step;
+            vertex[2] = -half + z * step;
+            vertex[1] = terrain_getHeight(terrain, vertex[0], vertex[2]);
+        }
+    }
+    
+    // Lower each vertex by the worst error of the cells around it, so every triangle stays under
+    // the terrain samples it spans
+    float* cellError = (float*)malloc(sizeof(float) * grid * grid);
+    if (!cellError || !renderer_terrainOccluderErrors(terrain, mesh->vertices, cellError)) {
+        free(cellError);
+        occlusion_freeMesh(mesh);
+        return;
+    }
+    for (int z = 0; z < side; z++) {
+        for (int x = 0; x < side; x++) {
+            float error = 0.0f;
+            for (int cz = z - 1; cz <= z; cz++) {
+                for (int cx = x - 1; cx <= x; cx++) {
+                    if (cx < 0 || cz < 0 || cx >= grid || cz >= grid) continue;
+                    error = fmaxf(error, cellError[cz * grid + cx]);
+                }
+            }
+            mesh->vertices[(z * side + x) * 3 + 1] -= error + OCCLUSION_TERRAIN_BIAS;
+        }
+    }
+    free(cellError);
+    
+    size_t index = 0;
+    for (int z = 0; z < grid; z++) {
+        for (int x = 0; x < grid; x++) {
+            unsigned int topLeft = z * side + x;
+            unsigned int bottomLeft = (z + 1) * side + x;
+            mesh->indices[index++] = topLeft;
+            mesh->indices[index++] = bottomLeft;
+            mesh->indices[index++] = topLeft + 1;
+            mesh->indices[index++] = topLeft + 1;
+            mesh->indices[index++] = bottomLeft;
+            mesh->indices[index++] = bottomLeft + 1;
+        }
+    }
+    
+    mesh->vertexCount = (size_t)(side * side);
+    mesh->indexCount = index;
+}
+
+// Rasterize this frame's occluders: coarse terrain and shrunken structure boxes
+static void renderer_rasterizeOccluders(Renderer* renderer, SceneManager* scene, const float* viewProjection) {
+    OcclusionCuller* occlusion = renderer->occlusionCuller;
+    occlusion_begin(occlusion, viewProjection);
+    
+    if (!renderer->terrainOccluder->vertices && scene->terrain.heightData) {
+        renderer_buildTerrainOccluder(renderer->terrainOccluder, &scene->terrain);
+    }
+    occlusion_addOccluderMesh(occlusion, renderer->terrainOccluder);
+    
+    Object* structures[2] = { scene->cottages, scene->ruins };
+    size_t structureCounts[2] = { scene->cottageCount, scene->ruinCount };
+    for (int type = 0; type < 2; type++) {
+        for (size_t i = 0; i < structureCounts[type]; i++) {
+            Object* object = &structures[type][i];
+            if (!object->isVisible) continue;
+            
+            float boxMin[3], boxMax[3];
+            renderer_objectBounds(object, OCCLUSION_STRUCTURE_RADIUS, OCCLUSION_PROXY_SHRINK, boxMin, boxMax);
+            occlusion_addOccluderBox(occlusion, boxMin, boxMax);
+        }
+    }
+    
+    occlusion_rasterize(occlusion);
+}
+
+// Give objects of one category an impostor atlas; failed bakes are remembered and not retried
+static void renderer_assignImpostors(Renderer* renderer, Object* objects, size_t count, float distance) {
+    for (size_t i = 0; i < count; i++) {
+        Object* object = &objects[i];
+        if (object->impostor || object->impostorDistance < 0.0f || !object->mesh) continue;
+        
+        object->impostor = impostor_getAtlas(renderer->impostors, object->mesh, object->material);
+        object->impostorDistance = object->impostor ? distance : -1.0f;
+    }
+}
+
+// Gather the scene's objects into the BVH: rebuilt when the set changes, refit otherwise
+static void renderer_updateSceneBvh(Renderer* renderer, SceneManager* scene) {
+    SceneBvh* sceneBvh = renderer->sceneBvh;
+    sceneBvh_begin(sceneBvh);
+    sceneBvh_addObjects(sceneBvh, scene->cottages, scene->cottageCount);
+    sceneBvh_addObjects(sceneBvh, scene->ruins, scene->ruinCount);
+    sceneBvh_addObjects(sceneBvh, scene->bridges, scene->bridgeCount);
+    sceneBvh_addObjects(sceneBvh, scene->trees, scene->treeCount);
+    sceneBvh_addObjects(sceneBvh, scene->flowers, scene->flowerCount);
+    sceneBvh_addObjects(sceneBvh, scene->mushrooms, scene->mushroomCount);
+    sceneBvh_addObjects(sceneBvh, scene->lanterns, scene->lanternCount);
+    sceneBvh_end(sceneBvh);
+}
+
+// Advance the wind field and upload the cells that changed
+static void renderer_updateWind(Renderer* renderer, SceneManager* scene, Camera* camera, double time) {
+    WindField* windField = renderer->windField;
+    if (!windField->cells) return;
+    
+    windField_update(windField, time, camera->position, scene->windStrength, scene->windDirection);
+    if (windField->dirty) {
+        // The texture mirrors the ring-addressed cells, so it is replaced as is
+        glBindTexture(GL_TEXTURE_2D, renderer->windTexture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, windField->size, windField->size, GL_RGBA, GL_FLOAT, windField->cells);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        windField->dirty = false;
+    }
+}
+
+// Rebuild the sky view once the sun has moved far enough, a slice of rows per frame, and
+// upload it when complete
+static void renderer_updateAtmosphere(Renderer* renderer, const Skybox* skybox) {
+    Atmosphere* atmosphere = renderer->atmosphere;
+    if (!atmosphere->skyView) return;
+    
+    // Only the elevation matters; the sky pass rotates the LUT to the sun's azimuth
+    const float* sun = skybox->sunDirection;
+    float length = sqrtf(sun[0] * sun[0] + sun[1] * sun[1] + sun[2] * sun[2]);
+    if (length <= 0.0f) return;
+    float elevation = asinf(fmaxf(-1.0f, fminf(1.0f, sun[1] / length)));
+    
+    bool building = atmosphere->skyViewRow < ATMOSPHERE_SKY_VIEW_HEIGHT;
+    if (!building && fabsf(elevation - atmosphere->skyViewElevation) > ATMOSPHERE_SUN_STEP) {
+        atmosphere_beginSkyView(atmosphere, elevation);
+        building = true;
+    }
+    if (!building) return;
+    
+    if (atmosphere_buildSkyView(atmosphere, ATMOSPHERE_SKY_VIEW_ROWS, renderer->threadPool)) {
+        glBindTexture(GL_TEXTURE_2D, renderer->skyViewTexture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, ATMOSPHERE_SKY_VIEW_WIDTH, ATMOSPHERE_SKY_VIEW_HEIGHT, GL_RGB, GL_FLOAT, atmosphere->skyView);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        profiler_addCounter("Atmosphere sky view rebuild (ms)", atmosphere->skyViewTime);
+    }
+    profiler_addCounter("Atmosphere sky view slice (ms)", atmosphere->sliceTime);
 }
 
 // Main render function
 void renderer_render(Renderer* renderer, SceneManager* scene, Camera* camera, float timeOfDay, WeatherType weather) {
+    TRACE_SCOPE("renderer_render");
+    
+    // Camera matrices are uploaded once per frame for every program
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    camera_getViewMatrix(camera, viewMatrix);
+    camera_getProjectionMatrix(camera, projectionMatrix);
+    double seconds = profiler_now() / 1000.0;
+    shader_updateFrameData(viewMatrix, projectionMatrix, camera->position, (float)seconds);
+    
+    // Upload the next slice of streamed texture levels
+    profiler_beginCPU("Texture streaming");
+    TRACE_BEGIN("Texture streaming");
+    textureStreamer_update(renderer->textureStreamer);
+    TRACE_END();
+    profiler_endCPU();
+    
+    // Software depth buffer for occlusion tests
+    mat4 viewProjection;
+    renderer_multiplyMatrices(projectionMatrix, viewMatrix, viewProjection);
+    profiler_beginCPU("Occlusion rasterize");
+    TRACE_BEGIN("Occlusion rasterize");
+    renderer_rasterizeOccluders(renderer, scene, viewProjection);
+    TRACE_END();
+    profiler_endCPU();
+    
+    // Frustum-cull whole objects through the scene BVH (instances are culled one by one below)
+    profiler_beginCPU("Scene BVH");
+    TRACE_BEGIN("Scene BVH");
+    renderer_updateSceneBvh(renderer, scene);
+    const uint32_t* insideItems;
+    size_t insideCount = sceneBvh_queryFrustum(renderer->sceneBvh, viewProjection, &insideItems);
+    renderer->frustumFrame++;
+    for (size_t i = 0; i < insideCount; i++) {
+        const SceneBvhItem* item = &renderer->sceneBvh->items[insideItems[i]];
+        if (item->count == 0) item->object->frustumFrame = renderer->frustumFrame;
+    }
+    TRACE_END();
+    profiler_endCPU();
+    profiler_addCounter("BVH items", renderer->sceneBvh->itemCount);
+    profiler_addCounter("BVH items in frustum", (double)insideCount);
+    if (renderer->sceneBvh->rebuilt) profiler_addCounter("BVH build (ms)", renderer->sceneBvh->buildTime);
+    if (renderer->sceneBvh->refitTime > 0.0) profiler_addCounter("BVH refit (ms)", renderer->sceneBvh->refitTime);
+    
+    // Impostors for distant trees and structures
+    renderer_assignImpostors(renderer, scene->trees, scene->treeCount, IMPOSTOR_DISTANCE_TREES);
+    renderer_assignImpostors(renderer, scene->cottages, scene->cottageCount, IMPOSTOR_DISTANCE_STRUCTURES);
+    renderer_assignImpostors(renderer, scene->ruins, scene->ruinCount, IMPOSTOR_DISTANCE_STRUCTURES);
+    impostor_begin(renderer->impostors);
+    
+    // Cull vegetation instances against the camera and compact the survivors
+    profiler_beginCPU("Instance culling");
+    TRACE_BEGIN("Instance culling");
+    InstanceCuller* culler = renderer->instanceCuller;
+    culler->lodBias = renderer->lodBias;
+    instanceCulling_begin(culler, viewMatrix, projectionMatrix, camera->position, renderer->occlusionCuller, renderer->impostors);
+    instanceCulling_addObjects(culler, INSTANCE_CULL_TREES, scene->trees, scene->treeCount);
+    instanceCulling_addObjects(culler, INSTANCE_CULL_FLOWERS, scene->flowers, scene->flowerCount);
+    instanceCulling_addObjects(culler, INSTANCE_CULL_MUSHROOMS, scene->mushrooms, scene->mushroomCount);
+    instanceCulling_addObjects(culler, INSTANCE_CULL_LANTERNS, scene->lanterns, scene->lanternCount);
+    instanceCulling_execute(culler);
+    TRACE_END();
+    profiler_endCPU();
+    
+    // Scroll the wind field with the camera and the mean wind
+    profiler_beginCPU("Wind field");
+    TRACE_BEGIN("Wind field");
+    renderer_updateWind(renderer, scene, camera, seconds);
+    TRACE_END();
+    profiler_endCPU();
+    profiler_addCounter("Wind field update (ms)", renderer->windField->updateTime);
+    profiler_addCounter("Wind cells updated", (double)renderer->windField->cellsUpdated);
+    
+    // Follow the sun with the sky-view LUT
+    profiler_beginCPU("Atmosphere");
+    TRACE_BEGIN("Atmosphere");
+    renderer_updateAtmosphere(renderer, &scene->skybox);
+    TRACE_END();
+    profiler_endCPU();
+    
+    // Build grass chunks near the camera and cull whole chunks
+    profiler_beginCPU("Grass chunks");
+    TRACE_BEGIN("Grass chunks");
+    grass_update(renderer->grass, &scene->terrain, viewProjection, camera->position, renderer->occlusionCuller);
+    TRACE_END();
+    profiler_endCPU();
+    const GrassStats* grassStats = grass_getStats(renderer->grass);
+    profiler_addCounter("Grass chunks resident", (double)grassStats->chunksResident);
+    profiler_addCounter("Grass chunks in range", (double)grassStats->chunksInRange);
+    profiler_addCounter("Grass chunks culled", (double)grassStats->chunksCulled);
+    profiler_addCounter("Grass blades in range", (double)grassStats->bladesInRange);
+    if (grassStats->chunksBuilt) {
+        profiler_addCounter("Grass chunks built", (double)grassStats->chunksBuilt);
+        profiler_addCounter("Grass build (ms)", grassStats->buildTime);
+    }
+    
     // 1. Render shadow maps
     if (renderer->enableShadows) {
+        profiler_beginGPU("Shadow maps");
+        TRACE_BEGIN("renderer_renderShadowMaps");
         renderer_renderShadowMaps(renderer, scene);
+        TRACE_END();
+        profiler_endGPU();
     }
     
     // 2. Geometry pass (fill G-buffer)
+    profiler_beginGPU("Geometry pass");
+    TRACE_BEGIN("renderer_geometryPass");
     renderer_geometryPass(renderer, scene, camera);
+    TRACE_END();
+    profiler_endGPU();
     
     // 3. SSAO pass
     if (renderer->enableSSAO) {
+        // Each quality mode is timed under its own name so they can be compared
+        static const char* ssaoScopeNames[SSAO_QUALITY_COUNT] = {
+            "SSAO pass (full)", "SSAO pass (half)", "SSAO pass (quarter)"
+        };
+        profiler_beginGPU(ssaoScopeNames[renderer->ssaoQuality]);
+        TRACE_BEGIN("renderer_ssaoPass");
         renderer_ssaoPass(renderer, camera);
+        TRACE_END();
+        profiler_endGPU();
     }
     
     // 4. Lighting pass
+    profiler_beginGPU("Lighting pass");
+    TRACE_BEGIN("renderer_lightingPass");
     renderer_lightingPass(renderer, scene, camera, timeOfDay);
+    TRACE_END();
+    profiler_endGPU();
     
     // 5. Transparency pass (water, particles)
+    profiler_beginGPU("Transparency pass");
+    TRACE_BEGIN("renderer_transparencyPass");
     renderer_transparencyPass(renderer, scene, camera, timeOfDay);
+    TRACE_END();
+    profiler_endGPU();
     
-    // 6. Post-process pass
+    // 6. Post-process pass (writes the active render region of the window-sized postBuffer)
+    profiler_beginGPU("Post-process pass");
+    TRACE_BEGIN("renderer_postProcessPass");
     renderer_postProcessPass(renderer);
+    TRACE_END();
+    profiler_endGPU();
+    
+    // 7. Upscale that region to the full window with sharpening
+    profiler_beginGPU("Upscale pass");
+    TRACE_BEGIN("renderer_upscalePass");
+    renderer_upscalePass(renderer);
+    TRACE_END();
+    profiler_endGPU();
+    
+    renderer_updateDynamicResolution(renderer);
+    
+    // Driver-call and occlusion counts for this frame
+    shader_reportCounters();
+    const OcclusionStats* occlusionStats = occlusion_getStats(renderer->occlusionCuller);
+    profiler_addCounter("Occluder triangles", occlusionStats->trianglesRasterized);
+    profiler_addCounter("Occlusion boxes tested", occlusionStats->boxesTested);
+    profiler_addCounter("Occlusion boxes occluded", occlusionStats->boxesOccluded);
 }
 
 // Geometry pass
@@ -342,8 +1115,8 @@ void renderer_geometryPass(Renderer* renderer, SceneManager* scene, Camera* came
     // Clear buffers
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     
-    // Set viewport
-    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+    // Set viewport to the active render region
+    glViewport(0, 0, renderer->renderWidth, renderer->renderHeight);
     
     // Wireframe mode
     if (renderer->showWireframe) {
@@ -359,55 +1132,323 @@ void renderer_geometryPass(Renderer* renderer, SceneManager* scene, Camera* came
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
 }
 
-// Simple scene renderer
-void renderer_renderScene(Renderer* renderer, SceneManager* scene, Camera* camera, bool depthOnly) {
-    // Get view matrix
+// SSAO pass: generate at reduced resolution, accumulate over time, then upsample
+void renderer_ssaoPass(Renderer* renderer, Camera* camera) {
+    // Camera matrices
     mat4 viewMatrix;
-    camera_getViewMatrix(camera, viewMatrix);
-    
-    // Get projection matrix
     mat4 projectionMatrix;
+    mat4 viewProjection;
+    camera_getViewMatrix(camera, viewMatrix);
     camera_getProjectionMatrix(camera, projectionMatrix);
+    renderer_multiplyMatrices(projectionMatrix, viewMatrix, viewProjection);
     
-    // Use appropriate shader
-    GLuint shader = depthOnly ? renderer->shadowMapShader : renderer->gBufferShader;
+    // Active region of the reduced-resolution targets
+    int divisor = renderer->ssaoDivisor;
+    int aoWidth = (renderer->renderWidth + divisor - 1) / divisor;
+    int aoHeight = (renderer->renderHeight + divisor - 1) / divisor;
+    
+    // Kernel subset and noise rotation for this frame
+    unsigned int subsets = renderer->ssaoKernelSize / renderer->ssaoSamplesPerFrame;
+    if (subsets == 0) subsets = 1;
+    unsigned int subset = renderer->ssaoTemporal ? renderer->ssaoFrame % subsets : 0;
+    float rotation = renderer->ssaoTemporal ? (float)(renderer->ssaoFrame % 64) * 2.39996323f : 0.0f;
+    
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+    glBindVertexArray(renderer->quadVAO);
+    
+    // 1. Generate occlusion
+    GLuint shader = renderer->ssaoShader;
+    glBindFramebuffer(GL_FRAMEBUFFER, renderer->ssaoBuffer);
+    glViewport(0, 0, aoWidth, aoHeight);
     shader_use(shader);
+    renderer_setScreenUniforms(renderer, shader);
+    shader_setInt(shader, "sampleOffset", (int)(subset * renderer->ssaoSamplesPerFrame));
+    shader_setInt(shader, "sampleCount", (int)renderer->ssaoSamplesPerFrame);
+    shader_setFloat(shader, "noiseRotation", rotation);
+    shader_setVec2(shader, "noiseScale", aoWidth / 4.0f, aoHeight / 4.0f);
+    shader_setInt(shader, "gPosition", 0);
+    shader_setInt(shader, "gNormal", 1);
+    shader_setInt(shader, "noiseTexture", 2);
+    texture_bind(renderer->gPosition, GL_TEXTURE0);
+    texture_bind(renderer->gNormal, GL_TEXTURE1);
+    texture_bind(renderer->ssaoNoiseTexture, GL_TEXTURE2);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
     
-    // Set matrices
-    if (!depthOnly) {
-        shader_setMat4(shader, "view", viewMatrix);
-        shader_setMat4(shader, "projection", projectionMatrix);
+    // 2. Temporal accumulation with reprojection
+    GLuint aoResult = renderer->ssaoColorBuffer;
+    if (renderer->ssaoTemporal) {
+        int write = renderer->ssaoFrame & 1;
+        int read = write ^ 1;
+        
+        shader = renderer->ssaoTemporalShader;
+        glBindFramebuffer(GL_FRAMEBUFFER, renderer->ssaoHistoryBuffers[write]);
+        shader_use(shader);
+        renderer_setScreenUniforms(renderer, shader);
+        shader_setMat4(shader, "prevViewProjection", renderer->prevViewProjection);
+        shader_setInt(shader, "historyValid", renderer->ssaoHistoryValid);
+        shader_setVec2(shader, "historyUvScale", renderer->ssaoHistoryUvScale[0], renderer->ssaoHistoryUvScale[1]);
+        shader_setFloat(shader, "blendFactor", 1.0f / (float)subsets);
+        shader_setInt(shader, "currentAO", 0);
+        shader_setInt(shader, "historyAO", 1);
+        shader_setInt(shader, "gPosition", 2);
+        texture_bind(renderer->ssaoColorBuffer, GL_TEXTURE0);
+        texture_bind(renderer->ssaoHistoryColorBuffers[read], GL_TEXTURE1);
+        texture_bind(renderer->gPosition, GL_TEXTURE2);
+        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+        
+        aoResult = renderer->ssaoHistoryColorBuffers[write];
+        renderer->ssaoHistoryValid = true;
+        renderer->ssaoHistoryUvScale[0] = (float)renderer->renderWidth / renderer->windowWidth;
+        renderer->ssaoHistoryUvScale[1] = (float)renderer->renderHeight / renderer->windowHeight;
     }
     
+    // 3. Depth/normal-aware upsample to full resolution (also denoises)
+    shader = renderer->ssaoUpsampleShader;
+    glBindFramebuffer(GL_FRAMEBUFFER, renderer->ssaoBlurBuffer);
+    glViewport(0, 0, renderer->renderWidth, renderer->renderHeight);
+    shader_use(shader);
+    renderer_setScreenUniforms(renderer, shader);
+    shader_setVec2(shader, "aoTexelSize", 1.0f / renderer->ssaoWidth, 1.0f / renderer->ssaoHeight);
+    shader_setInt(shader, "aoTexture", 0);
+    shader_setInt(shader, "gPosition", 1);
+    shader_setInt(shader, "gNormal", 2);
+    texture_bind(aoResult, GL_TEXTURE0);
+    texture_bind(renderer->gPosition, GL_TEXTURE1);
+    texture_bind(renderer->gNormal, GL_TEXTURE2);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    
+    // Remember this frame's camera for next frame's reprojection
+    memcpy(renderer->prevViewProjection, viewProjection, sizeof(mat4));
+    renderer->ssaoFrame++;
+    
+    glBindVertexArray(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glEnable(GL_BLEND);
+    glEnable(GL_DEPTH_TEST);
+}
+
+// Queue the visible objects of one scene category
+static void renderer_submitObjects(Renderer* renderer, Object* objects, size_t count, Camera* camera, bool depthOnly) {
+    RenderQueuePass pass = depthOnly ? RENDER_QUEUE_SHADOW : RENDER_QUEUE_OPAQUE;
+    
+    for (size_t i = 0; i < count; i++) {
+        Object* object = &objects[i];
+        if (!object->isVisible) continue;
+        
+        // Shadows draw every instance; the camera pass only what survived instance culling
+        if (object->isInstanced && (depthOnly ? object->shadowInstanceCount : object->visibleInstanceCount) == 0) continue;
+        
+        // Outside the camera frustum, or hidden behind terrain or other structures (camera pass only)
+        if (!depthOnly && !object->isInstanced) {
+            if (object->frustumFrame != renderer->frustumFrame) {
+                profiler_addCounter("Structures frustum culled", 1);
+                continue;
+            }
+            
+            float boxMin[3], boxMax[3];
+            renderer_objectBounds(object, OCCLUSION_STRUCTURE_RADIUS, 1.0f, boxMin, boxMax);
+            if (!occlusion_testBox(renderer->occlusionCuller, boxMin, boxMax)) {
+                profiler_addCounter("Structures occluded", 1);
+                continue;
+            }
+        }
+        
+        // View distance, used for impostor switching and front-to-back ordering
+        float dx = object->transform.position[0] - camera->position[0];
+        float dy = object->transform.position[1] - camera->position[1];
+        float dz = object->transform.position[2] - camera->position[2];
+        float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+        float depth = distance / camera->farPlane;
+        
+        // Distant structures switch to their impostor (instanced objects are split by the culler)
+        if (!depthOnly && !object->isInstanced && object->impostor && distance > object->impostorDistance) {
+            impostor_addInstances(renderer->impostors, object->impostor, object->transform.modelMatrix, 1, object->impostorDistance);
+            if (distance >= object->impostorDistance + IMPOSTOR_FADE_RANGE) continue;
+        }
+        
+        GLuint shader;
+        if (depthOnly) {
+            shader = renderer->shadowMapShader;
+        } else {
+            shader = object->isInstanced ? renderer->instancedShader : renderer->gBufferShader;
+        }
+        
+        // Mesh level from projected size (instances get theirs from the culler)
+        unsigned int lod = 0;
+        if (!object->isInstanced && object->mesh && object->mesh->lodCount > 1) {
+            float scale = fmaxf(fabsf(object->transform.scale[0]), fmaxf(fabsf(object->transform.scale[1]), fabsf(object->transform.scale[2])));
+            float screenSize = distance > 0.0f ? object->mesh->boundingRadius * scale * camera->projectionMatrix[5] * renderer->lodBias / distance : INFINITY;
+            lod = model_selectLod(object->mesh, screenSize);
+        }
+        
+        renderQueue_submit(renderer->renderQueue, pass, shader, object, depth, lod);
+    }
+}
+
+// Simple scene renderer
+void renderer_renderScene(Renderer* renderer, SceneManager* scene, Camera* camera, bool depthOnly) {
+    // Use appropriate shader (camera matrices come from the FrameData block)
+    GLuint shader = depthOnly ? renderer->shadowMapShader : renderer->gBufferShader;
+    shader_use(shader);
+    
     // Render terrain
     renderer_renderTerrain(renderer, &scene->terrain, camera, depthOnly);
     
-    // Render objects
-    for (size_t i = 0; i < scene->cottageCount; i++) {
-        renderer_renderObject(renderer, &scene->cottages[i], camera, depthOnly);
-    }
+    // Queue objects and instanced vegetation, then draw them sorted by state
+    RenderQueue* queue = renderer->renderQueue;
+    renderQueue_reset(queue);
+    renderer_submitObjects(renderer, scene->cottages, scene->cottageCount, camera, depthOnly);
+    renderer_submitObjects(renderer, scene->ruins, scene->ruinCount, camera, depthOnly);
+    renderer_submitObjects(renderer, scene->bridges, scene->bridgeCount, camera, depthOnly);
+    renderer_submitObjects(renderer, scene->trees, scene->treeCount, camera, depthOnly);
+    renderer_submitObjects(renderer, scene->flowers, scene->flowerCount, camera, depthOnly);
+    renderer_submitObjects(renderer, scene->mushrooms, scene->mushroomCount, camera, depthOnly);
+    renderer_submitObjects(renderer, scene->lanterns, scene->lanternCount, camera, depthOnly);
     
-    for (size_t i = 0; i < scene->ruinCount; i++) {
-        renderer_renderObject(renderer, &scene->ruins[i], camera, depthOnly);
+    renderQueue_sort(queue);
+    renderQueue_draw(queue);
+    
+    // Impostors write the same G-buffer outputs, after the meshes they replace
+    if (!depthOnly) {
+        impostor_draw(renderer->impostors);
     }
     
-    for (size_t i = 0; i < scene->bridgeCount; i++) {
-        renderer_renderObject(renderer, &scene->bridges[i], camera, depthOnly);
+    // Grass is left out of the shadow maps
+    if (!depthOnly) {
+        grass_draw(renderer->grass, renderer->windField, renderer->windTexture);
     }
     
-    // Render instanced vegetation
-    renderer_renderInstancedObjects(renderer, scene->trees, scene->treeCount, camera, depthOnly);
-    renderer_renderInstancedObjects(renderer, scene->flowers, scene->flowerCount, camera, depthOnly);
-    renderer_renderInstancedObjects(renderer, scene->mushrooms, scene->mushroomCount, camera, depthOnly);
-    renderer_renderInstancedObjects(renderer, scene->lanterns, scene->lanternCount, camera, depthOnly);
+    // Report draw and state-change counts (the "unsorted" and "per-object" figures are
+    // what the same items would have cost in submission order / with no elision)
+    const RenderQueueStats* stats = &queue->stats;
+    unsigned int stateChanges = stats->shaderChanges + stats->materialChanges + stats->meshChanges;
+    if (depthOnly) {
+        profiler_addCounter("Shadow draw calls", stats->drawCalls);
+        profiler_addCounter("Shadow state changes", stateChanges);
+        profiler_addCounter("Shadow triangles", (double)stats->triangles);
+    } else {
+        profiler_addCounter("Draw calls", stats->drawCalls);
+        profiler_addCounter("State changes (sorted)", stateChanges);
+        profiler_addCounter("State changes (submission order)", stats->unsortedStateChanges);
+        profiler_addCounter("State changes (per-object rebind)", stats->naiveStateChanges);
+        profiler_addCounter("Triangles submitted", (double)stats->triangles);
+        profiler_addCounter("Triangles at full detail", (double)stats->fullDetailTriangles);
+        
+        const ImpostorStats* impostorStats = impostor_getStats(renderer->impostors);
+        profiler_addCounter("Impostor instances", (double)impostorStats->instancesDrawn);
+        profiler_addCounter("Impostor draw calls", impostorStats->drawCalls);
+        
+        const GrassStats* grassStats = grass_getStats(renderer->grass);
+        profiler_addCounter("Grass chunks drawn", (double)grassStats->chunksVisible);
+        profiler_addCounter("Grass blades drawn", (double)grassStats->bladesDrawn);
+        profiler_addCounter("Grass density scale", grassStats->densityScale);
+    }
     
     // Render skybox (only in non-depth pass)
     if (!depthOnly) {
+        profiler_beginGPU("Sky pass");
         renderer_renderSkybox(renderer, &scene->skybox, camera);
+        profiler_endGPU();
     }
 }
 
-// Pick object under mouse cursor
+// Sky from the atmosphere LUTs: a fullscreen quad at the far plane, drawn after the geometry
+// so only uncovered pixels are shaded
+void renderer_renderSkybox(Renderer* renderer, Skybox* skybox, Camera* camera) {
+    (void)camera;
+    const Atmosphere* atmosphere = renderer->atmosphere;
+    if (!atmosphere->skyViewValid) return;
+    
+    GLint depthFunc;
+    glGetIntegerv(GL_DEPTH_FUNC, &depthFunc);
+    glDepthFunc(GL_LEQUAL);
+    glDepthMask(GL_FALSE);
+    
+    shader_use(renderer->skyboxShader);
+    
+    // The LUT was built for skyViewElevation; rotating the sun into the current azimuth is exact,
+    // the elevation is at most ATMOSPHERE_SUN_STEP behind
+    float sun[3] = { skybox->sunDirection[0], skybox->sunDirection[1], skybox->sunDirection[2] };
+    float length = sqrtf(sun[0] * sun[0] + sun[1] * sun[1] + sun[2] * sun[2]);
+    if (length > 0.0f) {
+        sun[0] /= length;
+        sun[1] /= length;
+        sun[2] /= length;
+    }
+    shader_setVec3(renderer->skyboxShader, "sunDirection", sun[0], sun[1], sun[2]);
+    shader_setVec4(renderer->skyboxShader, "atmosphere", atmosphere->params.bottomRadius, atmosphere->params.topRadius,
+                   atmosphere->params.bottomRadius + atmosphere->viewerHeight, ATMOSPHERE_SUN_ILLUMINANCE);
+    shader_setFloat(renderer->skyboxShader, "sunCosRadius", cosf(ATMOSPHERE_SUN_RADIUS));
+    shader_setInt(renderer->skyboxShader, "transmittanceLut", 0);
+    shader_setInt(renderer->skyboxShader, "skyViewLut", 1);
+    texture_bind(renderer->transmittanceTexture, GL_TEXTURE0);
+    texture_bind(renderer->skyViewTexture, GL_TEXTURE1);
+    
+    glBindVertexArray(renderer->quadVAO);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+    
+    glDepthMask(GL_TRUE);
+    glDepthFunc(depthFunc);
+}
+
+// Upscale pass: stretch the render region over the window and sharpen
+void renderer_upscalePass(Renderer* renderer) {
+    glBindFramebuffer(GL_FRAMEBUFFER, renderer->outputFramebuffer);
+    glViewport(0, 0, renderer->windowWidth, renderer->windowHeight);
+    glDisable(GL_DEPTH_TEST);
+    
+    shader_use(renderer->upscaleShader);
+    renderer_setScreenUniforms(renderer, renderer->upscaleShader);
+    
+    // Sharpening only makes sense when we are actually upscaling
+    float sharpness = renderer->renderScale < 1.0f ? renderer->sharpness : 0.0f;
+    shader_setFloat(renderer->upscaleShader, "sharpness", sharpness);
+    shader_setInt(renderer->upscaleShader, "sceneTexture", 0);
+    texture_bind(renderer->postColorBuffer, GL_TEXTURE0);
+    
+    glBindVertexArray(renderer->quadVAO);
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+    
+    glEnable(GL_DEPTH_TEST);
+}
+
+// Pick object under mouse cursor: cast a ray from the camera through the pixel against
+// the scene BVH (on the CPU, no read back of the G-buffer)
 void renderer_pick(Renderer* renderer, SceneManager* scene, Camera* camera, int x, int y) {
-    // Not implemented yet
+    if (renderer->windowWidth <= 0 || renderer->windowHeight <= 0) return;
+    renderer_updateSceneBvh(renderer, scene);
+    
+    // Window pixel to normalized device coordinates (GLUT puts y = 0 at the top)
+    float ndcX = (x + 0.5f) / renderer->windowWidth * 2.0f - 1.0f;
+    float ndcY = 1.0f - (y + 0.5f) / renderer->windowHeight * 2.0f;
+    
+    // Undo the projection's scale to get the view-space slope, then rotate into the world
+    mat4 projectionMatrix;
+    camera_getProjectionMatrix(camera, projectionMatrix);
+    float slopeX = ndcX / projectionMatrix[0];
+    float slopeY = ndcY / projectionMatrix[5];
+    float direction[3];
+    for (int axis = 0; axis < 3; axis++) {
+        direction[axis] = camera->front[axis] + camera->right[axis] * slopeX + camera->up[axis] * slopeY;
+    }
+    float length = sqrtf(direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2]);
+    for (int axis = 0; axis < 3; axis++) direction[axis] /= length;
+    
+    SceneBvhHit hit;
+    double start = profiler_now();
+    bool found = sceneBvh_raycast(renderer->sceneBvh, camera->position, direction, camera->farPlane, &hit);
+    double elapsed = profiler_now() - start;
+    
+    renderer->pickedObject = found ? hit.object : NULL;
+    renderer->pickedInstance = found ? hit.instance : SCENE_BVH_NO_INSTANCE;
+    if (!found) {
+        printf("Picked nothing (%.3f ms)\n", elapsed);
+    } else if (hit.instance == SCENE_BVH_NO_INSTANCE) {
+        printf("Picked %s at %.1f m (%.3f ms)\n", hit.object->name ? hit.object->name : "object", hit.distance, elapsed);
+    } else {
+        printf("Picked %s instance %zu at %.1f m (%.3f ms)\n", hit.object->name ? hit.object->name : "object", hit.instance, hit.distance, elapsed);
+    }
 } 
\ No newline at end of file
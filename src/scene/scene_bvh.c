@@ -0,0 +1,377 @@
+#include "scene/scene_bvh.h"
+
+// Ray test context: the instance behind the closest hit so far
+typedef struct {
+    const SceneBvh* sceneBvh;
+    size_t instance;
+} SceneBvhRayContext;
+
+// Sort key for ordering instances into clusters
+typedef struct {
+    uint32_t key;
+    uint32_t index;
+} SceneBvhSortKey;
+
+// Initialize an empty scene BVH
+void sceneBvh_init(SceneBvh* sceneBvh) {
+    memset(sceneBvh, 0, sizeof(SceneBvh));
+}
+
+void sceneBvh_cleanup(SceneBvh* sceneBvh) {
+    bvh_cleanup(&sceneBvh->bvh);
+    free(sceneBvh->objects);
+    free(sceneBvh->items);
+    free(sceneBvh->instanceOrder);
+    free(sceneBvh->results);
+    memset(sceneBvh, 0, sizeof(SceneBvh));
+}
+
+// Start gathering this frame's objects
+void sceneBvh_begin(SceneBvh* sceneBvh) {
+    sceneBvh->objectCount = 0;
+    sceneBvh->signature = 1469598103934665603ull;
+    sceneBvh->hasDynamic = false;
+}
+
+// Fold a value into the FNV-1a signature
+static uint64_t sceneBvh_hash(uint64_t hash, uint64_t value) {
+    for (int byte = 0; byte < 8; byte++) {
+        hash ^= (value >> (byte * 8)) & 0xffu;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Gather the visible objects of one scene category
+void sceneBvh_addObjects(SceneBvh* sceneBvh, Object* objects, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        Object* object = &objects[i];
+        if (!object->isVisible) continue;
+        if (object->isInstanced && (object->instanceCount == 0 || !object->instances)) continue;
+        
+        if (sceneBvh->objectCount == sceneBvh->objectCapacity) {
+            size_t capacity = sceneBvh->objectCapacity ? sceneBvh->objectCapacity * 2 : 256;
+            Object** grown = (Object**)realloc(sceneBvh->objects, sizeof(Object*) * capacity);
+            if (!grown) return;
+            sceneBvh->objects = grown;
+            sceneBvh->objectCapacity = capacity;
+        }
+        sceneBvh->objects[sceneBvh->objectCount++] = object;
+        
+        sceneBvh->signature = sceneBvh_hash(sceneBvh->signature, (uint64_t)(uintptr_t)object);
+        sceneBvh->signature = sceneBvh_hash(sceneBvh->signature, object->isInstanced ? object->instanceCount : 0);
+        if (!object->isStatic) sceneBvh->hasDynamic = true;
+    }
+}
+
+// Model-space bounding radius of an object's mesh
+static float sceneBvh_meshRadius(const Object* object) {
+    return object->mesh && object->mesh->boundingRadius > 0.0f ? object->mesh->boundingRadius : SCENE_BVH_DEFAULT_RADIUS;
+}
+
+// Bounding sphere of a whole object from its transform
+static void sceneBvh_objectSphere(const Object* object, float* center, float* radius) {
+    float scale = fmaxf(fabsf(object->transform.scale[0]), fmaxf(fabsf(object->transform.scale[1]), fabsf(object->transform.scale[2])));
+    center[0] = object->transform.position[0];
+    center[1] = object->transform.position[1];
+    center[2] = object->transform.position[2];
+    *radius = sceneBvh_meshRadius(object) * scale;
+}
+
+// Bounding sphere of one instance from its model matrix (largest axis scale)
+static void sceneBvh_instanceSphere(const Object* object, size_t instance, float* center, float* radius) {
+    const float* model = object->instances[instance].modelMatrix;
+    float scale = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        const float* column = &model[axis * 4];
+        float length = sqrtf(column[0] * column[0] + column[1] * column[1] + column[2] * column[2]);
+        if (length > scale) scale = length;
+    }
+    center[0] = model[12];
+    center[1] = model[13];
+    center[2] = model[14];
+    *radius = sceneBvh_meshRadius(object) * scale;
+}
+
+// Box around an item's sphere(s)
+static void sceneBvh_itemBox(const SceneBvh* sceneBvh, const SceneBvhItem* item, BvhBox* box) {
+    float center[3];
+    float radius;
+    if (item->count == 0) {
+        sceneBvh_objectSphere(item->object, center, &radius);
+        for (int axis = 0; axis < 3; axis++) {
+            box->min[axis] = center[axis] - radius;
+            box->max[axis] = center[axis] + radius;
+        }
+        return;
+    }
+    
+    for (int axis = 0; axis < 3; axis++) {
+        box->min[axis] = INFINITY;
+        box->max[axis] = -INFINITY;
+    }
+    for (uint32_t i = item->first; i < item->first + item->count; i++) {
+        sceneBvh_instanceSphere(item->object, sceneBvh->instanceOrder[i], center, &radius);
+        for (int axis = 0; axis < 3; axis++) {
+            box->min[axis] = fminf(box->min[axis], center[axis] - radius);
+            box->max[axis] = fmaxf(box->max[axis], center[axis] + radius);
+        }
+    }
+}
+
+// Interleave the low 16 bits of x and z into a 32-bit Morton code
+static uint32_t sceneBvh_morton(uint32_t x, uint32_t z) {
+    uint32_t code = 0;
+    for (int bit = 0; bit < 16; bit++) {
+        code |= ((x >> bit) & 1u) << (bit * 2);
+        code |= ((z >> bit) & 1u) << (bit * 2 + 1);
+    }
+    return code;
+}
+
+static int sceneBvh_compareKeys(const void* a, const void* b) {
+    const SceneBvhSortKey* ka = (const SceneBvhSortKey*)a;
+    const SceneBvhSortKey* kb = (const SceneBvhSortKey*)b;
+    if (ka->key != kb->key) return ka->key < kb->key ? -1 : 1;
+    return ka->index < kb->index ? -1 : (ka->index > kb->index ? 1 : 0);
+}
+
+// Order one object's instances along a Morton curve over their XZ extent
+static bool sceneBvh_sortInstances(const Object* object, uint32_t* order) {
+    size_t count = object->instanceCount;
+    SceneBvhSortKey* keys = (SceneBvhSortKey*)malloc(sizeof(SceneBvhSortKey) * count);
+    if (!keys) return false;
+    
+    float minX = INFINITY, maxX = -INFINITY, minZ = INFINITY, maxZ = -INFINITY;
+    for (size_t i = 0; i < count; i++) {
+        const float* model = object->instances[i].modelMatrix;
+        minX = fminf(minX, model[12]);
+        maxX = fmaxf(maxX, model[12]);
+        minZ = fminf(minZ, model[14]);
+        maxZ = fmaxf(maxZ, model[14]);
+    }
+    float scaleX = maxX > minX ? 65535.0f / (maxX - minX) : 0.0f;
+    float scaleZ = maxZ > minZ ? 65535.0f / (maxZ - minZ) : 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        const float* model = object->instances[i].modelMatrix;
+        keys[i].key = sceneBvh_morton((uint32_t)((model[12] - minX) * scaleX), (uint32_t)((model[14] - minZ) * scaleZ));
+        keys[i].index = (uint32_t)i;
+    }
+    qsort(keys, count, sizeof(SceneBvhSortKey), sceneBvh_compareKeys);
+    
+    for (size_t i = 0; i < count; i++) order[i] = keys[i].index;
+    free(keys);
+    return true;
+}
+
+// Grow an array to hold at least needed elements
+static bool sceneBvh_reserve(void** array, size_t elementSize, size_t needed, size_t* capacity) {
+    if (needed <= *capacity) return true;
+    size_t grown = *capacity ? *capacity : 256;
+    while (grown < needed) grown *= 2;
+    void* resized = realloc(*array, elementSize * grown);
+    if (!resized) return false;
+    *array = resized;
+    *capacity = grown;
+    return true;
+}
+
+// Split the gathered objects into items and build the tree over them
+static bool sceneBvh_build(SceneBvh* sceneBvh) {
+    size_t itemCount = 0;
+    size_t instanceCount = 0;
+    for (size_t i = 0; i < sceneBvh->objectCount; i++) {
+        const Object* object = sceneBvh->objects[i];
+        if (object->isInstanced) {
+            itemCount += (object->instanceCount + SCENE_BVH_CLUSTER_SIZE - 1) / SCENE_BVH_CLUSTER_SIZE;
+            instanceCount += object->instanceCount;
+        } else {
+            itemCount++;
+        }
+    }
+    
+    size_t itemCapacity = sceneBvh->itemCapacity;
+    size_t instanceCapacity = sceneBvh->instanceCapacity;
+    bool reserved = sceneBvh_reserve((void**)&sceneBvh->items, sizeof(SceneBvhItem), itemCount, &itemCapacity) &&
+                    sceneBvh_reserve((void**)&sceneBvh->instanceOrder, sizeof(uint32_t), instanceCount, &instanceCapacity) &&
+                    sceneBvh_reserve((void**)&sceneBvh->results, sizeof(uint32_t), itemCount, &sceneBvh->resultCapacity);
+    sceneBvh->itemCapacity = (uint32_t)itemCapacity;
+    sceneBvh->instanceCapacity = (uint32_t)instanceCapacity;
+    if (reserved && itemCount > sceneBvh->bvh.capacity) {
+        bvh_cleanup(&sceneBvh->bvh);
+        reserved = bvh_init(&sceneBvh->bvh, (uint32_t)itemCapacity);
+    }
+    if (!reserved) {
+        fprintf(stderr, "Failed to allocate scene BVH for %zu items\n", itemCount);
+        sceneBvh->itemCount = 0;
+        sceneBvh->bvh.nodeCount = 0;
+        return false;
+    }
+    
+    // One item per object, one per cluster of Morton-adjacent instances
+    SceneBvhItem* items = sceneBvh->items;
+    uint32_t item = 0;
+    uint32_t instance = 0;
+    for (size_t i = 0; i < sceneBvh->objectCount; i++) {
+        Object* object = sceneBvh->objects[i];
+        if (!object->isInstanced) {
+            items[item++] = (SceneBvhItem){ object, 0, 0 };
+            continue;
+        }
+        
+        uint32_t* order = &sceneBvh->instanceOrder[instance];
+        if (!sceneBvh_sortInstances(object, order)) {
+            for (size_t j = 0; j < object->instanceCount; j++) order[j] = (uint32_t)j;
+        }
+        for (size_t first = 0; first < object->instanceCount; first += SCENE_BVH_CLUSTER_SIZE) {
+            size_t count = object->instanceCount - first;
+            if (count > SCENE_BVH_CLUSTER_SIZE) count = SCENE_BVH_CLUSTER_SIZE;
+            items[item++] = (SceneBvhItem){ object, instance + (uint32_t)first, (uint32_t)count };
+        }
+        instance += (uint32_t)object->instanceCount;
+    }
+    sceneBvh->itemCount = item;
+    sceneBvh->instanceCount = instance;
+    
+    for (uint32_t i = 0; i < item; i++) {
+        sceneBvh_itemBox(sceneBvh, &items[i], &sceneBvh->bvh.boxes[i]);
+    }
+    bvh_build(&sceneBvh->bvh, item);
+    sceneBvh->builtSignature = sceneBvh->signature;
+    return true;
+}
+
+// Finish gathering: rebuild if the object set changed, otherwise refit moved objects
+void sceneBvh_end(SceneBvh* sceneBvh) {
+    sceneBvh->rebuilt = false;
+    sceneBvh->buildTime = 0.0;
+    sceneBvh->refitTime = 0.0;
+    double start = profiler_now();
+    
+    if (sceneBvh->signature != sceneBvh->builtSignature || (sceneBvh->itemCount == 0 && sceneBvh->objectCount > 0)) {
+        sceneBvh_build(sceneBvh);
+        sceneBvh->rebuilt = true;
+        sceneBvh->buildTime = profiler_now() - start;
+        return;
+    }
+    if (!sceneBvh->hasDynamic) return;
+    
+    for (uint32_t i = 0; i < sceneBvh->itemCount; i++) {
+        const SceneBvhItem* item = &sceneBvh->items[i];
+        if (!item->object->isStatic) sceneBvh_itemBox(sceneBvh, item, &sceneBvh->bvh.boxes[i]);
+    }
+    bvh_refit(&sceneBvh->bvh);
+    sceneBvh->refitTime = profiler_now() - start;
+    
+    // Moved objects stretch boxes the tree was not split for; start over once it costs too much
+    if (sceneBvh->bvh.area > sceneBvh->bvh.buildArea * SCENE_BVH_REBUILD_GROWTH) {
+        start = profiler_now();
+        sceneBvh_build(sceneBvh);
+        sceneBvh->rebuilt = true;
+        sceneBvh->buildTime = profiler_now() - start;
+    }
+}
+
+// Items inside or crossing the frustum of a column-major projection * view. The
+// indices (into items) stay valid until the next query or update.
+size_t sceneBvh_queryFrustum(SceneBvh* sceneBvh, const float* viewProjection, const uint32_t** items) {
+    float planes[6][4];
+    bvh_frustumFromMatrix(viewProjection, planes);
+    *items = sceneBvh->results;
+    return bvh_queryFrustum(&sceneBvh->bvh, planes, sceneBvh->results, sceneBvh->itemCount);
+}
+
+// Does the sphere at center overlap the query sphere?
+static bool sceneBvh_spheresOverlap(const float* a, float radiusA, const float* b, float radiusB) {
+    float dx = a[0] - b[0];
+    float dy = a[1] - b[1];
+    float dz = a[2] - b[2];
+    float reach = radiusA + radiusB;
+    return dx * dx + dy * dy + dz * dz <= reach * reach;
+}
+
+// Objects and instances whose bounding sphere overlaps the sphere (light ranges, gameplay
+// triggers). Returns the number found; at most maxHits are written.
+size_t sceneBvh_querySphere(SceneBvh* sceneBvh, const float* center, float radius, SceneBvhHit* hits, size_t maxHits) {
+    size_t itemCount = bvh_querySphere(&sceneBvh->bvh, center, radius, sceneBvh->results, sceneBvh->itemCount);
+    size_t found = 0;
+    
+    for (size_t i = 0; i < itemCount; i++) {
+        const SceneBvhItem* item = &sceneBvh->items[sceneBvh->results[i]];
+        float itemCenter[3];
+        float itemRadius;
+        
+        if (item->count == 0) {
+            sceneBvh_objectSphere(item->object, itemCenter, &itemRadius);
+            if (!sceneBvh_spheresOverlap(itemCenter, itemRadius, center, radius)) continue;
+            if (found < maxHits) hits[found] = (SceneBvhHit){ item->object, SCENE_BVH_NO_INSTANCE, 0.0f };
+            found++;
+            continue;
+        }
+        
+        for (uint32_t j = item->first; j < item->first + item->count; j++) {
+            size_t instance = sceneBvh->instanceOrder[j];
+            sceneBvh_instanceSphere(item->object, instance, itemCenter, &itemRadius);
+            if (!sceneBvh_spheresOverlap(itemCenter, itemRadius, center, radius)) continue;
+            if (found < maxHits) hits[found] = (SceneBvhHit){ item->object, instance, 0.0f };
+            found++;
+        }
+    }
+    return found;
+}
+
+// Distance along the ray to where it enters the sphere (0 from inside), negative for a miss
+static float sceneBvh_raySphere(const float* center, float radius, const float* origin, const float* direction) {
+    float offset[3] = { origin[0] - center[0], origin[1] - center[1], origin[2] - center[2] };
+    float a = direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2];
+    float b = offset[0] * direction[0] + offset[1] * direction[1] + offset[2] * direction[2];
+    float c = offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2] - radius * radius;
+    if (c <= 0.0f) return 0.0f;
+    
+    float discriminant = b * b - a * c;
+    if (discriminant < 0.0f || b > 0.0f) return -1.0f;
+    return (-b - sqrtf(discriminant)) / a;
+}
+
+// BVH ray test for one item: its sphere, or the closest of its cluster's instance spheres
+static float sceneBvh_rayTest(void* context, uint32_t index, const float* origin, const float* direction, float maxT) {
+    SceneBvhRayContext* ray = (SceneBvhRayContext*)context;
+    const SceneBvh* sceneBvh = ray->sceneBvh;
+    const SceneBvhItem* item = &sceneBvh->items[index];
+    float center[3];
+    float radius;
+    
+    if (item->count == 0) {
+        sceneBvh_objectSphere(item->object, center, &radius);
+        float t = sceneBvh_raySphere(center, radius, origin, direction);
+        if (t >= 0.0f && t < maxT) ray->instance = SCENE_BVH_NO_INSTANCE;
+        return t;
+    }
+    
+    float closest = -1.0f;
+    for (uint32_t i = item->first; i < item->first + item->count; i++) {
+        size_t instance = sceneBvh->instanceOrder[i];
+        sceneBvh_instanceSphere(item->object, instance, center, &radius);
+        float t = sceneBvh_raySphere(center, radius, origin, direction);
+        if (t >= 0.0f && t < maxT) {
+            maxT = t;
+            closest = t;
+            ray->instance = instance;
+        }
+    }
+    return closest;
+}
+
+// Closest object or instance whose bounding sphere the ray hits within maxDistance
+// (distance in units of direction). Bounding spheres only: meshes have no CPU copy.
+bool sceneBvh_raycast(SceneBvh* sceneBvh, const float* origin, const float* direction, float maxDistance, SceneBvhHit* hit) {
+    SceneBvhRayContext context = { sceneBvh, SCENE_BVH_NO_INSTANCE };
+    uint32_t index = 0;
+    float t = bvh_raycast(&sceneBvh->bvh, origin, direction, maxDistance, sceneBvh_rayTest, &context, &index);
+    if (t < 0.0f) return false;
+    
+    hit->object = sceneBvh->items[index].object;
+    hit->instance = context.instance;
+    hit->distance = t;
+    return true;
+}
@@ -0,0 +1,167 @@
+#include "scene/scene_manager.h"
+#include "scene/wind_field.h"
+#include "utils/thread_pool.h"
+
+// What every scene job reads
+typedef struct {
+    SceneManager* scene;
+    const SceneUpdate* update;
+} SceneJobContext;
+
+// Weather first: the other parts read its intensity. A change of requested weather starts a
+// transition that is advanced every tick for WEATHER_TRANSITION_TIME (and until the intensity
+// settles); steady weather is not recomputed.
+static void sceneManager_weatherJob(void* context, size_t begin, size_t end) {
+    (void)begin; (void)end;
+    SceneJobContext* job = (SceneJobContext*)context;
+    SceneChanges* changes = &job->scene->changes;
+    const SceneUpdate* update = job->update;
+    
+    if (!changes->valid || update->weather != changes->weather) {
+        changes->weather = update->weather;
+        changes->transitionLeft = WEATHER_TRANSITION_TIME;
+    }
+    if (changes->transitionLeft <= 0.0f) {
+        changes->skipped[SCENE_PART_WEATHER]++;
+        return;
+    }
+    
+    float intensity = job->scene->weatherIntensity;
+    sceneManager_updateWeather(job->scene, update->deltaTime, update->weather);
+    changes->transitionLeft -= update->deltaTime;
+    if (changes->transitionLeft <= 0.0f && job->scene->weatherIntensity != intensity) {
+        changes->transitionLeft = update->deltaTime;
+    }
+    changes->weatherVersion++;
+    changes->recomputed[SCENE_PART_WEATHER]++;
+}
+
+static void sceneManager_windJob(void* context, size_t begin, size_t end) {
+    (void)begin; (void)end;
+    SceneJobContext* job = (SceneJobContext*)context;
+    sceneManager_updateWind(job->scene, job->update->deltaTime);
+}
+
+// Fold one value into an FNV-1a hash
+static inline uint64_t sceneManager_hashValue(uint64_t hash, uint64_t value) {
+    hash ^= value;
+    return hash * 1099511628211ull;
+}
+
+// Signature of what switches lanterns: the array, and each lantern's visibility and instances
+static uint64_t sceneManager_lanternSignature(const SceneManager* scene) {
+    uint64_t hash = 14695981039346656037ull;
+    hash = sceneManager_hashValue(hash, (uint64_t)(uintptr_t)scene->lanterns);
+    hash = sceneManager_hashValue(hash, scene->lanternCount);
+    for (size_t i = 0; i < scene->lanternCount; i++) {
+        const Object* lantern = &scene->lanterns[i];
+        hash = sceneManager_hashValue(hash, (uint64_t)(uintptr_t)lantern->instances);
+        hash = sceneManager_hashValue(hash, lantern->instanceCount);
+        hash = sceneManager_hashValue(hash, lantern->isVisible);
+    }
+    return hash;
+}
+
+// Lights follow the sun in steps of LIGHTS_TIME_STEP, and change with the weather and with
+// lanterns switching; otherwise last tick's lights stand
+static void sceneManager_lightsJob(void* context, size_t begin, size_t end) {
+    (void)begin; (void)end;
+    SceneJobContext* job = (SceneJobContext*)context;
+    SceneChanges* changes = &job->scene->changes;
+    float timeOfDay = job->update->timeOfDay;
+    
+    // Lanterns added, removed or switched since the last tick count as a change
+    uint64_t signature = sceneManager_lanternSignature(job->scene);
+    if (signature != changes->lanternSignature) {
+        changes->lanternSignature = signature;
+        sceneManager_lanternsChanged(job->scene);
+    }
+    
+    // Time of day wraps at midnight
+    float moved = fabsf(timeOfDay - changes->lightsTimeOfDay);
+    if (moved > 0.5f) moved = 1.0f - moved;
+    if (changes->valid && moved < LIGHTS_TIME_STEP && changes->lightsWeatherVersion == changes->weatherVersion &&
+        changes->lightsLanternVersion == changes->lanternVersion) {
+        changes->skipped[SCENE_PART_LIGHTS]++;
+        return;
+    }
+    
+    sceneManager_updateLights(job->scene, timeOfDay);
+    changes->lightsTimeOfDay = timeOfDay;
+    changes->lightsWeatherVersion = changes->weatherVersion;
+    changes->lightsLanternVersion = changes->lanternVersion;
+    changes->lightsVersion++;
+    changes->recomputed[SCENE_PART_LIGHTS]++;
+}
+
+static void sceneManager_particlesJob(void* context, size_t begin, size_t end) {
+    (void)begin; (void)end;
+    SceneJobContext* job = (SceneJobContext*)context;
+    const SceneUpdate* update = job->update;
+    
+    // Particles live around the camera, so they take the field's wind there
+    if (update->windField) {
+        vec3 wind = { 0.0f, 0.0f, 0.0f };
+        windField_sample(update->windField, update->cameraPosition[0], update->cameraPosition[2], &wind[0], &wind[2]);
+        particleSystem_setWind(&job->scene->particles, wind);
+    }
+    particleSystem_update(&job->scene->particles, update->deltaTime, (float*)update->cameraPosition,
+                          update->timeOfDay, update->weather);
+}
+
+static void sceneManager_terrainLodJob(void* context, size_t begin, size_t end) {
+    (void)begin; (void)end;
+    SceneJobContext* job = (SceneJobContext*)context;
+    terrain_updateLOD(&job->scene->terrain, (float*)job->update->cameraPosition);
+}
+
+// Advance the selected parts of the scene as a job graph and return when all are done:
+//   weather -> wind, lights, particles
+//   terrain LOD (independent)
+// Each part touches its own state, so the jobs after weather run side by side.
+// Without a pool the same order runs on the calling thread. Weather and lights are
+// change-driven (see SceneChanges); once both have run, later updates may skip them.
+void sceneManager_updateJobs(SceneManager* scene, ThreadPool* pool, const SceneUpdate* update) {
+    TRACE_SCOPE("sceneManager_updateJobs");
+    SceneJobContext context = { scene, update };
+    unsigned int parts = update->parts;
+    bool tracked = (parts & (SCENE_UPDATE_WEATHER | SCENE_UPDATE_LIGHTS)) == (SCENE_UPDATE_WEATHER | SCENE_UPDATE_LIGHTS);
+    
+    if (!pool) {
+        if (parts & SCENE_UPDATE_WEATHER) sceneManager_weatherJob(&context, 0, 1);
+        if (parts & SCENE_UPDATE_WIND) sceneManager_windJob(&context, 0, 1);
+        if (parts & SCENE_UPDATE_LIGHTS) sceneManager_lightsJob(&context, 0, 1);
+        if (parts & SCENE_UPDATE_PARTICLES) sceneManager_particlesJob(&context, 0, 1);
+        if (parts & SCENE_UPDATE_TERRAIN_LOD) sceneManager_terrainLodJob(&context, 0, 1);
+        if (tracked) scene->changes.valid = true;
+        return;
+    }
+    
+    const ThreadPoolJob weatherJob = { "Job: weather (ms)", sceneManager_weatherJob, &context, 1, 1 };
+    const ThreadPoolJob windJob = { "Job: wind (ms)", sceneManager_windJob, &context, 1, 1 };
+    const ThreadPoolJob lightsJob = { "Job: lights (ms)", sceneManager_lightsJob, &context, 1, 1 };
+    const ThreadPoolJob particlesJob = { "Job: particles (ms)", sceneManager_particlesJob, &context, 1, 1 };
+    const ThreadPoolJob terrainLodJob = { "Job: terrain LOD (ms)", sceneManager_terrainLodJob, &context, 1, 1 };
+    
+    ThreadPoolCounter weatherDone;
+    ThreadPoolCounter done;
+    threadPool_initCounter(&weatherDone);
+    threadPool_initCounter(&done);
+    
+    if (parts & SCENE_UPDATE_WEATHER) threadPool_submit(pool, &weatherJob, &weatherDone);
+    if (parts & SCENE_UPDATE_TERRAIN_LOD) threadPool_submit(pool, &terrainLodJob, &done);
+    if (parts & SCENE_UPDATE_WIND) threadPool_submitAfter(pool, &windJob, &weatherDone, &done);
+    if (parts & SCENE_UPDATE_LIGHTS) threadPool_submitAfter(pool, &lightsJob, &weatherDone, &done);
+    if (parts & SCENE_UPDATE_PARTICLES) threadPool_submitAfter(pool, &particlesJob, &weatherDone, &done);
+    
+    // The calling thread runs jobs too until the graph is through
+    threadPool_wait(pool, &done);
+    threadPool_wait(pool, &weatherDone);
+    if (tracked) scene->changes.valid = true;
+}
+
+// Lanterns were switched on or off: lights are recomputed on the next update. The lights job
+// notices lanterns added, removed or hidden by itself; call this for other edits.
+void sceneManager_lanternsChanged(SceneManager* scene) {
+    scene->changes.lanternVersion++;
+}
@@ -0,0 +1,427 @@
+#include "scene/simulation.h"
+#include <time.h>
+
+// Middle slot flag: holds a snapshot the renderer has not picked up yet
+#define SIMULATION_SLOT_FRESH 4u
+#define SIMULATION_SLOT_MASK 3u
+
+// Object collections of a scene, in a fixed order
+static void simulation_collections(SceneManager* scene, Object*** arrays, size_t** counts) {
+    arrays[0] = &scene->trees;      counts[0] = &scene->treeCount;
+    arrays[1] = &scene->flowers;    counts[1] = &scene->flowerCount;
+    arrays[2] = &scene->mushrooms;  counts[2] = &scene->mushroomCount;
+    arrays[3] = &scene->cottages;   counts[3] = &scene->cottageCount;
+    arrays[4] = &scene->ruins;      counts[4] = &scene->ruinCount;
+    arrays[5] = &scene->bridges;    counts[5] = &scene->bridgeCount;
+    arrays[6] = &scene->lanterns;   counts[6] = &scene->lanternCount;
+}
+#define SIMULATION_COLLECTIONS 7
+
+// Allocate the per-object and per-light arrays of a state
+static bool simulation_allocState(Simulation* simulation, SimulationState* state) {
+    size_t objects = simulation->objectCount ? simulation->objectCount : 1;
+    size_t lights = simulation->renderScene.lightCount ? simulation->renderScene.lightCount : 1;
+    state->objects = (SimulationObjectState*)calloc(objects, sizeof(SimulationObjectState));
+    state->lights = (SimulationLightState*)calloc(lights, sizeof(SimulationLightState));
+    return state->objects && state->lights;
+}
+
+static void simulation_freeState(SimulationState* state) {
+    free(state->objects);
+    free(state->lights);
+    state->objects = NULL;
+    state->lights = NULL;
+}
+
+// Copy a state into preallocated arrays
+static void simulation_copyState(const Simulation* simulation, SimulationState* dst, const SimulationState* src) {
+    SimulationObjectState* objects = dst->objects;
+    SimulationLightState* lights = dst->lights;
+    *dst = *src;
+    dst->objects = objects;
+    dst->lights = lights;
+    memcpy(objects, src->objects, sizeof(SimulationObjectState) * simulation->objectCount);
+    memcpy(lights, src->lights, sizeof(SimulationLightState) * simulation->renderScene.lightCount);
+}
+
+// Read the render-relevant state out of the simulated scene
+static void simulation_capture(Simulation* simulation, SimulationState* state, uint64_t tick, float timeOfDay, WeatherType weather) {
+    const SceneManager* scene = simulation->scene;
+    state->tick = tick;
+    state->simTime = tick * (double)simulation->step;
+    state->publishTime = profiler_now();
+    state->timeOfDay = timeOfDay;
+    state->weather = weather;
+    state->weatherIntensity = scene->weatherIntensity;
+    state->windStrength = scene->windStrength;
+    state->windDirection = scene->windDirection;
+    state->lightsVersion = scene->changes.lightsVersion;
+    memcpy(state->partsRecomputed, scene->changes.recomputed, sizeof(state->partsRecomputed));
+    memcpy(state->partsSkipped, scene->changes.skipped, sizeof(state->partsSkipped));
+    
+    for (size_t i = 0; i < simulation->objectCount; i++) {
+        const Object* object = simulation->sourceObjects[i];
+        SimulationObjectState* out = &state->objects[i];
+        memcpy(out->position, object->transform.position, sizeof(vec3));
+        memcpy(out->rotation, object->transform.rotation, sizeof(vec3));
+        memcpy(out->scale, object->transform.scale, sizeof(vec3));
+        out->animationTime = object->animationTime;
+        out->windFactor = object->windFactor;
+    }
+    
+    for (size_t i = 0; i < simulation->renderScene.lightCount; i++) {
+        const Light* light = &scene->lights[i];
+        SimulationLightState* out = &state->lights[i];
+        memcpy(out->position, light->position, sizeof(vec3));
+        memcpy(out->direction, light->direction, sizeof(vec3));
+        memcpy(out->color, light->color, sizeof(vec3));
+        out->intensity = light->intensity;
+    }
+}
+
+// Build the render copy of the scene and the list of objects to interpolate
+bool simulation_init(Simulation* simulation, SceneManager* scene, float tickRate) {
+    memset(simulation, 0, sizeof(Simulation));
+    simulation->scene = scene;
+    simulation->step = 1.0f / (tickRate > 0.0f ? tickRate : SIMULATION_TICK_RATE);
+    
+    // Shared resources (terrain, water, skybox, meshes, instance arrays) stay with the
+    // simulated scene; object and light arrays are duplicated so each thread has its own
+    simulation->renderScene = *scene;
+    SceneManager* render = &simulation->renderScene;
+    Object** sourceArrays[SIMULATION_COLLECTIONS];
+    Object** renderArrays[SIMULATION_COLLECTIONS];
+    size_t* sourceCounts[SIMULATION_COLLECTIONS];
+    size_t* renderCounts[SIMULATION_COLLECTIONS];
+    simulation_collections(scene, sourceArrays, sourceCounts);
+    simulation_collections(render, renderArrays, renderCounts);
+    
+    bool ok = true;
+    size_t tracked = 0;
+    for (int c = 0; c < SIMULATION_COLLECTIONS; c++) {
+        size_t count = *sourceCounts[c];
+        *renderArrays[c] = NULL;
+        if (!*sourceArrays[c] || count == 0) continue;
+        
+        *renderArrays[c] = (Object*)malloc(sizeof(Object) * count);
+        if (!*renderArrays[c]) {
+            ok = false;
+            continue;
+        }
+        memcpy(*renderArrays[c], *sourceArrays[c], sizeof(Object) * count);
+        
+        for (size_t i = 0; i < count; i++) {
+            const Object* object = &(*sourceArrays[c])[i];
+            if (!object->isStatic && !object->isInstanced) tracked++;
+        }
+    }
+    
+    render->lights = NULL;
+    if (scene->lights && scene->lightCount > 0) {
+        render->lights = (Light*)malloc(sizeof(Light) * scene->lightCount);
+        if (render->lights) {
+            memcpy(render->lights, scene->lights, sizeof(Light) * scene->lightCount);
+        } else {
+            ok = false;
+        }
+    } else {
+        render->lightCount = 0;
+    }
+    
+    simulation->sourceObjects = (Object**)malloc(sizeof(Object*) * (tracked ? tracked : 1));
+    simulation->renderObjects = (Object**)malloc(sizeof(Object*) * (tracked ? tracked : 1));
+    ok = ok && simulation->sourceObjects && simulation->renderObjects;
+    for (int c = 0; ok && c < SIMULATION_COLLECTIONS; c++) {
+        for (size_t i = 0; i < *sourceCounts[c]; i++) {
+            Object* object = &(*sourceArrays[c])[i];
+            if (object->isStatic || object->isInstanced) continue;
+            simulation->sourceObjects[simulation->objectCount] = object;
+            simulation->renderObjects[simulation->objectCount] = &(*renderArrays[c])[i];
+            simulation->objectCount++;
+        }
+    }
+    
+    // Interpolated matrices are composed in batches, and only for objects that moved
+    ok = ok && transformStore_init(&simulation->transforms, simulation->objectCount);
+    for (size_t i = 0; ok && i < simulation->objectCount; i++) {
+        Transform* transform = &simulation->renderObjects[i]->transform;
+        transformStore_add(&simulation->transforms, transform->position, transform->rotation, transform->scale,
+                           false, (float*)transform->modelMatrix);
+    }
+    
+    // Particles follow the camera and upload every frame; they belong to the render side
+    memset(&scene->particles, 0, sizeof(ParticleSystem));
+    
+    // Every slot starts out holding tick 0, so the renderer always has a valid pair
+    ok = ok && simulation_allocState(simulation, &simulation->lastState);
+    for (int i = 0; ok && i < SIMULATION_SNAPSHOT_SLOTS; i++) {
+        ok = simulation_allocState(simulation, &simulation->slots[i].previous) &&
+             simulation_allocState(simulation, &simulation->slots[i].current);
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed to allocate simulation state\n");
+        simulation_cleanup(simulation);
+        return false;
+    }
+    
+    simulation_capture(simulation, &simulation->lastState, 0, 0.0f, scene->weather);
+    for (int i = 0; i < SIMULATION_SNAPSHOT_SLOTS; i++) {
+        simulation_copyState(simulation, &simulation->slots[i].previous, &simulation->lastState);
+        simulation_copyState(simulation, &simulation->slots[i].current, &simulation->lastState);
+    }
+    simulation->lightsVersion = simulation->lastState.lightsVersion;
+    simulation->frontSlot = 0;
+    simulation->backSlot = 2;
+    atomic_init(&simulation->middleSlot, 1u);
+    
+    atomic_init(&simulation->timeScale, 1.0f);
+    atomic_init(&simulation->weather, (int)scene->weather);
+    atomic_init(&simulation->running, false);
+    atomic_init(&simulation->ticks, 0);
+    atomic_init(&simulation->skippedTicks, 0);
+    atomic_init(&simulation->tickTimeMicros, 0);
+    
+    printf("Simulation: %.0f Hz, %zu interpolated objects, %zu lights\n", 1.0f / simulation->step, simulation->objectCount, render->lightCount);
+    return true;
+}
+
+// Hand the finished back slot to the renderer and take the old middle slot in exchange
+static void simulation_publish(Simulation* simulation, uint64_t tick, float timeOfDay, WeatherType weather) {
+    SimulationSnapshot* snapshot = &simulation->slots[simulation->backSlot];
+    simulation_copyState(simulation, &snapshot->previous, &simulation->lastState);
+    simulation_capture(simulation, &snapshot->current, tick, timeOfDay, weather);
+    simulation_copyState(simulation, &simulation->lastState, &snapshot->current);
+    
+    unsigned int old = atomic_exchange(&simulation->middleSlot, simulation->backSlot | SIMULATION_SLOT_FRESH);
+    simulation->backSlot = old & SIMULATION_SLOT_MASK;
+}
+
+// Sleep until a profiler_now() deadline
+static void simulation_sleepUntil(double deadline) {
+    double remaining = deadline - profiler_now();
+    if (remaining <= 0.0) return;
+    
+    struct timespec duration;
+    duration.tv_sec = (time_t)(remaining / 1000.0);
+    duration.tv_nsec = (long)((remaining - duration.tv_sec * 1000.0) * 1.0e6);
+    nanosleep(&duration, NULL);
+}
+
+// Simulation thread: fixed steps against the wall clock, skipping ahead after long stalls
+static void* simulation_thread(void* argument) {
+    Simulation* simulation = (Simulation*)argument;
+    double stepMs = simulation->step * 1000.0;
+    float timeOfDay = simulation->lastState.timeOfDay;
+    uint64_t tick = 0;
+    trace_setThreadName("Simulation");
+    
+    while (atomic_load(&simulation->running)) {
+        double now = profiler_now();
+        double due = simulation->startTime + (tick + 1) * stepMs;
+        if (now < due) {
+            simulation_sleepUntil(due);
+            continue;
+        }
+        
+        // Catch up a few missed ticks, drop the rest rather than spiral
+        uint64_t behind = (uint64_t)((now - simulation->startTime) / stepMs) - tick;
+        if (behind > SIMULATION_MAX_CATCHUP_TICKS) {
+            uint64_t skip = behind - 1;
+            tick += skip;
+            atomic_fetch_add(&simulation->skippedTicks, skip);
+        }
+        
+        TRACE_SCOPE("Simulation tick");
+        double start = profiler_now();
+        float timeScale = atomic_load(&simulation->timeScale);
+        WeatherType weather = (WeatherType)atomic_load(&simulation->weather);
+        timeOfDay += simulation->step * timeScale / DAY_LENGTH;
+        if (timeOfDay >= 1.0f) timeOfDay -= 1.0f;
+        
+        // Weather, wind and lights; particles and terrain LOD follow the camera on the render thread
+        SceneUpdate update = { simulation->step, timeOfDay, weather, { 0.0f, 0.0f, 0.0f },
+                               SCENE_UPDATE_WEATHER | SCENE_UPDATE_WIND | SCENE_UPDATE_LIGHTS };
+        sceneManager_updateJobs(simulation->scene, simulation->pool, &update);
+        tick++;
+        simulation_publish(simulation, tick, timeOfDay, weather);
+        
+        atomic_fetch_add(&simulation->tickTimeMicros, (uint64_t)((profiler_now() - start) * 1000.0));
+        atomic_fetch_add(&simulation->ticks, 1);
+    }
+    
+    return NULL;
+}
+
+// Start ticking (tick 0 is now); scene jobs go to pool, or run on the simulation thread if NULL
+void simulation_start(Simulation* simulation, ThreadPool* pool) {
+    if (simulation->started) return;
+    simulation->pool = pool;
+    
+    simulation->startTime = profiler_now();
+    simulation->windowStart = simulation->startTime;
+    atomic_store(&simulation->running, true);
+    if (pthread_create(&simulation->thread, NULL, simulation_thread, simulation) != 0) {
+        fprintf(stderr, "Failed to start simulation thread\n");
+        atomic_store(&simulation->running, false);
+        return;
+    }
+    simulation->started = true;
+}
+
+// Stop ticking and join the thread
+void simulation_stop(Simulation* simulation) {
+    if (!simulation->started) return;
+    
+    atomic_store(&simulation->running, false);
+    pthread_join(simulation->thread, NULL);
+    simulation->started = false;
+}
+
+// Stop the thread and free the render copy (shared resources belong to the simulated scene)
+void simulation_cleanup(Simulation* simulation) {
+    simulation_stop(simulation);
+    
+    SceneManager* render = &simulation->renderScene;
+    Object** renderArrays[SIMULATION_COLLECTIONS];
+    size_t* renderCounts[SIMULATION_COLLECTIONS];
+    simulation_collections(render, renderArrays, renderCounts);
+    for (int c = 0; c < SIMULATION_COLLECTIONS; c++) {
+        free(*renderArrays[c]);
+        *renderArrays[c] = NULL;
+    }
+    free(render->lights);
+    render->lights = NULL;
+    particleSystem_cleanup(&render->particles);
+    
+    for (int i = 0; i < SIMULATION_SNAPSHOT_SLOTS; i++) {
+        simulation_freeState(&simulation->slots[i].previous);
+        simulation_freeState(&simulation->slots[i].current);
+    }
+    simulation_freeState(&simulation->lastState);
+    transformStore_cleanup(&simulation->transforms);
+    free(simulation->sourceObjects);
+    free(simulation->renderObjects);
+    simulation->sourceObjects = NULL;
+    simulation->renderObjects = NULL;
+    simulation->objectCount = 0;
+}
+
+// Day-cycle speed (0 = paused) and requested weather, picked up on the next tick
+void simulation_setControls(Simulation* simulation, float timeScale, WeatherType weather) {
+    atomic_store(&simulation->timeScale, timeScale);
+    atomic_store(&simulation->weather, (int)weather);
+}
+
+static inline float simulation_lerp(float a, float b, float t) {
+    return a + (b - a) * t;
+}
+
+static inline void simulation_lerp3(vec3 out, const vec3 a, const vec3 b, float t) {
+    out[0] = a[0] + (b[0] - a[0]) * t;
+    out[1] = a[1] + (b[1] - a[1]) * t;
+    out[2] = a[2] + (b[2] - a[2]) * t;
+}
+
+// Fold the render thread's counters into the stats about once a second
+static void simulation_updateStats(Simulation* simulation, const SimulationState* current, double now) {
+    simulation->windowFrames++;
+    double elapsed = now - simulation->windowStart;
+    if (elapsed < 1000.0) return;
+    
+    uint64_t ticks = atomic_load(&simulation->ticks);
+    uint64_t tickTime = atomic_load(&simulation->tickTimeMicros);
+    uint64_t windowTicks = ticks - simulation->windowTicks;
+    
+    SimulationStats* stats = &simulation->stats;
+    stats->tickRate = (float)(windowTicks * 1000.0 / elapsed);
+    stats->renderRate = (float)(simulation->windowFrames * 1000.0 / elapsed);
+    stats->snapshotLatency = (float)(simulation->windowLatency / simulation->windowFrames);
+    stats->tickTime = windowTicks ? (float)((tickTime - simulation->windowTickTime) / 1000.0 / windowTicks) : 0.0f;
+    stats->skippedTicks = atomic_load(&simulation->skippedTicks);
+    for (int part = 0; part < SCENE_PART_COUNT; part++) {
+        stats->partsRecomputed[part] = current->partsRecomputed[part] - simulation->windowRecomputed[part];
+        stats->partsSkipped[part] = current->partsSkipped[part] - simulation->windowSkipped[part];
+        simulation->windowRecomputed[part] = current->partsRecomputed[part];
+        simulation->windowSkipped[part] = current->partsSkipped[part];
+    }
+    
+    simulation->windowStart = now;
+    simulation->windowTicks = ticks;
+    simulation->windowTickTime = tickTime;
+    simulation->windowFrames = 0;
+    simulation->windowLatency = 0.0;
+}
+
+// Pick up the newest snapshot and write state interpolated one tick behind real time into
+// renderScene; returns the interpolation factor between the snapshot's two ticks
+float simulation_interpolate(Simulation* simulation, float* timeOfDay, WeatherType* weather) {
+    if (atomic_load(&simulation->middleSlot) & SIMULATION_SLOT_FRESH) {
+        unsigned int old = atomic_exchange(&simulation->middleSlot, simulation->frontSlot);
+        simulation->frontSlot = old & SIMULATION_SLOT_MASK;
+    }
+    const SimulationSnapshot* snapshot = &simulation->slots[simulation->frontSlot];
+    const SimulationState* previous = &snapshot->previous;
+    const SimulationState* current = &snapshot->current;
+    
+    // Rendering one tick behind keeps the pair ahead of the render time when ticks are on schedule
+    double now = profiler_now();
+    double renderTime = (now - simulation->startTime) / 1000.0 - simulation->step;
+    double span = current->simTime - previous->simTime;
+    float t = span > 0.0 ? (float)((renderTime - previous->simTime) / span) : 1.0f;
+    if (t < 0.0f) t = 0.0f;
+    if (t > 1.0f) t = 1.0f;
+    
+    for (size_t i = 0; i < simulation->objectCount; i++) {
+        const SimulationObjectState* a = &previous->objects[i];
+        const SimulationObjectState* b = &current->objects[i];
+        Object* object = simulation->renderObjects[i];
+        simulation_lerp3(object->transform.position, a->position, b->position, t);
+        simulation_lerp3(object->transform.rotation, a->rotation, b->rotation, t);
+        simulation_lerp3(object->transform.scale, a->scale, b->scale, t);
+        object->animationTime = simulation_lerp(a->animationTime, b->animationTime, t);
+        object->windFactor = simulation_lerp(a->windFactor, b->windFactor, t);
+        transformStore_set(&simulation->transforms, (uint32_t)i, object->transform.position,
+                           object->transform.rotation, object->transform.scale);
+    }
+    transformStore_compose(&simulation->transforms, simulation->pool);
+    simulation->stats.transformsComposed = simulation->transforms.composed;
+    simulation->stats.transformsSkipped = simulation->transforms.skipped;
+    simulation->stats.composeTime = (float)simulation->transforms.composeTime;
+    
+    // Lights are left alone while both ticks hold the version they were last written from
+    SceneManager* render = &simulation->renderScene;
+    bool lightsChanged = previous->lightsVersion != current->lightsVersion || simulation->lightsVersion != current->lightsVersion;
+    for (size_t i = 0; lightsChanged && i < render->lightCount; i++) {
+        const SimulationLightState* a = &previous->lights[i];
+        const SimulationLightState* b = &current->lights[i];
+        Light* light = &render->lights[i];
+        simulation_lerp3(light->position, a->position, b->position, t);
+        simulation_lerp3(light->direction, a->direction, b->direction, t);
+        simulation_lerp3(light->color, a->color, b->color, t);
+        light->intensity = simulation_lerp(a->intensity, b->intensity, t);
+    }
+    if (lightsChanged) simulation->lightsVersion = previous->lightsVersion;
+    simulation->stats.lightsInterpolated = lightsChanged;
+    
+    // Wind direction (radians) along the shorter arc
+    render->weather = current->weather;
+    render->weatherIntensity = simulation_lerp(previous->weatherIntensity, current->weatherIntensity, t);
+    render->windStrength = simulation_lerp(previous->windStrength, current->windStrength, t);
+    render->windDirection = atan2f(simulation_lerp(sinf(previous->windDirection), sinf(current->windDirection), t),
+                                   simulation_lerp(cosf(previous->windDirection), cosf(current->windDirection), t));
+    
+    // Time of day wraps at midnight
+    float nextTimeOfDay = current->timeOfDay < previous->timeOfDay ? current->timeOfDay + 1.0f : current->timeOfDay;
+    *timeOfDay = simulation_lerp(previous->timeOfDay, nextTimeOfDay, t);
+    if (*timeOfDay >= 1.0f) *timeOfDay -= 1.0f;
+    *weather = current->weather;
+    
+    simulation->windowLatency += now - current->publishTime;
+    simulation_updateStats(simulation, current, now);
+    return t;
+}
+
+// Last measured rates
+const SimulationStats* simulation_getStats(const Simulation* simulation) {
+    return &simulation->stats;
+}
@@ -0,0 +1,360 @@
+#include "scene/transform_store.h"
+#include "utils/thread_pool.h"
+#include "utils/trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define TRANSFORM_STORE_SSE
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define TRANSFORM_STORE_NEON
+#endif
+
+#define TRANSFORM_DEG_TO_RAD 0.017453292519943295f
+
+// sin/cos polynomial coefficients on [-pi/4, pi/4] (cephes sinf/cosf)
+#define TRANSFORM_SIN_1 -1.6666654611e-1f
+#define TRANSFORM_SIN_2  8.3321608736e-3f
+#define TRANSFORM_SIN_3 -1.9515295891e-4f
+#define TRANSFORM_COS_1  4.166664568298827e-2f
+#define TRANSFORM_COS_2 -1.388731625493765e-3f
+#define TRANSFORM_COS_3  2.443315711809948e-5f
+#define TRANSFORM_PIO2_HI 1.5707963705062866f      // pi / 2 split in two for an exact reduction
+#define TRANSFORM_PIO2_LO -4.37113900018624283e-8f
+#define TRANSFORM_TWO_OVER_PI 0.63661977236758134f
+
+// Inputs of one batch, one lane per transform
+typedef struct {
+    float position[3][TRANSFORM_STORE_LANES];
+    float rotation[3][TRANSFORM_STORE_LANES];
+    float scale[3][TRANSFORM_STORE_LANES];
+} TransformBatch;
+
+// Wall clock in milliseconds
+static double transformStore_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Rotation and scale part of a matrix from the sines and cosines of pitch (x), yaw (y) and
+// roll (z): columns of Ry * Rx * Rz, each scaled by its axis
+#define TRANSFORM_COMPOSE_BASIS(MUL, ADD, SUB, NEG, m, sx, cx, sy, cy, sz, cz, kx, ky, kz) \
+    do { \
+        m[0] = MUL(ADD(MUL(cy, cz), MUL(MUL(sy, sx), sz)), kx); \
+        m[1] = MUL(MUL(cx, sz), kx); \
+        m[2] = MUL(SUB(MUL(MUL(cy, sx), sz), MUL(sy, cz)), kx); \
+        m[4] = MUL(SUB(MUL(MUL(sy, sx), cz), MUL(cy, sz)), ky); \
+        m[5] = MUL(MUL(cx, cz), ky); \
+        m[6] = MUL(ADD(MUL(sy, sz), MUL(MUL(cy, sx), cz)), ky); \
+        m[8] = MUL(MUL(sy, cx), kz); \
+        m[9] = MUL(NEG(sx), kz); \
+        m[10] = MUL(MUL(cy, cx), kz); \
+    } while (0)
+
+#define TRANSFORM_SCALAR_MUL(a, b) ((a) * (b))
+#define TRANSFORM_SCALAR_ADD(a, b) ((a) + (b))
+#define TRANSFORM_SCALAR_SUB(a, b) ((a) - (b))
+#define TRANSFORM_SCALAR_NEG(a) (-(a))
+
+// Compose one matrix (reference path, also used for batch tails)
+void transform_compose(const float* position, const float* rotation, const float* scale, float* matrix) {
+    float sx = sinf(rotation[0] * TRANSFORM_DEG_TO_RAD), cx = cosf(rotation[0] * TRANSFORM_DEG_TO_RAD);
+    float sy = sinf(rotation[1] * TRANSFORM_DEG_TO_RAD), cy = cosf(rotation[1] * TRANSFORM_DEG_TO_RAD);
+    float sz = sinf(rotation[2] * TRANSFORM_DEG_TO_RAD), cz = cosf(rotation[2] * TRANSFORM_DEG_TO_RAD);
+    TRANSFORM_COMPOSE_BASIS(TRANSFORM_SCALAR_MUL, TRANSFORM_SCALAR_ADD, TRANSFORM_SCALAR_SUB, TRANSFORM_SCALAR_NEG,
+                            matrix, sx, cx, sy, cy, sz, cz, scale[0], scale[1], scale[2]);
+    matrix[3] = 0.0f;
+    matrix[7] = 0.0f;
+    matrix[11] = 0.0f;
+    matrix[12] = position[0];
+    matrix[13] = position[1];
+    matrix[14] = position[2];
+    matrix[15] = 1.0f;
+}
+
+#if defined(TRANSFORM_STORE_SSE)
+// Four sines and cosines at once: reduce by multiples of pi/2, evaluate both polynomials,
+// then swap and negate by quadrant
+static inline void transformStore_sincos(__m128 x, __m128* sine, __m128* cosine) {
+    __m128i quadrant = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(TRANSFORM_TWO_OVER_PI)));
+    __m128 q = _mm_cvtepi32_ps(quadrant);
+    __m128 r = _mm_sub_ps(_mm_sub_ps(x, _mm_mul_ps(q, _mm_set1_ps(TRANSFORM_PIO2_HI))), _mm_mul_ps(q, _mm_set1_ps(TRANSFORM_PIO2_LO)));
+    __m128 r2 = _mm_mul_ps(r, r);
+    
+    __m128 s = _mm_add_ps(_mm_set1_ps(TRANSFORM_SIN_2), _mm_mul_ps(r2, _mm_set1_ps(TRANSFORM_SIN_3)));
+    s = _mm_add_ps(_mm_set1_ps(TRANSFORM_SIN_1), _mm_mul_ps(r2, s));
+    s = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), s));
+    __m128 c = _mm_add_ps(_mm_set1_ps(TRANSFORM_COS_2), _mm_mul_ps(r2, _mm_set1_ps(TRANSFORM_COS_3)));
+    c = _mm_add_ps(_mm_set1_ps(TRANSFORM_COS_1), _mm_mul_ps(r2, c));
+    c = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), r2)), _mm_mul_ps(_mm_mul_ps(r2, r2), c));
+    
+    __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+    __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(quadrant, _mm_set1_epi32(2)), 30));
+    __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(quadrant, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+    *sine = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, c), _mm_andnot_ps(swap, s)), sinSign);
+    *cosine = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, s), _mm_andnot_ps(swap, c)), cosSign);
+}
+
+#define TRANSFORM_SSE_NEG(a) _mm_xor_ps((a), _mm_set1_ps(-0.0f))
+
+// Compose a full batch and store each lane's matrix
+static inline void transformStore_composeBatch(const TransformBatch* batch, float** outputs) {
+    __m128 sx, cx, sy, cy, sz, cz;
+    __m128 toRadians = _mm_set1_ps(TRANSFORM_DEG_TO_RAD);
+    transformStore_sincos(_mm_mul_ps(_mm_loadu_ps(batch->rotation[0]), toRadians), &sx, &cx);
+    transformStore_sincos(_mm_mul_ps(_mm_loadu_ps(batch->rotation[1]), toRadians), &sy, &cy);
+    transformStore_sincos(_mm_mul_ps(_mm_loadu_ps(batch->rotation[2]), toRadians), &sz, &cz);
+    
+    __m128 m[16];
+    TRANSFORM_COMPOSE_BASIS(_mm_mul_ps, _mm_add_ps, _mm_sub_ps, TRANSFORM_SSE_NEG, m, sx, cx, sy, cy, sz, cz,
+                            _mm_loadu_ps(batch->scale[0]), _mm_loadu_ps(batch->scale[1]), _mm_loadu_ps(batch->scale[2]));
+    m[3] = _mm_setzero_ps();
+    m[7] = _mm_setzero_ps();
+    m[11] = _mm_setzero_ps();
+    m[12] = _mm_loadu_ps(batch->position[0]);
+    m[13] = _mm_loadu_ps(batch->position[1]);
+    m[14] = _mm_loadu_ps(batch->position[2]);
+    m[15] = _mm_set1_ps(1.0f);
+    
+    // Lanes hold one element of four matrices; transpose each column to store it whole
+    for (int column = 0; column < 4; column++) {
+        __m128 c0 = m[column * 4 + 0];
+        __m128 c1 = m[column * 4 + 1];
+        __m128 c2 = m[column * 4 + 2];
+        __m128 c3 = m[column * 4 + 3];
+        _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+        _mm_storeu_ps(outputs[0] + column * 4, c0);
+        _mm_storeu_ps(outputs[1] + column * 4, c1);
+        _mm_storeu_ps(outputs[2] + column * 4, c2);
+        _mm_storeu_ps(outputs[3] + column * 4, c3);
+    }
+}
+#elif defined(TRANSFORM_STORE_NEON)
+// Four sines and cosines at once (see the SSE version)
+static inline void transformStore_sincos(float32x4_t x, float32x4_t* sine, float32x4_t* cosine) {
+    float32x4_t scaled = vmulq_n_f32(x, TRANSFORM_TWO_OVER_PI);
+    float32x4_t half = vbslq_f32(vcltq_f32(scaled, vdupq_n_f32(0.0f)), vdupq_n_f32(-0.5f), vdupq_n_f32(0.5f));
+    int32x4_t quadrant = vcvtq_s32_f32(vaddq_f32(scaled, half));
+    float32x4_t q = vcvtq_f32_s32(quadrant);
+    float32x4_t r = vmlsq_n_f32(vmlsq_n_f32(x, q, TRANSFORM_PIO2_HI), q, TRANSFORM_PIO2_LO);
+    float32x4_t r2 = vmulq_f32(r, r);
+    
+    float32x4_t s = vmlaq_n_f32(vdupq_n_f32(TRANSFORM_SIN_2), r2, TRANSFORM_SIN_3);
+    s = vmlaq_f32(vdupq_n_f32(TRANSFORM_SIN_1), r2, s);
+    s = vmlaq_f32(r, vmulq_f32(r, r2), s);
+    float32x4_t c = vmlaq_n_f32(vdupq_n_f32(TRANSFORM_COS_2), r2, TRANSFORM_COS_3);
+    c = vmlaq_f32(vdupq_n_f32(TRANSFORM_COS_1), r2, c);
+    c = vmlaq_f32(vmlsq_n_f32(vdupq_n_f32(1.0f), r2, 0.5f), vmulq_f32(r2, r2), c);
+    
+    uint32x4_t swap = vceqq_s32(vandq_s32(quadrant, vdupq_n_s32(1)), vdupq_n_s32(1));
+    uint32x4_t sinSign = vshlq_n_u32(vreinterpretq_u32_s32(vandq_s32(quadrant, vdupq_n_s32(2))), 30);
+    uint32x4_t cosSign = vshlq_n_u32(vreinterpretq_u32_s32(vandq_s32(vaddq_s32(quadrant, vdupq_n_s32(1)), vdupq_n_s32(2))), 30);
+    *sine = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(vbslq_f32(swap, c, s)), sinSign));
+    *cosine = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(vbslq_f32(swap, s, c)), cosSign));
+}
+
+// Compose a full batch and store each lane's matrix
+static inline void transformStore_composeBatch(const TransformBatch* batch, float** outputs) {
+    float32x4_t sx, cx, sy, cy, sz, cz;
+    transformStore_sincos(vmulq_n_f32(vld1q_f32(batch->rotation[0]), TRANSFORM_DEG_TO_RAD), &sx, &cx);
+    transformStore_sincos(vmulq_n_f32(vld1q_f32(batch->rotation[1]), TRANSFORM_DEG_TO_RAD), &sy, &cy);
+    transformStore_sincos(vmulq_n_f32(vld1q_f32(batch->rotation[2]), TRANSFORM_DEG_TO_RAD), &sz, &cz);
+    
+    float32x4_t m[16];
+    TRANSFORM_COMPOSE_BASIS(vmulq_f32, vaddq_f32, vsubq_f32, vnegq_f32, m, sx, cx, sy, cy, sz, cz,
+                            vld1q_f32(batch->scale[0]), vld1q_f32(batch->scale[1]), vld1q_f32(batch->scale[2]));
+    m[3] = vdupq_n_f32(0.0f);
+    m[7] = vdupq_n_f32(0.0f);
+    m[11] = vdupq_n_f32(0.0f);
+    m[12] = vld1q_f32(batch->position[0]);
+    m[13] = vld1q_f32(batch->position[1]);
+    m[14] = vld1q_f32(batch->position[2]);
+    m[15] = vdupq_n_f32(1.0f);
+    
+    // Interleaving stores write element k of each lane's column next to each other
+    for (int column = 0; column < 4; column++) {
+        float32x4x4_t columns = { { m[column * 4 + 0], m[column * 4 + 1], m[column * 4 + 2], m[column * 4 + 3] } };
+        float lanes[16];
+        vst4q_f32(lanes, columns);
+        for (int lane = 0; lane < TRANSFORM_STORE_LANES; lane++) {
+            memcpy(outputs[lane] + column * 4, lanes + lane * 4, sizeof(float) * 4);
+        }
+    }
+}
+#else
+// Compose a full batch one lane at a time
+static inline void transformStore_composeBatch(const TransformBatch* batch, float** outputs) {
+    for (int lane = 0; lane < TRANSFORM_STORE_LANES; lane++) {
+        float position[3] = { batch->position[0][lane], batch->position[1][lane], batch->position[2][lane] };
+        float rotation[3] = { batch->rotation[0][lane], batch->rotation[1][lane], batch->rotation[2][lane] };
+        float scale[3] = { batch->scale[0][lane], batch->scale[1][lane], batch->scale[2][lane] };
+        transform_compose(position, rotation, scale, outputs[lane]);
+    }
+}
+#endif
+
+// Range task over the dirty list: gather four transforms, compose, copy to the targets
+static void transformStore_composeRange(void* context, size_t begin, size_t end) {
+    TransformStore* store = (TransformStore*)context;
+    size_t i = begin;
+    
+    for (; i + TRANSFORM_STORE_LANES <= end; i += TRANSFORM_STORE_LANES) {
+        TransformBatch batch;
+        float* outputs[TRANSFORM_STORE_LANES];
+        for (int lane = 0; lane < TRANSFORM_STORE_LANES; lane++) {
+            uint32_t index = store->dirty[i + lane];
+            batch.position[0][lane] = store->positionX[index];
+            batch.position[1][lane] = store->positionY[index];
+            batch.position[2][lane] = store->positionZ[index];
+            batch.rotation[0][lane] = store->rotationX[index];
+            batch.rotation[1][lane] = store->rotationY[index];
+            batch.rotation[2][lane] = store->rotationZ[index];
+            batch.scale[0][lane] = store->scaleX[index];
+            batch.scale[1][lane] = store->scaleY[index];
+            batch.scale[2][lane] = store->scaleZ[index];
+            outputs[lane] = store->matrices + (size_t)index * 16;
+        }
+        transformStore_composeBatch(&batch, outputs);
+    }
+    
+    for (; i < end; i++) {
+        uint32_t index = store->dirty[i];
+        float position[3] = { store->positionX[index], store->positionY[index], store->positionZ[index] };
+        float rotation[3] = { store->rotationX[index], store->rotationY[index], store->rotationZ[index] };
+        float scale[3] = { store->scaleX[index], store->scaleY[index], store->scaleZ[index] };
+        transform_compose(position, rotation, scale, store->matrices + (size_t)index * 16);
+    }
+    
+    for (i = begin; i < end; i++) {
+        uint32_t index = store->dirty[i];
+        if (store->targets[index]) memcpy(store->targets[index], store->matrices + (size_t)index * 16, sizeof(float) * 16);
+        store->flags[index] &= (uint8_t)~TRANSFORM_STORE_DIRTY;
+    }
+}
+
+// Grow every array to hold capacity transforms
+static bool transformStore_reserve(TransformStore* store, size_t capacity) {
+    if (capacity <= store->capacity) return true;
+    
+    float** floatArrays[] = {
+        &store->positionX, &store->positionY, &store->positionZ,
+        &store->rotationX, &store->rotationY, &store->rotationZ,
+        &store->scaleX, &store->scaleY, &store->scaleZ
+    };
+    for (size_t a = 0; a < sizeof(floatArrays) / sizeof(floatArrays[0]); a++) {
+        float* resized = (float*)realloc(*floatArrays[a], sizeof(float) * capacity);
+        if (!resized) return false;
+        *floatArrays[a] = resized;
+    }
+    
+    uint8_t* flags = (uint8_t*)realloc(store->flags, capacity);
+    if (flags) store->flags = flags;
+    float* matrices = (float*)realloc(store->matrices, sizeof(float) * 16 * capacity);
+    if (matrices) store->matrices = matrices;
+    float** targets = (float**)realloc(store->targets, sizeof(float*) * capacity);
+    if (targets) store->targets = targets;
+    uint32_t* dirty = (uint32_t*)realloc(store->dirty, sizeof(uint32_t) * capacity);
+    if (dirty) store->dirty = dirty;
+    if (!flags || !matrices || !targets || !dirty) return false;
+    
+    store->capacity = capacity;
+    return true;
+}
+
+// Initialize an empty store with room for capacity transforms
+bool transformStore_init(TransformStore* store, size_t capacity) {
+    memset(store, 0, sizeof(TransformStore));
+    return transformStore_reserve(store, capacity ? capacity : 64);
+}
+
+void transformStore_cleanup(TransformStore* store) {
+    free(store->positionX);
+    free(store->positionY);
+    free(store->positionZ);
+    free(store->rotationX);
+    free(store->rotationY);
+    free(store->rotationZ);
+    free(store->scaleX);
+    free(store->scaleY);
+    free(store->scaleZ);
+    free(store->flags);
+    free(store->matrices);
+    free(store->targets);
+    free(store->dirty);
+    memset(store, 0, sizeof(TransformStore));
+}
+
+// Add a transform, dirty until the next compose; target (may be NULL) receives a copy of
+// its matrix on every compose
+uint32_t transformStore_add(TransformStore* store, const float* position, const float* rotation, const float* scale,
+                            bool isStatic, float* target) {
+    if (store->count >= TRANSFORM_STORE_INVALID) return TRANSFORM_STORE_INVALID;
+    if (store->count == store->capacity && !transformStore_reserve(store, store->capacity * 2)) {
+        fprintf(stderr, "Failed to grow the transform store past %zu transforms\n", store->capacity);
+        return TRANSFORM_STORE_INVALID;
+    }
+    
+    uint32_t index = (uint32_t)store->count++;
+    store->flags[index] = isStatic ? TRANSFORM_STORE_STATIC : 0;
+    store->targets[index] = target;
+    store->positionX[index] = NAN;      // Never equal, so the set below always marks it dirty
+    transformStore_set(store, index, position, rotation, scale);
+    return index;
+}
+
+// Update a transform; it is only marked dirty if a value actually changed
+void transformStore_set(TransformStore* store, uint32_t index, const float* position, const float* rotation, const float* scale) {
+    if (index >= store->count) return;
+    
+    bool changed = store->positionX[index] != position[0] || store->positionY[index] != position[1] ||
+                   store->positionZ[index] != position[2] || store->rotationX[index] != rotation[0] ||
+                   store->rotationY[index] != rotation[1] || store->rotationZ[index] != rotation[2] ||
+                   store->scaleX[index] != scale[0] || store->scaleY[index] != scale[1] ||
+                   store->scaleZ[index] != scale[2];
+    if (!changed) return;
+    
+    store->positionX[index] = position[0];
+    store->positionY[index] = position[1];
+    store->positionZ[index] = position[2];
+    store->rotationX[index] = rotation[0];
+    store->rotationY[index] = rotation[1];
+    store->rotationZ[index] = rotation[2];
+    store->scaleX[index] = scale[0];
+    store->scaleY[index] = scale[1];
+    store->scaleZ[index] = scale[2];
+    if (!(store->flags[index] & TRANSFORM_STORE_DIRTY)) {
+        store->flags[index] |= TRANSFORM_STORE_DIRTY;
+        store->dirty[store->dirtyCount++] = index;
+    }
+}
+
+// Compose every dirty transform (on the pool when there are enough of them) and clear the
+// dirty list; clean transforms are not touched
+void transformStore_compose(TransformStore* store, ThreadPool* pool) {
+    TRACE_SCOPE("transformStore_compose");
+    double start = transformStore_now();
+    size_t dirtyCount = store->dirtyCount;
+    
+    if (pool && dirtyCount >= TRANSFORM_STORE_PARALLEL_THRESHOLD) {
+        threadPool_parallelFor(pool, "Job: transforms (ms)", transformStore_composeRange, store, dirtyCount, TRANSFORM_STORE_GRAIN);
+    } else if (dirtyCount > 0) {
+        transformStore_composeRange(store, 0, dirtyCount);
+    }
+    
+    store->composed = dirtyCount;
+    store->skipped = store->count - dirtyCount;
+    store->dirtyCount = 0;
+    store->composeTime = transformStore_now() - start;
+}
+
+// Current matrix of a transform (as of the last compose)
+const float* transformStore_getMatrix(const TransformStore* store, uint32_t index) {
+    return store->matrices + (size_t)index * 16;
+}
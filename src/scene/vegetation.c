@@ -0,0 +1,110 @@
+#include "scene/scene_manager.h"
+#include "scene/vegetation_placer.h"
+#include "scene/transform_store.h"
+#include "utils/thread_pool.h"
+
+// Where the writer puts the points of one category: variant v goes to objects[v]
+typedef struct {
+    Object* objects;
+} VegetationTarget;
+
+// Terrain lookups for the placer (read-only, safe on worker threads)
+static void vegetation_sampleTerrain(void* context, float x, float z, float* height, float* slope, int* biome) {
+    Terrain* terrain = (Terrain*)context;
+    *height = terrain_getHeight(terrain, x, z);
+    *slope = terrain_getSlope(terrain, x, z);
+    *biome = (int)terrain_getBiomeAt(terrain, x, z);
+}
+
+// Fill one instance transform: yaw about Y and a uniform scale
+static void vegetation_writeInstance(void* context, int variant, size_t index, const VegetationPoint* point) {
+    VegetationTarget* target = (VegetationTarget*)context;
+    Transform* transform = &target->objects[variant].instances[index];
+    
+    transform->position[0] = point->position[0];
+    transform->position[1] = point->position[1];
+    transform->position[2] = point->position[2];
+    transform->rotation[0] = 0.0f;
+    transform->rotation[1] = point->yaw;
+    transform->rotation[2] = 0.0f;
+    transform->scale[0] = point->scale;
+    transform->scale[1] = point->scale;
+    transform->scale[2] = point->scale;
+    transform_compose(transform->position, transform->rotation, transform->scale, (float*)transform->modelMatrix);
+}
+
+// Place one category across its objects (one object per variant) and upload the instances
+static void vegetation_placeCategory(SceneManager* scene, VegetationLayer* layer, Object* objects, size_t objectCount,
+                                     ThreadPool* pool, int cores) {
+    if (objectCount == 0) return;
+    layer->variantCount = objectCount < VEGETATION_MAX_VARIANTS ? (int)objectCount : VEGETATION_MAX_VARIANTS;
+    
+    float half = scene->terrain.size * 0.5f;
+    VegetationPlacer placer;
+    if (!vegetationPlacer_run(&placer, layer, -half, -half, scene->terrain.size,
+                              vegetation_sampleTerrain, &scene->terrain, pool)) {
+        return;
+    }
+    
+    // Size every variant's instance array before the parallel write
+    for (int v = 0; v < layer->variantCount; v++) {
+        Object* object = &objects[v];
+        size_t count = placer.variantCounts[v];
+        Transform* instances = count ? (Transform*)realloc(object->instances, count * sizeof(Transform)) : NULL;
+        if (count && !instances) {
+            fprintf(stderr, "Failed to allocate %zu %s instances\n", count, layer->name);
+            vegetationPlacer_cleanup(&placer);
+            return;
+        }
+        if (!count) free(object->instances);
+        object->instances = instances;
+        object->instanceCount = count;
+        object->isInstanced = count > 0;
+    }
+    
+    VegetationTarget target = { objects };
+    vegetationPlacer_write(&placer, vegetation_writeInstance, &target, pool);
+    for (int v = 0; v < layer->variantCount; v++) {
+        if (objects[v].instanceCount) object_setupInstances(&objects[v]);
+    }
+    
+    printf("Placed %zu %s (%zu candidates, %zu accepted) in %.2f ms + %.2f ms write on %d cores\n",
+           placer.kept, layer->name, placer.candidates, placer.accepted, placer.placeTime, placer.writeTime, cores);
+    vegetationPlacer_cleanup(&placer);
+}
+
+// Scatter trees, flowers and mushrooms over the terrain with Poisson-disk spacing.
+// Placement is seeded by the terrain seed and comes out identical on any thread count.
+// The renderer's pool does not exist yet while the world is built, so this runs on a
+// short-lived pool of its own.
+void sceneManager_populateVegetation(SceneManager* scene) {
+    TRACE_SCOPE("sceneManager_populateVegetation");
+    uint32_t seed = (uint32_t)scene->terrain.seed;
+    
+    // Density per biome: meadow, forest, rocky
+    VegetationLayer trees = {
+        "trees", seed, 1, TREE_SPACING, TREE_INSTANCES, { 0.05f, 0.9f, 0.02f },
+        -INFINITY, INFINITY, 0.5f, 0.8f, 1.3f, 1
+    };
+    VegetationLayer flowers = {
+        "flowers", seed, 2, FLOWER_SPACING, FLOWER_INSTANCES, { 0.6f, 0.1f, 0.0f },
+        -INFINITY, INFINITY, 0.35f, 0.7f, 1.2f, 1
+    };
+    VegetationLayer mushrooms = {
+        "mushrooms", seed, 3, MUSHROOM_SPACING, MUSHROOM_INSTANCES, { 0.02f, 0.5f, 0.0f },
+        -INFINITY, INFINITY, 0.3f, 0.6f, 1.4f, 1
+    };
+    
+    ThreadPool* pool = (ThreadPool*)malloc(sizeof(ThreadPool));
+    if (pool) threadPool_init(pool, WORKER_THREADS);
+    int cores = pool ? pool->threadCount + 1 : 1;
+    
+    vegetation_placeCategory(scene, &trees, scene->trees, scene->treeCount, pool, cores);
+    vegetation_placeCategory(scene, &flowers, scene->flowers, scene->flowerCount, pool, cores);
+    vegetation_placeCategory(scene, &mushrooms, scene->mushrooms, scene->mushroomCount, pool, cores);
+    
+    if (pool) {
+        threadPool_cleanup(pool);
+        free(pool);
+    }
+}
@@ -0,0 +1,302 @@
+#include "scene/vegetation_placer.h"
+#include "utils/thread_pool.h"
+#include "utils/trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+// What one write task needs
+typedef struct {
+    VegetationPlacer* placer;
+    VegetationWriter writer;
+    void* context;
+} VegetationWriteContext;
+
+// Wall clock in milliseconds
+static double vegetationPlacer_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Mix a value into a hash (murmur3 finalizer steps)
+static uint32_t vegetationPlacer_hash(uint32_t hash, uint32_t value) {
+    hash ^= value * 0xcc9e2d51u;
+    hash = (hash << 13) | (hash >> 19);
+    hash = hash * 5u + 0xe6546b64u;
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+// Per-tile random stream (xorshift32)
+static uint32_t vegetationPlacer_next(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+// Uniform in [0, 1)
+static float vegetationPlacer_random(uint32_t* state) {
+    return (vegetationPlacer_next(state) >> 8) / 16777216.0f;
+}
+
+// Is any placed point closer than the radius to (x, z)? Looks two cells out, which covers
+// the radius at a cell size of radius / sqrt(2).
+static bool vegetationPlacer_crowded(const VegetationPlacer* placer, int cellX, int cellZ, float x, float z) {
+    float radiusSquared = placer->layer->minDistance * placer->layer->minDistance;
+    int x0 = cellX > 2 ? cellX - 2 : 0;
+    int z0 = cellZ > 2 ? cellZ - 2 : 0;
+    int x1 = cellX + 2 < placer->cellsPerSide - 1 ? cellX + 2 : placer->cellsPerSide - 1;
+    int z1 = cellZ + 2 < placer->cellsPerSide - 1 ? cellZ + 2 : placer->cellsPerSide - 1;
+    
+    for (int cz = z0; cz <= z1; cz++) {
+        for (int cx = x0; cx <= x1; cx++) {
+            uint32_t slot = placer->cells[(size_t)cz * placer->cellsPerSide + cx];
+            if (slot == 0) continue;
+            
+            const VegetationPoint* other = &placer->points[slot - 1];
+            float dx = other->position[0] - x;
+            float dz = other->position[2] - z;
+            if (dx * dx + dz * dz < radiusSquared) return true;
+        }
+    }
+    return false;
+}
+
+// Throw darts over one tile; every random draw comes from the tile's own stream
+static void vegetationPlacer_fillTile(VegetationPlacer* placer, int tileX, int tileZ) {
+    const VegetationLayer* layer = placer->layer;
+    int tileIndex = tileZ * placer->tilesPerSide + tileX;
+    VegetationTile* tile = &placer->tiles[tileIndex];
+    VegetationPoint* points = &placer->points[(size_t)tileIndex * placer->tileCapacity];
+    
+    // Cells covered by the tile (the last row and column may be partial)
+    int cellX0 = tileX * placer->cellsPerTile;
+    int cellZ0 = tileZ * placer->cellsPerTile;
+    int cellsX = placer->cellsPerSide - cellX0 < placer->cellsPerTile ? placer->cellsPerSide - cellX0 : placer->cellsPerTile;
+    int cellsZ = placer->cellsPerSide - cellZ0 < placer->cellsPerTile ? placer->cellsPerSide - cellZ0 : placer->cellsPerTile;
+    float tileMinX = placer->minX + cellX0 * placer->cellSize;
+    float tileMinZ = placer->minZ + cellZ0 * placer->cellSize;
+    float maxX = placer->minX + placer->size;
+    float maxZ = placer->minZ + placer->size;
+    
+    uint32_t state = vegetationPlacer_hash(vegetationPlacer_hash(vegetationPlacer_hash(layer->seed, layer->layer), (uint32_t)tileX), (uint32_t)tileZ);
+    if (state == 0) state = 0x9e3779b9u;
+    
+    int darts = cellsX * cellsZ * VEGETATION_DARTS_PER_CELL;
+    tile->count = 0;
+    tile->candidates = (uint32_t)darts;
+    for (int dart = 0; dart < darts; dart++) {
+        float x = tileMinX + vegetationPlacer_random(&state) * cellsX * placer->cellSize;
+        float z = tileMinZ + vegetationPlacer_random(&state) * cellsZ * placer->cellSize;
+        float chance = vegetationPlacer_random(&state);
+        if (x >= maxX || z >= maxZ) continue;
+        
+        // Spacing first: it is far cheaper than sampling the terrain
+        int cellX = (int)((x - placer->minX) / placer->cellSize);
+        int cellZ = (int)((z - placer->minZ) / placer->cellSize);
+        if (cellX < cellX0) cellX = cellX0;
+        if (cellZ < cellZ0) cellZ = cellZ0;
+        if (cellX >= cellX0 + cellsX) cellX = cellX0 + cellsX - 1;
+        if (cellZ >= cellZ0 + cellsZ) cellZ = cellZ0 + cellsZ - 1;
+        if (placer->cells[(size_t)cellZ * placer->cellsPerSide + cellX] != 0) continue;
+        if (vegetationPlacer_crowded(placer, cellX, cellZ, x, z)) continue;
+        
+        float height;
+        float slope;
+        int biome;
+        placer->sampler(placer->samplerContext, x, z, &height, &slope, &biome);
+        if (height < layer->minHeight || height > layer->maxHeight || slope > layer->maxSlope) continue;
+        if (biome < 0 || biome >= VEGETATION_MAX_BIOMES || chance >= layer->biomeDensity[biome]) continue;
+        
+        VegetationPoint* point = &points[tile->count];
+        point->position[0] = x;
+        point->position[1] = height;
+        point->position[2] = z;
+        point->yaw = vegetationPlacer_random(&state) * 360.0f;
+        point->scale = layer->minScale + vegetationPlacer_random(&state) * (layer->maxScale - layer->minScale);
+        point->priority = vegetationPlacer_next(&state);
+        point->variant = (uint8_t)(vegetationPlacer_next(&state) % (uint32_t)layer->variantCount);
+        
+        tile->count++;
+        placer->cells[(size_t)cellZ * placer->cellsPerSide + cellX] = (uint32_t)((size_t)tileIndex * placer->tileCapacity + tile->count);
+    }
+}
+
+// Range task over the tiles of the current phase
+static void vegetationPlacer_phaseTask(void* context, size_t begin, size_t end) {
+    VegetationPlacer* placer = (VegetationPlacer*)context;
+    int phaseX = placer->phase & 1;
+    int phaseZ = placer->phase >> 1;
+    int phaseTilesX = (placer->tilesPerSide - phaseX + 1) / 2;
+    
+    for (size_t i = begin; i < end; i++) {
+        int tileX = phaseX + 2 * (int)(i % phaseTilesX);
+        int tileZ = phaseZ + 2 * (int)(i / phaseTilesX);
+        vegetationPlacer_fillTile(placer, tileX, tileZ);
+    }
+}
+
+// Pick the priority cut that keeps at most maxCount points: the maxCount-th smallest
+// priority, found with a two-pass radix select over the high and low 16 bits. Thinning
+// a Poisson-disk set only removes points, so the spacing holds.
+static bool vegetationPlacer_thin(VegetationPlacer* placer) {
+    size_t maxCount = placer->layer->maxCount;
+    placer->keepBelow = UINT64_MAX;
+    if (maxCount == 0 || placer->accepted <= maxCount) return true;
+    
+    uint32_t* histogram = (uint32_t*)malloc(sizeof(uint32_t) * 65536);
+    if (!histogram) return false;
+    
+    int tileCount = placer->tilesPerSide * placer->tilesPerSide;
+    size_t rank = maxCount;
+    uint32_t cut = 0;
+    for (int pass = 0; pass < 2; pass++) {
+        memset(histogram, 0, sizeof(uint32_t) * 65536);
+        for (int t = 0; t < tileCount; t++) {
+            const VegetationPoint* points = &placer->points[(size_t)t * placer->tileCapacity];
+            for (uint32_t i = 0; i < placer->tiles[t].count; i++) {
+                uint32_t priority = points[i].priority;
+                if (pass == 0) {
+                    histogram[priority >> 16]++;
+                } else if ((priority >> 16) == cut) {
+                    histogram[priority & 0xffffu]++;
+                }
+            }
+        }
+        
+        uint32_t bucket = 0;
+        while (rank >= histogram[bucket]) rank -= histogram[bucket++];
+        cut = pass == 0 ? bucket : (cut << 16) | bucket;
+    }
+    free(histogram);
+    placer->keepBelow = cut;
+    return true;
+}
+
+// Place one layer over the square [minX, minX + size] x [minZ, minZ + size]. Afterwards
+// variantCounts holds how many points each variant will receive from vegetationPlacer_write.
+bool vegetationPlacer_run(VegetationPlacer* placer, const VegetationLayer* layer, float minX, float minZ, float size,
+                          VegetationSampler sampler, void* samplerContext, ThreadPool* pool) {
+    TRACE_SCOPE("vegetationPlacer_run");
+    double start = vegetationPlacer_now();
+    memset(placer, 0, sizeof(VegetationPlacer));
+    placer->layer = layer;
+    placer->sampler = sampler;
+    placer->samplerContext = samplerContext;
+    placer->minX = minX;
+    placer->minZ = minZ;
+    placer->size = size;
+    if (layer->minDistance <= 0.0f || size <= 0.0f || layer->variantCount < 1 || layer->variantCount > VEGETATION_MAX_VARIANTS) {
+        fprintf(stderr, "Invalid vegetation layer %s\n", layer->name ? layer->name : "");
+        return false;
+    }
+    
+    placer->cellSize = layer->minDistance / sqrtf(2.0f);
+    placer->cellsPerSide = (int)ceilf(size / placer->cellSize);
+    placer->cellsPerTile = (placer->cellsPerSide + VEGETATION_TILES_PER_SIDE - 1) / VEGETATION_TILES_PER_SIDE;
+    if (placer->cellsPerTile < VEGETATION_MIN_TILE_CELLS) placer->cellsPerTile = VEGETATION_MIN_TILE_CELLS;
+    placer->tilesPerSide = (placer->cellsPerSide + placer->cellsPerTile - 1) / placer->cellsPerTile;
+    placer->tileCapacity = (uint32_t)(placer->cellsPerTile * placer->cellsPerTile);
+    
+    int tileCount = placer->tilesPerSide * placer->tilesPerSide;
+    placer->cells = (uint32_t*)calloc((size_t)placer->cellsPerSide * placer->cellsPerSide, sizeof(uint32_t));
+    placer->tiles = (VegetationTile*)calloc(tileCount, sizeof(VegetationTile));
+    placer->points = (VegetationPoint*)malloc(sizeof(VegetationPoint) * tileCount * placer->tileCapacity);
+    if (!placer->cells || !placer->tiles || !placer->points) {
+        fprintf(stderr, "Failed to allocate vegetation placement for %s\n", layer->name ? layer->name : "layer");
+        vegetationPlacer_cleanup(placer);
+        return false;
+    }
+    
+    // Four checkerboard phases; tiles within a phase are independent
+    for (placer->phase = 0; placer->phase < 4; placer->phase++) {
+        int phaseTilesX = (placer->tilesPerSide - (placer->phase & 1) + 1) / 2;
+        int phaseTilesZ = (placer->tilesPerSide - (placer->phase >> 1) + 1) / 2;
+        size_t phaseTiles = (size_t)phaseTilesX * phaseTilesZ;
+        if (pool) {
+            threadPool_parallelFor(pool, "Job: vegetation placement (ms)", vegetationPlacer_phaseTask, placer, phaseTiles, 1);
+        } else {
+            vegetationPlacer_phaseTask(placer, 0, phaseTiles);
+        }
+    }
+    
+    for (int t = 0; t < tileCount; t++) {
+        placer->candidates += placer->tiles[t].candidates;
+        placer->accepted += placer->tiles[t].count;
+    }
+    if (!vegetationPlacer_thin(placer)) {
+        vegetationPlacer_cleanup(placer);
+        return false;
+    }
+    
+    // Output offsets per tile and variant, in tile order
+    for (int t = 0; t < tileCount; t++) {
+        VegetationTile* tile = &placer->tiles[t];
+        const VegetationPoint* points = &placer->points[(size_t)t * placer->tileCapacity];
+        size_t counts[VEGETATION_MAX_VARIANTS] = { 0 };
+        for (uint32_t i = 0; i < tile->count; i++) {
+            if (points[i].priority < placer->keepBelow) counts[points[i].variant]++;
+        }
+        for (int v = 0; v < layer->variantCount; v++) {
+            tile->offsets[v] = (uint32_t)placer->variantCounts[v];
+            placer->variantCounts[v] += counts[v];
+            placer->kept += counts[v];
+        }
+    }
+    
+    placer->placeTime = vegetationPlacer_now() - start;
+    return true;
+}
+
+// Range task: hand the kept points of some tiles to the writer
+static void vegetationPlacer_writeTask(void* context, size_t begin, size_t end) {
+    VegetationWriteContext* write = (VegetationWriteContext*)context;
+    VegetationPlacer* placer = write->placer;
+    
+    for (size_t t = begin; t < end; t++) {
+        const VegetationTile* tile = &placer->tiles[t];
+        const VegetationPoint* points = &placer->points[t * placer->tileCapacity];
+        uint32_t next[VEGETATION_MAX_VARIANTS];
+        memcpy(next, tile->offsets, sizeof(next));
+        for (uint32_t i = 0; i < tile->count; i++) {
+            if (points[i].priority >= placer->keepBelow) continue;
+            write->writer(write->context, points[i].variant, next[points[i].variant]++, &points[i]);
+        }
+    }
+}
+
+// Pass every kept point to the writer, tiles in parallel
+void vegetationPlacer_write(VegetationPlacer* placer, VegetationWriter writer, void* context, ThreadPool* pool) {
+    TRACE_SCOPE("vegetationPlacer_write");
+    if (!placer->tiles) return;
+    
+    double start = vegetationPlacer_now();
+    VegetationWriteContext write = { placer, writer, context };
+    size_t tileCount = (size_t)placer->tilesPerSide * placer->tilesPerSide;
+    if (pool) {
+        threadPool_parallelFor(pool, "Job: vegetation write (ms)", vegetationPlacer_writeTask, &write, tileCount, 4);
+    } else {
+        vegetationPlacer_writeTask(&write, 0, tileCount);
+    }
+    placer->writeTime = vegetationPlacer_now() - start;
+}
+
+void vegetationPlacer_cleanup(VegetationPlacer* placer) {
+    free(placer->cells);
+    free(placer->tiles);
+    free(placer->points);
+    placer->cells = NULL;
+    placer->tiles = NULL;
+    placer->points = NULL;
+}
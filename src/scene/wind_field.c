@@ -0,0 +1,337 @@
+#include "scene/wind_field.h"
+#include "config.h"
+#include "utils/thread_pool.h"
+#include "utils/trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define WIND_FIELD_SSE
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define WIND_FIELD_NEON
+#endif
+
+// Channels of a cell
+#define WIND_CHANNELS 4
+#define WIND_GUST_ALONG 0
+#define WIND_GUST_ACROSS 1
+#define WIND_FLUID_X 2
+#define WIND_FLUID_Z 3
+
+// What sampling reads from the field, with the window position folded into floats
+typedef struct {
+    const float* cells;
+    int size;
+    int mask;
+    int ringX;                  // Ring position of the window's first cell
+    int ringZ;
+    float baseX;                // World position of the window's first cell
+    float baseZ;
+    float invCell;
+    float maxCoord;
+    float windX;
+    float windZ;
+} WindSampler;
+
+// Batch sampling job
+typedef struct {
+    const WindField* field;
+    const float* positions;
+    size_t stride;
+    float* velocities;
+} WindSampleJob;
+
+// Wall clock in milliseconds
+static double windField_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Lattice hash to [-1, 1]
+static float windField_hash(int x, int z, uint32_t seed) {
+    uint32_t h = (uint32_t)x * 0x8da6b343u ^ (uint32_t)z * 0xd8163841u ^ seed * 0xcb1ab31fu;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return (float)(h >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+// Smoothly interpolated value noise, roughly in [-1, 1]
+static float windField_noise(float x, float z, uint32_t seed) {
+    float fx = floorf(x);
+    float fz = floorf(z);
+    int ix = (int)fx;
+    int iz = (int)fz;
+    float tx = x - fx;
+    float tz = z - fz;
+    tx = tx * tx * (3.0f - 2.0f * tx);
+    tz = tz * tz * (3.0f - 2.0f * tz);
+    
+    float a = windField_hash(ix, iz, seed);
+    float b = windField_hash(ix + 1, iz, seed);
+    float c = windField_hash(ix, iz + 1, seed);
+    float d = windField_hash(ix + 1, iz + 1, seed);
+    return (a + (b - a) * tx) + ((c + (d - c) * tx) - (a + (b - a) * tx)) * tz;
+}
+
+// Two octaves of gust noise at a noise-space position
+static float windField_gust(float x, float z, uint32_t seed) {
+    float scale = 1.0f / WIND_FIELD_GUST_SCALE;
+    float n = windField_noise(x * scale, z * scale, seed) * 0.7f +
+              windField_noise(x * scale * 2.3f + 17.0f, z * scale * 2.3f - 5.0f, seed ^ 0x9e3779b9u) * 0.3f;
+    return n * WIND_FIELD_GUST_STRENGTH;
+}
+
+// Cell (x, z) of the window, in noise-space cell coordinates
+static float* windField_cell(WindField* field, int x, int z) {
+    int mask = field->size - 1;
+    return field->cells + ((size_t)(z & mask) * field->size + (x & mask)) * WIND_CHANNELS;
+}
+
+// Read the coupled fluid at a cell's current world position
+static void windField_fillFluid(WindField* field, int x, int z, float* cell) {
+    if (!field->fluidSampler) {
+        cell[WIND_FLUID_X] = 0.0f;
+        cell[WIND_FLUID_Z] = 0.0f;
+        return;
+    }
+    
+    float worldX = (float)(x * (double)field->cellSize + field->scroll[0]);
+    float worldZ = (float)(z * (double)field->cellSize + field->scroll[1]);
+    float velocityX = 0.0f;
+    float velocityZ = 0.0f;
+    field->fluidSampler(field->fluidContext, worldX, worldZ, &velocityX, &velocityZ);
+    cell[WIND_FLUID_X] = velocityX * field->fluidCoupling;
+    cell[WIND_FLUID_Z] = velocityZ * field->fluidCoupling;
+}
+
+// Compute every channel of the cells in [x0, x1) x [z0, z1)
+static void windField_fillRect(WindField* field, int x0, int x1, int z0, int z1) {
+    for (int z = z0; z < z1; z++) {
+        for (int x = x0; x < x1; x++) {
+            float* cell = windField_cell(field, x, z);
+            float noiseX = x * field->cellSize;
+            float noiseZ = z * field->cellSize;
+            cell[WIND_GUST_ALONG] = windField_gust(noiseX, noiseZ, field->seed);
+            cell[WIND_GUST_ACROSS] = windField_gust(noiseX, noiseZ, field->seed ^ 0x632be5abu) * 0.5f;
+            windField_fillFluid(field, x, z, cell);
+        }
+    }
+    
+    if (x1 > x0 && z1 > z0) {
+        field->cellsUpdated += (size_t)(x1 - x0) * (z1 - z0);
+    }
+}
+
+// Allocate a size x size field (size must be a power of two)
+bool windField_init(WindField* field, int size, float cellSize, uint32_t seed) {
+    memset(field, 0, sizeof(WindField));
+    if (size < 2 || (size & (size - 1)) != 0 || cellSize <= 0.0f) {
+        fprintf(stderr, "Wind field size must be a power of two (got %d)\n", size);
+        return false;
+    }
+    
+    field->cells = (float*)calloc((size_t)size * size * WIND_CHANNELS, sizeof(float));
+    if (!field->cells) {
+        fprintf(stderr, "Failed to allocate wind field\n");
+        return false;
+    }
+    
+    field->size = size;
+    field->cellSize = cellSize;
+    field->seed = seed;
+    field->fluidCoupling = WIND_FIELD_FLUID_COUPLING;
+    return true;
+}
+
+// Free the field
+void windField_cleanup(WindField* field) {
+    free(field->cells);
+    memset(field, 0, sizeof(WindField));
+}
+
+// Couple a fluid simulation into the field (NULL sampler to decouple). Its velocity is
+// re-read WIND_FIELD_FLUID_ROWS rows per update, scaled by coupling.
+void windField_setFluid(WindField* field, WindFieldFluidSampler sampler, void* context, float coupling) {
+    field->fluidSampler = sampler;
+    field->fluidContext = context;
+    field->fluidCoupling = coupling;
+}
+
+// Advance the field to time (seconds): carry the gusts along the mean wind, move the window
+// with the camera and compute only the cells that scrolled into it
+void windField_update(WindField* field, double time, const float* cameraPosition, float strength, float direction) {
+    TRACE_SCOPE("windField_update");
+    double start = windField_now();
+    field->cellsUpdated = 0;
+    
+    // Gusts travel with the mean wind, so existing cells stay valid as it carries them
+    double deltaTime = field->valid ? time - field->time : 0.0;
+    if (deltaTime < 0.0) deltaTime = 0.0;
+    field->time = time;
+    field->windX = cosf(direction) * strength;
+    field->windZ = sinf(direction) * strength;
+    field->scroll[0] += field->windX * WIND_FIELD_SPEED * deltaTime;
+    field->scroll[1] += field->windZ * WIND_FIELD_SPEED * deltaTime;
+    
+    // Window centred on the camera, in noise-space cells
+    int size = field->size;
+    int originX = (int)floor((cameraPosition[0] - field->scroll[0]) / field->cellSize) - size / 2;
+    int originZ = (int)floor((cameraPosition[2] - field->scroll[1]) / field->cellSize) - size / 2;
+    int dx = originX - field->originX;
+    int dz = originZ - field->originZ;
+    
+    if (!field->valid || abs(dx) >= size || abs(dz) >= size) {
+        windField_fillRect(field, originX, originX + size, originZ, originZ + size);
+    } else {
+        // Columns that entered the window, then the rest of the rows that did
+        int keptX0 = dx > 0 ? originX : field->originX;
+        int keptX1 = dx > 0 ? field->originX + size : originX + size;
+        if (dx > 0) windField_fillRect(field, keptX1, originX + size, originZ, originZ + size);
+        if (dx < 0) windField_fillRect(field, originX, keptX0, originZ, originZ + size);
+        if (dz > 0) windField_fillRect(field, keptX0, keptX1, field->originZ + size, originZ + size);
+        if (dz < 0) windField_fillRect(field, keptX0, keptX1, originZ, field->originZ);
+    }
+    
+    field->originX = originX;
+    field->originZ = originZ;
+    field->valid = true;
+    
+    // The fluid does not move with the gusts: refresh a few rows of it round-robin
+    if (field->fluidSampler) {
+        int mask = size - 1;
+        for (int row = 0; row < WIND_FIELD_FLUID_ROWS && row < size; row++) {
+            int z = originZ + ((field->fluidRow - originZ) & mask);
+            for (int x = originX; x < originX + size; x++) {
+                windField_fillFluid(field, x, z, windField_cell(field, x, z));
+            }
+            field->fluidRow = (field->fluidRow + 1) & mask;
+            field->cellsUpdated += size;
+        }
+    }
+    
+    if (field->cellsUpdated > 0) field->dirty = true;
+    field->updateTime = windField_now() - start;
+}
+
+// Field state a sample needs, read once per call or batch
+static void windField_beginSampling(const WindField* field, WindSampler* sampler) {
+    int mask = field->size - 1;
+    sampler->cells = field->cells;
+    sampler->size = field->size;
+    sampler->mask = mask;
+    sampler->ringX = field->originX & mask;
+    sampler->ringZ = field->originZ & mask;
+    sampler->baseX = (float)(field->scroll[0] + (double)field->originX * field->cellSize);
+    sampler->baseZ = (float)(field->scroll[1] + (double)field->originZ * field->cellSize);
+    sampler->invCell = 1.0f / field->cellSize;
+    sampler->maxCoord = (float)(field->size - 1);
+    sampler->windX = field->windX;
+    sampler->windZ = field->windZ;
+}
+
+// Bilinear blend of the four cells around (x, z), clamped to the window, then combined:
+// mean wind scaled by the gust, pushed sideways by the crosswind, plus the fluid
+static inline void windField_sampleAt(const WindSampler* sampler, float x, float z, float* wind) {
+    float u = fminf(fmaxf((x - sampler->baseX) * sampler->invCell, 0.0f), sampler->maxCoord);
+    float v = fminf(fmaxf((z - sampler->baseZ) * sampler->invCell, 0.0f), sampler->maxCoord);
+    int x0 = (int)u;
+    int z0 = (int)v;
+    float tx = u - x0;
+    float tz = v - z0;
+    int x1 = x0 + 1 < sampler->size ? x0 + 1 : x0;
+    int z1 = z0 + 1 < sampler->size ? z0 + 1 : z0;
+    
+    int mask = sampler->mask;
+    size_t row0 = (size_t)((sampler->ringZ + z0) & mask) * sampler->size;
+    size_t row1 = (size_t)((sampler->ringZ + z1) & mask) * sampler->size;
+    int column0 = (sampler->ringX + x0) & mask;
+    int column1 = (sampler->ringX + x1) & mask;
+    const float* c00 = sampler->cells + (row0 + column0) * WIND_CHANNELS;
+    const float* c10 = sampler->cells + (row0 + column1) * WIND_CHANNELS;
+    const float* c01 = sampler->cells + (row1 + column0) * WIND_CHANNELS;
+    const float* c11 = sampler->cells + (row1 + column1) * WIND_CHANNELS;
+    
+    float w00 = (1.0f - tx) * (1.0f - tz);
+    float w10 = tx * (1.0f - tz);
+    float w01 = (1.0f - tx) * tz;
+    float w11 = tx * tz;
+    
+    // All four channels of a cell blend at once
+    float blend[WIND_CHANNELS];
+#if defined(WIND_FIELD_SSE)
+    __m128 bottom = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(c00), _mm_set1_ps(w00)), _mm_mul_ps(_mm_loadu_ps(c10), _mm_set1_ps(w10)));
+    __m128 top = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(c01), _mm_set1_ps(w01)), _mm_mul_ps(_mm_loadu_ps(c11), _mm_set1_ps(w11)));
+    _mm_storeu_ps(blend, _mm_add_ps(bottom, top));
+#elif defined(WIND_FIELD_NEON)
+    float32x4_t bottom = vaddq_f32(vmulq_n_f32(vld1q_f32(c00), w00), vmulq_n_f32(vld1q_f32(c10), w10));
+    float32x4_t top = vaddq_f32(vmulq_n_f32(vld1q_f32(c01), w01), vmulq_n_f32(vld1q_f32(c11), w11));
+    vst1q_f32(blend, vaddq_f32(bottom, top));
+#else
+    for (int c = 0; c < WIND_CHANNELS; c++) {
+        blend[c] = (c00[c] * w00 + c10[c] * w10) + (c01[c] * w01 + c11[c] * w11);
+    }
+#endif
+    
+    float gust = 1.0f + blend[WIND_GUST_ALONG];
+    float across = blend[WIND_GUST_ACROSS];
+    wind[0] = sampler->windX * gust - sampler->windZ * across + blend[WIND_FLUID_X];
+    wind[1] = sampler->windZ * gust + sampler->windX * across + blend[WIND_FLUID_Z];
+}
+
+// Wind at a world position (bilinear between cells, clamped to the window)
+void windField_sample(const WindField* field, float x, float z, float* windX, float* windZ) {
+    WindSampler sampler;
+    windField_beginSampling(field, &sampler);
+    float wind[2];
+    windField_sampleAt(&sampler, x, z, wind);
+    *windX = wind[0];
+    *windZ = wind[1];
+}
+
+// Sample a range of a batch
+static void windField_sampleRange(void* context, size_t begin, size_t end) {
+    WindSampleJob* job = (WindSampleJob*)context;
+    WindSampler sampler;
+    windField_beginSampling(job->field, &sampler);
+    
+    const float* position = job->positions + begin * job->stride;
+    for (size_t i = begin; i < end; i++, position += job->stride) {
+        windField_sampleAt(&sampler, position[0], position[2], &job->velocities[i * 2]);
+    }
+}
+
+// Wind at count positions (x, y, z, stride floats apart), written as (x, z) pairs to
+// velocities; large batches are split across the pool
+void windField_sampleBatch(const WindField* field, const float* positions, size_t stride, size_t count, float* velocities, ThreadPool* pool) {
+    TRACE_SCOPE("windField_sampleBatch");
+    WindSampleJob job = { field, positions, stride, velocities };
+    
+    if (pool && count >= WIND_FIELD_BATCH_GRAIN * 2) {
+        threadPool_parallelFor(pool, "Job: wind samples (ms)", windField_sampleRange, &job, count, WIND_FIELD_BATCH_GRAIN);
+    } else {
+        windField_sampleRange(&job, 0, count);
+    }
+}
+
+// Texture coordinates of the cells as uv = world.xz * transform[0] + transform[1..2], for a
+// GL_REPEAT texture of the ring-addressed cells
+void windField_getTextureTransform(const WindField* field, float* transform) {
+    // Wrap the scroll by the texture period so the offset keeps its precision
+    double period = (double)field->size * field->cellSize;
+    double scrollX = fmod(field->scroll[0], period);
+    double scrollZ = fmod(field->scroll[1], period);
+    
+    transform[0] = (float)(1.0 / period);
+    transform[1] = (float)(-scrollX / period + 0.5 / field->size);
+    transform[2] = (float)(-scrollZ / period + 0.5 / field->size);
+}
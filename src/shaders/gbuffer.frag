@@ -9,6 +9,7 @@ in vec2 TexCoords;
 in vec3 FragPos;
 in vec3 Normal;
 in mat3 TBN;
+flat in float FadeDistance;
 
 // Material properties
 uniform sampler2D texture_diffuse;
@@ -28,16 +29,46 @@ uniform float roughness = 0.5;
 uniform float metallic = 0.0;
 uniform float ao = 1.0;
 
+// Fade out over [fadeStart, fadeStart + fadeRange] as the impostor fades in (0 = never)
+uniform float fadeStart = 0.0;
+uniform float fadeRange = 1.0;
+
+// 4x4 ordered dither threshold for this pixel (same pattern as impostor.frag)
+float ditherThreshold()
+{
+    const float bayer[16] = float[16](0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0,
+                                      3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);
+    ivec2 p = ivec2(gl_FragCoord.xy) & 3;
+    return (bayer[p.y * 4 + p.x] + 0.5) / 16.0;
+}
+
+// Tangent-space normal from the red and green channels; z is rebuilt so two-channel (BC5)
+// normal maps decode the same as RGB ones
+vec3 decodeNormal(vec2 rg)
+{
+    vec3 n;
+    n.xy = rg * 2.0 - 1.0;
+    n.z = sqrt(max(0.0, 1.0 - dot(n.xy, n.xy)));
+    return n;
+}
+
 void main()
 {
+    // Dithered cross-fade to the impostor
+    if (fadeStart > 0.0) {
+        float meshWeight = 1.0 - clamp((FadeDistance - fadeStart) / fadeRange, 0.0, 1.0);
+        if (meshWeight < ditherThreshold()) {
+            discard;
+        }
+    }
+    
     // Store position in world space
     gPosition = vec4(FragPos, 1.0);
     
     // Get normal from normal map if available
     vec3 norm;
     if (hasNormalMap) {
-        norm = texture(texture_normal, TexCoords).rgb;
-        norm = normalize(norm * 2.0 - 1.0);
+        norm = decodeNormal(texture(texture_normal, TexCoords).rg);
         norm = normalize(TBN * norm);
     } else {
         norm = normalize(Normal);
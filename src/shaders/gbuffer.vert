@@ -9,10 +9,21 @@ out vec2 TexCoords;
 out vec3 FragPos;
 out vec3 Normal;
 out mat3 TBN;
+flat out float FadeDistance;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Per-frame camera data shared by all programs (ShaderFrameData)
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPosition;
+    vec4 frameTime;
+};
+
+// Per-object data, one slice of the object ring per draw
+layout (std140) uniform ObjectData {
+    mat4 model;
+};
 
 void main()
 {
@@ -26,5 +37,8 @@ void main()
     vec3 B = cross(N, T);
     TBN = mat3(T, B, N);
     
+    // Distance of the object origin, so the whole object fades as one
+    FadeDistance = distance(model[3].xyz, viewPosition.xyz);
+    
     gl_Position = projection * view * model * vec4(aPos, 1.0);
 } 
\ No newline at end of file
@@ -0,0 +1,33 @@
+#version 410 core
+
+layout (location = 0) out vec4 gPosition;
+layout (location = 1) out vec4 gNormal;
+layout (location = 2) out vec4 gAlbedo;
+layout (location = 3) out vec4 gMaterial; // R: roughness, G: metallic, B: AO
+
+in vec3 FragPos;
+in vec3 Normal;
+in float BladeHeight;
+flat in float Tint;
+
+// Root and tip colours, varied per blade
+uniform vec3 rootColor = vec3(0.10, 0.22, 0.05);
+uniform vec3 tipColor = vec3(0.45, 0.62, 0.20);
+
+void main()
+{
+    gPosition = vec4(FragPos, 1.0);
+    
+    // Both sides are drawn; the back face reuses the mirrored normal
+    vec3 norm = normalize(Normal);
+    if (!gl_FrontFacing) {
+        norm.xz = -norm.xz;
+    }
+    gNormal = vec4(norm, 1.0);
+    
+    vec3 color = mix(rootColor, tipColor, BladeHeight) * (0.85 + 0.3 * Tint);
+    gAlbedo = vec4(color, 1.0);
+    
+    // Darker towards the root, where blades shade each other
+    gMaterial = vec4(0.8, 0.0, mix(0.4, 1.0, BladeHeight), 1.0);
+}
@@ -0,0 +1,64 @@
+#version 410 core
+
+layout (location = 0) in vec2 aBlade;       // x: side (-1..1), y: height along the blade (0..1)
+layout (location = 1) in vec3 aRoot;        // World space
+layout (location = 2) in vec4 aBladeParams; // x: density threshold, y: yaw, z: height, w: sway phase (all 0..1)
+
+out vec3 FragPos;
+out vec3 Normal;
+out float BladeHeight;
+flat out float Tint;
+
+// Per-frame camera data shared by all programs (ShaderFrameData)
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPosition;
+    vec4 frameTime;
+};
+
+// x: full density distance, y: cull distance, z: budget scale, w: fade band
+uniform vec4 density;
+// Blade width and height at full size
+uniform vec2 bladeSize;
+// Wind field cells (xy: gust along and across the mean wind, zw: coupled fluid velocity),
+// at uv = world.xz * windTransform.x + windTransform.yz
+uniform sampler2D windTexture;
+uniform vec3 windTransform;
+uniform vec2 meanWind;
+
+void main()
+{
+    // Same falloff as grass_density; a blade past its threshold shrinks to a point, so
+    // thinning never pops
+    float dist = distance(aRoot, viewPosition.xyz);
+    float t = clamp((dist - density.x) / (density.y - density.x), 0.0, 1.0);
+    float keep = (1.0 - t) * (1.0 - t) * density.z;
+    float grow = clamp((keep - aBladeParams.x) / density.w, 0.0, 1.0);
+    
+    float yaw = aBladeParams.y * 6.2831853;
+    vec3 side = vec3(cos(yaw), 0.0, sin(yaw));
+    float height = bladeSize.y * (0.6 + 0.8 * aBladeParams.z) * grow;
+    
+    // Local wind, combined as in windField_sample and capped so blades never fold flat
+    vec4 cell = texture(windTexture, aRoot.xz * windTransform.x + windTransform.yz);
+    vec2 wind = meanWind * (1.0 + cell.x) + vec2(-meanWind.y, meanWind.x) * cell.y + cell.zw;
+    wind *= min(1.0, 1.5 / max(length(wind), 0.0001));
+    
+    // Sway bends the blade with height squared so the root stays planted; the flutter
+    // rides on top of the field's slower gusts
+    float flutter = sin(frameTime.x * 1.7 + aBladeParams.w * 6.2831853 + dot(aRoot.xz, vec2(0.11, 0.07)));
+    float bend = (0.6 + 0.4 * flutter) * aBlade.y * aBlade.y;
+    vec3 sway = vec3(wind.x, 0.0, wind.y) * bend * height;
+    
+    vec3 position = aRoot + side * (aBlade.x * bladeSize.x * 0.5 * grow) + vec3(0.0, aBlade.y * height, 0.0) + sway;
+    
+    // Face normal tilted up, so blades light like the ground they cover
+    Normal = normalize(vec3(-side.z, 0.0, side.x) + vec3(0.0, 1.5, 0.0));
+    FragPos = position;
+    BladeHeight = aBlade.y;
+    Tint = aBladeParams.z;
+    
+    gl_Position = viewProjection * vec4(position, 1.0);
+}
@@ -0,0 +1,66 @@
+#version 410 core
+
+layout (location = 0) out vec4 gPosition;
+layout (location = 1) out vec4 gNormal;
+layout (location = 2) out vec4 gAlbedo;
+layout (location = 3) out vec4 gMaterial; // R: roughness, G: metallic, B: AO
+
+in vec2 AtlasCoords;
+in vec3 QuadPos;
+flat in vec3 DepthAxis;
+flat in mat3 NormalMatrix;
+flat in float FadeDistance;
+
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPosition;
+    vec4 frameTime;
+};
+
+uniform sampler2D albedoAtlas;
+uniform sampler2D normalDepthAtlas;
+
+// Fade in over [fadeStart, fadeStart + fadeRange], complementing the mesh's fade out
+uniform float fadeStart;
+uniform float fadeRange;
+
+// Material scalars of the baked mesh
+uniform float roughness = 0.5;
+uniform float metallic = 0.0;
+uniform float ao = 1.0;
+
+// 4x4 ordered dither threshold for this pixel (same pattern as gbuffer.frag)
+float ditherThreshold()
+{
+    const float bayer[16] = float[16](0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0,
+                                      3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);
+    ivec2 p = ivec2(gl_FragCoord.xy) & 3;
+    return (bayer[p.y * 4 + p.x] + 0.5) / 16.0;
+}
+
+void main()
+{
+    // Pixels the mesh still covers during the cross-fade
+    float meshWeight = 1.0 - clamp((FadeDistance - fadeStart) / fadeRange, 0.0, 1.0);
+    if (meshWeight >= ditherThreshold()) {
+        discard;
+    }
+    
+    vec4 albedo = texture(albedoAtlas, AtlasCoords);
+    if (albedo.a < 0.5) {
+        discard;
+    }
+    vec4 normalDepth = texture(normalDepthAtlas, AtlasCoords);
+    
+    // Push the quad back to the baked surface so lighting and SSAO see real depth
+    vec3 worldPos = QuadPos + DepthAxis * (0.5 - normalDepth.a);
+    vec4 clipPos = viewProjection * vec4(worldPos, 1.0);
+    gl_FragDepth = clipPos.z / clipPos.w * 0.5 + 0.5;
+    
+    gPosition = vec4(worldPos, 1.0);
+    gNormal = vec4(normalize(NormalMatrix * (normalDepth.rgb * 2.0 - 1.0)), 1.0);
+    gAlbedo = vec4(albedo.rgb, 1.0);
+    gMaterial = vec4(roughness, metallic, ao, 1.0);
+}
@@ -0,0 +1,74 @@
+#version 410 core
+
+layout (location = 0) in vec2 aCorner;
+layout (location = 4) in mat4 aInstanceMatrix;
+
+out vec2 AtlasCoords;
+out vec3 QuadPos;
+flat out vec3 DepthAxis;
+flat out mat3 NormalMatrix;
+flat out float FadeDistance;
+
+// Per-frame camera data shared by all programs (ShaderFrameData)
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPosition;
+    vec4 frameTime;
+};
+
+// Object-space bounding sphere (xyz: center, w: radius) the atlas was baked around
+uniform vec4 boundingSphere;
+uniform int frames;
+
+// Octahedral mapping of the unit sphere onto [0, 1]^2, y up (shared with impostor_bake.vert)
+vec2 signNotZero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 octahedralEncode(vec3 n)
+{
+    vec2 p = n.xz / (abs(n.x) + abs(n.y) + abs(n.z));
+    if (n.y < 0.0) {
+        p = (1.0 - abs(p.yx)) * signNotZero(p);
+    }
+    return p * 0.5 + 0.5;
+}
+
+vec3 octahedralDecode(vec2 uv)
+{
+    vec2 p = uv * 2.0 - 1.0;
+    vec3 n = vec3(p.x, 1.0 - abs(p.x) - abs(p.y), p.y);
+    if (n.y < 0.0) {
+        n.xz = (1.0 - abs(n.zx)) * signNotZero(n.xz);
+    }
+    return normalize(n);
+}
+
+void main()
+{
+    mat4 model = aInstanceMatrix;
+    vec3 worldCenter = vec3(model * vec4(boundingSphere.xyz, 1.0));
+    
+    // Nearest baked frame to the object-space view direction
+    vec3 toCamera = normalize(inverse(mat3(model)) * (viewPosition.xyz - worldCenter));
+    vec2 cell = clamp(floor(octahedralEncode(toCamera) * float(frames)), vec2(0.0), vec2(float(frames - 1)));
+    
+    // Same basis the frame was baked with
+    vec3 forward = octahedralDecode((cell + 0.5) / float(frames));
+    vec3 up = abs(forward.y) > 0.99 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    vec3 right = normalize(cross(up, forward));
+    up = cross(forward, right);
+    
+    float radius = boundingSphere.w;
+    vec3 local = boundingSphere.xyz + (right * aCorner.x + up * aCorner.y) * radius;
+    QuadPos = vec3(model * vec4(local, 1.0));
+    DepthAxis = mat3(model) * forward * (2.0 * radius);
+    NormalMatrix = transpose(inverse(mat3(model)));
+    AtlasCoords = (cell + aCorner * 0.5 + 0.5) / float(frames);
+    FadeDistance = distance(model[3].xyz, viewPosition.xyz);
+    
+    gl_Position = viewProjection * vec4(QuadPos, 1.0);
+}
@@ -0,0 +1,20 @@
+#version 410 core
+
+layout (location = 0) out vec4 bakedAlbedo;       // RGB: albedo, A: coverage
+layout (location = 1) out vec4 bakedNormalDepth;  // RGB: object-space normal, A: depth through the sphere
+
+in vec2 TexCoords;
+in vec3 Normal;
+
+uniform sampler2D texture_diffuse;
+
+void main()
+{
+    vec4 albedo = texture(texture_diffuse, TexCoords);
+    if (albedo.a < 0.5) {
+        discard;
+    }
+    
+    bakedAlbedo = vec4(albedo.rgb, 1.0);
+    bakedNormalDepth = vec4(normalize(Normal) * 0.5 + 0.5, gl_FragCoord.z);
+}
@@ -0,0 +1,46 @@
+#version 410 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+out vec3 Normal;
+
+// Object-space bounding sphere (xyz: center, w: radius) and the frame being rendered
+uniform vec4 boundingSphere;
+uniform vec2 frame;
+uniform int frames;
+
+// Octahedral mapping of the unit sphere onto [0, 1]^2, y up (shared with impostor.vert)
+vec2 signNotZero(vec2 v)
+{
+    return vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec3 octahedralDecode(vec2 uv)
+{
+    vec2 p = uv * 2.0 - 1.0;
+    vec3 n = vec3(p.x, 1.0 - abs(p.x) - abs(p.y), p.y);
+    if (n.y < 0.0) {
+        n.xz = (1.0 - abs(n.zx)) * signNotZero(n.xz);
+    }
+    return normalize(n);
+}
+
+void main()
+{
+    // Orthographic view from the frame's direction, framing the bounding sphere
+    vec3 forward = octahedralDecode((frame + 0.5) / float(frames));
+    vec3 up = abs(forward.y) > 0.99 ? vec3(0.0, 0.0, 1.0) : vec3(0.0, 1.0, 0.0);
+    vec3 right = normalize(cross(up, forward));
+    up = cross(forward, right);
+    
+    vec3 local = aPos - boundingSphere.xyz;
+    float radius = boundingSphere.w;
+    float depth = (radius - dot(local, forward)) / (2.0 * radius);
+    gl_Position = vec4(dot(local, right) / radius, dot(local, up) / radius, depth * 2.0 - 1.0, 1.0);
+    
+    TexCoords = aTexCoords;
+    Normal = aNormal;
+}
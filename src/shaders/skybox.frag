@@ -0,0 +1,91 @@
+#version 410 core
+
+layout (location = 0) out vec4 gPosition;
+layout (location = 1) out vec4 gNormal;
+layout (location = 2) out vec4 gAlbedo;
+layout (location = 3) out vec4 gMaterial; // R: roughness, G: metallic, B: AO, A: 0 for sky
+
+in vec3 ViewRay;
+
+const float PI = 3.14159265359;
+
+// Precomputed on the CPU (see atmosphere.c, whose parameterisations these invert)
+uniform sampler2D transmittanceLut;
+uniform sampler2D skyViewLut;
+
+uniform vec3 sunDirection;
+uniform vec4 atmosphere;    // Bottom radius, top radius, viewer radius (km), sun illuminance
+uniform float sunCosRadius;
+
+// LUT texels store their values at the ends of [0, 1], not half a texel in
+vec2 lutUv(vec2 uv, vec2 size)
+{
+    return (uv * (size - 1.0) + 0.5) / size;
+}
+
+// Transmittance to the top of the atmosphere from radius r towards zenith cosine mu
+vec3 transmittance(float r, float mu)
+{
+    float bottom = atmosphere.x;
+    float top = atmosphere.y;
+    float horizon = sqrt(top * top - bottom * bottom);
+    float rho = sqrt(max(r * r - bottom * bottom, 0.0));
+    float discriminant = r * r * (mu * mu - 1.0) + top * top;
+    float distance = max(0.0, -r * mu + sqrt(max(discriminant, 0.0)));
+    float minDistance = top - r;
+    float maxDistance = rho + horizon;
+    vec2 uv = vec2((distance - minDistance) / (maxDistance - minDistance), rho / horizon);
+    return texture(transmittanceLut, lutUv(uv, vec2(textureSize(transmittanceLut, 0)))).rgb;
+}
+
+// Sky luminance along a direction: rows are view zenith (squeezed towards the horizon),
+// columns the azimuth from the sun
+vec3 skyView(vec3 direction)
+{
+    float r = atmosphere.z;
+    float bottom = atmosphere.x;
+    float horizonDistance = sqrt(max(r * r - bottom * bottom, 0.0));
+    float beta = acos(horizonDistance / r);
+    float zenithHorizon = PI - beta;
+    float viewZenith = acos(clamp(direction.y, -1.0, 1.0));
+    
+    float v;
+    if (viewZenith < zenithHorizon) {
+        float coord = 1.0 - sqrt(max(1.0 - viewZenith / zenithHorizon, 0.0));
+        v = coord * 0.5;
+    } else {
+        float coord = sqrt(max((viewZenith - zenithHorizon) / beta, 0.0));
+        v = coord * 0.5 + 0.5;
+    }
+    
+    // The LUT was built with the sun in the +x/y plane; only the angle between the two
+    // horizontal directions matters
+    vec2 view = direction.xz;
+    vec2 sun = sunDirection.xz;
+    float cosAzimuth = 0.0;
+    if (dot(view, view) > 1e-8 && dot(sun, sun) > 1e-8) {
+        cosAzimuth = dot(normalize(view), normalize(sun));
+    }
+    float u = sqrt(max(0.5 - 0.5 * cosAzimuth, 0.0));
+    
+    return texture(skyViewLut, lutUv(vec2(u, v), vec2(textureSize(skyViewLut, 0)))).rgb;
+}
+
+void main()
+{
+    vec3 direction = normalize(ViewRay);
+    vec3 color = skyView(direction);
+    
+    // Sun disk, dimmed by the air it shines through, above the planet's horizon
+    float r = atmosphere.z;
+    float horizonCos = -sqrt(max(r * r - atmosphere.x * atmosphere.x, 0.0)) / r;
+    if (dot(direction, sunDirection) > sunCosRadius && direction.y > horizonCos) {
+        color += transmittance(r, sunDirection.y) / (2.0 * PI * (1.0 - sunCosRadius));
+    }
+    
+    // Already lit: material alpha 0 tells the lighting pass to pass the albedo through
+    gPosition = vec4(direction, 0.0);
+    gNormal = vec4(0.0);
+    gAlbedo = vec4(color * atmosphere.w, 1.0);
+    gMaterial = vec4(1.0, 0.0, 1.0, 0.0);
+}
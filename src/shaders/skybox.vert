@@ -0,0 +1,24 @@
+#version 410 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 aTexCoords;
+
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPosition;
+    vec4 frameTime;
+};
+
+out vec3 ViewRay;
+
+void main()
+{
+    // World-space ray through this corner: unproject, then undo the camera rotation
+    vec4 viewSpace = inverse(projection) * vec4(aPos.xy, 1.0, 1.0);
+    ViewRay = transpose(mat3(view)) * (viewSpace.xyz / viewSpace.w);
+    
+    // At the far plane, so only pixels the geometry left empty pass the depth test
+    gl_Position = vec4(aPos.xy, 1.0, 1.0);
+}
@@ -0,0 +1,77 @@
+#version 410 core
+
+in vec2 TexCoords;
+
+// R: occlusion, G: linear view depth (used by the temporal and upsample passes)
+out vec2 FragColor;
+
+// G-buffer (world space)
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+uniform sampler2D noiseTexture;
+
+// Hemisphere kernel; each frame uses samples[sampleOffset .. sampleOffset + sampleCount)
+uniform vec3 samples[64];
+uniform int sampleOffset;
+uniform int sampleCount;
+
+// Per-frame rotation of the noise vectors so consecutive subsets decorrelate
+uniform float noiseRotation;
+uniform vec2 noiseScale;
+
+// Active render region of the G-buffer
+uniform vec2 uvScale;
+
+// Per-frame camera data shared by all programs (ShaderFrameData)
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPosition;
+    vec4 frameTime;
+};
+
+uniform float radius = 0.5;
+uniform float bias = 0.025;
+
+void main()
+{
+    vec2 uv = TexCoords * uvScale;
+    vec4 worldPos = texture(gPosition, uv);
+    
+    // Sky: nothing to occlude
+    if (worldPos.w == 0.0) {
+        FragColor = vec2(1.0, 0.0);
+        return;
+    }
+    
+    vec3 fragPos = (view * vec4(worldPos.xyz, 1.0)).xyz;
+    vec3 normal = normalize(mat3(view) * texture(gNormal, uv).xyz);
+    
+    // Rotated random vector for the TBN basis
+    vec2 noise = texture(noiseTexture, TexCoords * noiseScale).xy;
+    float c = cos(noiseRotation);
+    float s = sin(noiseRotation);
+    vec3 randomVec = vec3(c * noise.x - s * noise.y, s * noise.x + c * noise.y, 0.0);
+    
+    vec3 tangent = normalize(randomVec - normal * dot(randomVec, normal));
+    vec3 bitangent = cross(normal, tangent);
+    mat3 TBN = mat3(tangent, bitangent, normal);
+    
+    float occlusion = 0.0;
+    for (int i = 0; i < sampleCount; i++) {
+        vec3 samplePos = fragPos + TBN * samples[sampleOffset + i] * radius;
+        
+        // Project sample to screen space
+        vec4 offset = projection * vec4(samplePos, 1.0);
+        offset.xy = (offset.xy / offset.w) * 0.5 + 0.5;
+        
+        vec3 occluderWorld = texture(gPosition, offset.xy * uvScale).xyz;
+        float sampleDepth = (view * vec4(occluderWorld, 1.0)).z;
+        
+        float rangeCheck = smoothstep(0.0, 1.0, radius / abs(fragPos.z - sampleDepth));
+        occlusion += (sampleDepth >= samplePos.z + bias ? 1.0 : 0.0) * rangeCheck;
+    }
+    
+    FragColor = vec2(1.0 - occlusion / float(sampleCount), -fragPos.z);
+}
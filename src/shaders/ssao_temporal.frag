@@ -0,0 +1,50 @@
+#version 410 core
+
+in vec2 TexCoords;
+
+// R: accumulated occlusion, G: linear view depth
+out vec2 FragColor;
+
+uniform sampler2D currentAO;
+uniform sampler2D historyAO;
+uniform sampler2D gPosition;
+
+uniform mat4 prevViewProjection;
+uniform bool historyValid;
+
+// Weight of the current frame (1 / number of kernel subsets)
+uniform float blendFactor;
+
+uniform vec2 uvScale;
+
+// Render region of the previous frame; the dynamic resolution may have changed since
+uniform vec2 historyUvScale;
+
+void main()
+{
+    vec2 uv = TexCoords * uvScale;
+    vec2 current = texture(currentAO, uv).rg;
+    vec4 worldPos = texture(gPosition, uv);
+    
+    if (!historyValid || worldPos.w == 0.0) {
+        FragColor = current;
+        return;
+    }
+    
+    // Reproject into last frame
+    vec4 prevClip = prevViewProjection * vec4(worldPos.xyz, 1.0);
+    vec2 prevUV = (prevClip.xy / prevClip.w) * 0.5 + 0.5;
+    
+    if (prevClip.w <= 0.0 || any(lessThan(prevUV, vec2(0.0))) || any(greaterThan(prevUV, vec2(1.0)))) {
+        FragColor = current;
+        return;
+    }
+    
+    vec2 history = texture(historyAO, prevUV * historyUvScale).rg;
+    
+    // Reject history from a different surface (disocclusion): clip w is last frame's view depth
+    float depthError = abs(history.g - prevClip.w) / max(prevClip.w, 1e-3);
+    float weight = depthError < 0.05 ? blendFactor : 1.0;
+    
+    FragColor = vec2(mix(history.r, current.r, weight), current.g);
+}
@@ -0,0 +1,70 @@
+#version 410 core
+
+in vec2 TexCoords;
+
+out float FragColor;
+
+// Reduced-resolution occlusion (R) and linear depth (G)
+uniform sampler2D aoTexture;
+uniform vec2 aoTexelSize;
+
+// Full-resolution G-buffer
+uniform sampler2D gPosition;
+uniform sampler2D gNormal;
+
+uniform vec2 uvScale;
+
+// Per-frame camera data shared by all programs (ShaderFrameData)
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPosition;
+    vec4 frameTime;
+};
+
+uniform float depthSharpness = 20.0;
+uniform float normalSharpness = 16.0;
+
+void main()
+{
+    vec2 uv = TexCoords * uvScale;
+    vec4 worldPos = texture(gPosition, uv);
+    
+    if (worldPos.w == 0.0) {
+        FragColor = 1.0;
+        return;
+    }
+    
+    float depth = -(view * vec4(worldPos.xyz, 1.0)).z;
+    vec3 normal = normalize(texture(gNormal, uv).xyz);
+    
+    // 3x3 low-resolution neighbourhood around the nearest coarse texel; this
+    // doubles as the denoising blur the old separate pass used to do
+    vec2 coarse = (floor(uv / aoTexelSize) + 0.5) * aoTexelSize;
+    vec2 maxUV = uvScale - aoTexelSize * 0.5;
+    
+    float sum = 0.0;
+    float weightSum = 0.0;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            vec2 sampleUV = clamp(coarse + vec2(x, y) * aoTexelSize, aoTexelSize * 0.5, maxUV);
+            vec2 ao = texture(aoTexture, sampleUV).rg;
+            
+            // Spatial falloff from the full-resolution pixel
+            vec2 d = (sampleUV - uv) / aoTexelSize;
+            float spatial = exp(-dot(d, d) * 0.5);
+            
+            // Reject samples from other surfaces
+            float depthWeight = exp(-abs(ao.g - depth) / max(depth, 1e-3) * depthSharpness);
+            vec3 sampleNormal = normalize(texture(gNormal, sampleUV).xyz);
+            float normalWeight = pow(max(dot(normal, sampleNormal), 0.0), normalSharpness);
+            
+            float w = spatial * depthWeight * normalWeight + 1e-4;
+            sum += ao.r * w;
+            weightSum += w;
+        }
+    }
+    
+    FragColor = sum / weightSum;
+}
@@ -40,6 +40,16 @@ uniform float meadowMaxSlope = 0.2;
 uniform float forestMaxHeight = 0.7;
 uniform float forestMaxSlope = 0.5;
 
+// Tangent-space normal from the red and green channels; z is rebuilt so two-channel (BC5)
+// normal maps decode the same as RGB ones
+vec3 decodeNormal(vec2 rg)
+{
+    vec3 n;
+    n.xy = rg * 2.0 - 1.0;
+    n.z = sqrt(max(0.0, 1.0 - dot(n.xy, n.xy)));
+    return n;
+}
+
 void main()
 {
     // Store position
@@ -75,14 +85,9 @@ void main()
     vec4 diffuseColor = meadowColor * meadowWeight + forestColor * forestWeight + rockyColor * rockyWeight;
     
     // Sample normal maps
-    vec3 meadowNormalMap = texture(meadowNormal, meadowUV).rgb;
-    vec3 forestNormalMap = texture(forestNormal, forestUV).rgb;
-    vec3 rockyNormalMap = texture(rockyNormal, rockyUV).rgb;
-    
-    // Convert normal maps from [0,1] to [-1,1] range
-    meadowNormalMap = normalize(meadowNormalMap * 2.0 - 1.0);
-    forestNormalMap = normalize(forestNormalMap * 2.0 - 1.0);
-    rockyNormalMap = normalize(rockyNormalMap * 2.0 - 1.0);
+    vec3 meadowNormalMap = decodeNormal(texture(meadowNormal, meadowUV).rg);
+    vec3 forestNormalMap = decodeNormal(texture(forestNormal, forestUV).rg);
+    vec3 rockyNormalMap = decodeNormal(texture(rockyNormal, rockyUV).rg);
     
     // Blend normal maps (this is simplified and not physically correct)
     vec3 normalMap = meadowNormalMap * meadowWeight + forestNormalMap * forestWeight + rockyNormalMap * rockyWeight;
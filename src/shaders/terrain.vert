@@ -13,10 +13,17 @@ out float Height;
 out float Slope;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
 uniform float terrainHeight;
 
+// Per-frame camera data shared by all programs (ShaderFrameData)
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPosition;
+    vec4 frameTime;
+};
+
 void main()
 {
     // Pass height and slope data to fragment shader
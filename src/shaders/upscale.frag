@@ -0,0 +1,47 @@
+#version 410 core
+
+in vec2 TexCoords;
+
+out vec4 FragColor;
+
+// Post-processed scene at render resolution
+uniform sampler2D sceneTexture;
+
+// Active render region of the scene texture and its texel size
+uniform vec2 uvScale;
+uniform vec2 texelSize;
+
+// 0 = plain bilinear, 1 = maximum sharpening
+uniform float sharpness;
+
+// Sample inside the render region only, never bleeding into stale texels
+vec3 sampleScene(vec2 uv) {
+    uv = clamp(uv, texelSize * 0.5, uvScale - texelSize * 0.5);
+    return texture(sceneTexture, uv).rgb;
+}
+
+void main()
+{
+    vec2 uv = TexCoords * uvScale;
+    vec3 center = sampleScene(uv);
+    
+    if (sharpness <= 0.0) {
+        FragColor = vec4(center, 1.0);
+        return;
+    }
+    
+    // Cross neighbourhood in source texels
+    vec3 north = sampleScene(uv + vec2(0.0, texelSize.y));
+    vec3 south = sampleScene(uv - vec2(0.0, texelSize.y));
+    vec3 east = sampleScene(uv + vec2(texelSize.x, 0.0));
+    vec3 west = sampleScene(uv - vec2(texelSize.x, 0.0));
+    
+    // Contrast-adaptive sharpening: sharpen less where local contrast is already high
+    vec3 minColor = min(center, min(min(north, south), min(east, west)));
+    vec3 maxColor = max(center, max(max(north, south), max(east, west)));
+    vec3 amount = sqrt(clamp(min(minColor, 1.0 - maxColor) / max(maxColor, 1e-4), 0.0, 1.0));
+    vec3 weight = -amount * mix(0.125, 0.2, sharpness);
+    
+    vec3 color = (center + (north + south + east + west) * weight) / (1.0 + 4.0 * weight);
+    FragColor = vec4(clamp(color, 0.0, 1.0), 1.0);
+}
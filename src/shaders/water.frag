@@ -47,6 +47,16 @@ float linearizeDepth(float depth) {
     return (2.0 * nearPlane * farPlane) / (farPlane + nearPlane - z * (farPlane - nearPlane));
 }
 
+// Tangent-space normal from the red and green channels; z is rebuilt so two-channel (BC5)
+// normal maps decode the same as RGB ones
+vec3 decodeNormal(vec2 rg)
+{
+    vec3 n;
+    n.xy = rg * 2.0 - 1.0;
+    n.z = sqrt(max(0.0, 1.0 - dot(n.xy, n.xy)));
+    return n;
+}
+
 void main()
 {
     // Normalize vectors
@@ -71,9 +81,8 @@ void main()
     refractionTexCoords = clamp(refractionTexCoords, 0.001, 0.999);
     
     // Sample normal map
-    vec4 normalMapColor = texture(normalMap, distortedTexCoords);
-    vec3 waterNormal = vec3(normalMapColor.r * 2.0 - 1.0, normalMapColor.b * 1.0, normalMapColor.g * 2.0 - 1.0);
-    waterNormal = normalize(waterNormal);
+    vec3 mapNormal = decodeNormal(texture(normalMap, distortedTexCoords).rg);
+    vec3 waterNormal = normalize(mapNormal.xzy);
     
     // Calculate Fresnel effect
     float refractiveFactor = dot(viewVector, waterNormal);
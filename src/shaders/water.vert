@@ -12,8 +12,15 @@ out vec3 ToCameraVector;
 out vec2 DistortedTexCoords;
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+
+// Per-frame camera data shared by all programs (ShaderFrameData)
+layout (std140) uniform FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 viewProjection;
+    vec4 viewPosition;
+    vec4 frameTime;
+};
 uniform vec3 cameraPosition;
 
 // Water properties
@@ -0,0 +1,439 @@
+#include "utils/benchmark.h"
+#include "utils/headless.h"
+#include <errno.h>
+#include <sys/stat.h>
+
+// Defaults for a run (frames at a fixed 60 Hz simulation step)
+#define BENCHMARK_DEFAULT_FRAMES 600
+#define BENCHMARK_DEFAULT_WARMUP 30
+#define BENCHMARK_TIME_STEP (1.0f / 60.0f)
+#define BENCHMARK_DEFAULT_TIME_OF_DAY 0.35f
+
+// Camera path keyframe (closed loop, Catmull-Rom through positions, angles eased per segment)
+typedef struct {
+    vec3 position;
+    float yaw;
+    float pitch;
+} BenchmarkKeyframe;
+
+// Village, forest edge, lake shore, ruins overlook, hilltop, and back; yaw is unwrapped so the loop turns one way
+static const BenchmarkKeyframe cameraPath[] = {
+    { {   0.0f, 15.0f,   0.0f }, -90.0f,  -5.0f },
+    { {  40.0f, 18.0f, -60.0f }, -60.0f,  -8.0f },
+    { {  90.0f, 25.0f, -20.0f },   0.0f, -12.0f },
+    { {  60.0f, 12.0f,  50.0f },  90.0f,  -4.0f },
+    { { -20.0f, 30.0f,  70.0f }, 150.0f, -20.0f },
+    { { -70.0f, 16.0f,  10.0f }, 210.0f,  -6.0f }
+};
+#define BENCHMARK_KEYFRAMES (int)(sizeof(cameraPath) / sizeof(cameraPath[0]))
+
+// One recorded frame
+typedef struct {
+    float cpuTime;
+    float gpuTime;
+    double drawCalls;
+    double triangles;
+    bool captured;
+} BenchmarkSample;
+
+// Parse "--headless" and its options; returns false for a normal windowed run
+bool benchmark_parseArgs(int argc, char** argv, BenchmarkConfig* config) {
+    memset(config, 0, sizeof(BenchmarkConfig));
+    config->width = WINDOW_WIDTH;
+    config->height = WINDOW_HEIGHT;
+    config->frames = BENCHMARK_DEFAULT_FRAMES;
+    config->warmupFrames = BENCHMARK_DEFAULT_WARMUP;
+    config->timeOfDay = BENCHMARK_DEFAULT_TIME_OF_DAY;
+    config->csvPath = "benchmark.csv";
+    config->captureDir = "benchmark_frames";
+    
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : NULL;
+        
+        if (strcmp(arg, "--headless") == 0) {
+            config->enabled = true;
+        } else if (strcmp(arg, "--dynamic-res") == 0) {
+            config->dynamicResolution = true;
+        } else if (value && strcmp(arg, "--frames") == 0) {
+            config->frames = atoi(value);
+            i++;
+        } else if (value && strcmp(arg, "--warmup") == 0) {
+            config->warmupFrames = atoi(value);
+            i++;
+        } else if (value && strcmp(arg, "--size") == 0) {
+            if (sscanf(value, "%dx%d", &config->width, &config->height) != 2) {
+                fprintf(stderr, "Ignoring bad --size %s (expected WxH)\n", value);
+                config->width = WINDOW_WIDTH;
+                config->height = WINDOW_HEIGHT;
+            }
+            i++;
+        } else if (value && strcmp(arg, "--time") == 0) {
+            config->timeOfDay = (float)atof(value);
+            i++;
+        } else if (value && strcmp(arg, "--csv") == 0) {
+            config->csvPath = value;
+            i++;
+        } else if (value && strcmp(arg, "--capture-dir") == 0) {
+            config->captureDir = value;
+            i++;
+        } else if (value && strcmp(arg, "--capture") == 0) {
+            // Comma-separated recorded frame numbers
+            const char* p = value;
+            while (*p && config->captureCount < BENCHMARK_MAX_CAPTURES) {
+                char* end;
+                long frame = strtol(p, &end, 10);
+                if (end == p) break;
+                config->captureFrames[config->captureCount++] = (int)frame;
+                p = *end == ',' ? end + 1 : end;
+            }
+            i++;
+        } else if (config->enabled) {
+            fprintf(stderr, "Ignoring unknown benchmark option %s\n", arg);
+        }
+    }
+    
+    if (config->frames < 1) config->frames = 1;
+    if (config->warmupFrames < 0) config->warmupFrames = 0;
+    if (config->width < 16) config->width = 16;
+    if (config->height < 16) config->height = 16;
+    return config->enabled;
+}
+
+// Place the camera at path parameter t in [0, 1)
+static void benchmark_setCamera(Camera* camera, float t) {
+    float position = t * BENCHMARK_KEYFRAMES;
+    int segment = (int)position % BENCHMARK_KEYFRAMES;
+    float u = position - floorf(position);
+    
+    const BenchmarkKeyframe* p0 = &cameraPath[(segment + BENCHMARK_KEYFRAMES - 1) % BENCHMARK_KEYFRAMES];
+    const BenchmarkKeyframe* p1 = &cameraPath[segment];
+    const BenchmarkKeyframe* p2 = &cameraPath[(segment + 1) % BENCHMARK_KEYFRAMES];
+    const BenchmarkKeyframe* p3 = &cameraPath[(segment + 2) % BENCHMARK_KEYFRAMES];
+    
+    float u2 = u * u;
+    float u3 = u2 * u;
+    for (int axis = 0; axis < 3; axis++) {
+        camera->position[axis] = 0.5f * (2.0f * p1->position[axis] +
+                                         (p2->position[axis] - p0->position[axis]) * u +
+                                         (2.0f * p0->position[axis] - 5.0f * p1->position[axis] + 4.0f * p2->position[axis] - p3->position[axis]) * u2 +
+                                         (3.0f * p1->position[axis] - p0->position[axis] - 3.0f * p2->position[axis] + p3->position[axis]) * u3);
+    }
+    
+    // The last segment closes the loop, a full turn past the first keyframe
+    float nextYaw = p2->yaw + (segment + 1 == BENCHMARK_KEYFRAMES ? 360.0f : 0.0f);
+    float ease = u2 * (3.0f - 2.0f * u);
+    camera->yaw = p1->yaw + (nextYaw - p1->yaw) * ease;
+    camera->pitch = p1->pitch + (p2->pitch - p1->pitch) * ease;
+    
+    camera_updateVectors(camera);
+    camera_updateViewMatrix(camera);
+}
+
+// Last published value of a profiler counter
+static double benchmark_counter(const char* name) {
+    int count = 0;
+    const ProfileCounter* counters = profiler_getCounters(&count);
+    for (int i = 0; i < count; i++) {
+        if (strcmp(counters[i].name, name) == 0) return counters[i].value;
+    }
+    return 0.0;
+}
+
+// Create a directory and its parents (existing directories are fine)
+static bool benchmark_makeDir(const char* dir) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s", dir);
+    
+    for (char* p = path + 1; ; p++) {
+        if (*p != '/' && *p != '\0') continue;
+        
+        char saved = *p;
+        *p = '\0';
+        if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "Failed to create capture directory: %s\n", path);
+            return false;
+        }
+        *p = saved;
+        if (saved == '\0') break;
+    }
+    return true;
+}
+
+// CRC-32 (PNG chunks) and Adler-32 (zlib stream)
+static uint32_t benchmark_crc32(uint32_t crc, const unsigned char* data, size_t size) {
+    static uint32_t table[256];
+    if (!table[1]) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+    }
+    
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void benchmark_putBE32(unsigned char* out, uint32_t value) {
+    out[0] = (unsigned char)(value >> 24);
+    out[1] = (unsigned char)(value >> 16);
+    out[2] = (unsigned char)(value >> 8);
+    out[3] = (unsigned char)value;
+}
+
+// Write one PNG chunk
+static bool benchmark_writeChunk(FILE* file, const char* type, const unsigned char* data, size_t size) {
+    unsigned char header[8];
+    benchmark_putBE32(header, (uint32_t)size);
+    memcpy(header + 4, type, 4);
+    
+    unsigned char footer[4];
+    uint32_t crc = benchmark_crc32(0, header + 4, 4);
+    crc = benchmark_crc32(crc, data, size);
+    benchmark_putBE32(footer, crc);
+    
+    return fwrite(header, 1, 8, file) == 8 && (size == 0 || fwrite(data, 1, size, file) == size) && fwrite(footer, 1, 4, file) == 4;
+}
+
+// Write RGBA8 pixels as a PNG with stored (uncompressed) deflate blocks: large, but byte-exact and dependency free
+static bool benchmark_writePNG(const char* path, const unsigned char* pixels, int width, int height) {
+    size_t rowBytes = (size_t)width * 4 + 1;
+    size_t rawSize = rowBytes * height;
+    size_t blocks = (rawSize + 65534) / 65535;
+    size_t zlibSize = 2 + rawSize + blocks * 5 + 4;
+    unsigned char* zlib = (unsigned char*)malloc(zlibSize);
+    unsigned char* raw = (unsigned char*)malloc(rawSize);
+    if (!zlib || !raw) {
+        free(zlib);
+        free(raw);
+        return false;
+    }
+    
+    // Filter type 0 per row
+    for (int y = 0; y < height; y++) {
+        raw[y * rowBytes] = 0;
+        memcpy(raw + y * rowBytes + 1, pixels + (size_t)y * width * 4, (size_t)width * 4);
+    }
+    
+    size_t out = 0;
+    zlib[out++] = 0x78;
+    zlib[out++] = 0x01;
+    uint32_t a = 1, b = 0;
+    for (size_t offset = 0; offset < rawSize; offset += 65535) {
+        size_t length = rawSize - offset < 65535 ? rawSize - offset : 65535;
+        zlib[out++] = offset + length == rawSize ? 1 : 0;
+        zlib[out++] = (unsigned char)(length & 0xFF);
+        zlib[out++] = (unsigned char)(length >> 8);
+        zlib[out++] = (unsigned char)(~length & 0xFF);
+        zlib[out++] = (unsigned char)((~length >> 8) & 0xFF);
+        memcpy(zlib + out, raw + offset, length);
+        out += length;
+        
+        for (size_t i = 0; i < length; i++) {
+            a = (a + raw[offset + i]) % 65521;
+            b = (b + a) % 65521;
+        }
+    }
+    benchmark_putBE32(zlib + out, (b << 16) | a);
+    out += 4;
+    free(raw);
+    
+    unsigned char ihdr[13];
+    benchmark_putBE32(ihdr, (uint32_t)width);
+    benchmark_putBE32(ihdr + 4, (uint32_t)height);
+    ihdr[8] = 8;    // Bit depth
+    ihdr[9] = 6;    // RGBA
+    ihdr[10] = 0;
+    ihdr[11] = 0;
+    ihdr[12] = 0;
+    
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    FILE* file = fopen(path, "wb");
+    bool ok = file != NULL;
+    if (ok) {
+        ok = fwrite(signature, 1, 8, file) == 8 &&
+             benchmark_writeChunk(file, "IHDR", ihdr, sizeof(ihdr)) &&
+             benchmark_writeChunk(file, "IDAT", zlib, out) &&
+             benchmark_writeChunk(file, "IEND", NULL, 0);
+        ok = fclose(file) == 0 && ok;
+    }
+    if (!ok) fprintf(stderr, "Failed to write %s\n", path);
+    
+    free(zlib);
+    return ok;
+}
+
+// Order statistics of one column
+static int benchmark_compareFloats(const void* a, const void* b) {
+    float fa = *(const float*)a;
+    float fb = *(const float*)b;
+    return fa < fb ? -1 : (fa > fb ? 1 : 0);
+}
+
+static void benchmark_printStats(const char* label, const float* values, int count) {
+    float* sorted = (float*)malloc(sizeof(float) * count);
+    if (!sorted) return;
+    memcpy(sorted, values, sizeof(float) * count);
+    qsort(sorted, count, sizeof(float), benchmark_compareFloats);
+    
+    double sum = 0.0;
+    for (int i = 0; i < count; i++) sum += sorted[i];
+    printf("  %s: mean %.3f ms, median %.3f, p95 %.3f, p99 %.3f, max %.3f\n", label, sum / count,
+           sorted[(count - 1) / 2], sorted[(int)((count - 1) * 0.95f)], sorted[(int)((count - 1) * 0.99f)], sorted[count - 1]);
+    free(sorted);
+}
+
+// Fixed GL state, as the windowed path sets up in initGL
+static void benchmark_initGL() {
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+    glEnable(GL_CULL_FACE);
+    glCullFace(GL_BACK);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glClearColor(0.2f, 0.3f, 0.4f, 1.0f);
+}
+
+// Render the camera path offscreen, write per-frame CPU/GPU times to CSV and dump the requested frames
+int benchmark_run(const BenchmarkConfig* config) {
+    HeadlessContext context;
+    if (!headless_init(&context, config->width, config->height)) return 1;
+    benchmark_initGL();
+    profiler_init();
+    
+    static SceneManager scene;
+    static Renderer renderer;
+    static Camera camera;
+    sceneManager_init(&scene);
+    renderer_init(&renderer);
+    renderer.enableDynamicResolution = config->dynamicResolution;
+    renderer.outputFramebuffer = context.framebuffer;
+    renderer_resize(&renderer, config->width, config->height);
+    camera_init(&camera, (vec3){0, 15, 0}, (vec3){0, 0, -1}, (vec3){0, 1, 0});
+    camera_updateProjection(&camera, config->width, config->height);
+    
+    BenchmarkSample* samples = (BenchmarkSample*)calloc(config->frames, sizeof(BenchmarkSample));
+    unsigned char* pixels = config->captureCount > 0 ? (unsigned char*)malloc((size_t)config->width * config->height * 4) : NULL;
+    if (!samples || (config->captureCount > 0 && !pixels)) {
+        fprintf(stderr, "Failed to allocate benchmark buffers\n");
+        free(samples);
+        free(pixels);
+        renderer_cleanup(&renderer);
+        sceneManager_cleanup(&scene);
+        profiler_cleanup();
+        headless_cleanup(&context);
+        return 1;
+    }
+    if (config->captureCount > 0) benchmark_makeDir(config->captureDir);
+    
+    // Timestamp pairs around each frame, read back a few frames later
+    GLuint queries[BENCHMARK_GPU_QUERY_LATENCY][2];
+    int queryFrames[BENCHMARK_GPU_QUERY_LATENCY];
+    glGenQueries(BENCHMARK_GPU_QUERY_LATENCY * 2, &queries[0][0]);
+    for (int i = 0; i < BENCHMARK_GPU_QUERY_LATENCY; i++) queryFrames[i] = -1;
+    
+    printf("Benchmark: %d frames (+%d warmup) at %dx%d\n", config->frames, config->warmupFrames, config->width, config->height);
+    double runStart = profiler_now();
+    int totalFrames = config->warmupFrames + config->frames;
+    
+    for (int frame = 0; frame <= totalFrames; frame++) {
+        // Resolve the frame that last used this query slot
+        int slot = frame % BENCHMARK_GPU_QUERY_LATENCY;
+        if (queryFrames[slot] >= config->warmupFrames) {
+            GLuint64 begin, end;
+            glGetQueryObjectui64v(queries[slot][0], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(queries[slot][1], GL_QUERY_RESULT, &end);
+            samples[queryFrames[slot] - config->warmupFrames].gpuTime = (float)((end - begin) / 1.0e6);
+        }
+        queryFrames[slot] = -1;
+        if (frame == totalFrames) {
+            // Drain the rest
+            for (int i = 1; i < BENCHMARK_GPU_QUERY_LATENCY; i++) {
+                int drain = (frame + i) % BENCHMARK_GPU_QUERY_LATENCY;
+                if (queryFrames[drain] < config->warmupFrames) continue;
+                GLuint64 begin, end;
+                glGetQueryObjectui64v(queries[drain][0], GL_QUERY_RESULT, &begin);
+                glGetQueryObjectui64v(queries[drain][1], GL_QUERY_RESULT, &end);
+                samples[queryFrames[drain] - config->warmupFrames].gpuTime = (float)((end - begin) / 1.0e6);
+            }
+            break;
+        }
+        
+        // Warmup frames hold the first keyframe
+        int recorded = frame - config->warmupFrames;
+        benchmark_setCamera(&camera, recorded > 0 ? (float)recorded / config->frames : 0.0f);
+        
+        profiler_beginFrame();
+        double start = profiler_now();
+        glQueryCounter(queries[slot][0], GL_TIMESTAMP);
+        
+        SceneUpdate update = { BENCHMARK_TIME_STEP, config->timeOfDay, WEATHER_CLEAR,
+                               { camera.position[0], camera.position[1], camera.position[2] }, SCENE_UPDATE_ALL };
+        sceneManager_updateJobs(&scene, renderer.threadPool, &update);
+        glBindFramebuffer(GL_FRAMEBUFFER, context.framebuffer);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        renderer_render(&renderer, &scene, &camera, config->timeOfDay, WEATHER_CLEAR);
+        
+        glQueryCounter(queries[slot][1], GL_TIMESTAMP);
+        queryFrames[slot] = frame;
+        float cpuTime = (float)(profiler_now() - start);
+        profiler_endFrame();
+        
+        // Nothing presents, so flush to keep the driver from batching frames together
+        glFlush();
+        if (recorded < 0) continue;
+        
+        BenchmarkSample* sample = &samples[recorded];
+        sample->cpuTime = cpuTime;
+        sample->drawCalls = benchmark_counter("Draw calls");
+        sample->triangles = benchmark_counter("Triangles submitted");
+        
+        // Readback stalls the pipeline; it happens after the frame's timestamps
+        for (int i = 0; i < config->captureCount; i++) {
+            if (config->captureFrames[i] != recorded) continue;
+            char path[512];
+            snprintf(path, sizeof(path), "%s/frame_%05d.png", config->captureDir, recorded);
+            sample->captured = headless_readPixels(&context, pixels) &&
+                               benchmark_writePNG(path, pixels, config->width, config->height);
+            if (sample->captured) printf("Captured frame %d to %s\n", recorded, path);
+            break;
+        }
+    }
+    double runTime = profiler_now() - runStart;
+    glDeleteQueries(BENCHMARK_GPU_QUERY_LATENCY * 2, &queries[0][0]);
+    
+    // Per-frame CSV
+    FILE* csv = fopen(config->csvPath, "w");
+    if (csv) {
+        fprintf(csv, "frame,cpu_ms,gpu_ms,draw_calls,triangles,captured\n");
+        for (int i = 0; i < config->frames; i++) {
+            const BenchmarkSample* sample = &samples[i];
+            fprintf(csv, "%d,%.4f,%.4f,%.0f,%.0f,%d\n", i, sample->cpuTime, sample->gpuTime, sample->drawCalls, sample->triangles, sample->captured ? 1 : 0);
+        }
+        fclose(csv);
+    } else {
+        fprintf(stderr, "Failed to write %s\n", config->csvPath);
+    }
+    
+    // Summary
+    float* column = (float*)malloc(sizeof(float) * config->frames);
+    if (column) {
+        printf("Benchmark finished in %.2f s (%s, %s)\n", runTime / 1000.0, context.backend, (const char*)glGetString(GL_RENDERER));
+        for (int i = 0; i < config->frames; i++) column[i] = samples[i].cpuTime;
+        benchmark_printStats("CPU", column, config->frames);
+        for (int i = 0; i < config->frames; i++) column[i] = samples[i].gpuTime;
+        benchmark_printStats("GPU", column, config->frames);
+        printf("  Per-frame times written to %s\n", config->csvPath);
+        free(column);
+    }
+    
+    free(samples);
+    free(pixels);
+    renderer_cleanup(&renderer);
+    sceneManager_cleanup(&scene);
+    profiler_cleanup();
+    headless_cleanup(&context);
+    return csv ? 0 : 1;
+}
@@ -0,0 +1,439 @@
+#include "utils/bvh.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+// Node waiting to be split during a build
+typedef struct {
+    uint32_t node;
+    int depth;
+} BvhBuildTask;
+
+// One SAH bin: box of the primitives whose centroid falls in it
+typedef struct {
+    BvhBox box;
+    uint32_t count;
+} BvhBin;
+
+// Plain compares (fminf/fmaxf may not inline and also order NaNs, which boxes never hold)
+static inline float bvh_min(float a, float b) {
+    return a < b ? a : b;
+}
+
+static inline float bvh_max(float a, float b) {
+    return a > b ? a : b;
+}
+
+// Empty box (grows with the first union)
+static void bvh_clearBox(BvhBox* box) {
+    for (int axis = 0; axis < 3; axis++) {
+        box->min[axis] = INFINITY;
+        box->max[axis] = -INFINITY;
+    }
+}
+
+static void bvh_growBox(BvhBox* box, const BvhBox* other) {
+    for (int axis = 0; axis < 3; axis++) {
+        box->min[axis] = bvh_min(box->min[axis], other->min[axis]);
+        box->max[axis] = bvh_max(box->max[axis], other->max[axis]);
+    }
+}
+
+// Half the surface area (the SAH only compares ratios)
+static float bvh_boxArea(const BvhBox* box) {
+    float dx = box->max[0] - box->min[0];
+    float dy = box->max[1] - box->min[1];
+    float dz = box->max[2] - box->min[2];
+    if (dx < 0.0f || dy < 0.0f || dz < 0.0f) return 0.0f;
+    return dx * dy + dy * dz + dz * dx;
+}
+
+// Allocate room for capacity primitives (a binary tree with one primitive per leaf at most
+// has 2n - 1 nodes)
+bool bvh_init(Bvh* bvh, uint32_t capacity) {
+    memset(bvh, 0, sizeof(Bvh));
+    if (capacity == 0) capacity = 1;
+    
+    bvh->nodes = (BvhNode*)malloc(sizeof(BvhNode) * (2 * (size_t)capacity));
+    bvh->order = (uint32_t*)malloc(sizeof(uint32_t) * capacity);
+    bvh->boxes = (BvhBox*)malloc(sizeof(BvhBox) * capacity);
+    bvh->references = (BvhReference*)malloc(sizeof(BvhReference) * capacity);
+    if (!bvh->nodes || !bvh->order || !bvh->boxes || !bvh->references) {
+        fprintf(stderr, "Failed to allocate BVH for %u primitives\n", capacity);
+        bvh_cleanup(bvh);
+        return false;
+    }
+    bvh->capacity = capacity;
+    return true;
+}
+
+void bvh_cleanup(Bvh* bvh) {
+    free(bvh->nodes);
+    free(bvh->order);
+    free(bvh->boxes);
+    free(bvh->references);
+    memset(bvh, 0, sizeof(Bvh));
+}
+
+// Pick the cheapest binned SAH split of references [first, first + count) along the axis
+// the centroids spread furthest on; returns false when they cannot be told apart
+static bool bvh_findSplit(const BvhReference* references, uint32_t first, uint32_t count, const BvhBox* centroids,
+                          int* splitAxis, float* splitPosition) {
+    int axis = 0;
+    for (int i = 1; i < 3; i++) {
+        if (centroids->max[i] - centroids->min[i] > centroids->max[axis] - centroids->min[axis]) axis = i;
+    }
+    float extent = centroids->max[axis] - centroids->min[axis];
+    if (extent <= 0.0f) return false;
+    
+    BvhBin bins[BVH_SAH_BINS];
+    for (int b = 0; b < BVH_SAH_BINS; b++) {
+        bvh_clearBox(&bins[b].box);
+        bins[b].count = 0;
+    }
+    float scale = BVH_SAH_BINS / extent;
+    for (uint32_t i = first; i < first + count; i++) {
+        const BvhReference* reference = &references[i];
+        int b = (int)((reference->centroid[axis] - centroids->min[axis]) * scale);
+        if (b >= BVH_SAH_BINS) b = BVH_SAH_BINS - 1;
+        bvh_growBox(&bins[b].box, &reference->box);
+        bins[b].count++;
+    }
+    
+    // Sweep from the right, then from the left, pricing each of the bin boundaries
+    float rightArea[BVH_SAH_BINS];
+    uint32_t rightCount[BVH_SAH_BINS];
+    BvhBox sweep;
+    bvh_clearBox(&sweep);
+    uint32_t sideCount = 0;
+    for (int b = BVH_SAH_BINS - 1; b > 0; b--) {
+        bvh_growBox(&sweep, &bins[b].box);
+        sideCount += bins[b].count;
+        rightArea[b] = bvh_boxArea(&sweep);
+        rightCount[b] = sideCount;
+    }
+    
+    float bestCost = INFINITY;
+    bvh_clearBox(&sweep);
+    sideCount = 0;
+    for (int b = 0; b < BVH_SAH_BINS - 1; b++) {
+        bvh_growBox(&sweep, &bins[b].box);
+        sideCount += bins[b].count;
+        if (sideCount == 0 || rightCount[b + 1] == 0) continue;
+        
+        float cost = bvh_boxArea(&sweep) * sideCount + rightArea[b + 1] * rightCount[b + 1];
+        if (cost < bestCost) {
+            bestCost = cost;
+            *splitAxis = axis;
+            *splitPosition = centroids->min[axis] + (b + 1) / scale;
+        }
+    }
+    return bestCost < INFINITY;
+}
+
+// Build the tree over the first count boxes (count <= capacity). The build sorts copies
+// of the boxes, so each node's primitives sit next to each other in memory.
+void bvh_build(Bvh* bvh, uint32_t count) {
+    if (count > bvh->capacity) count = bvh->capacity;
+    bvh->count = count;
+    bvh->nodeCount = 0;
+    bvh->depth = 0;
+    if (count == 0) return;
+    
+    BvhReference* references = bvh->references;
+    for (uint32_t i = 0; i < count; i++) {
+        references[i].box = bvh->boxes[i];
+        for (int axis = 0; axis < 3; axis++) {
+            references[i].centroid[axis] = (bvh->boxes[i].min[axis] + bvh->boxes[i].max[axis]) * 0.5f;
+        }
+        references[i].index = i;
+    }
+    
+    BvhNode* root = &bvh->nodes[bvh->nodeCount++];
+    root->first = 0;
+    root->count = count;
+    
+    BvhBuildTask stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = (BvhBuildTask){ 0, 0 };
+    
+    while (stackSize > 0) {
+        BvhBuildTask task = stack[--stackSize];
+        BvhNode* node = &bvh->nodes[task.node];
+        if (task.depth > bvh->depth) bvh->depth = task.depth;
+        
+        uint32_t first = node->first;
+        uint32_t last = node->first + node->count;
+        BvhBox centroids;
+        bvh_clearBox(&node->box);
+        bvh_clearBox(&centroids);
+        for (uint32_t i = first; i < last; i++) {
+            bvh_growBox(&node->box, &references[i].box);
+            for (int axis = 0; axis < 3; axis++) {
+                centroids.min[axis] = bvh_min(centroids.min[axis], references[i].centroid[axis]);
+                centroids.max[axis] = bvh_max(centroids.max[axis], references[i].centroid[axis]);
+            }
+        }
+        
+        // Traversal stacks are fixed size, so very deep nodes stay leaves
+        if (node->count <= BVH_MAX_LEAF_SIZE || task.depth >= BVH_STACK_SIZE - 2) {
+            for (uint32_t i = first; i < last; i++) bvh->order[i] = references[i].index;
+            continue;
+        }
+        
+        // Partition around the split; coincident centroids split at the median
+        uint32_t middle = first;
+        int axis = 0;
+        float position = 0.0f;
+        if (bvh_findSplit(references, first, node->count, &centroids, &axis, &position)) {
+            uint32_t left = first;
+            uint32_t right = last;
+            while (left < right) {
+                if (references[left].centroid[axis] < position) {
+                    left++;
+                } else {
+                    BvhReference swap = references[left];
+                    references[left] = references[--right];
+                    references[right] = swap;
+                }
+            }
+            middle = left;
+        }
+        if (middle == first || middle == last) middle = first + node->count / 2;
+        
+        uint32_t childIndex = bvh->nodeCount;
+        bvh->nodeCount += 2;
+        BvhNode* leftChild = &bvh->nodes[childIndex];
+        BvhNode* rightChild = &bvh->nodes[childIndex + 1];
+        leftChild->first = first;
+        leftChild->count = middle - first;
+        rightChild->first = middle;
+        rightChild->count = last - middle;
+        
+        node->first = childIndex;
+        node->count = 0;
+        
+        // Each pop pushes at most two, and depth is capped, so the stack cannot overflow
+        stack[stackSize++] = (BvhBuildTask){ childIndex + 1, task.depth + 1 };
+        stack[stackSize++] = (BvhBuildTask){ childIndex, task.depth + 1 };
+    }
+    
+    bvh->buildArea = 0.0f;
+    for (uint32_t n = 0; n < bvh->nodeCount; n++) {
+        bvh->buildArea += bvh_boxArea(&bvh->nodes[n].box);
+    }
+    bvh->area = bvh->buildArea;
+}
+
+// Recompute node boxes from the current primitive boxes, keeping the topology.
+// Cheap, but the tree degrades as primitives move far from where it was built.
+void bvh_refit(Bvh* bvh) {
+    bvh->area = 0.0f;
+    for (uint32_t n = bvh->nodeCount; n-- > 0;) {
+        BvhNode* node = &bvh->nodes[n];
+        bvh_clearBox(&node->box);
+        if (node->count > 0) {
+            for (uint32_t i = node->first; i < node->first + node->count; i++) {
+                bvh_growBox(&node->box, &bvh->boxes[bvh->order[i]]);
+            }
+        } else {
+            bvh_growBox(&node->box, &bvh->nodes[node->first].box);
+            bvh_growBox(&node->box, &bvh->nodes[node->first + 1].box);
+        }
+        bvh->area += bvh_boxArea(&node->box);
+    }
+}
+
+// Normalized frustum planes (ax + by + cz + d >= 0 inside) from a column-major projection * view
+void bvh_frustumFromMatrix(const float* m, float planes[6][4]) {
+    for (int i = 0; i < 3; i++) {
+        for (int side = 0; side < 2; side++) {
+            float sign = side == 0 ? 1.0f : -1.0f;
+            float* plane = planes[i * 2 + side];
+            for (int col = 0; col < 4; col++) {
+                plane[col] = m[col * 4 + 3] + sign * m[col * 4 + i];
+            }
+            
+            float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+            if (length > 0.0f) {
+                for (int col = 0; col < 4; col++) plane[col] /= length;
+            }
+        }
+    }
+}
+
+// Test a box against the planes still set in mask; planes it is fully inside of are
+// cleared from mask. Farthest corner along the normal decides outside, nearest fully inside.
+static bool bvh_boxOutside(const BvhBox* box, const float planes[6][4], unsigned int* mask) {
+    for (int p = 0; p < 6; p++) {
+        if (!(*mask & (1u << p))) continue;
+        const float* plane = planes[p];
+        float far = plane[3];
+        float near = plane[3];
+        for (int axis = 0; axis < 3; axis++) {
+            float a = plane[axis] * box->min[axis];
+            float b = plane[axis] * box->max[axis];
+            far += bvh_max(a, b);
+            near += bvh_min(a, b);
+        }
+        if (far < 0.0f) return true;
+        if (near >= 0.0f) *mask &= ~(1u << p);
+    }
+    return false;
+}
+
+// Primitives whose box is inside or crosses the frustum. Planes a node is fully inside of
+// are not tested again below it. Returns the number found; at most maxResults are written.
+size_t bvh_queryFrustum(const Bvh* bvh, const float planes[6][4], uint32_t* results, size_t maxResults) {
+    if (bvh->nodeCount == 0) return 0;
+    
+    struct { uint32_t node; unsigned int mask; } stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize].node = 0;
+    stack[stackSize++].mask = 0x3fu;
+    size_t found = 0;
+    
+    while (stackSize > 0) {
+        stackSize--;
+        const BvhNode* node = &bvh->nodes[stack[stackSize].node];
+        unsigned int mask = stack[stackSize].mask;
+        if (mask && bvh_boxOutside(&node->box, planes, &mask)) continue;
+        
+        if (node->count == 0) {
+            stack[stackSize].node = node->first + 1;
+            stack[stackSize++].mask = mask;
+            stack[stackSize].node = node->first;
+            stack[stackSize++].mask = mask;
+            continue;
+        }
+        
+        // Leaves test their primitives against whatever planes are left
+        for (uint32_t i = node->first; i < node->first + node->count; i++) {
+            uint32_t index = bvh->order[i];
+            unsigned int primitiveMask = mask;
+            if (primitiveMask && bvh_boxOutside(&bvh->boxes[index], planes, &primitiveMask)) continue;
+            if (found < maxResults) results[found] = index;
+            found++;
+        }
+    }
+    return found;
+}
+
+// Squared distance from a point to a box (0 inside)
+static float bvh_boxDistanceSquared(const BvhBox* box, const float* point) {
+    float distance = 0.0f;
+    for (int axis = 0; axis < 3; axis++) {
+        float d = bvh_max(box->min[axis] - point[axis], bvh_max(0.0f, point[axis] - box->max[axis]));
+        distance += d * d;
+    }
+    return distance;
+}
+
+// Primitives whose box overlaps the sphere. Returns the number found; at most maxResults are written.
+size_t bvh_querySphere(const Bvh* bvh, const float* center, float radius, uint32_t* results, size_t maxResults) {
+    if (bvh->nodeCount == 0) return 0;
+    
+    uint32_t stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    float radiusSquared = radius * radius;
+    size_t found = 0;
+    
+    while (stackSize > 0) {
+        const BvhNode* node = &bvh->nodes[stack[--stackSize]];
+        if (bvh_boxDistanceSquared(&node->box, center) > radiusSquared) continue;
+        
+        if (node->count > 0) {
+            for (uint32_t i = node->first; i < node->first + node->count; i++) {
+                uint32_t index = bvh->order[i];
+                if (bvh_boxDistanceSquared(&bvh->boxes[index], center) > radiusSquared) continue;
+                if (found < maxResults) results[found] = index;
+                found++;
+            }
+        } else {
+            stack[stackSize++] = node->first + 1;
+            stack[stackSize++] = node->first;
+        }
+    }
+    return found;
+}
+
+// Distance at which the ray enters the box, or INFINITY if it misses it before maxT
+static float bvh_rayBox(const BvhBox* box, const float* origin, const float* inverse, float maxT) {
+    float tMin = 0.0f;
+    float tMax = maxT;
+    for (int axis = 0; axis < 3; axis++) {
+        float t0 = (box->min[axis] - origin[axis]) * inverse[axis];
+        float t1 = (box->max[axis] - origin[axis]) * inverse[axis];
+        // A NaN slab (flat direction, origin on the plane) leaves the interval as it was
+        tMin = bvh_max(bvh_min(t0, t1), tMin);
+        tMax = bvh_min(bvh_max(t0, t1), tMax);
+    }
+    return tMin <= tMax ? tMin : INFINITY;
+}
+
+// Closest primitive hit along the ray within maxT, as reported by test; returns its
+// distance (in units of direction) and index, or a negative value when nothing is hit.
+// Children are visited near to far so farther subtrees are pruned by the closest hit.
+float bvh_raycast(const Bvh* bvh, const float* origin, const float* direction, float maxT,
+                  BvhRayTest test, void* context, uint32_t* hitIndex) {
+    if (bvh->nodeCount == 0) return -1.0f;
+    
+    // Zero components give infinite slabs, which the min/max above handle
+    float inverse[3];
+    for (int axis = 0; axis < 3; axis++) inverse[axis] = 1.0f / direction[axis];
+    
+    // Nodes are pushed with their entry distance and skipped if a closer hit turned up since
+    struct { uint32_t node; float t; } stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    float closest = maxT;
+    bool hit = false;
+    
+    float tRoot = bvh_rayBox(&bvh->nodes[0].box, origin, inverse, closest);
+    if (tRoot == INFINITY) return -1.0f;
+    stack[stackSize].node = 0;
+    stack[stackSize++].t = tRoot;
+    
+    while (stackSize > 0) {
+        stackSize--;
+        if (stack[stackSize].t > closest) continue;
+        const BvhNode* node = &bvh->nodes[stack[stackSize].node];
+        
+        if (node->count > 0) {
+            for (uint32_t i = node->first; i < node->first + node->count; i++) {
+                uint32_t index = bvh->order[i];
+                if (bvh_rayBox(&bvh->boxes[index], origin, inverse, closest) == INFINITY) continue;
+                
+                float t = test(context, index, origin, direction, closest);
+                if (t >= 0.0f && t < closest) {
+                    closest = t;
+                    *hitIndex = index;
+                    hit = true;
+                }
+            }
+            continue;
+        }
+        
+        uint32_t near = node->first;
+        uint32_t far = node->first + 1;
+        float tNear = bvh_rayBox(&bvh->nodes[near].box, origin, inverse, closest);
+        float tFar = bvh_rayBox(&bvh->nodes[far].box, origin, inverse, closest);
+        if (tFar < tNear) {
+            uint32_t swapNode = near; near = far; far = swapNode;
+            float swapT = tNear; tNear = tFar; tFar = swapT;
+        }
+        
+        // Far child first, so the near one is popped next
+        if (tFar != INFINITY) {
+            stack[stackSize].node = far;
+            stack[stackSize++].t = tFar;
+        }
+        if (tNear != INFINITY) {
+            stack[stackSize].node = near;
+            stack[stackSize++].t = tNear;
+        }
+    }
+    return hit ? closest : -1.0f;
+}
@@ -1,16 +1,33 @@
 #include "utils/debug.h"
+#include "utils/debug_imgui.h"
 #include <stdio.h>
 #include <stdarg.h>
 
+// Overlay state
+static bool showProfiler = false;
+static double lastProfilerLog = 0.0;
+
 // Initialize debug system
 void debug_init() {
-    // In a real implementation, this would initialize ImGui and other debug tools
+    profiler_init();
+    trace_init();
+    
+    #ifdef WONDERLANDS_HAS_IMGUI
+    debugImGui_init();
+    #endif
+    
     printf("Debug system initialized\n");
 }
 
 // Clean up debug system
 void debug_cleanup() {
-    // Clean up resources
+    #ifdef WONDERLANDS_HAS_IMGUI
+    debugImGui_shutdown();
+    #endif
+    
+    trace_cleanup();
+    profiler_cleanup();
+    
     printf("Debug system cleaned up\n");
 }
 
@@ -55,8 +72,38 @@ void debug_showImGuiWindow(bool* show) {
 
 // Render debug overlay
 void debug_renderOverlay() {
-    // This is a placeholder for rendering debug information
-    // In a real implementation, this would render ImGui windows, etc.
+    #ifdef WONDERLANDS_HAS_IMGUI
+    debugImGui_render(&showProfiler);
+    #else
+    // Without ImGui, print the profiler table once a second instead
+    if (!showProfiler) return;
+    
+    double now = profiler_now();
+    if (now - lastProfilerLog < 1000.0) return;
+    lastProfilerLog = now;
+    
+    int count = 0;
+    const ProfileScopeStats* stats = profiler_getStats(&count);
+    
+    printf("%-28s %4s %8s %8s %8s %8s\n", "scope (ms)", "", "last", "avg", "p95", "max");
+    for (int i = 0; i < count; i++) {
+        if (stats[i].historyCount == 0) continue;
+        printf("%*s%-*s %4s %8.2f %8.2f %8.2f %8.2f\n",
+               stats[i].depth * 2, "", 28 - stats[i].depth * 2, stats[i].name,
+               stats[i].domain == PROFILE_GPU ? "GPU" : "CPU",
+               stats[i].last, stats[i].average, stats[i].p95, stats[i].max);
+    }
+    
+    const ProfileCounter* counters = profiler_getCounters(&count);
+    for (int i = 0; i < count; i++) {
+        printf("%-33s %8.2f\n", counters[i].name, counters[i].value);
+    }
+    #endif
+}
+
+// Toggle the profiler window
+void debug_toggleProfiler() {
+    showProfiler = !showProfiler;
 }
 
 // Check for OpenGL errors
@@ -0,0 +1,129 @@
+#ifdef WONDERLANDS_HAS_IMGUI
+
+#include "utils/debug_imgui.h"
+#include "utils/profiler.h"
+#include "utils/trace.h"
+
+#include "imgui.h"
+#include "imgui_impl_glut.h"
+#include "imgui_impl_opengl3.h"
+
+// Initialize ImGui with the GLUT and OpenGL 3 backends
+void debugImGui_init() {
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGui::GetIO().IniFilename = NULL;
+    ImGui::StyleColorsDark();
+    
+    // Input callbacks stay with main.c; the overlay is display-only
+    ImGui_ImplGLUT_Init();
+    ImGui_ImplOpenGL3_Init("#version 410");
+}
+
+// Shut down ImGui
+void debugImGui_shutdown() {
+    ImGui_ImplOpenGL3_Shutdown();
+    ImGui_ImplGLUT_Shutdown();
+    ImGui::DestroyContext();
+}
+
+// Draw one domain's scopes as a table
+static void debugImGui_scopeTable(const char* label, const ProfileScopeStats* stats, int count, ProfileDomain domain) {
+    if (!ImGui::BeginTable(label, 5, ImGuiTableFlags_RowBg | ImGuiTableFlags_SizingStretchProp)) {
+        return;
+    }
+    
+    ImGui::TableSetupColumn(label);
+    ImGui::TableSetupColumn("last");
+    ImGui::TableSetupColumn("avg");
+    ImGui::TableSetupColumn("p95");
+    ImGui::TableSetupColumn("max");
+    ImGui::TableHeadersRow();
+    
+    for (int i = 0; i < count; i++) {
+        const ProfileScopeStats* scope = &stats[i];
+        if (scope->domain != domain || scope->historyCount == 0) continue;
+        
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::Indent(scope->depth * 10.0f + 1.0f);
+        ImGui::TextUnformatted(scope->name);
+        ImGui::Unindent(scope->depth * 10.0f + 1.0f);
+        ImGui::TableNextColumn(); ImGui::Text("%.2f", scope->last);
+        ImGui::TableNextColumn(); ImGui::Text("%.2f", scope->average);
+        ImGui::TableNextColumn(); ImGui::Text("%.2f", scope->p95);
+        ImGui::TableNextColumn(); ImGui::Text("%.2f", scope->max);
+    }
+    
+    ImGui::EndTable();
+}
+
+// Render the debug overlay for this frame
+void debugImGui_render(bool* showProfiler) {
+    ImGui_ImplOpenGL3_NewFrame();
+    ImGui_ImplGLUT_NewFrame();
+    ImGui::NewFrame();
+    
+    // Always-on frame time readout
+    ImGuiWindowFlags overlayFlags = ImGuiWindowFlags_NoDecoration | ImGuiWindowFlags_AlwaysAutoResize |
+                                    ImGuiWindowFlags_NoInputs | ImGuiWindowFlags_NoSavedSettings;
+    ImGui::SetNextWindowPos(ImVec2(10.0f, 10.0f));
+    ImGui::SetNextWindowBgAlpha(0.35f);
+    if (ImGui::Begin("Frame", NULL, overlayFlags)) {
+        ImGui::Text("CPU %.2f ms  GPU %.2f ms", profiler_getCPUFrameTime(), profiler_getGPUFrameTime());
+    }
+    ImGui::End();
+    
+    if (*showProfiler) {
+        int count = 0;
+        const ProfileScopeStats* stats = profiler_getStats(&count);
+        
+        ImGui::SetNextWindowPos(ImVec2(10.0f, 50.0f), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowSize(ImVec2(420.0f, 480.0f), ImGuiCond_FirstUseEver);
+        if (ImGui::Begin("Profiler (ms)", showProfiler)) {
+            // Frame time graph for the CPU frame scope
+            for (int i = 0; i < count; i++) {
+                if (stats[i].depth == 0 && stats[i].domain == PROFILE_CPU && stats[i].historyCount > 0) {
+                    ImGui::PlotLines("##frame", stats[i].history, stats[i].historyCount, stats[i].historyIndex,
+                                     "CPU frame", 0.0f, stats[i].max * 1.2f, ImVec2(-1.0f, 60.0f));
+                    break;
+                }
+            }
+            
+            debugImGui_scopeTable("GPU", stats, count, PROFILE_GPU);
+            ImGui::Separator();
+            debugImGui_scopeTable("CPU", stats, count, PROFILE_CPU);
+            
+            // Per-frame counters
+            int counterCount = 0;
+            const ProfileCounter* counters = profiler_getCounters(&counterCount);
+            if (counterCount > 0 && ImGui::CollapsingHeader("Counters", ImGuiTreeNodeFlags_DefaultOpen)) {
+                for (int i = 0; i < counterCount; i++) {
+                    ImGui::Text("%-32s %10.2f", counters[i].name, counters[i].value);
+                }
+            }
+            
+            if (ImGui::Button("Export Chrome trace")) {
+                profiler_exportChromeTrace("wonderlands_trace.json");
+            }
+            
+            #ifdef WONDERLANDS_TRACE
+            // Per-thread CPU scopes, last few seconds
+            bool recording = trace_isEnabled();
+            if (ImGui::Checkbox("Record CPU trace", &recording)) {
+                trace_setEnabled(recording);
+            }
+            ImGui::SameLine();
+            if (ImGui::Button("Dump CPU trace")) {
+                trace_dump("wonderlands_cpu_trace.json", TRACE_DUMP_SECONDS);
+            }
+            #endif
+        }
+        ImGui::End();
+    }
+    
+    ImGui::Render();
+    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+}
+
+#endif // WONDERLANDS_HAS_IMGUI
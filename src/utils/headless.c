@@ -0,0 +1,246 @@
+#include "utils/headless.h"
+
+#if defined(WONDERLANDS_HEADLESS_EGL)
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#elif defined(WONDERLANDS_HEADLESS_OSMESA)
+#include <GL/osmesa.h>
+#endif
+
+// Backend state (one headless context per process)
+#if defined(WONDERLANDS_HEADLESS_EGL)
+static EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+static EGLContext eglContext = EGL_NO_CONTEXT;
+static EGLSurface eglSurface = EGL_NO_SURFACE;
+#elif defined(WONDERLANDS_HEADLESS_OSMESA)
+static OSMesaContext osmesaContext = NULL;
+static unsigned char* osmesaBuffer = NULL;
+#endif
+
+#if defined(WONDERLANDS_HEADLESS_EGL)
+// Prefer the surfaceless platform (no display server, no GPU device node needed)
+static EGLDisplay headless_getEGLDisplay() {
+    #ifdef EGL_PLATFORM_SURFACELESS_MESA
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    const char* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (getPlatformDisplay && extensions && strstr(extensions, "EGL_MESA_platform_surfaceless")) {
+        EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if (display != EGL_NO_DISPLAY) return display;
+    }
+    #endif
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+// Create and bind a core 4.1 context, without a surface if the driver allows it
+static bool headless_createEGL(HeadlessContext* context, int width, int height) {
+    eglDisplay = headless_getEGLDisplay();
+    EGLint major, minor;
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor)) {
+        fprintf(stderr, "Failed to initialize EGL display\n");
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        fprintf(stderr, "EGL display does not support desktop OpenGL\n");
+        return false;
+    }
+    
+    const char* extensions = eglQueryString(eglDisplay, EGL_EXTENSIONS);
+    bool surfaceless = extensions && strstr(extensions, "EGL_KHR_surfaceless_context");
+    
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount) || configCount == 0) {
+        fprintf(stderr, "No suitable EGL config\n");
+        return false;
+    }
+    
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 4,
+        EGL_CONTEXT_MINOR_VERSION, 1,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, contextAttributes);
+    if (eglContext == EGL_NO_CONTEXT) {
+        fprintf(stderr, "Failed to create an OpenGL 4.1 core EGL context (0x%x)\n", eglGetError());
+        return false;
+    }
+    
+    if (!surfaceless) {
+        const EGLint surfaceAttributes[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+        eglSurface = eglCreatePbufferSurface(eglDisplay, config, surfaceAttributes);
+        if (eglSurface == EGL_NO_SURFACE) {
+            fprintf(stderr, "Failed to create EGL pbuffer (0x%x)\n", eglGetError());
+            return false;
+        }
+    }
+    if (!eglMakeCurrent(eglDisplay, eglSurface, eglSurface, eglContext)) {
+        fprintf(stderr, "Failed to make EGL context current (0x%x)\n", eglGetError());
+        return false;
+    }
+    
+    context->backend = surfaceless ? "EGL (surfaceless)" : "EGL (pbuffer)";
+    return true;
+}
+#endif
+
+#if defined(WONDERLANDS_HEADLESS_OSMESA)
+// Create and bind a core 4.1 OSMesa context over a client-side colour buffer
+static bool headless_createOSMesa(HeadlessContext* context, int width, int height) {
+    const int attributes[] = {
+        OSMESA_FORMAT, OSMESA_RGBA,
+        OSMESA_DEPTH_BITS, 24,
+        OSMESA_STENCIL_BITS, 8,
+        OSMESA_PROFILE, OSMESA_CORE_PROFILE,
+        OSMESA_CONTEXT_MAJOR_VERSION, 4,
+        OSMESA_CONTEXT_MINOR_VERSION, 1,
+        0
+    };
+    osmesaContext = OSMesaCreateContextAttribs(attributes, NULL);
+    if (!osmesaContext) {
+        fprintf(stderr, "Failed to create an OpenGL 4.1 core OSMesa context\n");
+        return false;
+    }
+    
+    osmesaBuffer = (unsigned char*)malloc((size_t)width * height * 4);
+    if (!osmesaBuffer || !OSMesaMakeCurrent(osmesaContext, osmesaBuffer, GL_UNSIGNED_BYTE, width, height)) {
+        fprintf(stderr, "Failed to make OSMesa context current\n");
+        return false;
+    }
+    
+    context->backend = "OSMesa";
+    return true;
+}
+#endif
+
+// Load GL entry points for a context created without GLUT
+static bool headless_initGLEW() {
+    #ifndef __APPLE__
+    glewExperimental = GL_TRUE;
+    GLenum err = glewInit();
+    #ifdef GLEW_ERROR_NO_GLX_DISPLAY
+    // GLX-built GLEW refuses EGL contexts; the core entry points still load
+    if (err == GLEW_ERROR_NO_GLX_DISPLAY) err = glewContextInit();
+    #endif
+    if (err != GLEW_OK) {
+        fprintf(stderr, "GLEW initialization error: %s\n", glewGetErrorString(err));
+        return false;
+    }
+    
+    // glewInit can leave GL_INVALID_ENUM behind on core profiles
+    while (glGetError() != GL_NO_ERROR) {}
+    #endif
+    return true;
+}
+
+// Create the context and an RGBA8/depth-stencil framebuffer of the given size
+bool headless_init(HeadlessContext* context, int width, int height) {
+    memset(context, 0, sizeof(HeadlessContext));
+    context->width = width;
+    context->height = height;
+    
+    #if defined(WONDERLANDS_HEADLESS_EGL)
+    if (!headless_createEGL(context, width, height)) {
+        headless_cleanup(context);
+        return false;
+    }
+    #elif defined(WONDERLANDS_HEADLESS_OSMESA)
+    if (!headless_createOSMesa(context, width, height)) {
+        headless_cleanup(context);
+        return false;
+    }
+    #else
+    fprintf(stderr, "Headless rendering is unavailable: built without EGL or OSMesa\n");
+    return false;
+    #endif
+    
+    if (!headless_initGLEW()) {
+        headless_cleanup(context);
+        return false;
+    }
+    
+    glGenRenderbuffers(1, &context->colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, context->colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &context->depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, context->depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    
+    glGenFramebuffers(1, &context->framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, context->framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, context->colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, context->depthBuffer);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete) {
+        fprintf(stderr, "Headless framebuffer is not complete!\n");
+        headless_cleanup(context);
+        return false;
+    }
+    
+    printf("Headless context: %s, %s, %dx%d\n", context->backend, (const char*)glGetString(GL_RENDERER), width, height);
+    return true;
+}
+
+// Destroy the framebuffer and the context
+void headless_cleanup(HeadlessContext* context) {
+    if (context->framebuffer) glDeleteFramebuffers(1, &context->framebuffer);
+    if (context->colorBuffer) glDeleteRenderbuffers(1, &context->colorBuffer);
+    if (context->depthBuffer) glDeleteRenderbuffers(1, &context->depthBuffer);
+    context->framebuffer = 0;
+    context->colorBuffer = 0;
+    context->depthBuffer = 0;
+    
+    #if defined(WONDERLANDS_HEADLESS_EGL)
+    if (eglDisplay != EGL_NO_DISPLAY) {
+        eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (eglSurface != EGL_NO_SURFACE) eglDestroySurface(eglDisplay, eglSurface);
+        if (eglContext != EGL_NO_CONTEXT) eglDestroyContext(eglDisplay, eglContext);
+        eglTerminate(eglDisplay);
+    }
+    eglDisplay = EGL_NO_DISPLAY;
+    eglContext = EGL_NO_CONTEXT;
+    eglSurface = EGL_NO_SURFACE;
+    #elif defined(WONDERLANDS_HEADLESS_OSMESA)
+    if (osmesaContext) OSMesaDestroyContext(osmesaContext);
+    free(osmesaBuffer);
+    osmesaContext = NULL;
+    osmesaBuffer = NULL;
+    #endif
+}
+
+// Read back the framebuffer as tightly packed RGBA8, top row first
+bool headless_readPixels(HeadlessContext* context, unsigned char* pixels) {
+    if (!context->framebuffer) return false;
+    
+    size_t rowBytes = (size_t)context->width * 4;
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, context->framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, context->width, context->height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+    
+    // GL rows start at the bottom
+    unsigned char* row = (unsigned char*)malloc(rowBytes);
+    if (!row) return false;
+    for (int y = 0; y < context->height / 2; y++) {
+        unsigned char* top = pixels + (size_t)y * rowBytes;
+        unsigned char* bottom = pixels + (size_t)(context->height - 1 - y) * rowBytes;
+        memcpy(row, top, rowBytes);
+        memcpy(top, bottom, rowBytes);
+        memcpy(bottom, row, rowBytes);
+    }
+    free(row);
+    return true;
+}
@@ -0,0 +1,683 @@
+#include "utils/mesh_optimizer.h"
+
+// Forsyth vertex scoring constants ("Linear-Speed Vertex Cache Optimisation")
+#define FORSYTH_CACHE_DECAY_POWER 1.5f
+#define FORSYTH_LAST_TRIANGLE_SCORE 0.75f
+#define FORSYTH_VALENCE_BOOST_SCALE 2.0f
+#define FORSYTH_VALENCE_BOOST_POWER 0.5f
+#define FORSYTH_MAX_VALENCE 64
+
+// Score lookup tables, built on first use
+static float cacheScores[MESH_OPTIMIZER_CACHE_SIZE];
+static float valenceScores[FORSYTH_MAX_VALENCE];
+static bool scoresReady = false;
+
+static void meshOptimizer_initScores() {
+    for (int i = 0; i < MESH_OPTIMIZER_CACHE_SIZE; i++) {
+        if (i < 3) {
+            // The last triangle's vertices score the same, so its neighbours are not favoured over each other
+            cacheScores[i] = FORSYTH_LAST_TRIANGLE_SCORE;
+        } else {
+            float scale = 1.0f - (float)(i - 3) / (MESH_OPTIMIZER_CACHE_SIZE - 3);
+            cacheScores[i] = powf(scale, FORSYTH_CACHE_DECAY_POWER);
+        }
+    }
+    for (int i = 1; i < FORSYTH_MAX_VALENCE; i++) {
+        valenceScores[i] = FORSYTH_VALENCE_BOOST_SCALE * powf((float)i, -FORSYTH_VALENCE_BOOST_POWER);
+    }
+    valenceScores[0] = 0.0f;
+    scoresReady = true;
+}
+
+// Score of a vertex from its cache position (-1 = not cached) and remaining triangle count
+static float meshOptimizer_vertexScore(int cachePosition, uint32_t remaining) {
+    if (remaining == 0) return -1.0f;
+    
+    float score = cachePosition >= 0 ? cacheScores[cachePosition] : 0.0f;
+    return score + valenceScores[remaining < FORSYTH_MAX_VALENCE ? remaining : FORSYTH_MAX_VALENCE - 1];
+}
+
+// Reorder triangles for post-transform vertex cache reuse (Forsyth), in place
+void meshOptimizer_optimizeVertexCache(uint32_t* indices, uint32_t numIndices, uint32_t numVertices) {
+    uint32_t numTriangles = numIndices / 3;
+    if (numTriangles < 2 || numVertices == 0) return;
+    if (!scoresReady) meshOptimizer_initScores();
+    
+    // Per-vertex triangle lists (remaining triangles are kept at the front of each list)
+    uint32_t* offsets = (uint32_t*)calloc(numVertices + 1, sizeof(uint32_t));
+    uint32_t* remaining = (uint32_t*)calloc(numVertices, sizeof(uint32_t));
+    uint32_t* adjacency = (uint32_t*)malloc(sizeof(uint32_t) * numTriangles * 3);
+    float* vertexScores = (float*)malloc(sizeof(float) * numVertices);
+    float* triangleScores = (float*)malloc(sizeof(float) * numTriangles);
+    bool* emitted = (bool*)calloc(numTriangles, sizeof(bool));
+    uint32_t* output = (uint32_t*)malloc(sizeof(uint32_t) * numTriangles * 3);
+    if (!offsets || !remaining || !adjacency || !vertexScores || !triangleScores || !emitted || !output) {
+        free(offsets); free(remaining); free(adjacency);
+        free(vertexScores); free(triangleScores); free(emitted); free(output);
+        return;
+    }
+    
+    for (uint32_t i = 0; i < numTriangles * 3; i++) {
+        if (indices[i] < numVertices) remaining[indices[i]]++;
+    }
+    for (uint32_t v = 0; v < numVertices; v++) offsets[v + 1] = offsets[v] + remaining[v];
+    memset(remaining, 0, sizeof(uint32_t) * numVertices);
+    for (uint32_t t = 0; t < numTriangles; t++) {
+        for (int k = 0; k < 3; k++) {
+            uint32_t v = indices[t * 3 + k];
+            if (v < numVertices) adjacency[offsets[v] + remaining[v]++] = t;
+        }
+    }
+    
+    for (uint32_t v = 0; v < numVertices; v++) {
+        vertexScores[v] = meshOptimizer_vertexScore(-1, remaining[v]);
+    }
+    for (uint32_t t = 0; t < numTriangles; t++) {
+        triangleScores[t] = 0.0f;
+        for (int k = 0; k < 3; k++) {
+            uint32_t v = indices[t * 3 + k];
+            if (v < numVertices) triangleScores[t] += vertexScores[v];
+        }
+    }
+    
+    // Simulated cache, with room for the three vertices pushed in front of it
+    uint32_t cache[MESH_OPTIMIZER_CACHE_SIZE + 3];
+    uint32_t newCache[MESH_OPTIMIZER_CACHE_SIZE + 3];
+    int cacheCount = 0;
+    uint32_t scanCursor = 0;
+    uint32_t bestTriangle = UINT32_MAX;
+    
+    for (uint32_t written = 0; written < numTriangles; written++) {
+        // No candidate around the cache: continue with the next unemitted triangle in input order
+        if (bestTriangle == UINT32_MAX) {
+            while (scanCursor < numTriangles && emitted[scanCursor]) scanCursor++;
+            bestTriangle = scanCursor;
+        }
+        
+        uint32_t triangle = bestTriangle;
+        emitted[triangle] = true;
+        const uint32_t* corners = &indices[triangle * 3];
+        output[written * 3 + 0] = corners[0];
+        output[written * 3 + 1] = corners[1];
+        output[written * 3 + 2] = corners[2];
+        
+        // Drop the triangle from its vertices' remaining lists
+        for (int k = 0; k < 3; k++) {
+            uint32_t v = corners[k];
+            if (v >= numVertices) continue;
+            uint32_t* list = &adjacency[offsets[v]];
+            for (uint32_t i = 0; i < remaining[v]; i++) {
+                if (list[i] == triangle) {
+                    list[i] = list[remaining[v] - 1];
+                    remaining[v]--;
+                    break;
+                }
+            }
+        }
+        
+        // Move the triangle's vertices to the front of the cache
+        int newCount = 0;
+        for (int k = 0; k < 3; k++) {
+            uint32_t v = corners[k];
+            if (v >= numVertices) continue;
+            bool present = false;
+            for (int i = 0; i < newCount; i++) present = present || newCache[i] == v;
+            if (!present) newCache[newCount++] = v;
+        }
+        for (int i = 0; i < cacheCount; i++) {
+            uint32_t v = cache[i];
+            if (v != corners[0] && v != corners[1] && v != corners[2]) newCache[newCount++] = v;
+        }
+        
+        // Rescore everything that was or is in the cache, and the triangles touching it
+        for (int i = 0; i < newCount; i++) {
+            uint32_t v = newCache[i];
+            int position = i < MESH_OPTIMIZER_CACHE_SIZE ? i : -1;
+            float score = meshOptimizer_vertexScore(position, remaining[v]);
+            float delta = score - vertexScores[v];
+            vertexScores[v] = score;
+            for (uint32_t j = 0; j < remaining[v]; j++) triangleScores[adjacency[offsets[v] + j]] += delta;
+        }
+        
+        cacheCount = newCount < MESH_OPTIMIZER_CACHE_SIZE ? newCount : MESH_OPTIMIZER_CACHE_SIZE;
+        memcpy(cache, newCache, sizeof(uint32_t) * cacheCount);
+        
+        bestTriangle = UINT32_MAX;
+        float bestScore = -1.0f;
+        for (int i = 0; i < cacheCount; i++) {
+            uint32_t v = cache[i];
+            for (uint32_t j = 0; j < remaining[v]; j++) {
+                uint32_t candidate = adjacency[offsets[v] + j];
+                if (triangleScores[candidate] > bestScore) {
+                    bestScore = triangleScores[candidate];
+                    bestTriangle = candidate;
+                }
+            }
+        }
+    }
+    
+    memcpy(indices, output, sizeof(uint32_t) * numTriangles * 3);
+    
+    free(offsets); free(remaining); free(adjacency);
+    free(vertexScores); free(triangleScores); free(emitted); free(output);
+}
+
+// Unnormalized face normal (twice the area)
+static void meshOptimizer_triangleNormal(const float* p0, const float* p1, const float* p2, double* normal) {
+    double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+    double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+    normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+// Push a triangle through a FIFO cache of timestamps (see meshOptimizer_computeACMR); returns
+// its misses. Adding cacheSize + 1 to the clock empties the cache.
+static uint32_t meshOptimizer_cacheTriangle(const uint32_t* corners, uint32_t numVertices, uint32_t* timestamps, uint32_t* clock, int cacheSize) {
+    uint32_t misses = 0;
+    for (int k = 0; k < 3; k++) {
+        uint32_t v = corners[k];
+        if (v >= numVertices) continue;
+        if (timestamps[v] == 0 || *clock - timestamps[v] >= (uint32_t)cacheSize) {
+            (*clock)++;
+            timestamps[v] = *clock;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+// Cluster of consecutive triangles and its overdraw sort key
+typedef struct {
+    uint32_t first;
+    uint32_t count;
+    float key;
+} MeshOverdrawCluster;
+
+static int meshOptimizer_compareClusters(const void* a, const void* b) {
+    const MeshOverdrawCluster* ca = (const MeshOverdrawCluster*)a;
+    const MeshOverdrawCluster* cb = (const MeshOverdrawCluster*)b;
+    if (ca->key != cb->key) return ca->key > cb->key ? -1 : 1;
+    return (ca->first > cb->first) - (ca->first < cb->first);
+}
+
+// Reorder clusters of a cache-optimized triangle order to reduce overdraw (Sander et al., "Fast
+// Triangle Reordering for Vertex Locality and Reduced Overdraw"), in place. The order is cut
+// where the simulated cache starts over, and again wherever the running ACMR has come within
+// threshold of its cluster's. Clusters then draw outermost-facing first, so they tend to occlude
+// the ones behind them.
+void meshOptimizer_optimizeOverdraw(uint32_t* indices, uint32_t numIndices, const MeshVertex* vertices, uint32_t numVertices, float threshold) {
+    uint32_t numTriangles = numIndices / 3;
+    if (numTriangles < 3 || numVertices == 0) return;
+    
+    uint32_t* timestamps = (uint32_t*)calloc(numVertices, sizeof(uint32_t));
+    uint32_t* misses = (uint32_t*)malloc(sizeof(uint32_t) * numTriangles);
+    MeshOverdrawCluster* clusters = (MeshOverdrawCluster*)malloc(sizeof(MeshOverdrawCluster) * numTriangles);
+    uint32_t* output = (uint32_t*)malloc(sizeof(uint32_t) * numTriangles * 3);
+    if (!timestamps || !misses || !clusters || !output) {
+        free(timestamps); free(misses); free(clusters); free(output);
+        return;
+    }
+    
+    // Hard boundaries: triangles that miss on all three vertices start over anyway
+    uint32_t clock = 0;
+    for (uint32_t t = 0; t < numTriangles; t++) {
+        misses[t] = meshOptimizer_cacheTriangle(&indices[t * 3], numVertices, timestamps, &clock, MESH_OPTIMIZER_ACMR_CACHE_SIZE);
+    }
+    
+    // Soft boundaries: within each hard cluster, cut once the running ACMR (from a cold cache)
+    // is within threshold of the whole cluster's
+    uint32_t clusterCount = 0;
+    for (uint32_t start = 0; start < numTriangles; ) {
+        uint32_t end = start + 1;
+        uint32_t hardMisses = misses[start];
+        while (end < numTriangles && misses[end] < 3) hardMisses += misses[end++];
+        float limit = threshold * (float)hardMisses / (float)(end - start);
+        
+        clock += MESH_OPTIMIZER_ACMR_CACHE_SIZE + 1;
+        uint32_t first = start, running = 0;
+        for (uint32_t t = start; t < end; t++) {
+            running += meshOptimizer_cacheTriangle(&indices[t * 3], numVertices, timestamps, &clock, MESH_OPTIMIZER_ACMR_CACHE_SIZE);
+            if (t + 1 < end && (float)running <= limit * (float)(t + 1 - first)) {
+                clusters[clusterCount].first = first;
+                clusters[clusterCount++].count = t + 1 - first;
+                first = t + 1;
+                running = 0;
+                clock += MESH_OPTIMIZER_ACMR_CACHE_SIZE + 1;
+            }
+        }
+        clusters[clusterCount].first = first;
+        clusters[clusterCount++].count = end - first;
+        start = end;
+    }
+    
+    // Area-weighted centroid of the whole mesh
+    double meshCentroid[3] = { 0.0, 0.0, 0.0 };
+    double meshArea = 0.0;
+    for (uint32_t t = 0; t < numTriangles; t++) {
+        const uint32_t* corners = &indices[t * 3];
+        if (corners[0] >= numVertices || corners[1] >= numVertices || corners[2] >= numVertices) continue;
+        double normal[3];
+        meshOptimizer_triangleNormal(vertices[corners[0]].position, vertices[corners[1]].position, vertices[corners[2]].position, normal);
+        double area = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        for (int axis = 0; axis < 3; axis++) {
+            meshCentroid[axis] += area * (vertices[corners[0]].position[axis] + vertices[corners[1]].position[axis] + vertices[corners[2]].position[axis]) / 3.0;
+        }
+        meshArea += area;
+    }
+    if (meshArea > 0.0) {
+        for (int axis = 0; axis < 3; axis++) meshCentroid[axis] /= meshArea;
+    }
+    
+    // Key: how far out along its own facing a cluster sits
+    for (uint32_t c = 0; c < clusterCount; c++) {
+        double centroid[3] = { 0.0, 0.0, 0.0 };
+        double facing[3] = { 0.0, 0.0, 0.0 };
+        double area = 0.0;
+        for (uint32_t t = clusters[c].first; t < clusters[c].first + clusters[c].count; t++) {
+            const uint32_t* corners = &indices[t * 3];
+            if (corners[0] >= numVertices || corners[1] >= numVertices || corners[2] >= numVertices) continue;
+            double normal[3];
+            meshOptimizer_triangleNormal(vertices[corners[0]].position, vertices[corners[1]].position, vertices[corners[2]].position, normal);
+            double triangleArea = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+            for (int axis = 0; axis < 3; axis++) {
+                centroid[axis] += triangleArea * (vertices[corners[0]].position[axis] + vertices[corners[1]].position[axis] + vertices[corners[2]].position[axis]) / 3.0;
+                facing[axis] += normal[axis];
+            }
+            area += triangleArea;
+        }
+        
+        double facingLength = sqrt(facing[0] * facing[0] + facing[1] * facing[1] + facing[2] * facing[2]);
+        double key = 0.0;
+        if (area > 0.0 && facingLength > 0.0) {
+            for (int axis = 0; axis < 3; axis++) key += (centroid[axis] / area - meshCentroid[axis]) * facing[axis] / facingLength;
+        }
+        clusters[c].key = (float)key;
+    }
+    
+    qsort(clusters, clusterCount, sizeof(MeshOverdrawCluster), meshOptimizer_compareClusters);
+    uint32_t written = 0;
+    for (uint32_t c = 0; c < clusterCount; c++) {
+        memcpy(output + written * 3, indices + clusters[c].first * 3, sizeof(uint32_t) * 3 * clusters[c].count);
+        written += clusters[c].count;
+    }
+    memcpy(indices, output, sizeof(uint32_t) * numTriangles * 3);
+    
+    free(timestamps); free(misses); free(clusters); free(output);
+}
+
+// Reorder vertices into first-use order of the index buffer, dropping unreferenced ones;
+// returns the new vertex count
+uint32_t meshOptimizer_optimizeVertexFetch(MeshVertex* vertices, uint32_t* indices, uint32_t numIndices, uint32_t numVertices) {
+    uint32_t* remap = (uint32_t*)malloc(sizeof(uint32_t) * numVertices);
+    MeshVertex* reordered = (MeshVertex*)malloc(sizeof(MeshVertex) * numVertices);
+    if (!remap || !reordered) {
+        free(remap);
+        free(reordered);
+        return numVertices;
+    }
+    memset(remap, 0xFF, sizeof(uint32_t) * numVertices);
+    
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < numIndices; i++) {
+        uint32_t v = indices[i];
+        if (v >= numVertices) continue;
+        if (remap[v] == UINT32_MAX) {
+            remap[v] = next;
+            reordered[next++] = vertices[v];
+        }
+        indices[i] = remap[v];
+    }
+    
+    memcpy(vertices, reordered, sizeof(MeshVertex) * next);
+    free(remap);
+    free(reordered);
+    return next;
+}
+
+// Average cache miss ratio: transformed vertices per triangle through a FIFO cache
+float meshOptimizer_computeACMR(const uint32_t* indices, uint32_t numIndices, uint32_t numVertices, int cacheSize) {
+    if (numIndices < 3) return 0.0f;
+    
+    // Timestamps instead of a queue: a vertex is cached if it was pushed within the last cacheSize misses
+    uint32_t* timestamps = (uint32_t*)calloc(numVertices, sizeof(uint32_t));
+    if (!timestamps) return 0.0f;
+    
+    uint32_t misses = 0;
+    for (uint32_t i = 0; i < numIndices; i++) {
+        uint32_t v = indices[i];
+        if (v >= numVertices) continue;
+        if (timestamps[v] == 0 || misses + 1 - timestamps[v] > (uint32_t)cacheSize) {
+            misses++;
+            timestamps[v] = misses;
+        }
+    }
+    
+    free(timestamps);
+    return (float)misses / (float)(numIndices / 3);
+}
+
+// Signed normalized 10_10_10_2, matching GL_INT_2_10_10_10_REV
+static uint32_t meshOptimizer_packSnorm10(const float* v, float w) {
+    uint32_t packed = 0;
+    for (int i = 0; i < 3; i++) {
+        float c = fmaxf(-1.0f, fminf(1.0f, v[i]));
+        int value = (int)lroundf(c * 511.0f);
+        packed |= ((uint32_t)value & 0x3FFu) << (i * 10);
+    }
+    return packed | (((uint32_t)(int)w & 0x3u) << 30);
+}
+
+// Convert to the quantized layout
+void meshOptimizer_quantize(const MeshVertex* vertices, uint32_t numVertices, QuantizedVertex* quantized) {
+    for (uint32_t i = 0; i < numVertices; i++) {
+        const MeshVertex* vertex = &vertices[i];
+        QuantizedVertex* out = &quantized[i];
+        out->position[0] = meshOptimizer_floatToHalf(vertex->position[0]);
+        out->position[1] = meshOptimizer_floatToHalf(vertex->position[1]);
+        out->position[2] = meshOptimizer_floatToHalf(vertex->position[2]);
+        out->position[3] = meshOptimizer_floatToHalf(1.0f);
+        out->normal = meshOptimizer_packSnorm10(vertex->normal, 0.0f);
+        out->tangent = meshOptimizer_packSnorm10(vertex->tangent, 0.0f);
+        out->texCoords[0] = meshOptimizer_floatToHalf(vertex->texCoords[0]);
+        out->texCoords[1] = meshOptimizer_floatToHalf(vertex->texCoords[1]);
+    }
+}
+
+// Symmetric 4x4 error quadric (plane equations summed, weighted by area)
+typedef struct {
+    double a00, a01, a02, a03;
+    double a11, a12, a13;
+    double a22, a23;
+    double a33;
+    double weight;
+} MeshQuadric;
+
+// One candidate half-edge collapse: vertex from moves onto vertex to
+typedef struct {
+    uint32_t from;
+    uint32_t to;
+    float cost;
+} MeshCollapse;
+
+static void meshOptimizer_addPlane(MeshQuadric* q, double a, double b, double c, double d, double weight) {
+    q->a00 += weight * a * a; q->a01 += weight * a * b; q->a02 += weight * a * c; q->a03 += weight * a * d;
+    q->a11 += weight * b * b; q->a12 += weight * b * c; q->a13 += weight * b * d;
+    q->a22 += weight * c * c; q->a23 += weight * c * d;
+    q->a33 += weight * d * d;
+    q->weight += weight;
+}
+
+static void meshOptimizer_addQuadric(MeshQuadric* q, const MeshQuadric* other) {
+    q->a00 += other->a00; q->a01 += other->a01; q->a02 += other->a02; q->a03 += other->a03;
+    q->a11 += other->a11; q->a12 += other->a12; q->a13 += other->a13;
+    q->a22 += other->a22; q->a23 += other->a23;
+    q->a33 += other->a33;
+    q->weight += other->weight;
+}
+
+// Mean squared distance from p to the quadric's planes
+static double meshOptimizer_evaluateQuadric(const MeshQuadric* q, const float* p) {
+    double x = p[0], y = p[1], z = p[2];
+    double error = q->a00 * x * x + 2.0 * q->a01 * x * y + 2.0 * q->a02 * x * z + 2.0 * q->a03 * x +
+                   q->a11 * y * y + 2.0 * q->a12 * y * z + 2.0 * q->a13 * y +
+                   q->a22 * z * z + 2.0 * q->a23 * z + q->a33;
+    return q->weight > 0.0 ? fabs(error) / q->weight : 0.0;
+}
+
+static int meshOptimizer_compareCollapses(const void* a, const void* b) {
+    float ca = ((const MeshCollapse*)a)->cost;
+    float cb = ((const MeshCollapse*)b)->cost;
+    return ca < cb ? -1 : (ca > cb ? 1 : 0);
+}
+
+static int meshOptimizer_compareEdges(const void* a, const void* b) {
+    uint64_t ea = *(const uint64_t*)a;
+    uint64_t eb = *(const uint64_t*)b;
+    return ea < eb ? -1 : (ea > eb ? 1 : 0);
+}
+
+// Vertices sorted by position, for welding attribute seams
+static const MeshVertex* sortVertices;
+
+static int meshOptimizer_comparePositions(const void* a, const void* b) {
+    const float* pa = sortVertices[*(const uint32_t*)a].position;
+    const float* pb = sortVertices[*(const uint32_t*)b].position;
+    for (int axis = 0; axis < 3; axis++) {
+        if (pa[axis] != pb[axis]) return pa[axis] < pb[axis] ? -1 : 1;
+    }
+    return 0;
+}
+
+// Simplify to at most targetIndices indices with quadric-error half-edge collapses onto existing
+// vertices, so the result shares the vertex buffer. Vertices on attribute seams are locked and
+// border vertices only slide along the border; collapses stop once the error (relative to the
+// mesh radius) would exceed maxError. Returns the new index count; *resultError gets the largest
+// error accepted.
+uint32_t meshOptimizer_simplify(const MeshVertex* vertices, uint32_t numVertices, const uint32_t* indices, uint32_t numIndices,
+                                uint32_t targetIndices, float maxError, uint32_t* output, float* resultError) {
+    memcpy(output, indices, sizeof(uint32_t) * numIndices);
+    if (resultError) *resultError = 0.0f;
+    if (numIndices <= targetIndices || numVertices == 0) return numIndices;
+    
+    uint32_t* sorted = (uint32_t*)malloc(sizeof(uint32_t) * numVertices);
+    uint32_t* canonical = (uint32_t*)malloc(sizeof(uint32_t) * numVertices);
+    bool* seam = (bool*)calloc(numVertices, sizeof(bool));
+    bool* border = (bool*)malloc(sizeof(bool) * numVertices);
+    bool* touched = (bool*)malloc(sizeof(bool) * numVertices);
+    uint32_t* remap = (uint32_t*)malloc(sizeof(uint32_t) * numVertices);
+    uint32_t* offsets = (uint32_t*)malloc(sizeof(uint32_t) * (numVertices + 1));
+    uint32_t* adjacency = (uint32_t*)malloc(sizeof(uint32_t) * numIndices);
+    uint64_t* edges = (uint64_t*)malloc(sizeof(uint64_t) * numIndices);
+    MeshCollapse* collapses = (MeshCollapse*)malloc(sizeof(MeshCollapse) * numIndices * 2);
+    MeshQuadric* quadrics = (MeshQuadric*)calloc(numVertices, sizeof(MeshQuadric));
+    if (!sorted || !canonical || !seam || !border || !touched || !remap || !offsets || !adjacency || !edges || !collapses || !quadrics) {
+        free(sorted); free(canonical); free(seam); free(border); free(touched); free(remap);
+        free(offsets); free(adjacency); free(edges); free(collapses); free(quadrics);
+        return numIndices;
+    }
+    
+    // Radius for scale-independent errors
+    float radius = 0.0f;
+    for (uint32_t v = 0; v < numVertices; v++) {
+        const float* p = vertices[v].position;
+        radius = fmaxf(radius, sqrtf(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]));
+    }
+    float invRadius = radius > 0.0f ? 1.0f / radius : 1.0f;
+    
+    // Weld vertices sharing a position; any group with several wedges is a seam and stays put
+    for (uint32_t v = 0; v < numVertices; v++) sorted[v] = v;
+    sortVertices = vertices;
+    qsort(sorted, numVertices, sizeof(uint32_t), meshOptimizer_comparePositions);
+    for (uint32_t i = 0; i < numVertices; ) {
+        uint32_t end = i + 1;
+        while (end < numVertices && meshOptimizer_comparePositions(&sorted[i], &sorted[end]) == 0) end++;
+        for (uint32_t j = i; j < end; j++) {
+            canonical[sorted[j]] = sorted[i];
+            seam[sorted[j]] = end - i > 1;
+        }
+        i = end;
+    }
+    
+    // Plane quadrics of the original surface, accumulated per welded position
+    for (uint32_t t = 0; t + 2 < numIndices; t += 3) {
+        const float* p0 = vertices[indices[t]].position;
+        const float* p1 = vertices[indices[t + 1]].position;
+        const float* p2 = vertices[indices[t + 2]].position;
+        double normal[3];
+        meshOptimizer_triangleNormal(p0, p1, p2, normal);
+        double length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (length <= 0.0) continue;
+        
+        double a = normal[0] / length, b = normal[1] / length, c = normal[2] / length;
+        double d = -(a * p0[0] + b * p0[1] + c * p0[2]) * invRadius;
+        double area = length * 0.5 * invRadius * invRadius;
+        for (int k = 0; k < 3; k++) {
+            meshOptimizer_addPlane(&quadrics[canonical[indices[t + k]]], a, b, c, d, area);
+        }
+    }
+    
+    uint32_t count = numIndices;
+    float maxCost = maxError * maxError;
+    float acceptedCost = 0.0f;
+    
+    for (int pass = 0; pass < 64 && count > targetIndices; pass++) {
+        uint32_t triangles = count / 3;
+        
+        // Vertex -> triangle lists
+        memset(offsets, 0, sizeof(uint32_t) * (numVertices + 1));
+        for (uint32_t i = 0; i < count; i++) offsets[output[i] + 1]++;
+        for (uint32_t v = 0; v < numVertices; v++) offsets[v + 1] += offsets[v];
+        for (uint32_t i = 0; i < count; i++) adjacency[offsets[output[i]]++] = i / 3;
+        for (uint32_t v = numVertices; v > 0; v--) offsets[v] = offsets[v - 1];
+        offsets[0] = 0;
+        
+        // Border edges: directed welded edges without a twin
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t a = canonical[output[i]];
+            uint32_t b = canonical[output[i - i % 3 + (i + 1) % 3]];
+            edges[i] = ((uint64_t)a << 32) | b;
+        }
+        qsort(edges, count, sizeof(uint64_t), meshOptimizer_compareEdges);
+        memset(border, 0, sizeof(bool) * numVertices);
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t next = i - i % 3 + (i + 1) % 3;
+            uint32_t a = canonical[output[i]];
+            uint32_t b = canonical[output[next]];
+            uint64_t twin = ((uint64_t)b << 32) | a;
+            if (bsearch(&twin, edges, count, sizeof(uint64_t), meshOptimizer_compareEdges)) continue;
+            border[a] = true;
+            border[b] = true;
+            
+            // First pass: keep the outline in place with a plane through the edge, perpendicular to its triangle
+            if (pass == 0) {
+                const float* p0 = vertices[output[i]].position;
+                const float* p1 = vertices[output[next]].position;
+                const float* p2 = vertices[output[i - i % 3 + (i + 2) % 3]].position;
+                double normal[3], plane[3];
+                meshOptimizer_triangleNormal(p0, p1, p2, normal);
+                double edge[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+                plane[0] = edge[1] * normal[2] - edge[2] * normal[1];
+                plane[1] = edge[2] * normal[0] - edge[0] * normal[2];
+                plane[2] = edge[0] * normal[1] - edge[1] * normal[0];
+                double length = sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+                if (length <= 0.0) continue;
+                
+                double pa = plane[0] / length, pb = plane[1] / length, pc = plane[2] / length;
+                double pd = -(pa * p0[0] + pb * p0[1] + pc * p0[2]) * invRadius;
+                double edgeLength2 = (edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2]) * invRadius * invRadius;
+                meshOptimizer_addPlane(&quadrics[a], pa, pb, pc, pd, MESH_SIMPLIFY_BORDER_WEIGHT * edgeLength2);
+                meshOptimizer_addPlane(&quadrics[b], pa, pb, pc, pd, MESH_SIMPLIFY_BORDER_WEIGHT * edgeLength2);
+            }
+        }
+        
+        // Candidate collapses from every triangle edge, both directions
+        uint32_t candidates = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t ends[2] = { output[i], output[i - i % 3 + (i + 1) % 3] };
+            for (int direction = 0; direction < 2; direction++) {
+                uint32_t from = ends[direction];
+                uint32_t to = ends[1 - direction];
+                if (seam[from] || from == to) continue;
+                
+                // Border vertices may only move along a border edge
+                uint32_t cf = canonical[from], ct = canonical[to];
+                if (border[cf]) {
+                    uint64_t forward = ((uint64_t)cf << 32) | ct;
+                    uint64_t backward = ((uint64_t)ct << 32) | cf;
+                    bool hasForward = bsearch(&forward, edges, count, sizeof(uint64_t), meshOptimizer_compareEdges) != NULL;
+                    bool hasBackward = bsearch(&backward, edges, count, sizeof(uint64_t), meshOptimizer_compareEdges) != NULL;
+                    if (hasForward && hasBackward) continue;
+                }
+                
+                MeshQuadric q = quadrics[cf];
+                meshOptimizer_addQuadric(&q, &quadrics[ct]);
+                float target[3] = { vertices[to].position[0] * invRadius, vertices[to].position[1] * invRadius, vertices[to].position[2] * invRadius };
+                double cost = meshOptimizer_evaluateQuadric(&q, target);
+                
+                // Attribute change for the triangles that take on the target's wedge
+                const MeshVertex* vf = &vertices[from];
+                const MeshVertex* vt = &vertices[to];
+                double attribute = 0.0;
+                for (int c = 0; c < 3; c++) attribute += (vf->normal[c] - vt->normal[c]) * (vf->normal[c] - vt->normal[c]);
+                for (int c = 0; c < 2; c++) attribute += (vf->texCoords[c] - vt->texCoords[c]) * (vf->texCoords[c] - vt->texCoords[c]);
+                cost += MESH_SIMPLIFY_ATTRIBUTE_WEIGHT * attribute;
+                
+                collapses[candidates].from = from;
+                collapses[candidates].to = to;
+                collapses[candidates].cost = (float)cost;
+                candidates++;
+            }
+        }
+        qsort(collapses, candidates, sizeof(MeshCollapse), meshOptimizer_compareCollapses);
+        
+        // Apply the cheapest independent collapses until this pass has removed enough triangles
+        for (uint32_t v = 0; v < numVertices; v++) remap[v] = v;
+        memset(touched, 0, sizeof(bool) * numVertices);
+        uint32_t removeGoal = (count - targetIndices) / 3;
+        uint32_t removed = 0;
+        uint32_t applied = 0;
+        for (uint32_t c = 0; c < candidates && removed < removeGoal; c++) {
+            const MeshCollapse* collapse = &collapses[c];
+            if (collapse->cost > maxCost) break;
+            uint32_t from = collapse->from, to = collapse->to;
+            if (touched[from] || touched[to]) continue;
+            
+            // Reject collapses that fold a triangle over
+            bool flips = false;
+            uint32_t lost = 0;
+            for (uint32_t j = offsets[from]; j < offsets[from + 1] && !flips; j++) {
+                const uint32_t* tri = &output[adjacency[j] * 3];
+                if (tri[0] == to || tri[1] == to || tri[2] == to) {
+                    lost++;
+                    continue;
+                }
+                const float* p[3];
+                const float* moved[3];
+                for (int k = 0; k < 3; k++) {
+                    p[k] = vertices[tri[k]].position;
+                    moved[k] = tri[k] == from ? vertices[to].position : p[k];
+                }
+                double before[3], after[3];
+                meshOptimizer_triangleNormal(p[0], p[1], p[2], before);
+                meshOptimizer_triangleNormal(moved[0], moved[1], moved[2], after);
+                double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+                double lengths = sqrt(before[0] * before[0] + before[1] * before[1] + before[2] * before[2]) *
+                                 sqrt(after[0] * after[0] + after[1] * after[1] + after[2] * after[2]);
+                flips = dot <= 0.25 * lengths;
+            }
+            if (flips) continue;
+            
+            // Lock the neighbourhood for the rest of the pass, so checks above stay valid
+            for (uint32_t j = offsets[from]; j < offsets[from + 1]; j++) {
+                const uint32_t* tri = &output[adjacency[j] * 3];
+                touched[tri[0]] = touched[tri[1]] = touched[tri[2]] = true;
+            }
+            touched[to] = true;
+            
+            remap[from] = to;
+            meshOptimizer_addQuadric(&quadrics[canonical[to]], &quadrics[canonical[from]]);
+            acceptedCost = fmaxf(acceptedCost, collapse->cost);
+            removed += lost;
+            applied++;
+        }
+        if (applied == 0) break;
+        
+        // Rewrite the indices, dropping triangles that collapsed
+        uint32_t written = 0;
+        for (uint32_t t = 0; t < triangles; t++) {
+            uint32_t a = remap[output[t * 3]], b = remap[output[t * 3 + 1]], c = remap[output[t * 3 + 2]];
+            if (a == b || b == c || a == c) continue;
+            output[written++] = a;
+            output[written++] = b;
+            output[written++] = c;
+        }
+        count = written;
+    }
+    
+    if (resultError) *resultError = sqrtf(acceptedCost);
+    
+    free(sorted); free(canonical); free(seam); free(border); free(touched); free(remap);
+    free(offsets); free(adjacency); free(edges); free(collapses); free(quadrics);
+    return count;
+}
@@ -1,25 +1,501 @@
 #include "utils/model_loader.h"
+#include "utils/mesh_optimizer.h"
+#include "utils/profiler.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <assimp/cimport.h>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
 
-// Load a model from a file path
+// Imported geometry of one mesh, before upload
+typedef struct {
+    MeshVertex* vertices;
+    QuantizedVertex* quantized;     // Replaces vertices in the VBO and cache when set
+    uint32_t* indices;
+    uint32_t numVertices;
+    uint32_t numIndices;            // All levels, full detail first
+    uint32_t flags;
+    float boundingRadius;
+    uint32_t lodCount;
+    uint32_t lodIndexCounts[MESH_MAX_LODS];
+} MeshData;
+
+// 64-bit FNV-1a over raw bytes, continuing from hash
+static uint64_t model_hashBytes(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Cache key: every build setting that shapes the stored vertices, index order and LOD chain
+static uint64_t model_settingsKey(void) {
+    float settings[10] = { MESH_LOD_LEVELS, MESH_LOD_RATIO, MESH_LOD_MAX_ERROR, MESH_LOD_MIN_TRIANGLES,
+                           MESH_OPTIMIZER_OVERDRAW_THRESHOLD, MESH_OPTIMIZER_CACHE_SIZE, MESH_SIMPLIFY_ATTRIBUTE_WEIGHT,
+                           MESH_SIMPLIFY_BORDER_WEIGHT, MESH_QUANTIZE, MESH_MAX_LODS };
+    return model_hashBytes(14695981039346656037ull, settings, sizeof(settings));
+}
+
+// 64-bit FNV-1a over a string
+static uint64_t model_hashString(const char* text) {
+    uint64_t hash = 14695981039346656037ull;
+    for (const unsigned char* c = (const unsigned char*)text; *c; c++) {
+        hash ^= *c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Cache file path for a source model
+static void model_cachePath(const char* path, char* cachePath, size_t size) {
+    snprintf(cachePath, size, "%s/%016llx.mesh", MESH_CACHE_DIR, (unsigned long long)model_hashString(path));
+}
+
+// Create the cache directory and its parent (existing directories are fine)
+static bool model_makeCacheDir() {
+    char path[256];
+    snprintf(path, sizeof(path), "%s", MESH_CACHE_DIR);
+    
+    for (char* p = path + 1; ; p++) {
+        if (*p != '/' && *p != '\0') continue;
+        
+        char saved = *p;
+        *p = '\0';
+        if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "Failed to create mesh cache directory: %s\n", path);
+            return false;
+        }
+        *p = saved;
+        if (saved == '\0') break;
+    }
+    return true;
+}
+
+static uint64_t model_align(uint64_t offset) {
+    return (offset + MESH_CACHE_ALIGNMENT - 1) & ~(uint64_t)(MESH_CACHE_ALIGNMENT - 1);
+}
+
+// Bytes per vertex for a mesh's cache flags
+static size_t model_vertexStride(uint32_t flags) {
+    return (flags & MESH_CACHE_QUANTIZED) ? sizeof(QuantizedVertex) : sizeof(MeshVertex);
+}
+
+// Vertex attribute layout of MeshVertex or QuantizedVertex; VAO and VBO must be bound
+static void model_setupAttributes(bool quantized) {
+    if (quantized) {
+        GLsizei stride = sizeof(QuantizedVertex);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(QuantizedVertex, position));
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(QuantizedVertex, normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(QuantizedVertex, texCoords));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(QuantizedVertex, tangent));
+        return;
+    }
+    
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void*)offsetof(MeshVertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void*)offsetof(MeshVertex, normal));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void*)offsetof(MeshVertex, texCoords));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(MeshVertex), (void*)offsetof(MeshVertex, tangent));
+}
+
+// Cache entry describing imported mesh data (offsets are filled in by the writer)
+static MeshCacheEntry model_describeMesh(const MeshData* data) {
+    MeshCacheEntry entry;
+    memset(&entry, 0, sizeof(entry));
+    entry.numVertices = data->numVertices;
+    entry.numIndices = data->numIndices;
+    entry.flags = data->flags;
+    entry.boundingRadius = data->boundingRadius;
+    entry.lodCount = data->lodCount;
+    memcpy(entry.lodIndexCounts, data->lodIndexCounts, sizeof(entry.lodIndexCounts));
+    return entry;
+}
+
+// Create the VAO and upload vertices and indices (all levels), one buffer store each
+static void model_uploadMesh(Mesh* mesh, const MeshCacheEntry* entry, const void* vertices, const uint32_t* indices) {
+    uint32_t flags = entry->flags;
+    mesh->numVertices = entry->numVertices;
+    mesh->hasNormals = (flags & MESH_CACHE_NORMALS) != 0;
+    mesh->hasTexCoords = (flags & MESH_CACHE_TEXCOORDS) != 0;
+    mesh->hasTangents = (flags & MESH_CACHE_TANGENTS) != 0;
+    mesh->quantized = (flags & MESH_CACHE_QUANTIZED) != 0;
+    mesh->boundingRadius = entry->boundingRadius;
+    
+    mesh->lodCount = entry->lodCount;
+    unsigned int first = 0;
+    for (uint32_t level = 0; level < entry->lodCount; level++) {
+        mesh->lodFirstIndex[level] = first;
+        mesh->lodIndexCount[level] = entry->lodIndexCounts[level];
+        first += entry->lodIndexCounts[level];
+    }
+    mesh->numIndices = mesh->lodIndexCount[0];
+    
+    glGenVertexArrays(1, &mesh->VAO);
+    glGenBuffers(1, &mesh->VBO);
+    glGenBuffers(1, &mesh->EBO);
+    
+    glBindVertexArray(mesh->VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh->VBO);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(entry->numVertices * model_vertexStride(flags)), vertices, GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh->EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)entry->numIndices * sizeof(uint32_t), indices, GL_STATIC_DRAW);
+    model_setupAttributes(mesh->quantized);
+    
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// Map a cache file and upload every mesh straight from it; false if missing, stale or corrupt
+static bool model_loadCache(Model* model, const char* path, const struct stat* source) {
+    char cachePath[512];
+    model_cachePath(path, cachePath, sizeof(cachePath));
+    
+    int fd = open(cachePath, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(MeshCacheHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t fileSize = (size_t)info.st_size;
+    void* mapping = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) return false;
+    
+    // Without the source (shipped cache) any matching version is accepted; with it, the source
+    // and the build settings must both match
+    const unsigned char* file = (const unsigned char*)mapping;
+    const MeshCacheHeader* header = (const MeshCacheHeader*)file;
+    const MeshCacheEntry* entries = (const MeshCacheEntry*)(file + sizeof(MeshCacheHeader));
+    bool valid = header->magic == MESH_CACHE_MAGIC && header->version == MESH_CACHE_VERSION && header->meshCount > 0 &&
+                 sizeof(MeshCacheHeader) + sizeof(MeshCacheEntry) * (uint64_t)header->meshCount <= fileSize;
+    if (valid && source) {
+        valid = (int64_t)source->st_mtime <= header->sourceTime && (uint64_t)source->st_size == header->sourceSize &&
+                header->settingsKey == model_settingsKey();
+    }
+    for (uint32_t i = 0; valid && i < header->meshCount; i++) {
+        const MeshCacheEntry* entry = &entries[i];
+        uint64_t levelIndices = 0;
+        for (uint32_t level = 0; level < entry->lodCount && level < MESH_MAX_LODS; level++) levelIndices += entry->lodIndexCounts[level];
+        valid = entry->lodCount >= 1 && entry->lodCount <= MESH_MAX_LODS && levelIndices == entry->numIndices &&
+                entry->vertexOffset <= fileSize && (uint64_t)entry->numVertices * model_vertexStride(entry->flags) <= fileSize - entry->vertexOffset &&
+                entry->indexOffset <= fileSize && (uint64_t)entry->numIndices * sizeof(uint32_t) <= fileSize - entry->indexOffset;
+    }
+    if (!valid) {
+        munmap(mapping, fileSize);
+        return false;
+    }
+    
+    model->meshes = (Mesh*)calloc(header->meshCount, sizeof(Mesh));
+    if (!model->meshes) {
+        munmap(mapping, fileSize);
+        return false;
+    }
+    model->numMeshes = header->meshCount;
+    for (uint32_t i = 0; i < header->meshCount; i++) {
+        const MeshCacheEntry* entry = &entries[i];
+        model_uploadMesh(&model->meshes[i], entry, file + entry->vertexOffset, (const uint32_t*)(file + entry->indexOffset));
+    }
+    
+    munmap(mapping, fileSize);
+    return true;
+}
+
+// Write imported meshes to the cache (via a temporary file, so readers never see a partial one)
+static void model_writeCache(const char* path, const struct stat* source, const MeshData* meshes, uint32_t count) {
+    if (!model_makeCacheDir()) return;
+    
+    char cachePath[512], tempPath[520];
+    model_cachePath(path, cachePath, sizeof(cachePath));
+    snprintf(tempPath, sizeof(tempPath), "%s.tmp", cachePath);
+    
+    MeshCacheHeader header = { MESH_CACHE_MAGIC, MESH_CACHE_VERSION, count, 0, (int64_t)source->st_mtime, (uint64_t)source->st_size,
+                               model_settingsKey() };
+    MeshCacheEntry* entries = (MeshCacheEntry*)calloc(count, sizeof(MeshCacheEntry));
+    if (!entries) return;
+    
+    uint64_t offset = sizeof(MeshCacheHeader) + sizeof(MeshCacheEntry) * (uint64_t)count;
+    for (uint32_t i = 0; i < count; i++) {
+        entries[i] = model_describeMesh(&meshes[i]);
+        entries[i].vertexOffset = model_align(offset);
+        offset = entries[i].vertexOffset + (uint64_t)meshes[i].numVertices * model_vertexStride(meshes[i].flags);
+        entries[i].indexOffset = model_align(offset);
+        offset = entries[i].indexOffset + (uint64_t)meshes[i].numIndices * sizeof(uint32_t);
+    }
+    
+    FILE* file = fopen(tempPath, "wb");
+    if (!file) {
+        fprintf(stderr, "Failed to write mesh cache: %s\n", tempPath);
+        free(entries);
+        return;
+    }
+    
+    static const unsigned char padding[MESH_CACHE_ALIGNMENT] = { 0 };
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(entries, sizeof(MeshCacheEntry), count, file) == count;
+    uint64_t written = sizeof(MeshCacheHeader) + sizeof(MeshCacheEntry) * (uint64_t)count;
+    for (uint32_t i = 0; ok && i < count; i++) {
+        size_t stride = model_vertexStride(meshes[i].flags);
+        const void* vertices = meshes[i].quantized ? (const void*)meshes[i].quantized : (const void*)meshes[i].vertices;
+        ok = fwrite(padding, 1, entries[i].vertexOffset - written, file) == entries[i].vertexOffset - written &&
+             fwrite(vertices, stride, meshes[i].numVertices, file) == meshes[i].numVertices;
+        written = entries[i].vertexOffset + (uint64_t)meshes[i].numVertices * stride;
+        ok = ok && fwrite(padding, 1, entries[i].indexOffset - written, file) == entries[i].indexOffset - written &&
+             fwrite(meshes[i].indices, sizeof(uint32_t), meshes[i].numIndices, file) == meshes[i].numIndices;
+        written = entries[i].indexOffset + (uint64_t)meshes[i].numIndices * sizeof(uint32_t);
+    }
+    ok = fclose(file) == 0 && ok;
+    
+    if (!ok || rename(tempPath, cachePath) != 0) {
+        fprintf(stderr, "Failed to write mesh cache: %s\n", cachePath);
+        remove(tempPath);
+    }
+    free(entries);
+}
+
+// Copy one triangulated assimp mesh into the cache vertex layout
+static bool model_convertMesh(const struct aiMesh* source, MeshData* data) {
+    data->numVertices = source->mNumVertices;
+    data->numIndices = 0;
+    data->vertices = (MeshVertex*)calloc(source->mNumVertices, sizeof(MeshVertex));
+    data->indices = (uint32_t*)malloc(sizeof(uint32_t) * 3 * (size_t)source->mNumFaces);
+    if (!data->vertices || !data->indices) return false;
+    
+    data->flags = (source->mNormals ? MESH_CACHE_NORMALS : 0) |
+                  (source->mTextureCoords[0] ? MESH_CACHE_TEXCOORDS : 0) |
+                  (source->mTangents ? MESH_CACHE_TANGENTS : 0);
+    
+    float radiusSq = 0.0f;
+    for (unsigned int i = 0; i < source->mNumVertices; i++) {
+        MeshVertex* vertex = &data->vertices[i];
+        vertex->position[0] = source->mVertices[i].x;
+        vertex->position[1] = source->mVertices[i].y;
+        vertex->position[2] = source->mVertices[i].z;
+        if (source->mNormals) {
+            vertex->normal[0] = source->mNormals[i].x;
+            vertex->normal[1] = source->mNormals[i].y;
+            vertex->normal[2] = source->mNormals[i].z;
+        }
+        if (source->mTextureCoords[0]) {
+            vertex->texCoords[0] = source->mTextureCoords[0][i].x;
+            vertex->texCoords[1] = source->mTextureCoords[0][i].y;
+        }
+        if (source->mTangents) {
+            vertex->tangent[0] = source->mTangents[i].x;
+            vertex->tangent[1] = source->mTangents[i].y;
+            vertex->tangent[2] = source->mTangents[i].z;
+        }
+        
+        float lengthSq = vertex->position[0] * vertex->position[0] + vertex->position[1] * vertex->position[1] + vertex->position[2] * vertex->position[2];
+        if (lengthSq > radiusSq) radiusSq = lengthSq;
+    }
+    data->boundingRadius = sqrtf(radiusSq);
+    
+    // Points and lines are skipped (triangulation has already split polygons), as are triangles
+    // that repeat an index and so cover no area
+    for (unsigned int i = 0; i < source->mNumFaces; i++) {
+        const struct aiFace* face = &source->mFaces[i];
+        if (face->mNumIndices != 3) continue;
+        if (face->mIndices[0] == face->mIndices[1] || face->mIndices[1] == face->mIndices[2] ||
+            face->mIndices[0] == face->mIndices[2]) continue;
+        data->indices[data->numIndices++] = face->mIndices[0];
+        data->indices[data->numIndices++] = face->mIndices[1];
+        data->indices[data->numIndices++] = face->mIndices[2];
+    }
+    
+    data->lodCount = 1;
+    data->lodIndexCounts[0] = data->numIndices;
+    return data->numIndices > 0;
+}
+
+// Append simplified levels after full detail, each from the one before, until one barely shrinks
+static void model_buildLods(MeshData* data) {
+    uint32_t levels = MESH_LOD_LEVELS < MESH_MAX_LODS ? MESH_LOD_LEVELS : MESH_MAX_LODS;
+    if (levels < 2 || data->lodIndexCounts[0] / 3 < MESH_LOD_MIN_TRIANGLES) return;
+    
+    uint32_t previousFirst = 0, previousCount = data->lodIndexCounts[0], total = previousCount;
+    for (uint32_t level = 1; level < levels; level++) {
+        uint32_t target = (uint32_t)(previousCount * MESH_LOD_RATIO) / 3 * 3;
+        if (target / 3 < MESH_LOD_MIN_TRIANGLES / 2) break;
+        
+        // The simplifier may write up to its input size
+        uint32_t* indices = (uint32_t*)realloc(data->indices, sizeof(uint32_t) * ((size_t)total + previousCount));
+        if (!indices) break;
+        data->indices = indices;
+        
+        float error = 0.0f;
+        uint32_t count = meshOptimizer_simplify(data->vertices, data->numVertices, data->indices + previousFirst, previousCount,
+                                                target, MESH_LOD_MAX_ERROR, data->indices + total, &error);
+        if (count == 0 || count > previousCount - previousCount / 10) break;
+        
+        meshOptimizer_optimizeVertexCache(data->indices + total, count, data->numVertices);
+        meshOptimizer_optimizeOverdraw(data->indices + total, count, data->vertices, data->numVertices, MESH_OPTIMIZER_OVERDRAW_THRESHOLD);
+        data->lodIndexCounts[level] = count;
+        data->lodCount = level + 1;
+        previousFirst = total;
+        previousCount = count;
+        total += count;
+    }
+    data->numIndices = total;
+}
+
+// Reorder for the post-transform cache and then overdraw, build the LOD chain, reorder for vertex
+// fetch, then quantize
+static void model_optimizeMesh(MeshData* data, MeshOptimizeStats* stats) {
+    uint32_t baseIndices = data->lodIndexCounts[0];
+    stats->acmrBefore = meshOptimizer_computeACMR(data->indices, baseIndices, data->numVertices, MESH_OPTIMIZER_ACMR_CACHE_SIZE);
+    stats->vertexBytesBefore = (size_t)data->numVertices * sizeof(MeshVertex);
+    
+    meshOptimizer_optimizeVertexCache(data->indices, baseIndices, data->numVertices);
+    meshOptimizer_optimizeOverdraw(data->indices, baseIndices, data->vertices, data->numVertices, MESH_OPTIMIZER_OVERDRAW_THRESHOLD);
+    model_buildLods(data);
+    data->numVertices = meshOptimizer_optimizeVertexFetch(data->vertices, data->indices, data->numIndices, data->numVertices);
+    
+#if MESH_QUANTIZE
+    data->quantized = (QuantizedVertex*)malloc(sizeof(QuantizedVertex) * (data->numVertices ? data->numVertices : 1));
+    if (data->quantized) {
+        meshOptimizer_quantize(data->vertices, data->numVertices, data->quantized);
+        data->flags |= MESH_CACHE_QUANTIZED;
+    }
+#endif
+    
+    stats->acmrAfter = meshOptimizer_computeACMR(data->indices, baseIndices, data->numVertices, MESH_OPTIMIZER_ACMR_CACHE_SIZE);
+    stats->vertexBytesAfter = (size_t)data->numVertices * model_vertexStride(data->flags);
+}
+
+// Import through assimp, optimize, upload, and refresh the cache
+static bool model_import(Model* model, const char* path, const struct stat* source) {
+    const struct aiScene* scene = aiImportFile(path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_GenSmoothNormals |
+                                                     aiProcess_CalcTangentSpace | aiProcess_PreTransformVertices | aiProcess_SortByPType |
+                                                     aiProcess_FlipUVs);
+    if (!scene || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE) || !scene->mRootNode) {
+        fprintf(stderr, "Failed to import model %s: %s\n", path, aiGetErrorString());
+        if (scene) aiReleaseImport(scene);
+        return false;
+    }
+    
+    // Point and line meshes are skipped
+    MeshData* meshes = (MeshData*)calloc(scene->mNumMeshes ? scene->mNumMeshes : 1, sizeof(MeshData));
+    uint32_t count = 0;
+    bool ok = meshes != NULL;
+    for (unsigned int i = 0; ok && i < scene->mNumMeshes; i++) {
+        const struct aiMesh* source = scene->mMeshes[i];
+        if (!(source->mPrimitiveTypes & aiPrimitiveType_TRIANGLE)) continue;
+        
+        if (model_convertMesh(source, &meshes[count])) {
+            count++;
+        } else {
+            free(meshes[count].vertices);
+            free(meshes[count].indices);
+            meshes[count].vertices = NULL;
+            meshes[count].indices = NULL;
+        }
+    }
+    aiReleaseImport(scene);
+    
+    if (ok && count == 0) {
+        fprintf(stderr, "Model has no triangle meshes: %s\n", path);
+        ok = false;
+    }
+    if (ok) {
+        model->meshes = (Mesh*)calloc(count, sizeof(Mesh));
+        ok = model->meshes != NULL;
+    }
+    
+    if (ok) {
+        // ACMR is weighted by triangle count across meshes
+        double acmrBefore = 0.0, acmrAfter = 0.0;
+        size_t bytesBefore = 0, bytesAfter = 0, triangles = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            MeshOptimizeStats stats;
+            model_optimizeMesh(&meshes[i], &stats);
+            size_t meshTriangles = meshes[i].lodIndexCounts[0] / 3;
+            acmrBefore += stats.acmrBefore * meshTriangles;
+            acmrAfter += stats.acmrAfter * meshTriangles;
+            bytesBefore += stats.vertexBytesBefore;
+            bytesAfter += stats.vertexBytesAfter;
+            triangles += meshTriangles;
+        }
+        printf("Optimized model %s: ACMR %.3f -> %.3f, vertex bytes %zu -> %zu\n",
+               path, acmrBefore / triangles, acmrAfter / triangles, bytesBefore, bytesAfter);
+        
+        // Triangles per level summed over meshes; meshes with fewer levels repeat their coarsest
+        size_t lodTriangles[MESH_MAX_LODS] = {0};
+        uint32_t lodLevels = 1;
+        for (uint32_t i = 0; i < count; i++) {
+            if (meshes[i].lodCount > lodLevels) lodLevels = meshes[i].lodCount;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            for (uint32_t level = 0; level < lodLevels; level++) {
+                uint32_t source = level < meshes[i].lodCount ? level : meshes[i].lodCount - 1;
+                lodTriangles[level] += meshes[i].lodIndexCounts[source] / 3;
+            }
+        }
+        printf("LOD chain for %s:", path);
+        for (uint32_t level = 0; level < lodLevels; level++) printf(" %zu", lodTriangles[level]);
+        printf(" triangles\n");
+        
+        model->numMeshes = count;
+        for (uint32_t i = 0; i < count; i++) {
+            const void* vertices = meshes[i].quantized ? (const void*)meshes[i].quantized : (const void*)meshes[i].vertices;
+            MeshCacheEntry layout = model_describeMesh(&meshes[i]);
+            model_uploadMesh(&model->meshes[i], &layout, vertices, meshes[i].indices);
+        }
+        if (source) model_writeCache(path, source, meshes, count);
+    }
+    
+    for (uint32_t i = 0; meshes && i < count; i++) {
+        free(meshes[i].vertices);
+        free(meshes[i].quantized);
+        free(meshes[i].indices);
+    }
+    free(meshes);
+    return ok;
+}
+
+// Load a model from a file path, from the mesh cache unless the source is newer
 Model* model_load(const char* path) {
-    // This is a placeholder implementation
-    // In a real implementation, this would use assimp to load the model
-    printf("Loading model: %s\n", path);
+    double start = profiler_now();
     
-    Model* model = (Model*)malloc(sizeof(Model));
+    Model* model = (Model*)calloc(1, sizeof(Model));
     if (!model) {
         fprintf(stderr, "Failed to allocate memory for model\n");
         return NULL;
     }
-    
-    // Initialize with empty values
-    model->meshes = NULL;
-    model->numMeshes = 0;
     model->name = strdup(path);
     model->path = strdup(path);
     
+    struct stat source;
+    bool hasSource = stat(path, &source) == 0;
+    bool cached = model_loadCache(model, path, hasSource ? &source : NULL);
+    if (!cached && !model_import(model, path, hasSource ? &source : NULL)) {
+        model_cleanup(model);
+        return NULL;
+    }
+    
+    unsigned int vertices = 0, triangles = 0, levels = 1;
+    for (unsigned int i = 0; i < model->numMeshes; i++) {
+        vertices += model->meshes[i].numVertices;
+        triangles += model->meshes[i].numIndices / 3;
+        if (model->meshes[i].lodCount > levels) levels = model->meshes[i].lodCount;
+    }
+    printf("Loaded model %s (%s): %u meshes, %u vertices, %u triangles, %u LODs in %.2f ms\n",
+           path, cached ? "mesh cache" : "assimp import", model->numMeshes, vertices, triangles, levels, profiler_now() - start);
+    
     return model;
 }
 
@@ -71,4 +547,18 @@ void model_renderMesh(Mesh* mesh, GLuint shader) {
     
     // Unbind VAO
     glBindVertexArray(0);
-} 
\ No newline at end of file
+}
+
+// Pick a level from projected size (bounding radius over distance, scaled by the projection and LOD bias)
+unsigned int model_selectLod(const Mesh* mesh, float screenSize) {
+    if (!mesh || mesh->lodCount < 2) return 0;
+    
+    // Each level halves the triangle count, so it takes over at half the size of the one before
+    unsigned int level = 0;
+    float threshold = MESH_LOD_SCREEN_SIZE;
+    while (level + 1 < mesh->lodCount && screenSize < threshold) {
+        level++;
+        threshold *= 0.5f;
+    }
+    return level;
+}
\ No newline at end of file
@@ -0,0 +1,440 @@
+#include "utils/profiler.h"
+#include "wonderlands.h"
+#include <time.h>
+
+// Open CPU scope
+typedef struct {
+    int scope;
+    double start;
+} CpuMarker;
+
+// One frame's worth of GPU timestamp queries
+typedef struct {
+    GLuint queries[PROFILER_MAX_GPU_SCOPES * 2];
+    int scope[PROFILER_MAX_GPU_SCOPES];
+    int depth[PROFILER_MAX_GPU_SCOPES];
+    int count;
+    int lastQuery;              // Query issued last; timestamps complete in order
+    bool pending;
+    
+    // Clock correlation, taken when the frame started
+    double cpuBase;
+    GLint64 gpuBase;
+    
+    // Trace frame the results belong to
+    int traceSlot;
+    unsigned int traceFrame;
+} GpuFrame;
+
+// Recorded frame for trace export
+typedef struct {
+    ProfileEvent events[PROFILER_MAX_EVENTS];
+    int count;
+    unsigned int frame;
+} TraceFrame;
+
+// Profiler state
+static bool initialized = false;
+static bool frameActive = false;
+static unsigned int frameNumber = 0;
+static double epoch = 0.0;
+
+static ProfileScopeStats scopes[PROFILER_MAX_SCOPES];
+static float frameTotals[PROFILER_MAX_SCOPES];
+static bool frameTouched[PROFILER_MAX_SCOPES];
+static int scopeCount = 0;
+
+static CpuMarker cpuStack[PROFILER_MAX_DEPTH];
+static int cpuDepth = 0;
+
+static GpuFrame gpuFrames[PROFILER_GPU_LATENCY];
+static int gpuFrameIndex = 0;
+static int gpuStack[PROFILER_MAX_DEPTH];
+static int gpuDepth = 0;
+static unsigned int droppedGpuFrames = 0;
+
+static TraceFrame* traceFrames = NULL;
+static int traceHead = 0;
+static int traceCount = 0;
+
+static ProfileCounter counters[PROFILER_MAX_COUNTERS];
+static int counterCount = 0;
+static bool counterOverflowReported = false;
+
+static int frameScopeCPU = -1;
+static int frameScopeGPU = -1;
+
+// Current time in milliseconds since the profiler started
+double profiler_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1.0e6 - epoch;
+}
+
+// Find or register a scope by name and domain
+static int profiler_findScope(const char* name, ProfileDomain domain, int depth) {
+    for (int i = 0; i < scopeCount; i++) {
+        if (scopes[i].domain == domain && strcmp(scopes[i].name, name) == 0) {
+            return i;
+        }
+    }
+    
+    if (scopeCount >= PROFILER_MAX_SCOPES) {
+        return -1;
+    }
+    
+    ProfileScopeStats* stats = &scopes[scopeCount];
+    memset(stats, 0, sizeof(ProfileScopeStats));
+    stats->name = name;
+    stats->domain = domain;
+    stats->depth = depth;
+    return scopeCount++;
+}
+
+// Push one per-frame total into a scope's history
+static void profiler_pushSample(int scope, float value) {
+    ProfileScopeStats* stats = &scopes[scope];
+    stats->history[stats->historyIndex] = value;
+    stats->historyIndex = (stats->historyIndex + 1) % PROFILER_HISTORY;
+    if (stats->historyCount < PROFILER_HISTORY) stats->historyCount++;
+    stats->last = value;
+}
+
+// Append an event to a recorded trace frame
+static void profiler_recordEvent(int slot, unsigned int frame, int scope, int depth, double start, double duration) {
+    if (!traceFrames) return;
+    
+    TraceFrame* trace = &traceFrames[slot];
+    if (trace->frame != frame || trace->count >= PROFILER_MAX_EVENTS) return;
+    
+    ProfileEvent* event = &trace->events[trace->count++];
+    event->scope = (short)scope;
+    event->depth = (short)depth;
+    event->start = start;
+    event->duration = duration;
+}
+
+// Read back a GPU frame's timestamps; returns false if they are not ready yet
+static bool profiler_resolveGpuFrame(GpuFrame* gpu, bool wait) {
+    if (!gpu->pending) return true;
+    
+    if (gpu->count > 0 && !wait) {
+        // Scopes nest, so the last scope to begin is not the last to end (the frame scope is)
+        GLint available = 0;
+        glGetQueryObjectiv(gpu->queries[gpu->lastQuery], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) return false;
+    }
+    
+    float totals[PROFILER_MAX_SCOPES] = {0};
+    bool touched[PROFILER_MAX_SCOPES] = {false};
+    
+    for (int i = 0; i < gpu->count; i++) {
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(gpu->queries[i * 2], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(gpu->queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+        
+        double duration = (double)(end - begin) / 1.0e6;
+        double start = gpu->cpuBase + (double)((GLint64)begin - gpu->gpuBase) / 1.0e6;
+        
+        int scope = gpu->scope[i];
+        totals[scope] += (float)duration;
+        touched[scope] = true;
+        profiler_recordEvent(gpu->traceSlot, gpu->traceFrame, scope, gpu->depth[i], start, duration);
+    }
+    
+    for (int i = 0; i < scopeCount; i++) {
+        if (touched[i]) profiler_pushSample(i, totals[i]);
+    }
+    
+    gpu->pending = false;
+    gpu->count = 0;
+    return true;
+}
+
+// Initialize profiler
+void profiler_init() {
+    if (initialized) return;
+    
+    epoch = 0.0;
+    epoch = profiler_now();
+    
+    scopeCount = 0;
+    counterCount = 0;
+    counterOverflowReported = false;
+    cpuDepth = 0;
+    gpuDepth = 0;
+    frameNumber = 0;
+    
+    for (int i = 0; i < PROFILER_GPU_LATENCY; i++) {
+        glGenQueries(PROFILER_MAX_GPU_SCOPES * 2, gpuFrames[i].queries);
+        gpuFrames[i].count = 0;
+        gpuFrames[i].pending = false;
+    }
+    gpuFrameIndex = 0;
+    
+    traceFrames = (TraceFrame*)calloc(PROFILER_TRACE_FRAMES, sizeof(TraceFrame));
+    if (!traceFrames) {
+        fprintf(stderr, "Failed to allocate profiler trace buffer\n");
+    }
+    traceHead = 0;
+    traceCount = 0;
+    
+    frameScopeCPU = profiler_findScope("Frame", PROFILE_CPU, 0);
+    frameScopeGPU = profiler_findScope("Frame", PROFILE_GPU, 0);
+    
+    initialized = true;
+}
+
+// Clean up profiler
+void profiler_cleanup() {
+    if (!initialized) return;
+    
+    for (int i = 0; i < PROFILER_GPU_LATENCY; i++) {
+        glDeleteQueries(PROFILER_MAX_GPU_SCOPES * 2, gpuFrames[i].queries);
+    }
+    
+    free(traceFrames);
+    traceFrames = NULL;
+    
+    if (droppedGpuFrames > 0) {
+        printf("Profiler dropped %u GPU frames that were not ready in time\n", droppedGpuFrames);
+    }
+    
+    initialized = false;
+}
+
+// Begin a new profiled frame
+void profiler_beginFrame() {
+    if (!initialized || frameActive) return;
+    
+    frameNumber++;
+    
+    // Claim a trace slot for this frame
+    if (traceFrames) {
+        traceHead = (traceHead + 1) % PROFILER_TRACE_FRAMES;
+        if (traceCount < PROFILER_TRACE_FRAMES) traceCount++;
+        traceFrames[traceHead].count = 0;
+        traceFrames[traceHead].frame = frameNumber;
+    }
+    
+    // Reuse the oldest query set; its results are PROFILER_GPU_LATENCY frames old
+    gpuFrameIndex = (gpuFrameIndex + 1) % PROFILER_GPU_LATENCY;
+    GpuFrame* gpu = &gpuFrames[gpuFrameIndex];
+    if (!profiler_resolveGpuFrame(gpu, false)) {
+        // Never stall the pipeline for statistics
+        gpu->pending = false;
+        gpu->count = 0;
+        droppedGpuFrames++;
+    }
+    
+    gpu->cpuBase = profiler_now();
+    glGetInteger64v(GL_TIMESTAMP, &gpu->gpuBase);
+    gpu->traceSlot = traceHead;
+    gpu->traceFrame = frameNumber;
+    
+    memset(frameTotals, 0, sizeof(frameTotals));
+    memset(frameTouched, 0, sizeof(frameTouched));
+    cpuDepth = 0;
+    gpuDepth = 0;
+    frameActive = true;
+    
+    profiler_beginCPU("Frame");
+    profiler_beginGPU("Frame");
+}
+
+// End the current frame and fold CPU totals into the history
+void profiler_endFrame() {
+    if (!frameActive) return;
+    
+    // Close the frame scopes, plus any left open by early returns
+    while (gpuDepth > 0) profiler_endGPU();
+    while (cpuDepth > 0) profiler_endCPU();
+    
+    for (int i = 0; i < scopeCount; i++) {
+        if (frameTouched[i]) profiler_pushSample(i, frameTotals[i]);
+    }
+    
+    // Publish this frame's counters
+    for (int i = 0; i < counterCount; i++) {
+        counters[i].value = counters[i].frameValue;
+        counters[i].frameValue = 0.0;
+    }
+    
+    gpuFrames[gpuFrameIndex].pending = gpuFrames[gpuFrameIndex].count > 0;
+    frameActive = false;
+}
+
+// Begin a CPU scope
+void profiler_beginCPU(const char* name) {
+    if (!frameActive || cpuDepth >= PROFILER_MAX_DEPTH) return;
+    
+    CpuMarker* marker = &cpuStack[cpuDepth];
+    marker->scope = profiler_findScope(name, PROFILE_CPU, cpuDepth);
+    marker->start = profiler_now();
+    cpuDepth++;
+}
+
+// End the innermost CPU scope
+void profiler_endCPU() {
+    if (!frameActive || cpuDepth <= 0) return;
+    
+    cpuDepth--;
+    CpuMarker* marker = &cpuStack[cpuDepth];
+    if (marker->scope < 0) return;
+    
+    double duration = profiler_now() - marker->start;
+    frameTotals[marker->scope] += (float)duration;
+    frameTouched[marker->scope] = true;
+    profiler_recordEvent(traceHead, frameNumber, marker->scope, cpuDepth, marker->start, duration);
+}
+
+// Begin a GPU scope (timestamp queries nest, unlike GL_TIME_ELAPSED)
+void profiler_beginGPU(const char* name) {
+    if (!frameActive || gpuDepth >= PROFILER_MAX_DEPTH) return;
+    
+    GpuFrame* gpu = &gpuFrames[gpuFrameIndex];
+    int scope = profiler_findScope(name, PROFILE_GPU, gpuDepth);
+    if (scope < 0 || gpu->count >= PROFILER_MAX_GPU_SCOPES) {
+        gpuStack[gpuDepth++] = -1;
+        return;
+    }
+    
+    int slot = gpu->count++;
+    gpu->scope[slot] = scope;
+    gpu->depth[slot] = gpuDepth;
+    glQueryCounter(gpu->queries[slot * 2], GL_TIMESTAMP);
+    
+    gpuStack[gpuDepth++] = slot;
+}
+
+// End the innermost GPU scope
+void profiler_endGPU() {
+    if (!frameActive || gpuDepth <= 0) return;
+    
+    int slot = gpuStack[--gpuDepth];
+    if (slot < 0) return;
+    
+    GpuFrame* gpu = &gpuFrames[gpuFrameIndex];
+    glQueryCounter(gpu->queries[slot * 2 + 1], GL_TIMESTAMP);
+    gpu->lastQuery = slot * 2 + 1;
+}
+
+// Sort helper for percentiles
+static int profiler_compareFloat(const void* a, const void* b) {
+    float fa = *(const float*)a;
+    float fb = *(const float*)b;
+    return (fa > fb) - (fa < fb);
+}
+
+// Get all scopes with up-to-date rolling statistics
+const ProfileScopeStats* profiler_getStats(int* count) {
+    float sorted[PROFILER_HISTORY];
+    
+    for (int i = 0; i < scopeCount; i++) {
+        ProfileScopeStats* stats = &scopes[i];
+        int n = stats->historyCount;
+        if (n == 0) continue;
+        
+        float sum = 0.0f;
+        float max = 0.0f;
+        for (int j = 0; j < n; j++) {
+            sorted[j] = stats->history[j];
+            sum += sorted[j];
+            if (sorted[j] > max) max = sorted[j];
+        }
+        qsort(sorted, n, sizeof(float), profiler_compareFloat);
+        
+        stats->average = sum / n;
+        stats->max = max;
+        stats->p95 = sorted[(int)((n - 1) * 0.95f)];
+    }
+    
+    if (count) *count = scopeCount;
+    return scopes;
+}
+
+// Add to a named per-frame counter
+void profiler_addCounter(const char* name, double value) {
+    if (!initialized) return;
+    
+    for (int i = 0; i < counterCount; i++) {
+        if (strcmp(counters[i].name, name) == 0) {
+            counters[i].frameValue += value;
+            return;
+        }
+    }
+    
+    if (counterCount >= PROFILER_MAX_COUNTERS) {
+        if (!counterOverflowReported) {
+            fprintf(stderr, "Profiler counter table full (%d), dropping \"%s\" and any later counters\n",
+                    PROFILER_MAX_COUNTERS, name);
+            counterOverflowReported = true;
+        }
+        return;
+    }
+    
+    ProfileCounter* counter = &counters[counterCount++];
+    counter->name = name;
+    counter->value = 0.0;
+    counter->frameValue = value;
+}
+
+// Get all counters with last frame's values
+const ProfileCounter* profiler_getCounters(int* count) {
+    if (count) *count = counterCount;
+    return counters;
+}
+
+// Last complete CPU frame time
+float profiler_getCPUFrameTime() {
+    return frameScopeCPU >= 0 ? scopes[frameScopeCPU].last : 0.0f;
+}
+
+// Last resolved GPU frame time (PROFILER_GPU_LATENCY frames old)
+float profiler_getGPUFrameTime() {
+    return frameScopeGPU >= 0 ? scopes[frameScopeGPU].last : 0.0f;
+}
+
+// Write recorded frames to a Chrome trace (chrome://tracing, Perfetto)
+bool profiler_exportChromeTrace(const char* path) {
+    if (!traceFrames) return false;
+    
+    // Flush outstanding GPU results so the newest frames are complete
+    for (int i = 0; i < PROFILER_GPU_LATENCY; i++) {
+        if (i != gpuFrameIndex || !frameActive) {
+            profiler_resolveGpuFrame(&gpuFrames[i], true);
+        }
+    }
+    
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Failed to open trace file: %s\n", path);
+        return false;
+    }
+    
+    fprintf(file, "{\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+    fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+    
+    int eventCount = 0;
+    int first = (traceHead - traceCount + 1 + PROFILER_TRACE_FRAMES) % PROFILER_TRACE_FRAMES;
+    for (int f = 0; f < traceCount; f++) {
+        TraceFrame* trace = &traceFrames[(first + f) % PROFILER_TRACE_FRAMES];
+        for (int i = 0; i < trace->count; i++) {
+            ProfileEvent* event = &trace->events[i];
+            ProfileScopeStats* stats = &scopes[event->scope];
+            bool gpu = stats->domain == PROFILE_GPU;
+            
+            fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%u}}",
+                    stats->name, gpu ? "gpu" : "cpu", gpu ? 2 : 1,
+                    event->start * 1000.0, event->duration * 1000.0, trace->frame);
+            eventCount++;
+        }
+    }
+    
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    fclose(file);
+    
+    printf("Exported %d profiler events from %d frames to %s\n", eventCount, traceCount, path);
+    return true;
+}
@@ -1,4 +1,39 @@
 #include "utils/shader_loader.h"
+#include <stdint.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+// Cached uniform location (open addressing, keyed by FNV-1a name hash)
+typedef struct {
+    uint32_t hash;
+    char* name;
+    GLint location;
+} UniformEntry;
+
+// Uniform table for one linked program
+typedef struct {
+    GLuint program;
+    UniformEntry* entries;
+    unsigned int capacity;
+} ProgramUniforms;
+
+static ProgramUniforms programs[SHADER_MAX_PROGRAMS];
+static int programCount = 0;
+static int lastProgramIndex = -1;
+static GLuint currentProgram = 0;
+static ShaderStats stats;
+
+// Per-frame and per-object uniform buffers
+static GLuint frameBuffer = 0;
+static GLuint objectBuffer = 0;
+static unsigned char* objectStaging = NULL;
+static size_t objectCapacity = 0;
+static size_t objectStride = 0;
+static size_t objectHead = 0;
+static size_t objectFlushed = 0;
+static unsigned int objectSegment = 0;
+static GLintptr boundObjectOffset = -1;
+static float lastFrameTime = -1.0f;
 
 // Read file contents
 static char* readFile(const char* filePath) {
@@ -48,47 +83,405 @@ static GLuint compileShader(GLenum type, const char* source) {
     return shader;
 }
 
-// Load vertex and fragment shaders
-GLuint shader_load(const char* vertexPath, const char* fragmentPath) {
-    char* vertexSource = readFile(vertexPath);
-    char* fragmentSource = readFile(fragmentPath);
+// FNV-1a hash of a uniform name
+static uint32_t hashName(const char* name) {
+    uint32_t hash = 2166136261u;
+    while (*name) {
+        hash ^= (unsigned char)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Find the uniform table for a program, or NULL if it was not loaded here
+static ProgramUniforms* findProgram(GLuint program) {
+    if (lastProgramIndex >= 0 && programs[lastProgramIndex].program == program) {
+        return &programs[lastProgramIndex];
+    }
     
-    if (!vertexSource || !fragmentSource) {
-        if (vertexSource) free(vertexSource);
-        if (fragmentSource) free(fragmentSource);
-        return 0;
+    for (int i = 0; i < programCount; i++) {
+        if (programs[i].program == program) {
+            lastProgramIndex = i;
+            return &programs[i];
+        }
     }
     
-    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexSource);
-    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentSource);
+    return NULL;
+}
+
+// Insert a name/location pair into a program's table
+static void insertUniform(ProgramUniforms* info, const char* name, GLint location) {
+    uint32_t hash = hashName(name);
+    unsigned int mask = info->capacity - 1;
     
-    free(vertexSource);
-    free(fragmentSource);
+    for (unsigned int probe = 0; probe < info->capacity; probe++) {
+        UniformEntry* entry = &info->entries[(hash + probe) & mask];
+        if (!entry->name) {
+            entry->hash = hash;
+            entry->name = strdup(name);
+            entry->location = location;
+            return;
+        }
+        if (entry->hash == hash && strcmp(entry->name, name) == 0) {
+            return;
+        }
+    }
+}
+
+// Free a program's table and remove it from the registry
+static void releaseProgram(GLuint program) {
+    ProgramUniforms* info = findProgram(program);
+    if (!info) return;
     
-    if (!vertexShader || !fragmentShader) {
-        return 0;
+    for (unsigned int i = 0; i < info->capacity; i++) {
+        free(info->entries[i].name);
     }
+    free(info->entries);
     
-    // Create shader program
-    GLuint program = glCreateProgram();
-    glAttachShader(program, vertexShader);
-    glAttachShader(program, fragmentShader);
-    glLinkProgram(program);
+    *info = programs[--programCount];
+    lastProgramIndex = -1;
+}
+
+// Reflect active uniforms into a hashed table and bind the shared uniform blocks
+static void registerProgram(GLuint program) {
+    releaseProgram(program);
+    if (programCount >= SHADER_MAX_PROGRAMS) {
+        fprintf(stderr, "Uniform cache full, program %u will query locations directly\n", program);
+        return;
+    }
     
-    // Check linking status
-    GLint success;
-    glGetProgramiv(program, GL_LINK_STATUS, &success);
-    if (!success) {
-        GLchar infoLog[512];
-        glGetProgramInfoLog(program, sizeof(infoLog), NULL, infoLog);
-        fprintf(stderr, "Shader program linking error: %s\n", infoLog);
-        return 0;
+    GLint uniformCount = 0;
+    GLint maxLength = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &uniformCount);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    
+    // Arrays get one entry per element plus the bare name
+    size_t nameSize = (size_t)maxLength + 16;
+    char* name = (char*)malloc(nameSize);
+    char* elementName = (char*)malloc(nameSize);
+    unsigned int required = 0;
+    for (GLint i = 0; i < uniformCount; i++) {
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(program, (GLuint)i, (GLsizei)nameSize, NULL, &size, &type, name);
+        required += (unsigned int)size + 1;
     }
     
-    // Clean up
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    unsigned int capacity = 16;
+    while (capacity < required * 2) capacity <<= 1;
+    
+    ProgramUniforms* info = &programs[programCount++];
+    info->program = program;
+    info->capacity = capacity;
+    info->entries = (UniformEntry*)calloc(capacity, sizeof(UniformEntry));
+    
+    for (GLint i = 0; i < uniformCount; i++) {
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(program, (GLuint)i, (GLsizei)nameSize, NULL, &size, &type, name);
+        
+        // Uniform block members have no location
+        GLint location = glGetUniformLocation(program, name);
+        stats.locationQueries++;
+        if (location < 0) continue;
+        
+        char* bracket = strstr(name, "[0]");
+        if (bracket && bracket[3] == '\0') {
+            *bracket = '\0';
+            insertUniform(info, name, location);
+            for (GLint element = 0; element < size; element++) {
+                snprintf(elementName, nameSize, "%s[%d]", name, element);
+                GLint elementLocation = element == 0 ? location : glGetUniformLocation(program, elementName);
+                if (element > 0) stats.locationQueries++;
+                insertUniform(info, elementName, elementLocation);
+            }
+        } else {
+            insertUniform(info, name, location);
+        }
+    }
+    
+    free(name);
+    free(elementName);
+    
+    // Shared uniform blocks (GLSL 4.10 has no layout(binding) for blocks)
+    GLuint frameIndex = glGetUniformBlockIndex(program, "FrameData");
+    if (frameIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program, frameIndex, SHADER_FRAME_BINDING);
+    }
+    GLuint objectIndex = glGetUniformBlockIndex(program, "ObjectData");
+    if (objectIndex != GL_INVALID_INDEX) {
+        glUniformBlockBinding(program, objectIndex, SHADER_OBJECT_BINDING);
+    }
+}
+
+// Program binary cache file layout
+#define SHADER_CACHE_MAGIC 0x44485357u     // "WSHD"
+#define SHADER_CACHE_VERSION 1
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t length;
+} ProgramCacheHeader;
+
+// One program of a batch while it is being built
+typedef struct {
+    char* vertexSource;
+    char* fragmentSource;
+    uint64_t key;
+    GLuint vertexShader;
+    GLuint fragmentShader;
+    GLuint program;
+} PendingProgram;
+
+// 64-bit FNV-1a over a string, continuing from hash
+static uint64_t hashString(uint64_t hash, const char* text) {
+    while (text && *text) {
+        hash ^= (unsigned char)*text++;
+        hash *= 1099511628211ull;
+    }
+    
+    // Separator so ("ab", "c") and ("a", "bc") differ
+    hash ^= 0xFFu;
+    hash *= 1099511628211ull;
+    return hash;
+}
+
+// Hash of the driver identity; binaries are only valid for the driver that produced them
+static uint64_t driverHash() {
+    uint64_t hash = 14695981039346656037ull;
+    hash = hashString(hash, (const char*)glGetString(GL_VENDOR));
+    hash = hashString(hash, (const char*)glGetString(GL_RENDERER));
+    hash = hashString(hash, (const char*)glGetString(GL_VERSION));
+    return hash;
+}
+
+// Let the driver compile on as many threads as it likes, if it supports that
+static bool enableParallelCompile() {
+#if defined(GLEW_KHR_parallel_shader_compile)
+    if (GLEW_KHR_parallel_shader_compile) {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFFu);
+        return true;
+    }
+#endif
+    return false;
+}
+
+// Cache file path for a program key
+static void programCachePath(uint64_t key, char* path, size_t size) {
+    snprintf(path, size, "%s/%016llx.bin", SHADER_CACHE_DIR, (unsigned long long)key);
+}
+
+// Create the cache directory and its parents (existing directories are fine)
+static bool makeCacheDir() {
+    char path[256];
+    snprintf(path, sizeof(path), "%s", SHADER_CACHE_DIR);
+    
+    for (char* p = path + 1; ; p++) {
+        if (*p != '/' && *p != '\0') continue;
+        
+        char saved = *p;
+        *p = '\0';
+        if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "Failed to create shader cache directory: %s\n", path);
+            return false;
+        }
+        *p = saved;
+        if (saved == '\0') break;
+    }
+    return true;
+}
+
+// Try to create a program from a cached binary; false on miss or driver rejection
+static bool loadProgramBinary(PendingProgram* pending) {
+    char path[256];
+    programCachePath(pending->key, path, sizeof(path));
+    FILE* file = fopen(path, "rb");
+    if (!file) return false;
+    
+    ProgramCacheHeader header;
+    bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+              header.magic == SHADER_CACHE_MAGIC &&
+              header.version == SHADER_CACHE_VERSION &&
+              header.key == pending->key &&
+              header.length > 0;
+    
+    void* binary = ok ? malloc(header.length) : NULL;
+    ok = binary && fread(binary, header.length, 1, file) == 1;
+    fclose(file);
+    
+    if (ok) {
+        GLuint program = glCreateProgram();
+        glProgramBinary(program, (GLenum)header.format, binary, (GLsizei)header.length);
+        
+        // Drivers reject binaries after updates; fall back to compiling
+        GLint success = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+        if (success) {
+            pending->program = program;
+        } else {
+            glDeleteProgram(program);
+            ok = false;
+        }
+    }
+    
+    free(binary);
+    return ok;
+}
+
+// Store a linked program's binary
+static void saveProgramBinary(const PendingProgram* pending) {
+    GLint length = 0;
+    glGetProgramiv(pending->program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0 || !makeCacheDir()) return;
+    
+    void* binary = malloc((size_t)length);
+    if (!binary) return;
     
+    GLenum format = 0;
+    glGetProgramBinary(pending->program, length, &length, &format, binary);
+    
+    ProgramCacheHeader header = { SHADER_CACHE_MAGIC, SHADER_CACHE_VERSION, pending->key, format, (uint32_t)length };
+    char path[256];
+    programCachePath(pending->key, path, sizeof(path));
+    FILE* file = fopen(path, "wb");
+    if (file) {
+        if (fwrite(&header, sizeof(header), 1, file) != 1 || fwrite(binary, (size_t)length, 1, file) != 1) {
+            fprintf(stderr, "Failed to write shader cache: %s\n", path);
+        }
+        fclose(file);
+    }
+    free(binary);
+}
+
+// Report why a batched program failed (compile status is only queried here)
+static void reportBuildError(const PendingProgram* pending, const ShaderProgramDesc* desc) {
+    GLchar infoLog[512];
+    GLuint shaders[2] = { pending->vertexShader, pending->fragmentShader };
+    const char* paths[2] = { desc->vertexPath, desc->fragmentPath };
+    
+    for (int i = 0; i < 2; i++) {
+        GLint success = GL_FALSE;
+        glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(shaders[i], sizeof(infoLog), NULL, infoLog);
+            fprintf(stderr, "Shader compilation error (%s): %s\n", paths[i], infoLog);
+        }
+    }
+    
+    glGetProgramInfoLog(pending->program, sizeof(infoLog), NULL, infoLog);
+    fprintf(stderr, "Shader program linking error: %s\n", infoLog);
+}
+
+// Load a batch of vertex/fragment programs. Cached binaries are used where the
+// driver accepts them; every miss is compiled and linked before any status is
+// queried, so drivers that compile in parallel can overlap the work.
+void shader_loadPrograms(const ShaderProgramDesc* descs, int count, ShaderLoadStats* loadStats) {
+    double start = profiler_now();
+    ShaderLoadStats result;
+    memset(&result, 0, sizeof(result));
+    result.programs = count;
+    
+    PendingProgram* pending = (PendingProgram*)calloc((size_t)count, sizeof(PendingProgram));
+    if (!pending) {
+        result.failed = count;
+        if (loadStats) *loadStats = result;
+        return;
+    }
+    
+    GLint binaryFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+    bool useCache = binaryFormats > 0;
+    uint64_t driver = useCache ? driverHash() : 0;
+    
+    // 1. Read sources and try the binary cache
+    int misses = 0;
+    for (int i = 0; i < count; i++) {
+        *descs[i].program = 0;
+        pending[i].vertexSource = readFile(descs[i].vertexPath);
+        pending[i].fragmentSource = readFile(descs[i].fragmentPath);
+        if (!pending[i].vertexSource || !pending[i].fragmentSource) {
+            result.failed++;
+            continue;
+        }
+        
+        if (useCache) {
+            pending[i].key = hashString(hashString(driver, pending[i].vertexSource), pending[i].fragmentSource);
+            if (loadProgramBinary(&pending[i])) {
+                result.cached++;
+                continue;
+            }
+        }
+        misses++;
+    }
+    
+    // 2. Kick off every compile and link without waiting on any of them
+    if (misses > 0) {
+        result.parallel = enableParallelCompile();
+    }
+    for (int i = 0; i < count; i++) {
+        PendingProgram* p = &pending[i];
+        if (p->program || !p->vertexSource || !p->fragmentSource) continue;
+        
+        const char* vertexSource = p->vertexSource;
+        const char* fragmentSource = p->fragmentSource;
+        p->vertexShader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(p->vertexShader, 1, &vertexSource, NULL);
+        glCompileShader(p->vertexShader);
+        p->fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(p->fragmentShader, 1, &fragmentSource, NULL);
+        glCompileShader(p->fragmentShader);
+    }
+    for (int i = 0; i < count; i++) {
+        PendingProgram* p = &pending[i];
+        if (!p->vertexShader) continue;
+        
+        p->program = glCreateProgram();
+        if (useCache) glProgramParameteri(p->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        glAttachShader(p->program, p->vertexShader);
+        glAttachShader(p->program, p->fragmentShader);
+        glLinkProgram(p->program);
+    }
+    
+    // 3. Collect results, storing new binaries
+    for (int i = 0; i < count; i++) {
+        PendingProgram* p = &pending[i];
+        if (p->vertexShader) {
+            GLint success = GL_FALSE;
+            glGetProgramiv(p->program, GL_LINK_STATUS, &success);
+            if (success) {
+                if (useCache) saveProgramBinary(p);
+                result.compiled++;
+            } else {
+                reportBuildError(p, &descs[i]);
+                glDeleteProgram(p->program);
+                p->program = 0;
+                result.failed++;
+            }
+            glDeleteShader(p->vertexShader);
+            glDeleteShader(p->fragmentShader);
+        }
+        
+        if (p->program) {
+            registerProgram(p->program);
+            *descs[i].program = p->program;
+        }
+        free(p->vertexSource);
+        free(p->fragmentSource);
+    }
+    free(pending);
+    
+    result.time = profiler_now() - start;
+    if (loadStats) *loadStats = result;
+}
+
+// Load vertex and fragment shaders
+GLuint shader_load(const char* vertexPath, const char* fragmentPath) {
+    GLuint program = 0;
+    ShaderProgramDesc desc = { vertexPath, fragmentPath, &program };
+    shader_loadPrograms(&desc, 1, NULL);
     return program;
 }
 
@@ -139,6 +532,7 @@ GLuint shader_loadWithGeometry(const char* vertexPath, const char* geometryPath,
     glDeleteShader(geometryShader);
     glDeleteShader(fragmentShader);
     
+    registerProgram(program);
     return program;
 }
 
@@ -176,35 +570,263 @@ GLuint shader_loadCompute(const char* computePath) {
     // Clean up
     glDeleteShader(computeShader);
     
+    registerProgram(program);
     return program;
 }
 
-// Use shader program
+// Delete a shader program and its cached uniform table
+void shader_delete(GLuint program) {
+    if (!program) return;
+    
+    releaseProgram(program);
+    if (currentProgram == program) currentProgram = 0;
+    glDeleteProgram(program);
+}
+
+// Use shader program (skips rebinding the current one)
 void shader_use(GLuint program) {
+    if (program == currentProgram) {
+        stats.programBindsSkipped++;
+        return;
+    }
+    
     glUseProgram(program);
+    currentProgram = program;
+    stats.programBinds++;
+}
+
+// Look up a uniform location from the cached table (-1 if inactive)
+GLint shader_getUniformLocation(GLuint program, const char* name) {
+    ProgramUniforms* info = findProgram(program);
+    if (!info) {
+        stats.locationQueries++;
+        return glGetUniformLocation(program, name);
+    }
+    
+    stats.locationCacheHits++;
+    uint32_t hash = hashName(name);
+    unsigned int mask = info->capacity - 1;
+    for (unsigned int probe = 0; probe < info->capacity; probe++) {
+        UniformEntry* entry = &info->entries[(hash + probe) & mask];
+        if (!entry->name) break;
+        if (entry->hash == hash && strcmp(entry->name, name) == 0) {
+            return entry->location;
+        }
+    }
+    
+    return -1;
 }
 
 // Set uniform values
 void shader_setInt(GLuint program, const char* name, int value) {
-    glUniform1i(glGetUniformLocation(program, name), value);
+    GLint location = shader_getUniformLocation(program, name);
+    if (location < 0) return;
+    glUniform1i(location, value);
+    stats.uniformUploads++;
 }
 
 void shader_setFloat(GLuint program, const char* name, float value) {
-    glUniform1f(glGetUniformLocation(program, name), value);
+    GLint location = shader_getUniformLocation(program, name);
+    if (location < 0) return;
+    glUniform1f(location, value);
+    stats.uniformUploads++;
 }
 
 void shader_setVec2(GLuint program, const char* name, float x, float y) {
-    glUniform2f(glGetUniformLocation(program, name), x, y);
+    GLint location = shader_getUniformLocation(program, name);
+    if (location < 0) return;
+    glUniform2f(location, x, y);
+    stats.uniformUploads++;
 }
 
 void shader_setVec3(GLuint program, const char* name, float x, float y, float z) {
-    glUniform3f(glGetUniformLocation(program, name), x, y, z);
+    GLint location = shader_getUniformLocation(program, name);
+    if (location < 0) return;
+    glUniform3f(location, x, y, z);
+    stats.uniformUploads++;
 }
 
 void shader_setVec4(GLuint program, const char* name, float x, float y, float z, float w) {
-    glUniform4f(glGetUniformLocation(program, name), x, y, z, w);
+    GLint location = shader_getUniformLocation(program, name);
+    if (location < 0) return;
+    glUniform4f(location, x, y, z, w);
+    stats.uniformUploads++;
 }
 
 void shader_setMat4(GLuint program, const char* name, const float* value) {
-    glUniformMatrix4fv(glGetUniformLocation(program, name), 1, GL_FALSE, value);
-} 
\ No newline at end of file
+    GLint location = shader_getUniformLocation(program, name);
+    if (location < 0) return;
+    glUniformMatrix4fv(location, 1, GL_FALSE, value);
+    stats.uniformUploads++;
+}
+
+// Create the shared FrameData and ObjectData uniform buffers
+void shader_initBuffers() {
+    glGenBuffers(1, &frameBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(ShaderFrameData), NULL, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, SHADER_FRAME_BINDING, frameBuffer);
+    
+    // Each object's block starts on the driver's offset alignment
+    GLint alignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (alignment < 1) alignment = 256;
+    objectStride = ((16 * sizeof(float) + alignment - 1) / alignment) * alignment;
+    objectCapacity = SHADER_OBJECT_RING_CAPACITY;
+    
+    glGenBuffers(1, &objectBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, objectBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, objectStride * objectCapacity * SHADER_OBJECT_RING_SEGMENTS, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    
+    objectStaging = (unsigned char*)malloc(objectStride * objectCapacity);
+    objectHead = 0;
+    objectFlushed = 0;
+    objectSegment = 0;
+    boundObjectOffset = -1;
+}
+
+// Release uniform buffers and all cached uniform tables
+void shader_cleanup() {
+    while (programCount > 0) {
+        releaseProgram(programs[programCount - 1].program);
+    }
+    
+    glDeleteBuffers(1, &frameBuffer);
+    glDeleteBuffers(1, &objectBuffer);
+    frameBuffer = 0;
+    objectBuffer = 0;
+    
+    free(objectStaging);
+    objectStaging = NULL;
+    currentProgram = 0;
+}
+
+// Upload the per-frame block once for all programs and start a new object segment
+void shader_updateFrameData(const float* view, const float* projection, const float* viewPosition, float time) {
+    ShaderFrameData data;
+    memcpy(data.view, view, sizeof(data.view));
+    memcpy(data.projection, projection, sizeof(data.projection));
+    
+    // viewProjection = projection * view (column-major)
+    for (int col = 0; col < 4; col++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                sum += projection[k * 4 + row] * view[col * 4 + k];
+            }
+            data.viewProjection[col * 4 + row] = sum;
+        }
+    }
+    
+    data.viewPosition[0] = viewPosition[0];
+    data.viewPosition[1] = viewPosition[1];
+    data.viewPosition[2] = viewPosition[2];
+    data.viewPosition[3] = 1.0f;
+    data.frameTime[0] = time;
+    data.frameTime[1] = lastFrameTime < 0.0f ? 0.0f : time - lastFrameTime;
+    data.frameTime[2] = 0.0f;
+    data.frameTime[3] = 0.0f;
+    lastFrameTime = time;
+    
+    glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(ShaderFrameData), &data);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    stats.bufferUpdates++;
+    
+    // Rotate to a segment the GPU is no longer reading
+    objectSegment = (objectSegment + 1) % SHADER_OBJECT_RING_SEGMENTS;
+    objectHead = 0;
+    objectFlushed = 0;
+}
+
+// Make room for count more objects this frame, growing the ring if needed
+bool shader_reserveObjectData(size_t count) {
+    if (!objectBuffer) return false;
+    if (objectHead + count <= objectCapacity) return true;
+    
+    // Draws issued earlier this frame keep the orphaned storage
+    shader_flushObjectData();
+    size_t capacity = objectCapacity * 2;
+    while (capacity < count) capacity *= 2;
+    
+    unsigned char* staging = (unsigned char*)realloc(objectStaging, objectStride * capacity);
+    if (!staging) {
+        fprintf(stderr, "Failed to grow object uniform ring\n");
+        return false;
+    }
+    
+    objectStaging = staging;
+    objectCapacity = capacity;
+    glBindBuffer(GL_UNIFORM_BUFFER, objectBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, objectStride * objectCapacity * SHADER_OBJECT_RING_SEGMENTS, NULL, GL_STREAM_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    
+    objectSegment = 0;
+    objectHead = 0;
+    objectFlushed = 0;
+    boundObjectOffset = -1;
+    return true;
+}
+
+// Stage one object's model matrix; returns its offset in the ring
+GLintptr shader_writeObjectData(const float* model) {
+    memcpy(objectStaging + objectHead * objectStride, model, 16 * sizeof(float));
+    GLintptr offset = (GLintptr)((objectSegment * objectCapacity + objectHead) * objectStride);
+    objectHead++;
+    return offset;
+}
+
+// Upload everything staged since the last flush with one mapping
+void shader_flushObjectData() {
+    if (objectHead <= objectFlushed) return;
+    
+    size_t segmentBase = objectSegment * objectCapacity * objectStride;
+    size_t start = objectFlushed * objectStride;
+    size_t size = (objectHead - objectFlushed) * objectStride;
+    
+    glBindBuffer(GL_UNIFORM_BUFFER, objectBuffer);
+    void* mapped = glMapBufferRange(GL_UNIFORM_BUFFER, (GLintptr)(segmentBase + start), (GLsizeiptr)size,
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (mapped) {
+        memcpy(mapped, objectStaging + start, size);
+        glUnmapBuffer(GL_UNIFORM_BUFFER);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    
+    stats.bufferUpdates++;
+    objectFlushed = objectHead;
+}
+
+// Point the ObjectData block at one object's slice of the ring
+void shader_bindObjectData(GLintptr offset) {
+    if (offset == boundObjectOffset) return;
+    
+    glBindBufferRange(GL_UNIFORM_BUFFER, SHADER_OBJECT_BINDING, objectBuffer, offset, 16 * sizeof(float));
+    boundObjectOffset = offset;
+    stats.bufferBinds++;
+}
+
+// Driver-call counts for the current frame
+const ShaderStats* shader_getStats() {
+    return &stats;
+}
+
+// Report this frame's driver-call counts to the profiler and reset them
+void shader_reportCounters() {
+    unsigned int driverCalls = stats.uniformUploads + stats.locationQueries + stats.programBinds +
+                               stats.bufferUpdates + stats.bufferBinds;
+    
+    profiler_addCounter("GL uniform uploads", stats.uniformUploads);
+    profiler_addCounter("GL uniform location queries", stats.locationQueries);
+    profiler_addCounter("GL program binds", stats.programBinds);
+    profiler_addCounter("GL uniform buffer updates", stats.bufferUpdates + stats.bufferBinds);
+    profiler_addCounter("Driver calls", driverCalls);
+    
+    // Each cache hit and skipped bind was a driver call before caching, and each
+    // ring bind replaced a "model" location query plus upload
+    unsigned int uncachedCalls = driverCalls + stats.locationCacheHits + stats.programBindsSkipped + stats.bufferBinds;
+    profiler_addCounter("Driver calls (uncached)", uncachedCalls);
+    
+    memset(&stats, 0, sizeof(ShaderStats));
+}
@@ -4,7 +4,80 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#include "utils/texture_container.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Block formats, in case the GL headers predate them
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#endif
+#ifndef GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+#ifndef GL_COMPRESSED_RG_RGTC2
+#define GL_COMPRESSED_RG_RGTC2 0x8DBD
+#endif
+
+static const char* containerFormatNames[TEXTURE_CONTAINER_FORMAT_COUNT] = { "RGBA8", "BC1", "BC3", "BC5" };
+
+// Path of the baked container for a source image: same name, .wtex extension
+static void texture_containerPath(const char* source, char* path, size_t size) {
+    snprintf(path, size, "%s", source);
+    char* dot = strrchr(path, '.');
+    char* slash = strrchr(path, '/');
+    if (dot && (!slash || dot > slash)) *dot = '\0';
+    strncat(path, TEXTURE_CONTAINER_EXTENSION, size - strlen(path) - 1);
+}
+
+// Whether a baked container can stand in for its source: it must exist, hold the expected
+// number of faces and be stored in the colour space the caller asked for (the baker guesses
+// it from the file name). A container with an unreadable header is left to
+// texture_loadContainer to report.
+static bool texture_containerUsable(const char* bakedPath, const char* source, uint32_t faces, bool gammaCorrection) {
+    FILE* file = fopen(bakedPath, "rb");
+    if (!file) return false;
+    
+    TextureContainerHeader header;
+    bool read = fread(&header, sizeof(header), 1, file) == 1;
+    fclose(file);
+    if (!read || header.magic != TEXTURE_CONTAINER_MAGIC) return true;
+    
+    // A directory bake leaves single-face containers next to each cubemap face
+    if (header.faces != faces) {
+        fprintf(stderr, "Texture container %s has %u faces but %s needs %u; loading the source\n",
+                bakedPath, header.faces, source, faces);
+        return false;
+    }
+    
+    // BC5 has no sRGB variant; a two-channel map is data either way
+    bool srgb = (header.flags & TEXTURE_CONTAINER_SRGB) != 0;
+    if (srgb != gammaCorrection && header.format != TEXTURE_CONTAINER_BC5) {
+        fprintf(stderr, "Texture container %s is baked %s but %s was requested %s; loading the source\n",
+                bakedPath, srgb ? "sRGB" : "linear", source, gammaCorrection ? "sRGB" : "linear");
+        return false;
+    }
+    return true;
+}
+
 GLuint texture_load(const char* path, bool gammaCorrection) {
+    // Prefer a baked container next to the source, if it matches the requested colour space
+    char bakedPath[512];
+    texture_containerPath(path, bakedPath, sizeof(bakedPath));
+    if (texture_containerUsable(bakedPath, path, 1, gammaCorrection)) {
+        GLuint baked = texture_loadContainer(bakedPath);
+        if (baked) return baked;
+    }
+    
+    double start = profiler_now();
     GLuint textureID;
     glGenTextures(1, &textureID);
     
@@ -39,6 +112,10 @@ GLuint texture_load(const char* path, bool gammaCorrection) {
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
         
+        // Drivers pad RGB to 4 bytes per texel; the mip chain adds a third
+        double vram = width * (double)height * 4.0 * 4.0 / 3.0;
+        printf("Loaded %s: %dx%d uncompressed, %.1f KB VRAM in %.2f ms\n", path, width, height, vram / 1024.0, profiler_now() - start);
+        
         stbi_image_free(data);
     } else {
         fprintf(stderr, "Failed to load texture: %s\n", path);
@@ -50,6 +127,15 @@ GLuint texture_load(const char* path, bool gammaCorrection) {
 }
 
 GLuint texture_loadCubemap(const char* faces[6]) {
+    // A baked cubemap is named after its +X face; the faces below are uploaded linear
+    char bakedPath[512];
+    texture_containerPath(faces[0], bakedPath, sizeof(bakedPath));
+    if (texture_containerUsable(bakedPath, faces[0], 6, false)) {
+        GLuint baked = texture_loadContainer(bakedPath);
+        if (baked) return baked;
+    }
+    
+    double start = profiler_now();
     GLuint textureID;
     glGenTextures(1, &textureID);
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
@@ -76,6 +162,222 @@ GLuint texture_loadCubemap(const char* faces[6]) {
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
     
+    double vram = width * (double)height * 4.0 * 6.0;
+    printf("Loaded cubemap %s: %dx%dx6 uncompressed, %.1f KB VRAM in %.2f ms\n", faces[0], width, height, vram / 1024.0, profiler_now() - start);
+    
+    return textureID;
+}
+
+// Decode a BC1 colour block into RGBA8 texels (4-colour and 3-colour + transparent modes)
+static void texture_decodeBC1(const unsigned char* block, unsigned char texels[16][4]) {
+    unsigned int c0 = block[0] | (block[1] << 8);
+    unsigned int c1 = block[2] | (block[3] << 8);
+    int palette[4][4];
+    unsigned int packed[2] = { c0, c1 };
+    for (int i = 0; i < 2; i++) {
+        int r = (packed[i] >> 11) & 31;
+        int g = (packed[i] >> 5) & 63;
+        int b = packed[i] & 31;
+        palette[i][0] = (r << 3) | (r >> 2);
+        palette[i][1] = (g << 2) | (g >> 4);
+        palette[i][2] = (b << 3) | (b >> 2);
+        palette[i][3] = 255;
+    }
+    for (int c = 0; c < 3; c++) {
+        if (c0 > c1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    palette[2][3] = 255;
+    palette[3][3] = c0 > c1 ? 255 : 0;
+    
+    unsigned int indices = block[4] | (block[5] << 8) | (block[6] << 16) | ((unsigned int)block[7] << 24);
+    for (int i = 0; i < 16; i++) {
+        const int* color = palette[(indices >> (i * 2)) & 3];
+        for (int c = 0; c < 4; c++) texels[i][c] = (unsigned char)color[c];
+    }
+}
+
+// Decode a BC4 block into one channel of RGBA8 texels
+static void texture_decodeBC4(const unsigned char* block, unsigned char texels[16][4], int channel) {
+    int palette[8];
+    palette[0] = block[0];
+    palette[1] = block[1];
+    if (palette[0] > palette[1]) {
+        for (int i = 2; i < 8; i++) palette[i] = ((8 - i) * palette[0] + (i - 1) * palette[1]) / 7;
+    } else {
+        for (int i = 2; i < 6; i++) palette[i] = ((6 - i) * palette[0] + (i - 1) * palette[1]) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+    
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++) indices |= (uint64_t)block[2 + i] << (i * 8);
+    for (int i = 0; i < 16; i++) {
+        texels[i][channel] = (unsigned char)palette[(indices >> (i * 3)) & 7];
+    }
+}
+
+// CPU fallback for drivers without S3TC: expand a BC1/BC3 level to RGBA8
+static unsigned char* texture_decodeLevel(uint32_t format, const unsigned char* data, uint32_t width, uint32_t height) {
+    unsigned char* pixels = malloc((size_t)width * height * 4);
+    if (!pixels) return NULL;
+    
+    uint32_t blocksX = (width + 3) / 4;
+    uint32_t blocksY = (height + 3) / 4;
+    unsigned char texels[16][4];
+    for (uint32_t by = 0; by < blocksY; by++) {
+        for (uint32_t bx = 0; bx < blocksX; bx++) {
+            if (format == TEXTURE_CONTAINER_BC3) {
+                texture_decodeBC1(data + 8, texels);
+                texture_decodeBC4(data, texels, 3);
+                data += 16;
+            } else {
+                texture_decodeBC1(data, texels);
+                data += 8;
+            }
+            for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++) {
+                for (uint32_t x = 0; x < 4 && bx * 4 + x < width; x++) {
+                    memcpy(pixels + ((size_t)(by * 4 + y) * width + bx * 4 + x) * 4, texels[y * 4 + x], 4);
+                }
+            }
+        }
+    }
+    
+    return pixels;
+}
+
+// S3TC is an extension on desktop GL; macOS core profiles always expose it
+static bool texture_hasS3TC(void) {
+#if defined(GLEW_EXT_texture_compression_s3tc)
+    return GLEW_EXT_texture_compression_s3tc;
+#else
+    return true;
+#endif
+}
+
+// Load a baked .wtex container (see tools/texture_baker.c): the file is memory-mapped and
+// every stored mip level is uploaded as is, without glGenerateMipmap
+GLuint texture_loadContainer(const char* path) {
+    double start = profiler_now();
+    
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open texture container: %s\n", path);
+        return 0;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(TextureContainerHeader)) {
+        fprintf(stderr, "Texture container too small: %s\n", path);
+        close(fd);
+        return 0;
+    }
+    size_t fileSize = (size_t)info.st_size;
+    void* mapping = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        fprintf(stderr, "Failed to map texture container: %s\n", path);
+        return 0;
+    }
+    
+    // Validate the header and every level entry before touching GL
+    const unsigned char* file = (const unsigned char*)mapping;
+    const TextureContainerHeader* header = (const TextureContainerHeader*)file;
+    const TextureContainerLevel* table = (const TextureContainerLevel*)(file + sizeof(TextureContainerHeader));
+    bool valid = header->magic == TEXTURE_CONTAINER_MAGIC && header->version == TEXTURE_CONTAINER_VERSION &&
+                 header->format < TEXTURE_CONTAINER_FORMAT_COUNT && header->width > 0 && header->height > 0 &&
+                 header->levels > 0 && header->levels <= TEXTURE_CONTAINER_MAX_LEVELS &&
+                 (header->faces == 1 || header->faces == 6) &&
+                 sizeof(TextureContainerHeader) + sizeof(TextureContainerLevel) * header->levels * header->faces <= fileSize;
+    for (uint32_t level = 0; valid && level < header->levels; level++) {
+        uint32_t levelWidth = header->width >> level ? header->width >> level : 1;
+        uint32_t levelHeight = header->height >> level ? header->height >> level : 1;
+        for (uint32_t face = 0; valid && face < header->faces; face++) {
+            const TextureContainerLevel* entry = &table[level * header->faces + face];
+            valid = entry->size == textureContainer_levelSize(header->format, levelWidth, levelHeight) &&
+                    entry->offset <= fileSize && entry->size <= fileSize - entry->offset;
+        }
+    }
+    if (!valid) {
+        fprintf(stderr, "Invalid or outdated texture container: %s\n", path);
+        munmap(mapping, fileSize);
+        return 0;
+    }
+    
+    bool srgb = (header->flags & TEXTURE_CONTAINER_SRGB) != 0;
+    bool cubemap = header->faces == 6;
+    GLenum target = cubemap ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+    GLenum internalFormat = srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+    bool compressed = true;
+    switch (header->format) {
+        case TEXTURE_CONTAINER_BC1:
+            internalFormat = srgb ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+            break;
+        case TEXTURE_CONTAINER_BC3:
+            internalFormat = srgb ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+            break;
+        case TEXTURE_CONTAINER_BC5:
+            internalFormat = GL_COMPRESSED_RG_RGTC2;    // Core since GL 3.0
+            break;
+        default:
+            compressed = false;
+            break;
+    }
+    bool decode = compressed && header->format != TEXTURE_CONTAINER_BC5 && !texture_hasS3TC();
+    
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(target, textureID);
+    
+    size_t vram = 0;
+    for (uint32_t level = 0; level < header->levels; level++) {
+        GLsizei levelWidth = (GLsizei)(header->width >> level ? header->width >> level : 1);
+        GLsizei levelHeight = (GLsizei)(header->height >> level ? header->height >> level : 1);
+        for (uint32_t face = 0; face < header->faces; face++) {
+            const TextureContainerLevel* entry = &table[level * header->faces + face];
+            const unsigned char* data = file + entry->offset;
+            GLenum faceTarget = cubemap ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+            
+            if (decode) {
+                unsigned char* pixels = texture_decodeLevel(header->format, data, (uint32_t)levelWidth, (uint32_t)levelHeight);
+                if (pixels) {
+                    glTexImage2D(faceTarget, level, srgb ? GL_SRGB8_ALPHA8 : GL_RGBA8, levelWidth, levelHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+                    free(pixels);
+                }
+                vram += (size_t)levelWidth * levelHeight * 4;
+            } else if (compressed) {
+                glCompressedTexImage2D(faceTarget, level, internalFormat, levelWidth, levelHeight, 0, (GLsizei)entry->size, data);
+                vram += (size_t)entry->size;
+            } else {
+                glTexImage2D(faceTarget, level, internalFormat, levelWidth, levelHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+                vram += (size_t)entry->size;
+            }
+        }
+    }
+    
+    // Set texture parameters
+    glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, (GLint)header->levels - 1);
+    glTexParameteri(target, GL_TEXTURE_MIN_FILTER, header->levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (cubemap) {
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    } else {
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    }
+    
+    printf("Loaded %s: %ux%u%s %s%s%s, %u levels, %.1f KB VRAM in %.2f ms\n",
+           path, header->width, header->height, cubemap ? "x6" : "", containerFormatNames[header->format],
+           srgb ? " sRGB" : "", decode ? " (decoded on CPU)" : "", header->levels, vram / 1024.0, profiler_now() - start);
+    
+    munmap(mapping, fileSize);
     return textureID;
 }
 
@@ -0,0 +1,491 @@
+#include "utils/texture_streamer.h"
+#include "utils/profiler.h"
+#include "stb_image.h"
+#include <unistd.h>
+
+// Placeholder colour shown until the first real level arrives
+static const unsigned char placeholderPixel[4] = { 128, 128, 128, 255 };
+
+// Append to a singly linked hand-off list
+static void textureStreamer_push(StreamedTexture** head, StreamedTexture** tail, StreamedTexture* texture) {
+    texture->next = NULL;
+    if (*tail) {
+        (*tail)->next = texture;
+    } else {
+        *head = texture;
+    }
+    *tail = texture;
+}
+
+// Pop from the front of a hand-off list
+static StreamedTexture* textureStreamer_pop(StreamedTexture** head, StreamedTexture** tail) {
+    StreamedTexture* texture = *head;
+    if (texture) {
+        *head = texture->next;
+        if (!*head) *tail = NULL;
+        texture->next = NULL;
+    }
+    return texture;
+}
+
+// Take a staging block of at least size bytes, waiting while the pool is at its limit
+static int textureStreamer_acquireStaging(TextureStreamer* streamer, size_t size) {
+    pthread_mutex_lock(&streamer->mutex);
+    for (;;) {
+        if (!streamer->running) break;
+        
+        // Smallest free block that fits
+        int best = -1;
+        int empty = -1;
+        bool anyInUse = false;
+        for (int i = 0; i < TEXTURE_STREAM_MAX_BLOCKS; i++) {
+            TextureStagingBlock* block = &streamer->blocks[i];
+            if (block->inUse) {
+                anyInUse = true;
+            } else if (block->data && block->capacity >= size) {
+                if (best < 0 || block->capacity < streamer->blocks[best].capacity) best = i;
+            } else if (empty < 0 || !block->data) {
+                empty = i;
+            }
+        }
+        if (best >= 0) {
+            streamer->blocks[best].inUse = true;
+            pthread_mutex_unlock(&streamer->mutex);
+            return best;
+        }
+        
+        // Grow (replacing a free block that is too small) while under the limit; an
+        // oversized request is still allowed when nothing else holds staging memory
+        if (empty >= 0) {
+            TextureStagingBlock* block = &streamer->blocks[empty];
+            size_t total = streamer->stats.stagingBytes - block->capacity + size;
+            if (total <= streamer->stagingLimit || !anyInUse) {
+                unsigned char* data = (unsigned char*)malloc(size);
+                if (!data) break;
+                free(block->data);
+                streamer->stats.stagingBytes = total;
+                block->data = data;
+                block->capacity = size;
+                block->inUse = true;
+                pthread_mutex_unlock(&streamer->mutex);
+                return empty;
+            }
+        }
+        
+        pthread_cond_wait(&streamer->stagingCondition, &streamer->mutex);
+    }
+    pthread_mutex_unlock(&streamer->mutex);
+    return -1;
+}
+
+// Return a staging block to the pool
+static void textureStreamer_releaseStaging(TextureStreamer* streamer, int index) {
+    pthread_mutex_lock(&streamer->mutex);
+    streamer->blocks[index].inUse = false;
+    pthread_cond_broadcast(&streamer->stagingCondition);
+    pthread_mutex_unlock(&streamer->mutex);
+}
+
+// 2x2 box filter of one level into the next (odd edges clamp)
+static void textureStreamer_downsample(const unsigned char* source, int sourceWidth, int sourceHeight,
+                                       unsigned char* destination, int components) {
+    int width = sourceWidth > 1 ? sourceWidth / 2 : 1;
+    int height = sourceHeight > 1 ? sourceHeight / 2 : 1;
+    
+    for (int y = 0; y < height; y++) {
+        int y0 = y * 2 < sourceHeight ? y * 2 : sourceHeight - 1;
+        int y1 = y * 2 + 1 < sourceHeight ? y * 2 + 1 : sourceHeight - 1;
+        for (int x = 0; x < width; x++) {
+            int x0 = x * 2 < sourceWidth ? x * 2 : sourceWidth - 1;
+            int x1 = x * 2 + 1 < sourceWidth ? x * 2 + 1 : sourceWidth - 1;
+            for (int c = 0; c < components; c++) {
+                int sum = source[(y0 * sourceWidth + x0) * components + c] +
+                          source[(y0 * sourceWidth + x1) * components + c] +
+                          source[(y1 * sourceWidth + x0) * components + c] +
+                          source[(y1 * sourceWidth + x1) * components + c];
+                destination[(y * width + x) * components + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+}
+
+// Decode every face and build the full mip chain in staging memory (worker thread)
+static bool textureStreamer_decode(TextureStreamer* streamer, StreamedTexture* texture) {
+    unsigned char* pixels[6] = { NULL };
+    bool ok = true;
+    
+    for (int face = 0; face < texture->faces && ok; face++) {
+        int width, height, components;
+        pixels[face] = stbi_load(texture->paths[face], &width, &height, &components, 0);
+        if (!pixels[face]) {
+            fprintf(stderr, "Failed to load texture: %s\n", texture->paths[face]);
+            ok = false;
+        } else if (components == 2) {
+            fprintf(stderr, "Texture has unknown format: %s\n", texture->paths[face]);
+            ok = false;
+        } else if (face == 0) {
+            texture->width = width;
+            texture->height = height;
+            texture->components = components;
+        } else if (width != texture->width || height != texture->height || components != texture->components) {
+            fprintf(stderr, "Cubemap faces differ in size or format: %s\n", texture->paths[face]);
+            ok = false;
+        }
+    }
+    
+    // Level sizes, laid out smallest first so uploads walk the buffer forwards
+    if (ok) {
+        int largest = texture->width > texture->height ? texture->width : texture->height;
+        texture->levels = 1;
+        while ((largest >> texture->levels) > 0 && texture->levels < TEXTURE_STREAM_MAX_LEVELS) texture->levels++;
+        
+        size_t total = 0;
+        for (int level = texture->levels - 1; level >= 0; level--) {
+            int width = texture->width >> level > 0 ? texture->width >> level : 1;
+            int height = texture->height >> level > 0 ? texture->height >> level : 1;
+            texture->faceSizes[level] = (size_t)width * height * texture->components;
+            texture->levelOffsets[level] = total;
+            total += texture->faceSizes[level] * texture->faces;
+        }
+        
+        texture->stagingBlock = textureStreamer_acquireStaging(streamer, total);
+        ok = texture->stagingBlock >= 0;
+    }
+    
+    if (ok) {
+        texture->staging = streamer->blocks[texture->stagingBlock].data;
+        for (int face = 0; face < texture->faces; face++) {
+            unsigned char* level0 = texture->staging + texture->levelOffsets[0] + texture->faceSizes[0] * face;
+            memcpy(level0, pixels[face], texture->faceSizes[0]);
+            
+            for (int level = 1; level < texture->levels; level++) {
+                int width = texture->width >> (level - 1) > 0 ? texture->width >> (level - 1) : 1;
+                int height = texture->height >> (level - 1) > 0 ? texture->height >> (level - 1) : 1;
+                const unsigned char* source = texture->staging + texture->levelOffsets[level - 1] + texture->faceSizes[level - 1] * face;
+                unsigned char* destination = texture->staging + texture->levelOffsets[level] + texture->faceSizes[level] * face;
+                textureStreamer_downsample(source, width, height, destination, texture->components);
+            }
+        }
+        texture->nextLevel = texture->levels - 1;
+    }
+    
+    for (int face = 0; face < texture->faces; face++) {
+        stbi_image_free(pixels[face]);
+    }
+    return ok;
+}
+
+// Worker thread: decode queued textures and hand them to the GL thread
+static void* textureStreamer_worker(void* argument) {
+    TextureStreamer* streamer = (TextureStreamer*)argument;
+    
+    pthread_mutex_lock(&streamer->mutex);
+    for (;;) {
+        while (streamer->running && !streamer->decodeHead) {
+            pthread_cond_wait(&streamer->workCondition, &streamer->mutex);
+        }
+        if (!streamer->running) break;
+        StreamedTexture* texture = textureStreamer_pop(&streamer->decodeHead, &streamer->decodeTail);
+        pthread_mutex_unlock(&streamer->mutex);
+        
+        bool ok = textureStreamer_decode(streamer, texture);
+        
+        pthread_mutex_lock(&streamer->mutex);
+        texture->state = ok ? TEXTURE_STREAM_DECODED : TEXTURE_STREAM_FAILED;
+        textureStreamer_push(&streamer->readyHead, &streamer->readyTail, texture);
+    }
+    pthread_mutex_unlock(&streamer->mutex);
+    
+    return NULL;
+}
+
+// Start decode workers (threadCount <= 0 = one per extra core, capped)
+void textureStreamer_init(TextureStreamer* streamer, int threadCount, size_t stagingLimit, size_t uploadBudget) {
+    memset(streamer, 0, sizeof(TextureStreamer));
+    streamer->stagingLimit = stagingLimit;
+    streamer->uploadBudget = uploadBudget;
+    
+    if (threadCount <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threadCount = cores > 1 ? (int)cores - 1 : 1;
+    }
+    if (threadCount > TEXTURE_STREAM_MAX_THREADS) {
+        threadCount = TEXTURE_STREAM_MAX_THREADS;
+    }
+    
+    glGenBuffers(1, &streamer->pixelBuffer);
+    
+    pthread_mutex_init(&streamer->mutex, NULL);
+    pthread_cond_init(&streamer->workCondition, NULL);
+    pthread_cond_init(&streamer->stagingCondition, NULL);
+    streamer->running = true;
+    
+    for (int i = 0; i < threadCount; i++) {
+        if (pthread_create(&streamer->threads[i], NULL, textureStreamer_worker, streamer) != 0) {
+            fprintf(stderr, "Failed to start texture streaming thread %d\n", i);
+            break;
+        }
+        streamer->threadCount++;
+    }
+}
+
+// Stop the workers and free staging memory (streamed GL textures stay with their owners)
+void textureStreamer_cleanup(TextureStreamer* streamer) {
+    pthread_mutex_lock(&streamer->mutex);
+    streamer->running = false;
+    pthread_cond_broadcast(&streamer->workCondition);
+    pthread_cond_broadcast(&streamer->stagingCondition);
+    pthread_mutex_unlock(&streamer->mutex);
+    
+    for (int i = 0; i < streamer->threadCount; i++) {
+        pthread_join(streamer->threads[i], NULL);
+    }
+    streamer->threadCount = 0;
+    
+    for (size_t i = 0; i < streamer->textureCount; i++) {
+        StreamedTexture* texture = streamer->textures[i];
+        for (int face = 0; face < texture->faces; face++) {
+            free(texture->paths[face]);
+        }
+        free(texture);
+    }
+    free(streamer->textures);
+    streamer->textures = NULL;
+    streamer->textureCount = 0;
+    streamer->textureCapacity = 0;
+    
+    for (int i = 0; i < TEXTURE_STREAM_MAX_BLOCKS; i++) {
+        free(streamer->blocks[i].data);
+        streamer->blocks[i].data = NULL;
+        streamer->blocks[i].capacity = 0;
+    }
+    streamer->stats.stagingBytes = 0;
+    
+    glDeleteBuffers(1, &streamer->pixelBuffer);
+    pthread_mutex_destroy(&streamer->mutex);
+    pthread_cond_destroy(&streamer->workCondition);
+    pthread_cond_destroy(&streamer->stagingCondition);
+}
+
+// Create the GL texture with its placeholder and queue the decode
+static GLuint textureStreamer_request(TextureStreamer* streamer, const char** paths, int faces, bool gammaCorrection) {
+    if (streamer->textureCount >= streamer->textureCapacity) {
+        size_t capacity = streamer->textureCapacity ? streamer->textureCapacity * 2 : 64;
+        StreamedTexture** textures = (StreamedTexture**)realloc(streamer->textures, sizeof(StreamedTexture*) * capacity);
+        if (!textures) return 0;
+        streamer->textures = textures;
+        streamer->textureCapacity = capacity;
+    }
+    
+    StreamedTexture* texture = (StreamedTexture*)calloc(1, sizeof(StreamedTexture));
+    if (!texture) return 0;
+    texture->faces = faces;
+    texture->target = faces == 6 ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+    texture->gammaCorrection = gammaCorrection;
+    texture->stagingBlock = -1;
+    texture->requestTime = profiler_now();
+    texture->state = TEXTURE_STREAM_QUEUED;
+    for (int face = 0; face < faces; face++) {
+        texture->paths[face] = strdup(paths[face]);
+    }
+    
+    // 1x1 placeholder at level 0 until the smallest real level lands
+    glGenTextures(1, &texture->texture);
+    glBindTexture(texture->target, texture->texture);
+    for (int face = 0; face < faces; face++) {
+        GLenum target = faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+        glTexImage2D(target, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, placeholderPixel);
+    }
+    glTexParameteri(texture->target, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(texture->target, GL_TEXTURE_MAX_LEVEL, 0);
+    glTexParameteri(texture->target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    if (faces == 6) {
+        glTexParameteri(texture->target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(texture->target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(texture->target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(texture->target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    } else {
+        glTexParameteri(texture->target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(texture->target, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(texture->target, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    }
+    glBindTexture(texture->target, 0);
+    
+    streamer->textures[streamer->textureCount++] = texture;
+    streamer->stats.texturesRequested++;
+    
+    pthread_mutex_lock(&streamer->mutex);
+    textureStreamer_push(&streamer->decodeHead, &streamer->decodeTail, texture);
+    pthread_cond_signal(&streamer->workCondition);
+    pthread_mutex_unlock(&streamer->mutex);
+    
+    return texture->texture;
+}
+
+// Request a 2D texture; the returned name is usable at once and shows a placeholder until streamed in
+GLuint textureStreamer_load(TextureStreamer* streamer, const char* path, bool gammaCorrection) {
+    return textureStreamer_request(streamer, &path, 1, gammaCorrection);
+}
+
+// Request a cubemap (faces in +X, -X, +Y, -Y, +Z, -Z order)
+GLuint textureStreamer_loadCubemap(TextureStreamer* streamer, const char* faces[6]) {
+    return textureStreamer_request(streamer, faces, 6, false);
+}
+
+// Internal and pixel formats for a decoded texture (same mapping as texture_load)
+static void textureStreamer_formats(const StreamedTexture* texture, GLenum* internalFormat, GLenum* dataFormat) {
+    if (texture->components == 1) {
+        *internalFormat = GL_RED;
+        *dataFormat = GL_RED;
+    } else if (texture->components == 3) {
+        *internalFormat = texture->gammaCorrection ? GL_SRGB : GL_RGB;
+        *dataFormat = GL_RGB;
+    } else {
+        *internalFormat = texture->gammaCorrection ? GL_SRGB_ALPHA : GL_RGBA;
+        *dataFormat = GL_RGBA;
+    }
+}
+
+// Finish a texture: release its staging memory and record the latency
+static void textureStreamer_finish(TextureStreamer* streamer, StreamedTexture* texture) {
+    if (texture->stagingBlock >= 0) {
+        textureStreamer_releaseStaging(streamer, texture->stagingBlock);
+        texture->stagingBlock = -1;
+        texture->staging = NULL;
+    }
+    
+    if (texture->state == TEXTURE_STREAM_FAILED) {
+        streamer->stats.texturesFailed++;
+        return;
+    }
+    
+    texture->state = TEXTURE_STREAM_DONE;
+    double latency = profiler_now() - texture->requestTime;
+    streamer->stats.texturesCompleted++;
+    streamer->stats.totalLatency += latency;
+    printf("Streamed texture %s (%dx%d, %d levels) in %.1f ms\n",
+           texture->paths[0], texture->width, texture->height, texture->levels, latency);
+}
+
+// Upload pending levels through the pixel buffer, smallest first, within the per-update byte budget
+void textureStreamer_update(TextureStreamer* streamer) {
+    streamer->stats.bytesUploaded = 0;
+    
+    // Take over everything the workers have finished
+    pthread_mutex_lock(&streamer->mutex);
+    StreamedTexture* texture;
+    while ((texture = textureStreamer_pop(&streamer->readyHead, &streamer->readyTail))) {
+        textureStreamer_push(&streamer->uploadHead, &streamer->uploadTail, texture);
+    }
+    pthread_mutex_unlock(&streamer->mutex);
+    
+    // Plan this update's uploads: whole levels (all faces), in request order
+    typedef struct {
+        StreamedTexture* texture;
+        int level;
+        size_t offset;
+    } TextureUpload;
+    TextureUpload uploads[TEXTURE_STREAM_MAX_UPLOADS];
+    int uploadCount = 0;
+    size_t used = 0;
+    
+    for (texture = streamer->uploadHead; texture && uploadCount < TEXTURE_STREAM_MAX_UPLOADS; texture = texture->next) {
+        if (texture->state == TEXTURE_STREAM_FAILED) continue;
+        
+        int level = texture->nextLevel;
+        while (level >= 0 && uploadCount < TEXTURE_STREAM_MAX_UPLOADS) {
+            size_t size = texture->faceSizes[level] * texture->faces;
+            
+            // A level larger than the whole budget goes alone
+            if (used > 0 && used + size > streamer->uploadBudget) break;
+            uploads[uploadCount].texture = texture;
+            uploads[uploadCount].level = level;
+            uploads[uploadCount].offset = used;
+            uploadCount++;
+            used += size;
+            level--;
+        }
+        if (used >= streamer->uploadBudget) break;
+    }
+    
+    if (uploadCount > 0) {
+        // Orphan and fill the unpack buffer, then source the uploads from it
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, streamer->pixelBuffer);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)used, NULL, GL_STREAM_DRAW);
+        unsigned char* mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)used,
+                                                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (mapped) {
+            for (int i = 0; i < uploadCount; i++) {
+                StreamedTexture* t = uploads[i].texture;
+                memcpy(mapped + uploads[i].offset, t->staging + t->levelOffsets[uploads[i].level],
+                       t->faceSizes[uploads[i].level] * t->faces);
+            }
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+            
+            for (int i = 0; i < uploadCount; i++) {
+                StreamedTexture* t = uploads[i].texture;
+                int level = uploads[i].level;
+                int width = t->width >> level > 0 ? t->width >> level : 1;
+                int height = t->height >> level > 0 ? t->height >> level : 1;
+                GLenum internalFormat, dataFormat;
+                textureStreamer_formats(t, &internalFormat, &dataFormat);
+                
+                glBindTexture(t->target, t->texture);
+                for (int face = 0; face < t->faces; face++) {
+                    GLenum target = t->faces == 6 ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+                    size_t offset = uploads[i].offset + t->faceSizes[level] * face;
+                    glTexImage2D(target, level, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, (const void*)offset);
+                }
+                
+                // Sample only the levels that are resident so far
+                glTexParameteri(t->target, GL_TEXTURE_MAX_LEVEL, t->levels - 1);
+                glTexParameteri(t->target, GL_TEXTURE_BASE_LEVEL, level);
+                t->nextLevel = level - 1;
+                t->state = TEXTURE_STREAM_UPLOADING;
+            }
+            
+            glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+            streamer->stats.bytesUploaded = used;
+        } else {
+            fprintf(stderr, "Failed to map texture upload buffer\n");
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    }
+    
+    // Retire finished and failed textures
+    StreamedTexture* previous = NULL;
+    texture = streamer->uploadHead;
+    while (texture) {
+        StreamedTexture* next = texture->next;
+        if (texture->state == TEXTURE_STREAM_FAILED || texture->nextLevel < 0) {
+            if (previous) {
+                previous->next = next;
+            } else {
+                streamer->uploadHead = next;
+            }
+            if (streamer->uploadTail == texture) streamer->uploadTail = previous;
+            texture->next = NULL;
+            textureStreamer_finish(streamer, texture);
+        } else {
+            previous = texture;
+        }
+        texture = next;
+    }
+    
+    profiler_addCounter("Texture upload bytes", (double)streamer->stats.bytesUploaded);
+    profiler_addCounter("Textures streaming",
+                        (double)(streamer->stats.texturesRequested - streamer->stats.texturesCompleted - streamer->stats.texturesFailed));
+}
+
+// True once every requested texture is resident (or failed)
+bool textureStreamer_isIdle(TextureStreamer* streamer) {
+    return streamer->stats.texturesCompleted + streamer->stats.texturesFailed == streamer->stats.texturesRequested;
+}
+
+// Get streaming counters
+const TextureStreamStats* textureStreamer_getStats(const TextureStreamer* streamer) {
+    return &streamer->stats;
+}
@@ -0,0 +1,488 @@
+#include "utils/thread_pool.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+#include <unistd.h>
+
+#define THREAD_POOL_QUEUE_MASK (THREAD_POOL_QUEUE_SIZE - 1)
+#define THREAD_POOL_SPIN_ROUNDS 64      // Empty steal rounds before a worker goes to sleep
+#define THREAD_POOL_CACHED_POOLS 4      // Pools whose queue a thread remembers without a lookup
+
+// Pool ids start at 1 so a zeroed thread-local never matches
+static atomic_uint threadPool_nextId = 1;
+
+// Queues owned by the calling thread, per pool; the pool's owner table is the fallback
+typedef struct {
+    unsigned int pool;
+    int queue;
+} ThreadPoolQueueCache;
+
+static _Thread_local ThreadPoolQueueCache threadPool_queueCache[THREAD_POOL_CACHED_POOLS];
+static _Thread_local unsigned int threadPool_queueCacheNext = 0;
+static _Thread_local unsigned int threadPool_random = 0;
+
+// Adapts a per-index task to a range job
+typedef struct {
+    ThreadPoolTask task;
+    void* context;
+} ThreadPoolRunContext;
+
+// Monotonic clock in nanoseconds
+static uint64_t threadPool_nanoseconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Push at the bottom (owner only); false when the queue is full
+static bool threadPool_push(ThreadPoolQueue* queue, ThreadPoolEntry* entry) {
+    long bottom = atomic_load_explicit(&queue->bottom, memory_order_relaxed);
+    long top = atomic_load_explicit(&queue->top, memory_order_acquire);
+    if (bottom - top >= THREAD_POOL_QUEUE_SIZE) return false;
+    
+    atomic_store_explicit(&queue->slots[bottom & THREAD_POOL_QUEUE_MASK], entry, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&queue->bottom, bottom + 1, memory_order_relaxed);
+    return true;
+}
+
+// Pop from the bottom (owner only), racing stealers for the last entry
+static ThreadPoolEntry* threadPool_pop(ThreadPoolQueue* queue) {
+    long bottom = atomic_load_explicit(&queue->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&queue->bottom, bottom, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long top = atomic_load_explicit(&queue->top, memory_order_relaxed);
+    
+    if (top > bottom) {
+        atomic_store_explicit(&queue->bottom, bottom + 1, memory_order_relaxed);
+        return NULL;
+    }
+    
+    ThreadPoolEntry* entry = atomic_load_explicit(&queue->slots[bottom & THREAD_POOL_QUEUE_MASK], memory_order_relaxed);
+    if (top == bottom) {
+        if (!atomic_compare_exchange_strong_explicit(&queue->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed)) {
+            entry = NULL;
+        }
+        atomic_store_explicit(&queue->bottom, bottom + 1, memory_order_relaxed);
+    }
+    return entry;
+}
+
+// Take from the top of another thread's queue; NULL if empty or another thief won
+static ThreadPoolEntry* threadPool_steal(ThreadPoolQueue* queue) {
+    long top = atomic_load_explicit(&queue->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long bottom = atomic_load_explicit(&queue->bottom, memory_order_acquire);
+    if (top >= bottom) return NULL;
+    
+    ThreadPoolEntry* entry = atomic_load_explicit(&queue->slots[top & THREAD_POOL_QUEUE_MASK], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&queue->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed)) {
+        return NULL;
+    }
+    return entry;
+}
+
+// Free entry from the queue's pool (owner only); NULL if all are in flight
+static ThreadPoolEntry* threadPool_allocEntry(ThreadPoolQueue* queue) {
+    for (int i = 0; i < THREAD_POOL_QUEUE_SIZE; i++) {
+        ThreadPoolEntry* entry = &queue->entries[queue->nextEntry++ & THREAD_POOL_QUEUE_MASK];
+        if (!atomic_load_explicit(&entry->busy, memory_order_acquire)) {
+            atomic_store_explicit(&entry->busy, true, memory_order_relaxed);
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+// Queue of the calling thread, claiming one on first use; -1 once all are taken
+static int threadPool_queueOf(ThreadPool* pool) {
+    for (int i = 0; i < THREAD_POOL_CACHED_POOLS; i++) {
+        if (threadPool_queueCache[i].pool == pool->id) return threadPool_queueCache[i].queue;
+    }
+    
+    // Not cached: a queue claimed earlier and since evicted is found by owner
+    pthread_t self = pthread_self();
+    int index = -1;
+    int count = atomic_load(&pool->queueCount);
+    if (count > THREAD_POOL_MAX_QUEUES) count = THREAD_POOL_MAX_QUEUES;
+    for (int i = 0; i < count && index < 0; i++) {
+        if (atomic_load_explicit(&pool->queueOwned[i], memory_order_acquire) &&
+            pthread_equal(pool->queueOwners[i], self)) {
+            index = i;
+        }
+    }
+    
+    if (index < 0) {
+        index = atomic_fetch_add(&pool->queueCount, 1);
+        if (index >= THREAD_POOL_MAX_QUEUES) {
+            fprintf(stderr, "Thread pool queues exhausted, jobs from this thread run inline\n");
+            index = -1;
+        } else {
+            pool->queueOwners[index] = self;
+            atomic_store_explicit(&pool->queueOwned[index], true, memory_order_release);
+        }
+        threadPool_random = 2654435761u * (unsigned int)(index + 2);
+    }
+    
+    ThreadPoolQueueCache* slot = &threadPool_queueCache[threadPool_queueCacheNext++ % THREAD_POOL_CACHED_POOLS];
+    slot->pool = pool->id;
+    slot->queue = index;
+    return index;
+}
+
+// Number of queues that may hold work
+static int threadPool_activeQueues(ThreadPool* pool) {
+    int count = atomic_load(&pool->queueCount);
+    return count < THREAD_POOL_MAX_QUEUES ? count : THREAD_POOL_MAX_QUEUES;
+}
+
+// Whether any queue looks non-empty
+static bool threadPool_hasWork(ThreadPool* pool) {
+    int count = threadPool_activeQueues(pool);
+    for (int i = 0; i < count; i++) {
+        if (atomic_load(&pool->queues[i].bottom) > atomic_load(&pool->queues[i].top)) return true;
+    }
+    return false;
+}
+
+// Tell a sleeping worker there is something to steal
+static void threadPool_wake(ThreadPool* pool) {
+    atomic_fetch_add(&pool->workSignal, 1);
+    if (atomic_load(&pool->sleepingWorkers) > 0) {
+        pthread_mutex_lock(&pool->mutex);
+        pthread_cond_signal(&pool->wakeCondition);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+}
+
+// Next entry for the calling thread: its own queue first, then the others from a random start
+static ThreadPoolEntry* threadPool_find(ThreadPool* pool, int queueIndex) {
+    if (queueIndex >= 0) {
+        ThreadPoolEntry* entry = threadPool_pop(&pool->queues[queueIndex]);
+        if (entry) return entry;
+    }
+    
+    int count = threadPool_activeQueues(pool);
+    if (count == 0) return NULL;
+    threadPool_random ^= threadPool_random << 13;
+    threadPool_random ^= threadPool_random >> 17;
+    threadPool_random ^= threadPool_random << 5;
+    int start = (int)(threadPool_random % (unsigned int)count);
+    for (int i = 0; i < count; i++) {
+        int victim = (start + i) % count;
+        if (victim == queueIndex) continue;
+        ThreadPoolEntry* entry = threadPool_steal(&pool->queues[victim]);
+        if (entry) return entry;
+    }
+    return NULL;
+}
+
+// Counter spinlock (held for a few instructions)
+static void threadPool_lockCounter(ThreadPoolCounter* counter) {
+    while (atomic_exchange_explicit(&counter->lock, 1, memory_order_acquire) != 0) {}
+}
+
+static void threadPool_unlockCounter(ThreadPoolCounter* counter) {
+    atomic_store_explicit(&counter->lock, 0, memory_order_release);
+}
+
+// Accumulate slice time under the job's name
+static void threadPool_addTiming(ThreadPool* pool, const char* name, uint64_t nanoseconds) {
+    for (int i = 0; i < THREAD_POOL_MAX_TIMERS; i++) {
+        ThreadPoolTimer* timer = &pool->timers[i];
+        const char* current = atomic_load_explicit(&timer->name, memory_order_acquire);
+        if (!current) {
+            const char* expected = NULL;
+            current = atomic_compare_exchange_strong(&timer->name, &expected, name) ? name : expected;
+        }
+        if (current == name) {
+            atomic_fetch_add_explicit(&timer->nanoseconds, nanoseconds, memory_order_relaxed);
+            atomic_fetch_add_explicit(&timer->slices, 1, memory_order_relaxed);
+            return;
+        }
+    }
+}
+
+static void threadPool_execute(ThreadPool* pool, ThreadPoolEntry* entry, int queueIndex);
+
+// Queue an entry on the calling thread's queue, or run it here if there is no room
+static void threadPool_enqueue(ThreadPool* pool, ThreadPoolEntry* entry, int queueIndex) {
+    if (queueIndex < 0 || !threadPool_push(&pool->queues[queueIndex], entry)) {
+        threadPool_execute(pool, entry, queueIndex);
+        return;
+    }
+    threadPool_wake(pool);
+}
+
+// A slice counted by counter finished; the last one releases the jobs waiting on it.
+// The lock is the last thing touched, so a waiter may free the counter once it is clear.
+static void threadPool_release(ThreadPool* pool, ThreadPoolCounter* counter, int queueIndex) {
+    ThreadPoolEntry* ready[THREAD_POOL_MAX_CONTINUATIONS];
+    int readyCount = 0;
+    
+    threadPool_lockCounter(counter);
+    if (atomic_fetch_sub(&counter->pending, 1) == 1) {
+        readyCount = counter->continuationCount;
+        memcpy(ready, counter->continuations, sizeof(ThreadPoolEntry*) * readyCount);
+        counter->continuationCount = 0;
+    }
+    threadPool_unlockCounter(counter);
+    
+    for (int i = 0; i < readyCount; i++) {
+        threadPool_enqueue(pool, ready[i], queueIndex);
+    }
+}
+
+// Run an entry, first splitting off upper halves for thieves while it is above grain size
+static void threadPool_execute(ThreadPool* pool, ThreadPoolEntry* entry, int queueIndex) {
+    size_t grain = entry->job.grain ? entry->job.grain : 1;
+    while (queueIndex >= 0 && entry->end - entry->begin > grain) {
+        ThreadPoolQueue* queue = &pool->queues[queueIndex];
+        ThreadPoolEntry* half = threadPool_allocEntry(queue);
+        if (!half) break;
+        
+        size_t middle = entry->begin + (entry->end - entry->begin) / 2;
+        half->job = entry->job;
+        half->begin = middle;
+        half->end = entry->end;
+        half->counter = entry->counter;
+        if (half->counter) atomic_fetch_add(&half->counter->pending, 1);
+        
+        if (!threadPool_push(queue, half)) {
+            // This slice still holds its own count, so the counter cannot reach zero here
+            if (half->counter) atomic_fetch_sub(&half->counter->pending, 1);
+            atomic_store_explicit(&half->busy, false, memory_order_release);
+            break;
+        }
+        entry->end = middle;
+        threadPool_wake(pool);
+    }
+    
+    const char* name = entry->job.name;
+    uint64_t start = name ? threadPool_nanoseconds() : 0;
+    entry->job.task(entry->job.context, entry->begin, entry->end);
+    if (name) {
+        uint64_t end = threadPool_nanoseconds();
+        threadPool_addTiming(pool, name, end - start);
+        if (pool->timingHook) pool->timingHook(pool->timingContext, name, queueIndex, start, end);
+    }
+    
+    ThreadPoolCounter* counter = entry->counter;
+    atomic_store_explicit(&entry->busy, false, memory_order_release);
+    if (counter) threadPool_release(pool, counter, queueIndex);
+}
+
+// Sleep until new work is signalled (or the pool stops)
+static void threadPool_sleep(ThreadPool* pool) {
+    pthread_mutex_lock(&pool->mutex);
+    atomic_fetch_add(&pool->sleepingWorkers, 1);
+    unsigned int seen = atomic_load(&pool->workSignal);
+    if (!threadPool_hasWork(pool)) {
+        while (atomic_load(&pool->running) && atomic_load(&pool->workSignal) == seen) {
+            pthread_cond_wait(&pool->wakeCondition, &pool->mutex);
+        }
+    }
+    atomic_fetch_sub(&pool->sleepingWorkers, 1);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+// Worker thread: run own jobs, steal when out, sleep after a while without any
+static void* threadPool_worker(void* argument) {
+    ThreadPool* pool = (ThreadPool*)argument;
+    int queueIndex = threadPool_queueOf(pool);
+    int idleRounds = 0;
+    
+    while (atomic_load(&pool->running)) {
+        ThreadPoolEntry* entry = threadPool_find(pool, queueIndex);
+        if (entry) {
+            threadPool_execute(pool, entry, queueIndex);
+            idleRounds = 0;
+        } else if (++idleRounds < THREAD_POOL_SPIN_ROUNDS) {
+            sched_yield();
+        } else {
+            threadPool_sleep(pool);
+            idleRounds = 0;
+        }
+    }
+    
+    return NULL;
+}
+
+// Start worker threads (threadCount <= 0 = one per extra core)
+void threadPool_init(ThreadPool* pool, int threadCount) {
+    memset(pool, 0, sizeof(ThreadPool));
+    
+    if (threadCount <= 0) {
+        long cores = sysconf(_SC_NPROCESSORS_ONLN);
+        threadCount = cores > 1 ? (int)cores - 1 : 0;
+    }
+    if (threadCount > THREAD_POOL_MAX_THREADS) {
+        threadCount = THREAD_POOL_MAX_THREADS;
+    }
+    
+    pool->id = atomic_fetch_add(&threadPool_nextId, 1);
+    for (int i = 0; i < THREAD_POOL_MAX_QUEUES; i++) {
+        atomic_init(&pool->queues[i].top, 0);
+        atomic_init(&pool->queues[i].bottom, 0);
+        atomic_init(&pool->queueOwned[i], false);
+    }
+    atomic_init(&pool->queueCount, 0);
+    atomic_init(&pool->workSignal, 0);
+    atomic_init(&pool->sleepingWorkers, 0);
+    atomic_init(&pool->running, true);
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->wakeCondition, NULL);
+    
+    for (int i = 0; i < threadCount; i++) {
+        if (pthread_create(&pool->threads[i], NULL, threadPool_worker, pool) != 0) {
+            fprintf(stderr, "Failed to start worker thread %d\n", i);
+            break;
+        }
+        pool->threadCount++;
+    }
+}
+
+// Stop and join all workers; anything still queued is dropped
+void threadPool_cleanup(ThreadPool* pool) {
+    atomic_store(&pool->running, false);
+    pthread_mutex_lock(&pool->mutex);
+    pthread_cond_broadcast(&pool->wakeCondition);
+    pthread_mutex_unlock(&pool->mutex);
+    
+    for (int i = 0; i < pool->threadCount; i++) {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pool->threadCount = 0;
+    
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->wakeCondition);
+}
+
+// Start a counter at zero outstanding jobs
+void threadPool_initCounter(ThreadPoolCounter* counter) {
+    atomic_init(&counter->pending, 0);
+    atomic_init(&counter->lock, 0);
+    counter->continuationCount = 0;
+}
+
+// Queue a job; counter (may be NULL) stays non-zero until every slice of it has run
+void threadPool_submit(ThreadPool* pool, const ThreadPoolJob* job, ThreadPoolCounter* counter) {
+    threadPool_submitAfter(pool, job, NULL, counter);
+}
+
+// Queue a job once dependency (may be NULL) has dropped to zero
+void threadPool_submitAfter(ThreadPool* pool, const ThreadPoolJob* job, ThreadPoolCounter* dependency, ThreadPoolCounter* counter) {
+    if (job->count == 0) return;
+    
+    int queueIndex = threadPool_queueOf(pool);
+    ThreadPoolEntry* entry = queueIndex >= 0 ? threadPool_allocEntry(&pool->queues[queueIndex]) : NULL;
+    ThreadPoolEntry local;
+    if (!entry) {
+        // Out of entries: run it here, in order
+        if (dependency) threadPool_wait(pool, dependency);
+        entry = &local;
+        atomic_init(&local.busy, true);
+        dependency = NULL;
+    }
+    
+    entry->job = *job;
+    entry->begin = 0;
+    entry->end = job->count;
+    entry->counter = counter;
+    if (counter) atomic_fetch_add(&counter->pending, 1);
+    
+    if (entry == &local) {
+        threadPool_execute(pool, entry, -1);
+        return;
+    }
+    
+    if (dependency) {
+        threadPool_lockCounter(dependency);
+        bool blocked = atomic_load(&dependency->pending) > 0;
+        if (blocked && dependency->continuationCount < THREAD_POOL_MAX_CONTINUATIONS) {
+            dependency->continuations[dependency->continuationCount++] = entry;
+            threadPool_unlockCounter(dependency);
+            return;
+        }
+        threadPool_unlockCounter(dependency);
+        
+        // Too many jobs already waiting on it
+        if (blocked) threadPool_wait(pool, dependency);
+    }
+    
+    threadPool_enqueue(pool, entry, queueIndex);
+}
+
+// Run queued jobs on the calling thread until counter reaches zero
+void threadPool_wait(ThreadPool* pool, ThreadPoolCounter* counter) {
+    int queueIndex = threadPool_queueOf(pool);
+    while (atomic_load(&counter->pending) > 0 || atomic_load(&counter->lock) != 0) {
+        ThreadPoolEntry* entry = threadPool_find(pool, queueIndex);
+        if (entry) {
+            threadPool_execute(pool, entry, queueIndex);
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+// Run task over [0, count) in slices of at most grain and return when all are done
+void threadPool_parallelFor(ThreadPool* pool, const char* name, ThreadPoolRangeTask task, void* context, size_t count, size_t grain) {
+    ThreadPoolCounter counter;
+    threadPool_initCounter(&counter);
+    
+    ThreadPoolJob job = { name, task, context, count, grain };
+    threadPool_submit(pool, &job, &counter);
+    threadPool_wait(pool, &counter);
+}
+
+// Call task for each index of a slice
+static void threadPool_runRange(void* context, size_t begin, size_t end) {
+    ThreadPoolRunContext* run = (ThreadPoolRunContext*)context;
+    for (size_t i = begin; i < end; i++) {
+        run->task(run->context, i);
+    }
+}
+
+// Run task(context, i) for every i in [0, count); the caller works too and returns when all are done
+void threadPool_run(ThreadPool* pool, ThreadPoolTask task, void* context, size_t count) {
+    if (count == 0) return;
+    
+    // Not worth waking anyone for a single item
+    if (pool->threadCount == 0 || count == 1) {
+        for (size_t i = 0; i < count; i++) {
+            task(context, i);
+        }
+        return;
+    }
+    
+    ThreadPoolRunContext run = { task, context };
+    threadPool_parallelFor(pool, NULL, threadPool_runRange, &run, count, 1);
+}
+
+// Install a callback that sees every timed slice (NULL to remove)
+void threadPool_setTimingHook(ThreadPool* pool, ThreadPoolTimingHook hook, void* context) {
+    pool->timingContext = context;
+    pool->timingHook = hook;
+}
+
+// Copy out and reset the per-name totals since the last call; returns how many were written
+int threadPool_collectTimings(ThreadPool* pool, ThreadPoolTiming* timings, int maxTimings) {
+    int count = 0;
+    for (int i = 0; i < THREAD_POOL_MAX_TIMERS && count < maxTimings; i++) {
+        ThreadPoolTimer* timer = &pool->timers[i];
+        const char* name = atomic_load_explicit(&timer->name, memory_order_acquire);
+        if (!name) break;
+        
+        unsigned int slices = atomic_exchange(&timer->slices, 0);
+        uint64_t nanoseconds = atomic_exchange(&timer->nanoseconds, 0);
+        if (slices == 0) continue;
+        
+        timings[count].name = name;
+        timings[count].time = (double)nanoseconds / 1000000.0;
+        timings[count].slices = slices;
+        count++;
+    }
+    return count;
+}
@@ -0,0 +1,262 @@
+#include "utils/trace.h"
+
+#ifdef WONDERLANDS_TRACE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#define TRACE_RING_MASK (TRACE_RING_EVENTS - 1)
+#define TRACE_CALIBRATION_SCOPES 4096
+
+// One thread's events. Only the owning thread writes; head is published after each
+// event, so a reader can tell which slots may have been overwritten while it copied.
+typedef struct {
+    TraceEvent events[TRACE_RING_EVENTS];
+    atomic_uint_fast64_t head;              // Events ever written
+    char name[32];
+    
+    // Open TRACE_BEGIN scopes (owner only)
+    const char* openNames[TRACE_MAX_DEPTH];
+    uint64_t openStarts[TRACE_MAX_DEPTH];
+    int depth;
+} TraceBuffer;
+
+// Trace state
+static TraceBuffer* buffers[TRACE_MAX_THREADS];
+static atomic_int bufferCount = 0;
+static atomic_bool enabled = false;
+static uint64_t epoch = 0;
+static double scopeCost = 0.0;              // Measured ns per recorded scope
+
+static _Thread_local TraceBuffer* threadBuffer = NULL;
+static _Thread_local bool threadFull = false;
+
+// Monotonic clock in nanoseconds
+uint64_t trace_now() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+// Buffer of the calling thread, allocated on first use
+static TraceBuffer* trace_threadBuffer() {
+    if (threadBuffer || threadFull) return threadBuffer;
+    
+    int index = atomic_fetch_add(&bufferCount, 1);
+    if (index >= TRACE_MAX_THREADS) {
+        atomic_fetch_sub(&bufferCount, 1);
+        threadFull = true;
+        return NULL;
+    }
+    
+    TraceBuffer* buffer = (TraceBuffer*)calloc(1, sizeof(TraceBuffer));
+    if (!buffer) {
+        threadFull = true;
+        return NULL;
+    }
+    atomic_init(&buffer->head, 0);
+    snprintf(buffer->name, sizeof(buffer->name), "Thread %d", index);
+    
+    // Readers skip the slot until it is set
+    buffers[index] = buffer;
+    threadBuffer = buffer;
+    return buffer;
+}
+
+// Append a completed event to the calling thread's ring
+void trace_record(const char* name, uint64_t start, uint64_t end) {
+    TraceBuffer* buffer = trace_threadBuffer();
+    if (!buffer) return;
+    
+    uint64_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    TraceEvent* event = &buffer->events[head & TRACE_RING_MASK];
+    event->name = name;
+    event->start = start;
+    event->end = end;
+    atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+}
+
+// Time what one scope costs, so dumps can state the overhead
+static void trace_calibrate() {
+    TraceBuffer* buffer = trace_threadBuffer();
+    if (!buffer) return;
+    
+    // Second pass only, once the ring pages are touched
+    for (int pass = 0; pass < 2; pass++) {
+        atomic_store(&buffer->head, 0);
+        uint64_t start = trace_now();
+        for (int i = 0; i < TRACE_CALIBRATION_SCOPES; i++) {
+            TraceScope scope = trace_beginScope("Calibration");
+            trace_endScope(&scope);
+        }
+        scopeCost = (double)(trace_now() - start) / TRACE_CALIBRATION_SCOPES;
+    }
+    
+    // Drop the calibration events
+    atomic_store(&buffer->head, 0);
+}
+
+// Initialize tracing on the main thread and start recording
+void trace_init() {
+    epoch = trace_now();
+    atomic_store(&enabled, true);
+    trace_setThreadName("Main");
+    trace_calibrate();
+    printf("CPU trace enabled: %d events per thread, ~%.0f ns per scope\n", TRACE_RING_EVENTS, scopeCost);
+}
+
+// Free all thread buffers (no thread may record afterwards)
+void trace_cleanup() {
+    atomic_store(&enabled, false);
+    int count = atomic_load(&bufferCount);
+    for (int i = 0; i < count; i++) {
+        free(buffers[i]);
+        buffers[i] = NULL;
+    }
+    atomic_store(&bufferCount, 0);
+    threadBuffer = NULL;
+}
+
+// Pause or resume recording on all threads
+void trace_setEnabled(bool value) {
+    atomic_store_explicit(&enabled, value, memory_order_relaxed);
+}
+
+bool trace_isEnabled() {
+    return atomic_load_explicit(&enabled, memory_order_relaxed);
+}
+
+// Name the calling thread in exported traces
+void trace_setThreadName(const char* name) {
+    TraceBuffer* buffer = trace_threadBuffer();
+    if (!buffer) return;
+    snprintf(buffer->name, sizeof(buffer->name), "%s", name);
+}
+
+// Open a scope (TRACE_SCOPE)
+TraceScope trace_beginScope(const char* name) {
+    TraceScope scope = { name, 0 };
+    if (atomic_load_explicit(&enabled, memory_order_relaxed)) {
+        scope.start = trace_now();
+    }
+    return scope;
+}
+
+// Close a scope (cleanup handler of TRACE_SCOPE)
+void trace_endScope(TraceScope* scope) {
+    if (scope->start == 0) return;
+    trace_record(scope->name, scope->start, trace_now());
+}
+
+// Open a scope closed by the next trace_end on this thread (TRACE_BEGIN)
+void trace_begin(const char* name) {
+    TraceBuffer* buffer = trace_threadBuffer();
+    if (!buffer) return;
+    
+    if (buffer->depth < TRACE_MAX_DEPTH) {
+        buffer->openNames[buffer->depth] = name;
+        buffer->openStarts[buffer->depth] = atomic_load_explicit(&enabled, memory_order_relaxed) ? trace_now() : 0;
+    }
+    buffer->depth++;
+}
+
+// Close the innermost TRACE_BEGIN scope
+void trace_end() {
+    TraceBuffer* buffer = threadBuffer;
+    if (!buffer || buffer->depth <= 0) return;
+    
+    buffer->depth--;
+    if (buffer->depth >= TRACE_MAX_DEPTH) return;
+    uint64_t start = buffer->openStarts[buffer->depth];
+    if (start != 0) trace_record(buffer->openNames[buffer->depth], start, trace_now());
+}
+
+// Thread pool timing hook: one event per executed job slice, on the thread that ran it
+void trace_recordJob(void* context, const char* name, int queue, uint64_t start, uint64_t end) {
+    (void)context;
+    (void)queue;
+    if (atomic_load_explicit(&enabled, memory_order_relaxed)) {
+        trace_record(name, start, end);
+    }
+}
+
+// Copy the events of one thread that are still intact; returns how many were copied
+static uint64_t trace_snapshot(TraceBuffer* buffer, TraceEvent* events, uint64_t* first) {
+    uint64_t head = atomic_load_explicit(&buffer->head, memory_order_acquire);
+    uint64_t begin = head > TRACE_RING_EVENTS ? head - TRACE_RING_EVENTS : 0;
+    for (uint64_t i = begin; i < head; i++) {
+        events[i - begin] = buffer->events[i & TRACE_RING_MASK];
+    }
+    
+    // The writer kept going: drop what it may have overwritten, plus the slot it is writing
+    uint64_t after = atomic_load_explicit(&buffer->head, memory_order_acquire);
+    uint64_t valid = after + 1 > TRACE_RING_EVENTS ? after + 1 - TRACE_RING_EVENTS : 0;
+    if (valid > begin) {
+        uint64_t skip = valid - begin;
+        if (skip > head - begin) skip = head - begin;
+        *first = skip;
+    } else {
+        *first = 0;
+    }
+    return head - begin;
+}
+
+// Write every thread's events that ended in the last seconds to a Chrome trace
+// (chrome://tracing, Perfetto). Recording continues while the dump runs.
+bool trace_dump(const char* path, double seconds) {
+    TraceEvent* events = (TraceEvent*)malloc(sizeof(TraceEvent) * TRACE_RING_EVENTS);
+    if (!events) return false;
+    
+    FILE* file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Failed to open trace file: %s\n", path);
+        free(events);
+        return false;
+    }
+    
+    uint64_t now = trace_now();
+    uint64_t window = (uint64_t)(seconds * 1.0e9);
+    uint64_t cutoff = now > window ? now - window : 0;
+    
+    fprintf(file, "{\"traceEvents\":[\n");
+    fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Enchanted Wonderlands\"}}");
+    
+    int threadCount = atomic_load(&bufferCount);
+    uint64_t eventCount = 0;
+    for (int t = 0; t < threadCount; t++) {
+        TraceBuffer* buffer = buffers[t];
+        if (!buffer) continue;
+        
+        fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                t + 1, buffer->name);
+        fprintf(file, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"sort_index\":%d}}",
+                t + 1, t);
+        
+        uint64_t first = 0;
+        uint64_t count = trace_snapshot(buffer, events, &first);
+        for (uint64_t i = first; i < count; i++) {
+            const TraceEvent* event = &events[i];
+            if (event->end < cutoff || event->end < event->start) continue;
+            
+            fprintf(file, ",\n{\"name\":\"%s\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                    event->name, t + 1,
+                    (double)(event->start - epoch) / 1000.0, (double)(event->end - event->start) / 1000.0);
+            eventCount++;
+        }
+    }
+    
+    fprintf(file, "\n],\"displayTimeUnit\":\"ns\"}\n");
+    fclose(file);
+    free(events);
+    
+    // Recording cost over the window, as a share of one core
+    double overhead = seconds > 0.0 ? eventCount * scopeCost / (seconds * 1.0e9) * 100.0 : 0.0;
+    printf("Dumped %llu CPU trace events from %d threads (last %.1f s) to %s, recording cost ~%.3f%% of one core\n",
+           (unsigned long long)eventCount, threadCount, seconds, path, overhead);
+    return true;
+}
+
+#endif // WONDERLANDS_TRACE
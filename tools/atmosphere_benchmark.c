@@ -0,0 +1,151 @@
+// Atmosphere LUT benchmark: startup cost of the transmittance and multiple-scattering LUTs,
+// and the cost of rebuilding the sky view whole or in per-frame slices as the sun moves.
+//
+// Usage:
+//   atmosphere_benchmark [--cores N] [--iterations N]
+//
+// Reported as median milliseconds on a pool of --cores cores (the calling thread included):
+//   transmittance      built at startup (or loaded from cache/atmosphere)
+//   multi-scattering   built at startup after transmittance
+//   sky view           one full rebuild
+//   sky view slice     ATMOSPHERE_SKY_VIEW_ROWS rows, the per-frame cost while the sun moves
+// The sky is then checked for the expected colours: a blue sky at noon and a sunset that is
+// redder towards the sun than away from it.
+
+#include "rendering/atmosphere.h"
+#include "config.h"
+#include "utils/thread_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ATMOSPHERE_BENCHMARK_DEFAULT_ITERATIONS 5
+#define ATMOSPHERE_BENCHMARK_MAX_ITERATIONS 100
+
+// Wall clock in milliseconds
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Median of a small sample set (sorts in place)
+static double bench_median(double* samples, int count) {
+    for (int i = 1; i < count; i++) {
+        double value = samples[i];
+        int j = i;
+        for (; j > 0 && samples[j - 1] > value; j--) samples[j] = samples[j - 1];
+        samples[j] = value;
+    }
+    return count % 2 ? samples[count / 2] : 0.5 * (samples[count / 2 - 1] + samples[count / 2]);
+}
+
+// Sky-view texel at u (azimuth from the sun) and v (view zenith), both in [0, 1]
+static const float* bench_skyTexel(const Atmosphere* atmosphere, float u, float v) {
+    int x = (int)(u * (ATMOSPHERE_SKY_VIEW_WIDTH - 1) + 0.5f);
+    int y = (int)(v * (ATMOSPHERE_SKY_VIEW_HEIGHT - 1) + 0.5f);
+    return atmosphere->skyView + ((size_t)y * ATMOSPHERE_SKY_VIEW_WIDTH + x) * 3;
+}
+
+static void printUsage(const char* program) {
+    fprintf(stderr, "Usage: %s [--cores N] [--iterations N]\n", program);
+}
+
+int main(int argc, char** argv) {
+    long onlineCores = sysconf(_SC_NPROCESSORS_ONLN);
+    int cores = onlineCores > 0 ? (int)onlineCores : 1;
+    int iterations = ATMOSPHERE_BENCHMARK_DEFAULT_ITERATIONS;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--cores") == 0 && i + 1 < argc) {
+            cores = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (cores < 1) cores = 1;
+    if (cores > THREAD_POOL_MAX_THREADS + 1) cores = THREAD_POOL_MAX_THREADS + 1;
+    if (iterations < 1) iterations = 1;
+    if (iterations > ATMOSPHERE_BENCHMARK_MAX_ITERATIONS) iterations = ATMOSPHERE_BENCHMARK_MAX_ITERATIONS;
+    
+    ThreadPool* pool = (ThreadPool*)malloc(sizeof(ThreadPool));
+    if (!pool) return 1;
+    threadPool_init(pool, cores - 1);
+    
+    AtmosphereParams params;
+    atmosphere_defaultParams(&params);
+    Atmosphere atmosphere;
+    
+    // Startup LUTs, without the cache so every iteration builds them
+    double transmittance[ATMOSPHERE_BENCHMARK_MAX_ITERATIONS];
+    double multiScattering[ATMOSPHERE_BENCHMARK_MAX_ITERATIONS];
+    for (int i = 0; i < iterations; i++) {
+        if (!atmosphere_init(&atmosphere, &params, ATMOSPHERE_VIEWER_HEIGHT, NULL, pool)) return 1;
+        transmittance[i] = atmosphere.transmittanceTime;
+        multiScattering[i] = atmosphere.multiScatteringTime;
+        if (i + 1 < iterations) atmosphere_cleanup(&atmosphere);
+    }
+    
+    // Whole sky-view rebuilds, then sliced ones over a sweep of sun elevations
+    double skyView[ATMOSPHERE_BENCHMARK_MAX_ITERATIONS];
+    for (int i = 0; i < iterations; i++) {
+        atmosphere_beginSkyView(&atmosphere, 0.5f);
+        double start = bench_now();
+        atmosphere_buildSkyView(&atmosphere, 0, pool);
+        skyView[i] = bench_now() - start;
+    }
+    
+    static double slices[ATMOSPHERE_BENCHMARK_MAX_ITERATIONS * ATMOSPHERE_SKY_VIEW_HEIGHT];
+    int sliceCount = 0;
+    double worstSlice = 0.0;
+    for (int i = 0; i < iterations; i++) {
+        atmosphere_beginSkyView(&atmosphere, 0.5f - i * ATMOSPHERE_SUN_STEP);
+        bool complete = false;
+        while (!complete) {
+            double start = bench_now();
+            complete = atmosphere_buildSkyView(&atmosphere, ATMOSPHERE_SKY_VIEW_ROWS, pool);
+            double elapsed = bench_now() - start;
+            slices[sliceCount++] = elapsed;
+            if (elapsed > worstSlice) worstSlice = elapsed;
+        }
+    }
+    
+    printf("Atmosphere LUTs on %d cores, %d iterations\n", cores, iterations);
+    printf("  %-18s %4dx%-4d %8.3f ms\n", "transmittance", ATMOSPHERE_TRANSMITTANCE_WIDTH, ATMOSPHERE_TRANSMITTANCE_HEIGHT,
+           bench_median(transmittance, iterations));
+    printf("  %-18s %4dx%-4d %8.3f ms\n", "multi-scattering", ATMOSPHERE_MULTI_SCATTERING_SIZE, ATMOSPHERE_MULTI_SCATTERING_SIZE,
+           bench_median(multiScattering, iterations));
+    printf("  %-18s %4dx%-4d %8.3f ms\n", "sky view", ATMOSPHERE_SKY_VIEW_WIDTH, ATMOSPHERE_SKY_VIEW_HEIGHT,
+           bench_median(skyView, iterations));
+    printf("  %-18s %4d rows  %8.3f ms  worst %8.3f ms  (%d slices per rebuild)\n", "sky view slice", ATMOSPHERE_SKY_VIEW_ROWS,
+           bench_median(slices, sliceCount), worstSlice, sliceCount / iterations);
+    
+    // Noon: the zenith is blue
+    atmosphere_beginSkyView(&atmosphere, 1.2f);
+    atmosphere_buildSkyView(&atmosphere, 0, pool);
+    const float* zenith = bench_skyTexel(&atmosphere, 0.5f, 0.0f);
+    printf("Noon zenith          %.4f %.4f %.4f\n", zenith[0], zenith[1], zenith[2]);
+    bool ok = zenith[2] > zenith[1] && zenith[1] > zenith[0];
+    
+    // Sunset: just above the horizon the sky towards the sun is redder than away from it
+    atmosphere_beginSkyView(&atmosphere, 0.01f);
+    atmosphere_buildSkyView(&atmosphere, 0, pool);
+    const float* towards = bench_skyTexel(&atmosphere, 0.0f, 0.45f);
+    const float* away = bench_skyTexel(&atmosphere, 1.0f, 0.45f);
+    printf("Sunset towards sun   %.4f %.4f %.4f\n", towards[0], towards[1], towards[2]);
+    printf("Sunset away from sun %.4f %.4f %.4f\n", away[0], away[1], away[2]);
+    ok = ok && towards[0] / towards[2] > away[0] / away[2] && towards[0] > away[0];
+    
+    atmosphere_cleanup(&atmosphere);
+    threadPool_cleanup(pool);
+    free(pool);
+    if (!ok) printf("Sky colours are NOT as expected\n");
+    return ok ? 0 : 1;
+}
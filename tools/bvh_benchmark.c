@@ -0,0 +1,449 @@
+// BVH benchmark: builds, refits and queries a BVH over scattered instance spheres, the way
+// the scene BVH does, and checks every query against brute force.
+//
+// Usage:
+//   bvh_benchmark [--instances N] [--iterations N] [--queries N]
+//
+// Two layouts are measured:
+//   instances   one primitive per instance
+//   clusters    one primitive per 64 Morton-adjacent instances (the scene BVH's layout);
+//               queries refine to the instances inside each cluster
+//
+// Refit moves every instance a little and refits the tree built before the move.
+// Query times are per query: frustum (8 view directions), ray (closest hit), sphere (radius 30).
+
+#include "utils/bvh.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+
+#define BVH_BENCHMARK_DEFAULT_INSTANCES 100000
+#define BVH_BENCHMARK_DEFAULT_ITERATIONS 10
+#define BVH_BENCHMARK_DEFAULT_QUERIES 1024
+#define BVH_BENCHMARK_CLUSTER_SIZE 64
+#define BVH_BENCHMARK_WORLD_SIZE 2000.0f
+#define BVH_BENCHMARK_SPHERE_RADIUS 30.0f
+#define BVH_BENCHMARK_RAY_LENGTH 2000.0f
+
+typedef struct {
+    float center[3];
+    float radius;
+} BenchSphere;
+
+// One layout under test
+typedef struct {
+    const char* name;
+    Bvh bvh;
+    BenchSphere* spheres;
+    uint32_t* order;                    // Instances in cluster order
+    uint32_t clusterSize;               // 1 = one primitive per instance
+    uint32_t primitiveCount;
+    size_t instanceCount;
+} BenchLayout;
+
+// Query inputs, shared by the layouts and brute force
+typedef struct {
+    float planes[8][6][4];
+    float (*rayOrigins)[3];
+    float (*rayDirections)[3];
+    float (*sphereCenters)[3];
+    int queryCount;
+} BenchQueries;
+
+// Per-query results for cross-checking
+typedef struct {
+    size_t frustum[8];
+    float* rayHits;
+    size_t* sphereHits;
+} BenchResults;
+
+// Ray test context
+typedef struct {
+    const BenchLayout* layout;
+} BenchRayContext;
+
+// Wall clock in milliseconds
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static unsigned int bench_seed = 12345u;
+
+// Uniform in [0, 1)
+static float bench_random(void) {
+    bench_seed = bench_seed * 1664525u + 1013904223u;
+    return (bench_seed >> 8) / 16777216.0f;
+}
+
+// Median of a small sample set (sorts in place)
+static double bench_median(double* samples, int count) {
+    for (int i = 1; i < count; i++) {
+        double value = samples[i];
+        int j = i;
+        for (; j > 0 && samples[j - 1] > value; j--) samples[j] = samples[j - 1];
+        samples[j] = value;
+    }
+    return count % 2 ? samples[count / 2] : 0.5 * (samples[count / 2 - 1] + samples[count / 2]);
+}
+
+// Interleave the low 16 bits of x and z into a 32-bit Morton code
+static uint32_t bench_morton(uint32_t x, uint32_t z) {
+    uint32_t code = 0;
+    for (int bit = 0; bit < 16; bit++) {
+        code |= ((x >> bit) & 1u) << (bit * 2);
+        code |= ((z >> bit) & 1u) << (bit * 2 + 1);
+    }
+    return code;
+}
+
+static int bench_compareKeys(const void* a, const void* b) {
+    uint64_t ka = *(const uint64_t*)a;
+    uint64_t kb = *(const uint64_t*)b;
+    return ka < kb ? -1 : (ka > kb ? 1 : 0);
+}
+
+// Camera at the centre of the world looking along one of 8 headings, 60 degrees wide,
+// near 0.1, far 1000 (same planes as job_benchmark, rotated about Y)
+static void bench_setupFrustum(float planes[6][4], float yaw) {
+    const float s = 0.5f;               // sin(30)
+    const float c = 0.8660254f;         // cos(30)
+    const float local[6][4] = {
+        {  c, 0.0f, -s, 0.0f },
+        { -c, 0.0f, -s, 0.0f },
+        { 0.0f,  c, -s, 0.0f },
+        { 0.0f, -c, -s, 0.0f },
+        { 0.0f, 0.0f, -1.0f, -0.1f },
+        { 0.0f, 0.0f,  1.0f, 1000.0f }
+    };
+    float sine = sinf(yaw);
+    float cosine = cosf(yaw);
+    for (int p = 0; p < 6; p++) {
+        planes[p][0] = cosine * local[p][0] + sine * local[p][2];
+        planes[p][1] = local[p][1];
+        planes[p][2] = -sine * local[p][0] + cosine * local[p][2];
+        planes[p][3] = local[p][3];
+    }
+}
+
+// Box around the spheres of one primitive
+static void bench_primitiveBox(const BenchLayout* layout, uint32_t primitive, BvhBox* box) {
+    size_t first = (size_t)primitive * layout->clusterSize;
+    size_t last = first + layout->clusterSize;
+    if (last > layout->instanceCount) last = layout->instanceCount;
+    
+    for (int axis = 0; axis < 3; axis++) {
+        box->min[axis] = INFINITY;
+        box->max[axis] = -INFINITY;
+    }
+    for (size_t i = first; i < last; i++) {
+        const BenchSphere* sphere = &layout->spheres[layout->order[i]];
+        for (int axis = 0; axis < 3; axis++) {
+            box->min[axis] = fminf(box->min[axis], sphere->center[axis] - sphere->radius);
+            box->max[axis] = fmaxf(box->max[axis], sphere->center[axis] + sphere->radius);
+        }
+    }
+}
+
+static void bench_updateBoxes(BenchLayout* layout) {
+    for (uint32_t p = 0; p < layout->primitiveCount; p++) {
+        bench_primitiveBox(layout, p, &layout->bvh.boxes[p]);
+    }
+}
+
+// Entry distance of a ray into a sphere (0 from inside), negative for a miss
+static float bench_raySphere(const BenchSphere* sphere, const float* origin, const float* direction) {
+    float offset[3] = { origin[0] - sphere->center[0], origin[1] - sphere->center[1], origin[2] - sphere->center[2] };
+    float b = offset[0] * direction[0] + offset[1] * direction[1] + offset[2] * direction[2];
+    float c = offset[0] * offset[0] + offset[1] * offset[1] + offset[2] * offset[2] - sphere->radius * sphere->radius;
+    if (c <= 0.0f) return 0.0f;
+    
+    float discriminant = b * b - c;
+    if (discriminant < 0.0f || b > 0.0f) return -1.0f;
+    return -b - sqrtf(discriminant);
+}
+
+// BVH ray test: closest instance sphere of the primitive
+static float bench_rayTest(void* context, uint32_t index, const float* origin, const float* direction, float maxT) {
+    const BenchLayout* layout = ((BenchRayContext*)context)->layout;
+    size_t first = (size_t)index * layout->clusterSize;
+    size_t last = first + layout->clusterSize;
+    if (last > layout->instanceCount) last = layout->instanceCount;
+    
+    float closest = -1.0f;
+    for (size_t i = first; i < last; i++) {
+        float t = bench_raySphere(&layout->spheres[layout->order[i]], origin, direction);
+        if (t >= 0.0f && t < maxT) {
+            maxT = t;
+            closest = t;
+        }
+    }
+    return closest;
+}
+
+// Instances of the returned primitives whose sphere overlaps the query sphere
+static size_t bench_refineSphere(const BenchLayout* layout, const uint32_t* primitives, size_t count, const float* center, float radius) {
+    size_t found = 0;
+    for (size_t p = 0; p < count; p++) {
+        size_t first = (size_t)primitives[p] * layout->clusterSize;
+        size_t last = first + layout->clusterSize;
+        if (last > layout->instanceCount) last = layout->instanceCount;
+        for (size_t i = first; i < last; i++) {
+            const BenchSphere* sphere = &layout->spheres[layout->order[i]];
+            float dx = sphere->center[0] - center[0];
+            float dy = sphere->center[1] - center[1];
+            float dz = sphere->center[2] - center[2];
+            float reach = sphere->radius + radius;
+            if (dx * dx + dy * dy + dz * dz <= reach * reach) found++;
+        }
+    }
+    return found;
+}
+
+// Time the three query kinds over a layout (microseconds per query) and record results
+static void bench_runQueries(const BenchLayout* layout, const BenchQueries* queries, uint32_t* scratch,
+                             BenchResults* results, double* frustumTime, double* rayTime, double* sphereTime) {
+    double start = bench_now();
+    for (int f = 0; f < 8; f++) {
+        results->frustum[f] = bvh_queryFrustum(&layout->bvh, queries->planes[f], scratch, layout->primitiveCount);
+    }
+    *frustumTime = (bench_now() - start) * 1000.0 / 8;
+    
+    BenchRayContext context = { layout };
+    start = bench_now();
+    for (int q = 0; q < queries->queryCount; q++) {
+        uint32_t hit = 0;
+        results->rayHits[q] = bvh_raycast(&layout->bvh, queries->rayOrigins[q], queries->rayDirections[q],
+                                          BVH_BENCHMARK_RAY_LENGTH, bench_rayTest, &context, &hit);
+    }
+    *rayTime = (bench_now() - start) * 1000.0 / queries->queryCount;
+    
+    start = bench_now();
+    for (int q = 0; q < queries->queryCount; q++) {
+        size_t count = bvh_querySphere(&layout->bvh, queries->sphereCenters[q], BVH_BENCHMARK_SPHERE_RADIUS, scratch, layout->primitiveCount);
+        results->sphereHits[q] = bench_refineSphere(layout, scratch, count, queries->sphereCenters[q], BVH_BENCHMARK_SPHERE_RADIUS);
+    }
+    *sphereTime = (bench_now() - start) * 1000.0 / queries->queryCount;
+}
+
+// The same queries without a tree: every primitive of a layout is tested
+static void bench_runBruteForce(const BenchLayout* layout, const BenchQueries* queries, uint32_t* scratch,
+                                BenchResults* results, double* frustumTime, double* rayTime, double* sphereTime) {
+    const Bvh* bvh = &layout->bvh;
+    double start = bench_now();
+    for (int f = 0; f < 8; f++) {
+        size_t found = 0;
+        for (uint32_t p = 0; p < bvh->count; p++) {
+            const BvhBox* box = &bvh->boxes[p];
+            bool inside = true;
+            for (int i = 0; i < 6 && inside; i++) {
+                const float* plane = queries->planes[f][i];
+                float far = plane[3];
+                for (int axis = 0; axis < 3; axis++) {
+                    far += fmaxf(plane[axis] * box->min[axis], plane[axis] * box->max[axis]);
+                }
+                inside = far >= 0.0f;
+            }
+            if (inside) found++;
+        }
+        results->frustum[f] = found;
+    }
+    *frustumTime = (bench_now() - start) * 1000.0 / 8;
+    
+    BenchRayContext context = { layout };
+    start = bench_now();
+    for (int q = 0; q < queries->queryCount; q++) {
+        float closest = BVH_BENCHMARK_RAY_LENGTH;
+        bool hit = false;
+        for (uint32_t p = 0; p < bvh->count; p++) {
+            float t = bench_rayTest(&context, p, queries->rayOrigins[q], queries->rayDirections[q], closest);
+            if (t >= 0.0f && t < closest) {
+                closest = t;
+                hit = true;
+            }
+        }
+        results->rayHits[q] = hit ? closest : -1.0f;
+    }
+    *rayTime = (bench_now() - start) * 1000.0 / queries->queryCount;
+    
+    start = bench_now();
+    for (int q = 0; q < queries->queryCount; q++) {
+        for (uint32_t p = 0; p < bvh->count; p++) scratch[p] = p;
+        results->sphereHits[q] = bench_refineSphere(layout, scratch, bvh->count, queries->sphereCenters[q], BVH_BENCHMARK_SPHERE_RADIUS);
+    }
+    *sphereTime = (bench_now() - start) * 1000.0 / queries->queryCount;
+}
+
+// Compare tree results with brute force; returns the number of mismatching queries
+static int bench_compare(const BenchResults* a, const BenchResults* b, int queryCount) {
+    int mismatches = 0;
+    for (int f = 0; f < 8; f++) {
+        if (a->frustum[f] != b->frustum[f]) mismatches++;
+    }
+    for (int q = 0; q < queryCount; q++) {
+        if (fabsf(a->rayHits[q] - b->rayHits[q]) > 1.0e-3f) mismatches++;
+        if (a->sphereHits[q] != b->sphereHits[q]) mismatches++;
+    }
+    return mismatches;
+}
+
+static bool bench_allocResults(BenchResults* results, int queryCount) {
+    results->rayHits = (float*)malloc(sizeof(float) * queryCount);
+    results->sphereHits = (size_t*)malloc(sizeof(size_t) * queryCount);
+    return results->rayHits && results->sphereHits;
+}
+
+static void bench_freeResults(BenchResults* results) {
+    free(results->rayHits);
+    free(results->sphereHits);
+}
+
+static void printUsage(const char* program) {
+    fprintf(stderr, "Usage: %s [--instances N] [--iterations N] [--queries N]\n", program);
+}
+
+int main(int argc, char** argv) {
+    size_t instanceCount = BVH_BENCHMARK_DEFAULT_INSTANCES;
+    int iterations = BVH_BENCHMARK_DEFAULT_ITERATIONS;
+    int queryCount = BVH_BENCHMARK_DEFAULT_QUERIES;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--instances") == 0 && i + 1 < argc) {
+            instanceCount = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--queries") == 0 && i + 1 < argc) {
+            queryCount = atoi(argv[++i]);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (instanceCount < 1) instanceCount = 1;
+    if (instanceCount > 0x7fffffffu) instanceCount = 0x7fffffffu;
+    if (iterations < 1) iterations = 1;
+    if (queryCount < 1) queryCount = 1;
+    
+    // Deterministic instances over the world, the way vegetation is scattered
+    BenchSphere* spheres = (BenchSphere*)malloc(sizeof(BenchSphere) * instanceCount);
+    uint32_t* identity = (uint32_t*)malloc(sizeof(uint32_t) * instanceCount);
+    uint32_t* morton = (uint32_t*)malloc(sizeof(uint32_t) * instanceCount);
+    uint64_t* keys = (uint64_t*)malloc(sizeof(uint64_t) * instanceCount);
+    uint32_t* scratch = (uint32_t*)malloc(sizeof(uint32_t) * instanceCount);
+    double* samples = (double*)malloc(sizeof(double) * iterations);
+    BenchQueries queries;
+    queries.queryCount = queryCount;
+    queries.rayOrigins = malloc(sizeof(float) * 3 * queryCount);
+    queries.rayDirections = malloc(sizeof(float) * 3 * queryCount);
+    queries.sphereCenters = malloc(sizeof(float) * 3 * queryCount);
+    BenchResults treeResults, bruteResults;
+    if (!spheres || !identity || !morton || !keys || !scratch || !samples || !queries.rayOrigins || !queries.rayDirections ||
+        !queries.sphereCenters || !bench_allocResults(&treeResults, queryCount) || !bench_allocResults(&bruteResults, queryCount)) {
+        fprintf(stderr, "Out of memory for %zu instances\n", instanceCount);
+        return 1;
+    }
+    
+    float half = BVH_BENCHMARK_WORLD_SIZE * 0.5f;
+    for (size_t i = 0; i < instanceCount; i++) {
+        spheres[i].center[0] = (bench_random() - 0.5f) * BVH_BENCHMARK_WORLD_SIZE;
+        spheres[i].center[1] = bench_random() * 40.0f;
+        spheres[i].center[2] = (bench_random() - 0.5f) * BVH_BENCHMARK_WORLD_SIZE;
+        spheres[i].radius = 1.0f + (i % 5) * 0.5f;
+        identity[i] = (uint32_t)i;
+        
+        uint32_t x = (uint32_t)((spheres[i].center[0] + half) / BVH_BENCHMARK_WORLD_SIZE * 65535.0f);
+        uint32_t z = (uint32_t)((spheres[i].center[2] + half) / BVH_BENCHMARK_WORLD_SIZE * 65535.0f);
+        keys[i] = ((uint64_t)bench_morton(x, z) << 32) | i;
+    }
+    qsort(keys, instanceCount, sizeof(uint64_t), bench_compareKeys);
+    for (size_t i = 0; i < instanceCount; i++) morton[i] = (uint32_t)keys[i];
+    free(keys);
+    
+    for (int f = 0; f < 8; f++) bench_setupFrustum(queries.planes[f], f * 0.7853982f);
+    for (int q = 0; q < queryCount; q++) {
+        // Rays from eye height across the ground, the way a pick ray runs
+        float yaw = bench_random() * 6.2831853f;
+        float pitch = -bench_random() * 0.3f;
+        queries.rayOrigins[q][0] = (bench_random() - 0.5f) * BVH_BENCHMARK_WORLD_SIZE;
+        queries.rayOrigins[q][1] = 20.0f;
+        queries.rayOrigins[q][2] = (bench_random() - 0.5f) * BVH_BENCHMARK_WORLD_SIZE;
+        queries.rayDirections[q][0] = cosf(pitch) * sinf(yaw);
+        queries.rayDirections[q][1] = sinf(pitch);
+        queries.rayDirections[q][2] = cosf(pitch) * cosf(yaw);
+        
+        queries.sphereCenters[q][0] = (bench_random() - 0.5f) * BVH_BENCHMARK_WORLD_SIZE;
+        queries.sphereCenters[q][1] = 10.0f;
+        queries.sphereCenters[q][2] = (bench_random() - 0.5f) * BVH_BENCHMARK_WORLD_SIZE;
+    }
+    
+    BenchLayout layouts[2] = {
+        { "instances", { 0 }, spheres, identity, 1, 0, instanceCount },
+        { "clusters of 64", { 0 }, spheres, morton, BVH_BENCHMARK_CLUSTER_SIZE, 0, instanceCount }
+    };
+    
+    printf("%zu instances, %d iterations (median), %d ray and sphere queries\n", instanceCount, iterations, queryCount);
+    printf("%-16s %9s %8s %6s %10s %10s %12s %10s %12s\n", "layout", "primitives", "nodes", "depth",
+           "build ms", "refit ms", "frustum us", "ray us", "sphere us");
+    
+    int mismatches = 0;
+    for (int l = 0; l < 2; l++) {
+        BenchLayout* layout = &layouts[l];
+        layout->primitiveCount = (uint32_t)((instanceCount + layout->clusterSize - 1) / layout->clusterSize);
+        if (!bvh_init(&layout->bvh, layout->primitiveCount)) return 1;
+        bench_updateBoxes(layout);
+        
+        for (int i = 0; i < iterations; i++) {
+            double start = bench_now();
+            bvh_build(&layout->bvh, layout->primitiveCount);
+            samples[i] = bench_now() - start;
+        }
+        double build = bench_median(samples, iterations);
+        
+        // Nudge every instance, then refit the tree built for the old positions
+        for (int i = 0; i < iterations; i++) {
+            for (size_t s = 0; s < instanceCount; s++) {
+                spheres[s].center[0] += (i % 2 ? -0.5f : 0.5f);
+            }
+            bench_updateBoxes(layout);
+            double start = bench_now();
+            bvh_refit(&layout->bvh);
+            samples[i] = bench_now() - start;
+        }
+        double refit = bench_median(samples, iterations);
+        
+        double frustumTime, rayTime, sphereTime;
+        bench_runQueries(layout, &queries, scratch, &treeResults, &frustumTime, &rayTime, &sphereTime);
+        printf("%-16s %9u %8u %6d %10.3f %10.3f %12.2f %10.2f %12.2f\n", layout->name, layout->primitiveCount,
+               layout->bvh.nodeCount, layout->bvh.depth, build, refit, frustumTime, rayTime, sphereTime);
+        
+        double bruteFrustum, bruteRay, bruteSphere;
+        bench_runBruteForce(layout, &queries, scratch, &bruteResults, &bruteFrustum, &bruteRay, &bruteSphere);
+        printf("%-16s %9s %8s %6s %10s %10s %12.2f %10.2f %12.2f\n", "  brute force", "", "", "", "", "",
+               bruteFrustum, bruteRay, bruteSphere);
+        mismatches += bench_compare(&treeResults, &bruteResults, queryCount);
+    }
+    
+    if (mismatches) {
+        printf("%d queries differ from brute force\n", mismatches);
+    } else {
+        printf("All queries match brute force\n");
+    }
+    
+    for (int l = 0; l < 2; l++) bvh_cleanup(&layouts[l].bvh);
+    bench_freeResults(&treeResults);
+    bench_freeResults(&bruteResults);
+    free(queries.rayOrigins);
+    free(queries.rayDirections);
+    free(queries.sphereCenters);
+    free(samples);
+    free(scratch);
+    free(morton);
+    free(identity);
+    free(spheres);
+    return mismatches ? 1 : 0;
+}
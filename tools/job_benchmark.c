@@ -0,0 +1,284 @@
+// Thread pool scaling benchmark: runs the same CPU workloads on 1..N cores and reports
+// time, speedup and parallel efficiency for each core count.
+//
+// Usage:
+//   job_benchmark [--cores N] [--items N] [--iterations N] [--csv file]
+//
+// Workloads:
+//   cull    parallel_for over instances: build a model matrix, test its sphere against a frustum
+//   graph   a scene-update shaped job graph: one serial job, then three parallel_for jobs
+//           that depend on it, plus an independent one
+//
+// "Cores" counts the calling thread, so N cores is a pool of N - 1 workers.
+
+#include "utils/thread_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#define JOB_BENCHMARK_DEFAULT_ITEMS 1000000
+#define JOB_BENCHMARK_DEFAULT_ITERATIONS 20
+#define JOB_BENCHMARK_GRAIN 1024
+#define JOB_BENCHMARK_GRAPH_WORK 64     // Inner loop length per graph item
+
+typedef struct {
+    float position[3];
+    float radius;
+    float angle;
+    float scale;
+} BenchInstance;
+
+// Inputs and outputs of one run
+typedef struct {
+    ThreadPool* pool;
+    const BenchInstance* instances;
+    float* matrices;                    // 16 per instance
+    unsigned char* visible;
+    float* field;                       // Graph workload output
+    size_t count;
+    float planes[6][4];
+} BenchState;
+
+// Wall clock in milliseconds
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Symmetric frustum around -Z, 60 degrees wide, near 0.1, far 1000
+static void bench_setupFrustum(BenchState* state) {
+    const float s = 0.5f;               // sin(30)
+    const float c = 0.8660254f;         // cos(30)
+    const float planes[6][4] = {
+        {  c, 0.0f, -s, 0.0f },
+        { -c, 0.0f, -s, 0.0f },
+        { 0.0f,  c, -s, 0.0f },
+        { 0.0f, -c, -s, 0.0f },
+        { 0.0f, 0.0f, -1.0f, -0.1f },
+        { 0.0f, 0.0f,  1.0f, 1000.0f }
+    };
+    memcpy(state->planes, planes, sizeof(planes));
+}
+
+// Build the instance transform and test it against the frustum
+static void bench_cullRange(void* context, size_t begin, size_t end) {
+    BenchState* state = (BenchState*)context;
+    for (size_t i = begin; i < end; i++) {
+        const BenchInstance* instance = &state->instances[i];
+        float* m = &state->matrices[i * 16];
+        float sine = sinf(instance->angle) * instance->scale;
+        float cosine = cosf(instance->angle) * instance->scale;
+        m[0] = cosine;  m[1] = 0.0f;            m[2] = -sine;   m[3] = 0.0f;
+        m[4] = 0.0f;    m[5] = instance->scale; m[6] = 0.0f;    m[7] = 0.0f;
+        m[8] = sine;    m[9] = 0.0f;            m[10] = cosine; m[11] = 0.0f;
+        m[12] = instance->position[0];
+        m[13] = instance->position[1];
+        m[14] = instance->position[2];
+        m[15] = 1.0f;
+        
+        float radius = instance->radius * instance->scale;
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++) {
+            const float* plane = state->planes[p];
+            float distance = plane[0] * m[12] + plane[1] * m[13] + plane[2] * m[14] + plane[3];
+            inside = distance >= -radius;
+        }
+        state->visible[i] = inside;
+    }
+}
+
+// Arithmetic-heavy stand-in for a scene system's per-element update
+static void bench_fieldRange(void* context, size_t begin, size_t end) {
+    BenchState* state = (BenchState*)context;
+    for (size_t i = begin; i < end; i++) {
+        float x = (float)i * 0.001f;
+        float value = 0.0f;
+        for (int k = 0; k < JOB_BENCHMARK_GRAPH_WORK; k++) {
+            value += sinf(x * (float)(k + 1)) * 0.5f;
+        }
+        state->field[i] = value;
+    }
+}
+
+// Graph node: a small serial pass at the start of the field
+static void bench_serialJob(void* context, size_t begin, size_t end) {
+    (void)begin; (void)end;
+    BenchState* state = (BenchState*)context;
+    bench_fieldRange(state, 0, state->count / 64);
+}
+
+// Graph node: a nested parallel_for over the node's slice of the field
+static void bench_parallelJob(void* context, size_t begin, size_t end) {
+    (void)begin; (void)end;
+    BenchState* state = (BenchState*)context;
+    threadPool_parallelFor(state->pool, "Bench: field", bench_fieldRange, state, state->count, JOB_BENCHMARK_GRAIN / 8);
+}
+
+static void bench_runCull(BenchState* state) {
+    threadPool_parallelFor(state->pool, "Bench: cull", bench_cullRange, state, state->count, JOB_BENCHMARK_GRAIN);
+}
+
+// serial -> parts 0..2 on quarters 0..2, independent part on quarter 3 alongside
+static void bench_runGraph(BenchState* state) {
+    BenchState quarters[4];
+    size_t quarter = state->count / 4;
+    for (int i = 0; i < 4; i++) {
+        quarters[i] = *state;
+        quarters[i].field = state->field + i * quarter;
+        quarters[i].count = quarter;
+    }
+    
+    ThreadPoolCounter first;
+    ThreadPoolCounter done;
+    threadPool_initCounter(&first);
+    threadPool_initCounter(&done);
+    
+    const ThreadPoolJob serialJob = { "Bench: serial", bench_serialJob, state, 1, 1 };
+    threadPool_submit(state->pool, &serialJob, &first);
+    const ThreadPoolJob independentJob = { "Bench: independent", bench_parallelJob, &quarters[3], 1, 1 };
+    threadPool_submit(state->pool, &independentJob, &done);
+    for (int i = 0; i < 3; i++) {
+        const ThreadPoolJob partJob = { "Bench: part", bench_parallelJob, &quarters[i], 1, 1 };
+        threadPool_submitAfter(state->pool, &partJob, &first, &done);
+    }
+    
+    threadPool_wait(state->pool, &done);
+    threadPool_wait(state->pool, &first);
+}
+
+// Median of a small sample set (sorts in place)
+static double bench_median(double* samples, int count) {
+    for (int i = 1; i < count; i++) {
+        double value = samples[i];
+        int j = i;
+        for (; j > 0 && samples[j - 1] > value; j--) samples[j] = samples[j - 1];
+        samples[j] = value;
+    }
+    return count % 2 ? samples[count / 2] : 0.5 * (samples[count / 2 - 1] + samples[count / 2]);
+}
+
+// Median time of one workload over the iterations (after one warmup run)
+static double bench_measure(BenchState* state, void (*run)(BenchState*), int iterations, double* samples) {
+    run(state);
+    for (int i = 0; i < iterations; i++) {
+        double start = bench_now();
+        run(state);
+        samples[i] = bench_now() - start;
+    }
+    return bench_median(samples, iterations);
+}
+
+static void printUsage(const char* program) {
+    fprintf(stderr, "Usage: %s [--cores N] [--items N] [--iterations N] [--csv file]\n", program);
+}
+
+int main(int argc, char** argv) {
+    long onlineCores = sysconf(_SC_NPROCESSORS_ONLN);
+    int maxCores = onlineCores > 0 ? (int)onlineCores : 1;
+    size_t items = JOB_BENCHMARK_DEFAULT_ITEMS;
+    int iterations = JOB_BENCHMARK_DEFAULT_ITERATIONS;
+    const char* csvPath = NULL;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--cores") == 0 && i + 1 < argc) {
+            maxCores = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--items") == 0 && i + 1 < argc) {
+            items = (size_t)strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csvPath = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (maxCores < 1) maxCores = 1;
+    if (maxCores > THREAD_POOL_MAX_THREADS + 1) maxCores = THREAD_POOL_MAX_THREADS + 1;
+    if (items < 1024) items = 1024;
+    if (iterations < 1) iterations = 1;
+    
+    // Deterministic instances spread around the camera
+    BenchState state;
+    memset(&state, 0, sizeof(BenchState));
+    BenchInstance* instances = (BenchInstance*)malloc(items * sizeof(BenchInstance));
+    state.matrices = (float*)malloc(items * 16 * sizeof(float));
+    state.visible = (unsigned char*)malloc(items);
+    state.field = (float*)malloc(items * sizeof(float));
+    double* samples = (double*)malloc(iterations * sizeof(double));
+    ThreadPool* pool = (ThreadPool*)malloc(sizeof(ThreadPool));
+    if (!instances || !state.matrices || !state.visible || !state.field || !samples || !pool) {
+        fprintf(stderr, "Out of memory for %zu items\n", items);
+        return 1;
+    }
+    unsigned int seed = 12345u;
+    for (size_t i = 0; i < items; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            seed = seed * 1664525u + 1013904223u;
+            instances[i].position[axis] = ((seed >> 8) / 16777216.0f - 0.5f) * 2000.0f;
+        }
+        seed = seed * 1664525u + 1013904223u;
+        instances[i].angle = (seed >> 8) / 16777216.0f * 6.2831853f;
+        instances[i].scale = 0.5f + (i % 7) * 0.25f;
+        instances[i].radius = 2.0f;
+    }
+    state.instances = instances;
+    state.count = items;
+    bench_setupFrustum(&state);
+    
+    FILE* csv = NULL;
+    if (csvPath) {
+        csv = fopen(csvPath, "w");
+        if (!csv) {
+            fprintf(stderr, "Failed to open %s for writing\n", csvPath);
+        } else {
+            fprintf(csv, "cores,cull_ms,cull_speedup,graph_ms,graph_speedup\n");
+        }
+    }
+    
+    printf("%zu items, %d iterations, median times\n", items, iterations);
+    printf("%5s  %10s %8s %6s  %10s %8s %6s\n", "cores", "cull ms", "speedup", "eff", "graph ms", "speedup", "eff");
+    
+    double cullBase = 0.0;
+    double graphBase = 0.0;
+    for (int cores = 1; cores <= maxCores; cores++) {
+        threadPool_init(pool, cores - 1);
+        state.pool = pool;
+        
+        double cull = bench_measure(&state, bench_runCull, iterations, samples);
+        double graph = bench_measure(&state, bench_runGraph, iterations, samples);
+        if (cores == 1) {
+            cullBase = cull;
+            graphBase = graph;
+        }
+        
+        double cullSpeedup = cullBase / cull;
+        double graphSpeedup = graphBase / graph;
+        printf("%5d  %10.3f %7.2fx %5.0f%%  %10.3f %7.2fx %5.0f%%\n", cores,
+               cull, cullSpeedup, 100.0 * cullSpeedup / cores,
+               graph, graphSpeedup, 100.0 * graphSpeedup / cores);
+        if (csv) fprintf(csv, "%d,%.4f,%.3f,%.4f,%.3f\n", cores, cull, cullSpeedup, graph, graphSpeedup);
+        
+        threadPool_cleanup(pool);
+    }
+    
+    // Keep the outputs observable
+    size_t visibleCount = 0;
+    for (size_t i = 0; i < items; i++) visibleCount += state.visible[i];
+    printf("%zu of %zu instances visible\n", visibleCount, items);
+    
+    if (csv) fclose(csv);
+    free(pool);
+    free(samples);
+    free(state.field);
+    free(state.visible);
+    free(state.matrices);
+    free(instances);
+    return 0;
+}
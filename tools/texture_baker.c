@@ -0,0 +1,623 @@
+// Offline texture baker: converts source images to .wtex containers with a
+// precomputed mip chain, block-compressed (BC1/BC3/BC5) or raw RGBA8.
+//
+// Usage:
+//   texture_baker [options] <image> <output.wtex>
+//   texture_baker [options] <directory> <output directory>
+//   texture_baker [options] --cubemap <+x> <-x> <+y> <-y> <+z> <-z> <output.wtex>
+//
+// Options:
+//   --format auto|bc1|bc3|bc5|raw   auto picks BC5 for normal maps, BC3 with alpha, else BC1
+//   --srgb / --linear               colour space of the source (default: sRGB unless the
+//                                   name marks a data map: normal, height, roughness, ...;
+//                                   cubemaps default to linear, as texture_loadCubemap expects)
+//
+// Baking a directory onto itself (texture_baker assets/textures assets/textures) puts each
+// container next to its source, which is where texture_load looks for it.
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "utils/texture_container.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <ctype.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#define BAKER_FORMAT_AUTO -1
+
+typedef struct {
+    int format;                 // TextureContainerFormat or BAKER_FORMAT_AUTO
+    int srgb;                   // 1, 0, or -1 to decide from the file name
+} BakeOptions;
+
+// One RGBA8 mip level
+typedef struct {
+    unsigned char* pixels;
+    uint32_t width;
+    uint32_t height;
+} BakeLevel;
+
+// Totals over a run
+typedef struct {
+    unsigned int textures;
+    unsigned int failed;
+    uint64_t rawBytes;
+    uint64_t bakedBytes;
+    double time;
+} BakeTotals;
+
+static const char* formatNames[TEXTURE_CONTAINER_FORMAT_COUNT] = { "raw", "bc1", "bc3", "bc5" };
+
+// Wall clock in milliseconds
+static double bake_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Case-insensitive substring test on the file name
+static bool nameContains(const char* path, const char* word) {
+    const char* name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    size_t length = strlen(word);
+    for (; *name; name++) {
+        size_t i = 0;
+        while (i < length && name[i] && tolower((unsigned char)name[i]) == word[i]) i++;
+        if (i == length) return true;
+    }
+    return false;
+}
+
+static bool isNormalMap(const char* path) {
+    return nameContains(path, "normal") || nameContains(path, "_nrm") || nameContains(path, "_n.");
+}
+
+// Data maps are stored linear; everything else is treated as colour
+static bool isColorMap(const char* path) {
+    static const char* dataWords[] = { "normal", "_nrm", "height", "rough", "metal", "_ao", "occlusion", "spec", "mask" };
+    for (size_t i = 0; i < sizeof(dataWords) / sizeof(dataWords[0]); i++) {
+        if (nameContains(path, dataWords[i])) return false;
+    }
+    return true;
+}
+
+static bool hasImageExtension(const char* path) {
+    const char* dot = strrchr(path, '.');
+    if (!dot) return false;
+    static const char* extensions[] = { ".png", ".jpg", ".jpeg", ".tga", ".bmp", ".psd", ".hdr" };
+    for (size_t i = 0; i < sizeof(extensions) / sizeof(extensions[0]); i++) {
+        const char* a = dot;
+        const char* b = extensions[i];
+        while (*a && *b && tolower((unsigned char)*a) == *b) { a++; b++; }
+        if (!*a && !*b) return true;
+    }
+    return false;
+}
+
+// Create every directory along a path
+static bool ensureDirectory(const char* path) {
+    char buffer[1024];
+    snprintf(buffer, sizeof(buffer), "%s", path);
+    for (char* p = buffer + 1; ; p++) {
+        if (*p == '/' || *p == '\0') {
+            char saved = *p;
+            *p = '\0';
+            if (mkdir(buffer, 0755) != 0 && errno != EEXIST) {
+                fprintf(stderr, "Failed to create directory %s: %s\n", buffer, strerror(errno));
+                return false;
+            }
+            *p = saved;
+            if (saved == '\0') break;
+        }
+    }
+    return true;
+}
+
+// sRGB <-> linear, so colour mips are averaged in linear space
+static float srgbToLinearTable[256];
+
+static void initSrgbTable(void) {
+    for (int i = 0; i < 256; i++) {
+        float c = i / 255.0f;
+        srgbToLinearTable[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+    }
+}
+
+static unsigned char linearToSrgb(float c) {
+    c = c <= 0.0031308f ? c * 12.92f : 1.055f * powf(c, 1.0f / 2.4f) - 0.055f;
+    int v = (int)(c * 255.0f + 0.5f);
+    return (unsigned char)(v < 0 ? 0 : (v > 255 ? 255 : v));
+}
+
+// Box-filter the next mip level; odd edges repeat the last texel
+static BakeLevel downsample(const BakeLevel* source, bool srgb) {
+    BakeLevel level;
+    level.width = source->width > 1 ? source->width / 2 : 1;
+    level.height = source->height > 1 ? source->height / 2 : 1;
+    level.pixels = malloc((size_t)level.width * level.height * 4);
+    if (!level.pixels) return level;
+    
+    for (uint32_t y = 0; y < level.height; y++) {
+        uint32_t y0 = y * 2 < source->height ? y * 2 : source->height - 1;
+        uint32_t y1 = y * 2 + 1 < source->height ? y * 2 + 1 : y0;
+        for (uint32_t x = 0; x < level.width; x++) {
+            uint32_t x0 = x * 2 < source->width ? x * 2 : source->width - 1;
+            uint32_t x1 = x * 2 + 1 < source->width ? x * 2 + 1 : x0;
+            const unsigned char* taps[4] = {
+                source->pixels + ((size_t)y0 * source->width + x0) * 4,
+                source->pixels + ((size_t)y0 * source->width + x1) * 4,
+                source->pixels + ((size_t)y1 * source->width + x0) * 4,
+                source->pixels + ((size_t)y1 * source->width + x1) * 4
+            };
+            unsigned char* out = level.pixels + ((size_t)y * level.width + x) * 4;
+            for (int c = 0; c < 4; c++) {
+                if (srgb && c < 3) {
+                    float sum = 0.0f;
+                    for (int t = 0; t < 4; t++) sum += srgbToLinearTable[taps[t][c]];
+                    out[c] = linearToSrgb(sum * 0.25f);
+                } else {
+                    out[c] = (unsigned char)((taps[0][c] + taps[1][c] + taps[2][c] + taps[3][c] + 2) / 4);
+                }
+            }
+        }
+    }
+    
+    return level;
+}
+
+// Full chain down to 1x1; returns the level count, 0 on allocation failure
+static int buildMipChain(unsigned char* pixels, uint32_t width, uint32_t height, bool srgb, BakeLevel levels[TEXTURE_CONTAINER_MAX_LEVELS]) {
+    levels[0].pixels = pixels;
+    levels[0].width = width;
+    levels[0].height = height;
+    
+    int count = 1;
+    while ((levels[count - 1].width > 1 || levels[count - 1].height > 1) && count < TEXTURE_CONTAINER_MAX_LEVELS) {
+        levels[count] = downsample(&levels[count - 1], srgb);
+        if (!levels[count].pixels) {
+            for (int i = 1; i < count; i++) free(levels[i].pixels);
+            return 0;
+        }
+        count++;
+    }
+    
+    return count;
+}
+
+// Gather a 4x4 block, clamping at the edges of levels smaller than a block
+static void fetchBlock(const BakeLevel* level, uint32_t bx, uint32_t by, unsigned char block[16][4]) {
+    for (int y = 0; y < 4; y++) {
+        uint32_t sy = by * 4 + y < level->height ? by * 4 + y : level->height - 1;
+        for (int x = 0; x < 4; x++) {
+            uint32_t sx = bx * 4 + x < level->width ? bx * 4 + x : level->width - 1;
+            memcpy(block[y * 4 + x], level->pixels + ((size_t)sy * level->width + sx) * 4, 4);
+        }
+    }
+}
+
+static uint16_t packRGB565(const float color[3]) {
+    int r = (int)(color[0] * 31.0f / 255.0f + 0.5f);
+    int g = (int)(color[1] * 63.0f / 255.0f + 0.5f);
+    int b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+    r = r < 0 ? 0 : (r > 31 ? 31 : r);
+    g = g < 0 ? 0 : (g > 63 ? 63 : g);
+    b = b < 0 ? 0 : (b > 31 ? 31 : b);
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void unpackRGB565(uint16_t packed, int color[3]) {
+    int r = (packed >> 11) & 31;
+    int g = (packed >> 5) & 63;
+    int b = packed & 31;
+    color[0] = (r << 3) | (r >> 2);
+    color[1] = (g << 2) | (g >> 4);
+    color[2] = (b << 3) | (b >> 2);
+}
+
+// BC1 colour block: endpoints on the principal axis of the block's colours, 4-colour mode
+static void encodeBC1(const unsigned char block[16][4], unsigned char out[8]) {
+    float mean[3] = { 0.0f, 0.0f, 0.0f };
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) mean[c] += block[i][c];
+    }
+    for (int c = 0; c < 3; c++) mean[c] /= 16.0f;
+    
+    // Covariance, then a few power iterations for the dominant axis
+    float cov[6] = { 0.0f };
+    for (int i = 0; i < 16; i++) {
+        float d[3] = { block[i][0] - mean[0], block[i][1] - mean[1], block[i][2] - mean[2] };
+        cov[0] += d[0] * d[0]; cov[1] += d[0] * d[1]; cov[2] += d[0] * d[2];
+        cov[3] += d[1] * d[1]; cov[4] += d[1] * d[2]; cov[5] += d[2] * d[2];
+    }
+    float axis[3] = { 0.577f, 0.577f, 0.577f };
+    for (int iteration = 0; iteration < 4; iteration++) {
+        float next[3] = {
+            cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2],
+            cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2],
+            cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2]
+        };
+        float length = sqrtf(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+        if (length < 1e-6f) break;
+        for (int c = 0; c < 3; c++) axis[c] = next[c] / length;
+    }
+    
+    float minT = 0.0f, maxT = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        float t = (block[i][0] - mean[0]) * axis[0] + (block[i][1] - mean[1]) * axis[1] + (block[i][2] - mean[2]) * axis[2];
+        if (t < minT) minT = t;
+        if (t > maxT) maxT = t;
+    }
+    float high[3], low[3];
+    for (int c = 0; c < 3; c++) {
+        high[c] = mean[c] + axis[c] * maxT;
+        low[c] = mean[c] + axis[c] * minT;
+    }
+    
+    uint16_t c0 = packRGB565(high);
+    uint16_t c1 = packRGB565(low);
+    if (c0 < c1) {
+        uint16_t swap = c0;
+        c0 = c1;
+        c1 = swap;
+    }
+    
+    out[0] = (unsigned char)(c0 & 0xFF);
+    out[1] = (unsigned char)(c0 >> 8);
+    out[2] = (unsigned char)(c1 & 0xFF);
+    out[3] = (unsigned char)(c1 >> 8);
+    uint32_t indices = 0;
+    
+    // Equal endpoints would select the 3-colour mode; index 0 is exact there anyway
+    if (c0 != c1) {
+        int palette[4][3];
+        unpackRGB565(c0, palette[0]);
+        unpackRGB565(c1, palette[1]);
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++) {
+            int best = 0;
+            int bestError = 1 << 30;
+            for (int p = 0; p < 4; p++) {
+                int dr = block[i][0] - palette[p][0];
+                int dg = block[i][1] - palette[p][1];
+                int db = block[i][2] - palette[p][2];
+                int error = dr * dr + dg * dg + db * db;
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (uint32_t)best << (i * 2);
+        }
+    }
+    
+    out[4] = (unsigned char)(indices & 0xFF);
+    out[5] = (unsigned char)((indices >> 8) & 0xFF);
+    out[6] = (unsigned char)((indices >> 16) & 0xFF);
+    out[7] = (unsigned char)(indices >> 24);
+}
+
+// BC4 single-channel block (BC3 alpha, BC5 red/green): min/max endpoints, 8-value mode
+static void encodeBC4(const unsigned char block[16][4], int channel, unsigned char out[8]) {
+    int high = 0, low = 255;
+    for (int i = 0; i < 16; i++) {
+        int v = block[i][channel];
+        if (v > high) high = v;
+        if (v < low) low = v;
+    }
+    
+    out[0] = (unsigned char)high;
+    out[1] = (unsigned char)low;
+    uint64_t indices = 0;
+    
+    if (high != low) {
+        int palette[8];
+        palette[0] = high;
+        palette[1] = low;
+        for (int p = 2; p < 8; p++) {
+            palette[p] = ((8 - p) * high + (p - 1) * low) / 7;
+        }
+        for (int i = 0; i < 16; i++) {
+            int v = block[i][channel];
+            int best = 0;
+            int bestError = 256;
+            for (int p = 0; p < 8; p++) {
+                int error = abs(v - palette[p]);
+                if (error < bestError) {
+                    bestError = error;
+                    best = p;
+                }
+            }
+            indices |= (uint64_t)best << (i * 3);
+        }
+    }
+    
+    for (int i = 0; i < 6; i++) {
+        out[2 + i] = (unsigned char)((indices >> (i * 8)) & 0xFF);
+    }
+}
+
+// Encode one level into its container representation
+static void encodeLevel(const BakeLevel* level, uint32_t format, unsigned char* out) {
+    if (format == TEXTURE_CONTAINER_RGBA8) {
+        memcpy(out, level->pixels, (size_t)level->width * level->height * 4);
+        return;
+    }
+    
+    uint32_t blocksX = (level->width + 3) / 4;
+    uint32_t blocksY = (level->height + 3) / 4;
+    unsigned char block[16][4];
+    for (uint32_t by = 0; by < blocksY; by++) {
+        for (uint32_t bx = 0; bx < blocksX; bx++) {
+            fetchBlock(level, bx, by, block);
+            switch (format) {
+                case TEXTURE_CONTAINER_BC1:
+                    encodeBC1(block, out);
+                    out += 8;
+                    break;
+                case TEXTURE_CONTAINER_BC3:
+                    encodeBC4(block, 3, out);
+                    encodeBC1(block, out + 8);
+                    out += 16;
+                    break;
+                case TEXTURE_CONTAINER_BC5:
+                    encodeBC4(block, 0, out);
+                    encodeBC4(block, 1, out + 8);
+                    out += 16;
+                    break;
+            }
+        }
+    }
+}
+
+static bool hasAlpha(const BakeLevel* level) {
+    size_t count = (size_t)level->width * level->height;
+    for (size_t i = 0; i < count; i++) {
+        if (level->pixels[i * 4 + 3] != 255) return true;
+    }
+    return false;
+}
+
+// Bake one texture (one face) or a cubemap (six faces) into a container
+static bool bakeTexture(const char* const* inputs, int faces, const char* output, const BakeOptions* options, BakeTotals* totals) {
+    double start = bake_now();
+    BakeLevel chains[6][TEXTURE_CONTAINER_MAX_LEVELS];
+    int levelCount = 0;
+    uint32_t width = 0, height = 0;
+    bool srgb = options->srgb >= 0 ? options->srgb == 1 : faces == 1 && isColorMap(inputs[0]);
+    bool alpha = false;
+    bool ok = true;
+    int loaded = 0;
+    
+    for (int face = 0; face < faces && ok; face++) {
+        int w, h, components;
+        unsigned char* pixels = stbi_load(inputs[face], &w, &h, &components, 4);
+        if (!pixels) {
+            fprintf(stderr, "Failed to load %s: %s\n", inputs[face], stbi_failure_reason());
+            ok = false;
+            break;
+        }
+        if (face > 0 && ((uint32_t)w != width || (uint32_t)h != height)) {
+            fprintf(stderr, "Cubemap face %s is %dx%d, expected %ux%u\n", inputs[face], w, h, width, height);
+            stbi_image_free(pixels);
+            ok = false;
+            break;
+        }
+        width = (uint32_t)w;
+        height = (uint32_t)h;
+        
+        int count = buildMipChain(pixels, width, height, srgb, chains[face]);
+        if (count == 0) {
+            fprintf(stderr, "Out of memory building mips for %s\n", inputs[face]);
+            stbi_image_free(pixels);
+            ok = false;
+            break;
+        }
+        levelCount = count;
+        loaded++;
+        alpha = alpha || ((components == 2 || components == 4) && hasAlpha(&chains[face][0]));
+    }
+    
+    uint32_t format = TEXTURE_CONTAINER_RGBA8;
+    if (ok) {
+        if (options->format != BAKER_FORMAT_AUTO) {
+            format = (uint32_t)options->format;
+        } else if (faces == 1 && isNormalMap(inputs[0])) {
+            format = TEXTURE_CONTAINER_BC5;
+        } else {
+            format = alpha ? TEXTURE_CONTAINER_BC3 : TEXTURE_CONTAINER_BC1;
+        }
+        
+        // Only the colour formats carry an sRGB variant
+        if (format == TEXTURE_CONTAINER_BC5) srgb = false;
+    }
+    
+    // Layout: header, level table (level-major), aligned level data
+    TextureContainerHeader header = {
+        TEXTURE_CONTAINER_MAGIC, TEXTURE_CONTAINER_VERSION, format, srgb ? TEXTURE_CONTAINER_SRGB : 0u,
+        width, height, (uint32_t)levelCount, (uint32_t)faces
+    };
+    TextureContainerLevel table[TEXTURE_CONTAINER_MAX_LEVELS * 6];
+    uint64_t rawBytes = 0;
+    uint64_t offset = sizeof(header) + sizeof(TextureContainerLevel) * (uint64_t)levelCount * faces;
+    if (ok) {
+        for (int level = 0; level < levelCount; level++) {
+            for (int face = 0; face < faces; face++) {
+                const BakeLevel* source = &chains[face][level];
+                offset = (offset + TEXTURE_CONTAINER_ALIGNMENT - 1) & ~(uint64_t)(TEXTURE_CONTAINER_ALIGNMENT - 1);
+                table[level * faces + face].offset = offset;
+                table[level * faces + face].size = textureContainer_levelSize(format, source->width, source->height);
+                offset += table[level * faces + face].size;
+                rawBytes += (uint64_t)source->width * source->height * 4;
+            }
+        }
+    }
+    
+    unsigned char* file = ok ? calloc(1, (size_t)offset) : NULL;
+    if (ok && !file) {
+        fprintf(stderr, "Out of memory encoding %s\n", output);
+        ok = false;
+    }
+    
+    if (ok) {
+        memcpy(file, &header, sizeof(header));
+        memcpy(file + sizeof(header), table, sizeof(TextureContainerLevel) * (size_t)levelCount * faces);
+        for (int level = 0; level < levelCount; level++) {
+            for (int face = 0; face < faces; face++) {
+                encodeLevel(&chains[face][level], format, file + table[level * faces + face].offset);
+            }
+        }
+        
+        FILE* out = fopen(output, "wb");
+        if (!out || fwrite(file, 1, (size_t)offset, out) != (size_t)offset) {
+            fprintf(stderr, "Failed to write %s: %s\n", output, strerror(errno));
+            ok = false;
+        }
+        if (out) fclose(out);
+    }
+    free(file);
+    
+    for (int face = 0; face < loaded; face++) {
+        stbi_image_free(chains[face][0].pixels);
+        for (int level = 1; level < levelCount; level++) free(chains[face][level].pixels);
+    }
+    
+    if (!ok) {
+        totals->failed++;
+        return false;
+    }
+    
+    double time = bake_now() - start;
+    printf("%s: %ux%u%s, %d levels, %s%s, %.1f KB -> %.1f KB (%.0f%%) in %.1f ms\n",
+           output, width, height, faces == 6 ? "x6" : "", levelCount, formatNames[format], srgb ? " sRGB" : "",
+           rawBytes / 1024.0, offset / 1024.0, 100.0 * offset / rawBytes, time);
+    
+    totals->textures++;
+    totals->rawBytes += rawBytes;
+    totals->bakedBytes += offset;
+    totals->time += time;
+    return true;
+}
+
+// Output path for a source: same relative path, container extension
+static void containerPath(const char* source, char* output, size_t size) {
+    snprintf(output, size, "%s", source);
+    char* dot = strrchr(output, '.');
+    char* slash = strrchr(output, '/');
+    if (dot && (!slash || dot > slash)) *dot = '\0';
+    strncat(output, TEXTURE_CONTAINER_EXTENSION, size - strlen(output) - 1);
+}
+
+// Bake every image under a directory, mirroring the tree into the output directory
+static void bakeDirectory(const char* inputDir, const char* outputDir, const BakeOptions* options, BakeTotals* totals) {
+    DIR* dir = opendir(inputDir);
+    if (!dir) {
+        fprintf(stderr, "Failed to open directory %s: %s\n", inputDir, strerror(errno));
+        totals->failed++;
+        return;
+    }
+    if (!ensureDirectory(outputDir)) {
+        closedir(dir);
+        totals->failed++;
+        return;
+    }
+    
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') continue;
+        
+        char input[1024], output[1024];
+        snprintf(input, sizeof(input), "%s/%s", inputDir, entry->d_name);
+        snprintf(output, sizeof(output), "%s/%s", outputDir, entry->d_name);
+        
+        struct stat info;
+        if (stat(input, &info) != 0) continue;
+        if (S_ISDIR(info.st_mode)) {
+            bakeDirectory(input, output, options, totals);
+        } else if (hasImageExtension(input)) {
+            char container[1024];
+            containerPath(output, container, sizeof(container));
+            const char* inputs[1] = { input };
+            bakeTexture(inputs, 1, container, options, totals);
+        }
+    }
+    
+    closedir(dir);
+}
+
+static void printUsage(const char* program) {
+    fprintf(stderr,
+            "Usage: %s [--format auto|bc1|bc3|bc5|raw] [--srgb|--linear] <image|directory> <output>\n"
+            "       %s [options] --cubemap <+x> <-x> <+y> <-y> <+z> <-z> <output>\n",
+            program, program);
+}
+
+int main(int argc, char** argv) {
+    BakeOptions options = { BAKER_FORMAT_AUTO, -1 };
+    bool cubemap = false;
+    const char* positional[7];
+    int positionalCount = 0;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc) {
+            const char* name = argv[++i];
+            options.format = -2;
+            if (strcmp(name, "auto") == 0) options.format = BAKER_FORMAT_AUTO;
+            for (int f = 0; f < TEXTURE_CONTAINER_FORMAT_COUNT; f++) {
+                if (strcmp(name, formatNames[f]) == 0) options.format = f;
+            }
+            if (options.format == -2) {
+                fprintf(stderr, "Unknown format: %s\n", name);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--srgb") == 0) {
+            options.srgb = 1;
+        } else if (strcmp(argv[i], "--linear") == 0) {
+            options.srgb = 0;
+        } else if (strcmp(argv[i], "--cubemap") == 0) {
+            cubemap = true;
+        } else if (argv[i][0] == '-') {
+            printUsage(argv[0]);
+            return 1;
+        } else if (positionalCount < 7) {
+            positional[positionalCount++] = argv[i];
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (positionalCount != (cubemap ? 7 : 2)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    
+    initSrgbTable();
+    BakeTotals totals = { 0 };
+    
+    struct stat info;
+    if (cubemap) {
+        bakeTexture(positional, 6, positional[6], &options, &totals);
+    } else if (stat(positional[0], &info) == 0 && S_ISDIR(info.st_mode)) {
+        bakeDirectory(positional[0], positional[1], &options, &totals);
+    } else {
+        bakeTexture(positional, 1, positional[1], &options, &totals);
+    }
+    
+    if (totals.textures > 1 || totals.failed > 0) {
+        printf("Baked %u textures (%u failed): %.1f MB RGBA8 with mips -> %.1f MB in %.1f ms\n",
+               totals.textures, totals.failed, totals.rawBytes / (1024.0 * 1024.0),
+               totals.bakedBytes / (1024.0 * 1024.0), totals.time);
+    }
+    
+    return totals.failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,229 @@
+// Transform composition benchmark: per-object matrix building (scalar trig and 4x4 multiplies,
+// as object_updateTransform does) against the SoA transform store at 10k and 100k transforms.
+//
+// Usage:
+//   transform_benchmark [--cores N] [--iterations N]
+//
+// Cases, each timed as median milliseconds per frame:
+//   per-object     translate * rotateY * rotateX * rotateZ * scale with full matrix multiplies
+//   store all      every transform changed, composed four at a time with SIMD sin/cos
+//   store all mt   the same on a pool of --cores cores (the calling thread included)
+//   store 10%      one transform in ten changed; the rest are skipped
+//   store clean    nothing changed
+// The store's matrices are checked against the per-object ones.
+
+#include "scene/transform_store.h"
+#include "utils/thread_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#define TRANSFORM_BENCHMARK_DEFAULT_ITERATIONS 20
+#define TRANSFORM_BENCHMARK_MAX_ITERATIONS 1000
+
+// Array-of-structures transform, shaped like Transform
+typedef struct {
+    float position[3];
+    float rotation[3];
+    float scale[3];
+    float modelMatrix[16];
+} BenchTransform;
+
+// Wall clock in milliseconds
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// out = a * b, column-major
+static void bench_multiply(const float* a, const float* b, float* out) {
+    float result[16];
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) sum += a[k * 4 + row] * b[column * 4 + k];
+            result[column * 4 + row] = sum;
+        }
+    }
+    memcpy(out, result, sizeof(result));
+}
+
+// Rotation about one axis (0 = x, 1 = y, 2 = z) by degrees
+static void bench_rotation(int axis, float degrees, float* m) {
+    float s = sinf(degrees * 0.017453292519943295f);
+    float c = cosf(degrees * 0.017453292519943295f);
+    memset(m, 0, sizeof(float) * 16);
+    m[15] = 1.0f;
+    int a = (axis + 1) % 3;
+    int b = (axis + 2) % 3;
+    m[axis * 4 + axis] = 1.0f;
+    m[a * 4 + a] = c;
+    m[a * 4 + b] = s;
+    m[b * 4 + a] = -s;
+    m[b * 4 + b] = c;
+}
+
+// The per-object path: one full matrix per step, multiplied together
+static void bench_composeObject(BenchTransform* transform) {
+    float m[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+    m[12] = transform->position[0];
+    m[13] = transform->position[1];
+    m[14] = transform->position[2];
+    
+    float step[16];
+    bench_rotation(1, transform->rotation[1], step);
+    bench_multiply(m, step, m);
+    bench_rotation(0, transform->rotation[0], step);
+    bench_multiply(m, step, m);
+    bench_rotation(2, transform->rotation[2], step);
+    bench_multiply(m, step, m);
+    
+    float scale[16] = { 0 };
+    scale[0] = transform->scale[0];
+    scale[5] = transform->scale[1];
+    scale[10] = transform->scale[2];
+    scale[15] = 1.0f;
+    bench_multiply(m, scale, transform->modelMatrix);
+}
+
+// Median of a small sample set (sorts in place)
+static double bench_median(double* samples, int count) {
+    for (int i = 1; i < count; i++) {
+        double value = samples[i];
+        int j = i;
+        for (; j > 0 && samples[j - 1] > value; j--) samples[j] = samples[j - 1];
+        samples[j] = value;
+    }
+    return count % 2 ? samples[count / 2] : 0.5 * (samples[count / 2 - 1] + samples[count / 2]);
+}
+
+// Move every stride-th transform a little (frame-dependent, so each frame is a real change)
+static void bench_animate(BenchTransform* transforms, size_t count, size_t stride, int frame) {
+    for (size_t i = 0; i < count; i += stride) {
+        transforms[i].rotation[1] += 0.5f + (float)(frame % 3);
+        transforms[i].position[1] += 0.01f;
+    }
+}
+
+// Time one store case: animate, push the changes into the store, compose
+static double bench_measureStore(TransformStore* store, BenchTransform* transforms, size_t count, size_t stride,
+                                 ThreadPool* pool, int iterations, double* samples) {
+    for (int i = 0; i <= iterations; i++) {
+        if (stride) bench_animate(transforms, count, stride, i);
+        double start = bench_now();
+        for (size_t t = 0; stride && t < count; t += stride) {
+            transformStore_set(store, (uint32_t)t, transforms[t].position, transforms[t].rotation, transforms[t].scale);
+        }
+        transformStore_compose(store, pool);
+        if (i > 0) samples[i - 1] = bench_now() - start;
+    }
+    return bench_median(samples, iterations);
+}
+
+// Run every case for one transform count
+static bool bench_run(size_t count, int cores, int iterations, double* samples) {
+    BenchTransform* transforms = (BenchTransform*)malloc(sizeof(BenchTransform) * count);
+    TransformStore store;
+    ThreadPool* pool = (ThreadPool*)malloc(sizeof(ThreadPool));
+    if (!transforms || !pool || !transformStore_init(&store, count)) {
+        fprintf(stderr, "Out of memory for %zu transforms\n", count);
+        return false;
+    }
+    
+    unsigned int seed = 12345u;
+    for (size_t i = 0; i < count; i++) {
+        for (int axis = 0; axis < 3; axis++) {
+            seed = seed * 1664525u + 1013904223u;
+            transforms[i].position[axis] = ((seed >> 8) / 16777216.0f - 0.5f) * 2000.0f;
+            seed = seed * 1664525u + 1013904223u;
+            transforms[i].rotation[axis] = ((seed >> 8) / 16777216.0f - 0.5f) * 720.0f;
+            transforms[i].scale[axis] = 0.5f + (float)((i + axis) % 7) * 0.25f;
+        }
+        transformStore_add(&store, transforms[i].position, transforms[i].rotation, transforms[i].scale, false, NULL);
+    }
+    transformStore_compose(&store, NULL);
+    
+    // Per-object baseline
+    for (int i = 0; i <= iterations; i++) {
+        bench_animate(transforms, count, 1, i);
+        double start = bench_now();
+        for (size_t t = 0; t < count; t++) bench_composeObject(&transforms[t]);
+        if (i > 0) samples[i - 1] = bench_now() - start;
+    }
+    double perObject = bench_median(samples, iterations);
+    
+    double all = bench_measureStore(&store, transforms, count, 1, NULL, iterations, samples);
+    
+    // Same inputs as the per-object matrices, for the accuracy check
+    for (size_t t = 0; t < count; t++) bench_composeObject(&transforms[t]);
+    for (size_t t = 0; t < count; t++) {
+        transformStore_set(&store, (uint32_t)t, transforms[t].position, transforms[t].rotation, transforms[t].scale);
+    }
+    transformStore_compose(&store, NULL);
+    double maxError = 0.0;
+    for (size_t t = 0; t < count; t++) {
+        const float* matrix = transformStore_getMatrix(&store, (uint32_t)t);
+        for (int k = 0; k < 16; k++) {
+            double error = fabs((double)matrix[k] - transforms[t].modelMatrix[k]);
+            double magnitude = fabs(transforms[t].modelMatrix[k]) > 1.0 ? fabs(transforms[t].modelMatrix[k]) : 1.0;
+            if (error / magnitude > maxError) maxError = error / magnitude;
+        }
+    }
+    
+    threadPool_init(pool, cores - 1);
+    double allParallel = bench_measureStore(&store, transforms, count, 1, pool, iterations, samples);
+    threadPool_cleanup(pool);
+    double tenth = bench_measureStore(&store, transforms, count, 10, NULL, iterations, samples);
+    size_t tenthComposed = store.composed;
+    double clean = bench_measureStore(&store, transforms, count, 0, NULL, iterations, samples);
+    
+    printf("%zu transforms\n", count);
+    printf("  %-14s %9.3f ms\n", "per-object", perObject);
+    printf("  %-14s %9.3f ms  %5.2fx\n", "store all", all, perObject / all);
+    printf("  %-14s %9.3f ms  %5.2fx  (%d cores)\n", "store all mt", allParallel, perObject / allParallel, cores);
+    printf("  %-14s %9.3f ms  %5.2fx  (%zu composed, %zu skipped)\n", "store 10%", tenth, perObject / tenth,
+           tenthComposed, count - tenthComposed);
+    printf("  %-14s %9.3f ms\n", "store clean", clean);
+    printf("  max relative error against per-object: %.2e\n", maxError);
+    
+    transformStore_cleanup(&store);
+    free(pool);
+    free(transforms);
+    return maxError < 1e-4;
+}
+
+static void printUsage(const char* program) {
+    fprintf(stderr, "Usage: %s [--cores N] [--iterations N]\n", program);
+}
+
+int main(int argc, char** argv) {
+    long onlineCores = sysconf(_SC_NPROCESSORS_ONLN);
+    int cores = onlineCores > 0 ? (int)onlineCores : 1;
+    int iterations = TRANSFORM_BENCHMARK_DEFAULT_ITERATIONS;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--cores") == 0 && i + 1 < argc) {
+            cores = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (cores < 1) cores = 1;
+    if (cores > THREAD_POOL_MAX_THREADS + 1) cores = THREAD_POOL_MAX_THREADS + 1;
+    if (iterations < 1) iterations = 1;
+    if (iterations > TRANSFORM_BENCHMARK_MAX_ITERATIONS) iterations = TRANSFORM_BENCHMARK_MAX_ITERATIONS;
+    
+    double samples[TRANSFORM_BENCHMARK_MAX_ITERATIONS];
+    bool accurate = bench_run(10000, cores, iterations, samples);
+    accurate = bench_run(100000, cores, iterations, samples) && accurate;
+    if (!accurate) printf("Store matrices do NOT match the per-object ones\n");
+    return accurate ? 0 : 1;
+}
@@ -0,0 +1,193 @@
+// Vegetation placement scaling benchmark: places tree, flower, mushroom and grass layers
+// over a synthetic terrain on 1..N cores and reports time, speedup and parallel efficiency.
+// Every run hashes its output; the hashes must match across core counts, since placement
+// is deterministic.
+//
+// Usage:
+//   vegetation_benchmark [--cores N] [--size N] [--iterations N] [--csv file]
+//
+// "Cores" counts the calling thread, so N cores is a pool of N - 1 workers.
+
+#include "scene/vegetation_placer.h"
+#include "utils/thread_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#define VEGETATION_BENCHMARK_DEFAULT_SIZE 1024.0f
+#define VEGETATION_BENCHMARK_DEFAULT_ITERATIONS 5
+#define VEGETATION_BENCHMARK_LAYERS 4
+
+// Output of one run: counts and an order-independent hash of every written point
+typedef struct {
+    size_t points[VEGETATION_BENCHMARK_LAYERS];
+    uint64_t hash;
+} BenchResult;
+
+// Wall clock in milliseconds
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Smooth hills and valleys standing in for the generated heightmap
+static float bench_height(float x, float z) {
+    return 12.0f * sinf(x * 0.011f) * cosf(z * 0.013f)
+         + 5.0f * sinf(x * 0.037f + z * 0.029f)
+         + 1.5f * cosf(x * 0.093f - z * 0.081f);
+}
+
+// Height, slope from central differences, and a biome by height and a low-frequency mask
+static void bench_sample(void* context, float x, float z, float* height, float* slope, int* biome) {
+    (void)context;
+    const float step = 0.5f;
+    float dx = (bench_height(x + step, z) - bench_height(x - step, z)) / (2.0f * step);
+    float dz = (bench_height(x, z + step) - bench_height(x, z - step)) / (2.0f * step);
+    *height = bench_height(x, z);
+    *slope = 1.0f - 1.0f / sqrtf(1.0f + dx * dx + dz * dz);
+    if (*height > 12.0f || *slope > 0.3f) {
+        *biome = 2;
+    } else {
+        *biome = sinf(x * 0.005f + 1.0f) * cosf(z * 0.006f) > 0.0f ? 1 : 0;
+    }
+}
+
+// Fold a point into the result hash; the sum is commutative, so writer order does not matter
+static void bench_write(void* context, int variant, size_t index, const VegetationPoint* point) {
+    uint64_t* hash = (uint64_t*)context;
+    uint32_t bits[3];
+    memcpy(bits, point->position, sizeof(bits));
+    uint64_t value = ((uint64_t)bits[0] << 32 | bits[2]) ^ ((uint64_t)variant << 48) ^ index;
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdull;
+    value ^= value >> 33;
+    __atomic_fetch_add(hash, value, __ATOMIC_RELAXED);
+}
+
+// Place and write every layer once
+static double bench_run(const VegetationLayer* layers, float size, ThreadPool* pool, BenchResult* result) {
+    double start = bench_now();
+    result->hash = 0;
+    for (int l = 0; l < VEGETATION_BENCHMARK_LAYERS; l++) {
+        VegetationPlacer placer;
+        if (!vegetationPlacer_run(&placer, &layers[l], -size * 0.5f, -size * 0.5f, size, bench_sample, NULL, pool)) {
+            result->points[l] = 0;
+            continue;
+        }
+        vegetationPlacer_write(&placer, bench_write, &result->hash, pool);
+        result->points[l] = placer.kept;
+        vegetationPlacer_cleanup(&placer);
+    }
+    return bench_now() - start;
+}
+
+// Median of a small sample set (sorts in place)
+static double bench_median(double* samples, int count) {
+    for (int i = 1; i < count; i++) {
+        double value = samples[i];
+        int j = i;
+        for (; j > 0 && samples[j - 1] > value; j--) samples[j] = samples[j - 1];
+        samples[j] = value;
+    }
+    return count % 2 ? samples[count / 2] : 0.5 * (samples[count / 2 - 1] + samples[count / 2]);
+}
+
+static void printUsage(const char* program) {
+    fprintf(stderr, "Usage: %s [--cores N] [--size N] [--iterations N] [--csv file]\n", program);
+}
+
+int main(int argc, char** argv) {
+    long onlineCores = sysconf(_SC_NPROCESSORS_ONLN);
+    int maxCores = onlineCores > 0 ? (int)onlineCores : 1;
+    float size = VEGETATION_BENCHMARK_DEFAULT_SIZE;
+    int iterations = VEGETATION_BENCHMARK_DEFAULT_ITERATIONS;
+    const char* csvPath = NULL;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--cores") == 0 && i + 1 < argc) {
+            maxCores = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            size = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) {
+            csvPath = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (maxCores < 1) maxCores = 1;
+    if (maxCores > THREAD_POOL_MAX_THREADS + 1) maxCores = THREAD_POOL_MAX_THREADS + 1;
+    if (size < 64.0f) size = 64.0f;
+    if (iterations < 1) iterations = 1;
+    
+    // Roughly the game's layers; density per biome: meadow, forest, rocky
+    const VegetationLayer layers[VEGETATION_BENCHMARK_LAYERS] = {
+        { "trees", 1234u, 1, 6.0f, 1000, { 0.05f, 0.9f, 0.02f }, -INFINITY, INFINITY, 0.5f, 0.8f, 1.3f, 4 },
+        { "flowers", 1234u, 2, 1.5f, 2000, { 0.6f, 0.1f, 0.0f }, -INFINITY, INFINITY, 0.35f, 0.7f, 1.2f, 3 },
+        { "mushrooms", 1234u, 3, 2.5f, 500, { 0.02f, 0.5f, 0.0f }, -INFINITY, INFINITY, 0.3f, 0.6f, 1.4f, 2 },
+        { "grass", 1234u, 4, 2.0f, 50000, { 1.0f, 0.5f, 0.1f }, -INFINITY, INFINITY, 0.4f, 0.8f, 1.2f, 1 }
+    };
+    
+    double* samples = (double*)malloc(iterations * sizeof(double));
+    ThreadPool* pool = (ThreadPool*)malloc(sizeof(ThreadPool));
+    if (!samples || !pool) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    
+    FILE* csv = NULL;
+    if (csvPath) {
+        csv = fopen(csvPath, "w");
+        if (!csv) {
+            fprintf(stderr, "Failed to open %s for writing\n", csvPath);
+        } else {
+            fprintf(csv, "cores,place_ms,speedup\n");
+        }
+    }
+    
+    printf("%.0f x %.0f terrain, %d iterations, median times\n", size, size, iterations);
+    printf("%5s  %10s %8s %6s  %16s\n", "cores", "place ms", "speedup", "eff", "hash");
+    
+    double base = 0.0;
+    BenchResult reference;
+    memset(&reference, 0, sizeof(BenchResult));
+    bool deterministic = true;
+    for (int cores = 1; cores <= maxCores; cores++) {
+        threadPool_init(pool, cores - 1);
+        
+        BenchResult result;
+        bench_run(layers, size, pool, &result);
+        for (int i = 0; i < iterations; i++) samples[i] = bench_run(layers, size, pool, &result);
+        double time = bench_median(samples, iterations);
+        if (cores == 1) {
+            base = time;
+            reference = result;
+        } else if (memcmp(&result, &reference, sizeof(BenchResult)) != 0) {
+            deterministic = false;
+        }
+        
+        double speedup = base / time;
+        printf("%5d  %10.3f %7.2fx %5.0f%%  %016llx\n", cores, time, speedup, 100.0 * speedup / cores,
+               (unsigned long long)result.hash);
+        if (csv) fprintf(csv, "%d,%.4f,%.3f\n", cores, time, speedup);
+        
+        threadPool_cleanup(pool);
+    }
+    
+    for (int l = 0; l < VEGETATION_BENCHMARK_LAYERS; l++) {
+        printf("%-10s %zu placed\n", layers[l].name, reference.points[l]);
+    }
+    printf("Placement is %s across core counts\n", deterministic ? "identical" : "NOT identical");
+    
+    if (csv) fclose(csv);
+    free(pool);
+    free(samples);
+    return deterministic ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+// Wind field benchmark: per-frame update cost as the camera and the wind move, and the cost
+// of sampling the field one point at a time against in batches.
+//
+// Usage:
+//   wind_benchmark [--cores N] [--iterations N]
+//
+// Update cases, WIND_BENCHMARK_FRAMES frames at 60 Hz each, reported as median and worst
+// milliseconds per frame and mean cells recomputed per frame:
+//   still          camera parked; only the wind carries the gusts along
+//   walking        camera at 5 m/s
+//   flying         camera at 60 m/s
+//   coupled        walking, with a synthetic vortex coupled in as the fluid
+//   full refill    the whole grid recomputed every frame (what a non-incremental field costs)
+// Sampling cases, median milliseconds for 100k and 1M points around the camera:
+//   per-call       windField_sample in a loop
+//   batch          windField_sampleBatch on the calling thread
+//   batch mt       windField_sampleBatch on a pool of --cores cores (the calling thread included)
+// Batch results are checked against the per-call ones.
+
+#include "scene/wind_field.h"
+#include "config.h"
+#include "utils/thread_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#define WIND_BENCHMARK_DEFAULT_ITERATIONS 20
+#define WIND_BENCHMARK_MAX_ITERATIONS 1000
+#define WIND_BENCHMARK_FRAMES 600
+
+// Wall clock in milliseconds
+static double bench_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Median of a small sample set (sorts in place)
+static double bench_median(double* samples, int count) {
+    for (int i = 1; i < count; i++) {
+        double value = samples[i];
+        int j = i;
+        for (; j > 0 && samples[j - 1] > value; j--) samples[j] = samples[j - 1];
+        samples[j] = value;
+    }
+    return count % 2 ? samples[count / 2] : 0.5 * (samples[count / 2 - 1] + samples[count / 2]);
+}
+
+// Stand-in fluid: a vortex around the origin, fading out over 100 units
+static void bench_vortex(void* context, float x, float z, float* velocityX, float* velocityZ) {
+    (void)context;
+    float falloff = expf(-(x * x + z * z) / 10000.0f);
+    *velocityX = -z * 0.02f * falloff;
+    *velocityZ = x * 0.02f * falloff;
+}
+
+// Run frames of one update case and print its line
+static void bench_update(const char* name, float cameraSpeed, bool coupled, bool refill) {
+    WindField field;
+    if (!windField_init(&field, WIND_FIELD_SIZE, WIND_FIELD_CELL_SIZE, WIND_FIELD_SEED)) return;
+    if (coupled) windField_setFluid(&field, bench_vortex, NULL, WIND_FIELD_FLUID_COUPLING);
+    
+    static double samples[WIND_BENCHMARK_FRAMES];
+    double worst = 0.0;
+    size_t cells = 0;
+    float camera[3] = { 0.0f, 10.0f, 0.0f };
+    for (int frame = 0; frame <= WIND_BENCHMARK_FRAMES; frame++) {
+        double time = frame / 60.0;
+        camera[0] = (float)(cameraSpeed * time);
+        camera[2] = (float)(cameraSpeed * time * 0.5);
+        if (refill) field.valid = false;
+        
+        // Gusty, slowly veering wind
+        windField_update(&field, time, camera, 1.0f + 0.5f * (float)sin(time * 0.7), 0.6f + 0.3f * (float)sin(time * 0.1));
+        if (frame == 0) continue;
+        samples[frame - 1] = field.updateTime;
+        if (field.updateTime > worst) worst = field.updateTime;
+        cells += field.cellsUpdated;
+    }
+    
+    double median = bench_median(samples, WIND_BENCHMARK_FRAMES);
+    printf("  %-12s %8.4f ms  worst %8.4f ms  %8.1f cells/frame\n", name, median, worst, (double)cells / WIND_BENCHMARK_FRAMES);
+    windField_cleanup(&field);
+}
+
+// Time the sampling cases for one point count; false if batch and per-call results differ
+static bool bench_sample(WindField* field, size_t count, int cores, int iterations, double* samples) {
+    float* positions = (float*)malloc(sizeof(float) * 3 * count);
+    float* expected = (float*)malloc(sizeof(float) * 2 * count);
+    float* velocities = (float*)malloc(sizeof(float) * 2 * count);
+    ThreadPool* pool = (ThreadPool*)malloc(sizeof(ThreadPool));
+    if (!positions || !expected || !velocities || !pool) {
+        fprintf(stderr, "Out of memory for %zu points\n", count);
+        return false;
+    }
+    
+    // Points within the grass cull distance of the camera (at the origin)
+    unsigned int seed = 12345u;
+    for (size_t i = 0; i < count; i++) {
+        seed = seed * 1664525u + 1013904223u;
+        positions[i * 3] = ((seed >> 8) / 16777216.0f - 0.5f) * 300.0f;
+        positions[i * 3 + 1] = 0.0f;
+        seed = seed * 1664525u + 1013904223u;
+        positions[i * 3 + 2] = ((seed >> 8) / 16777216.0f - 0.5f) * 300.0f;
+    }
+    
+    for (int i = 0; i <= iterations; i++) {
+        double start = bench_now();
+        for (size_t p = 0; p < count; p++) {
+            windField_sample(field, positions[p * 3], positions[p * 3 + 2], &expected[p * 2], &expected[p * 2 + 1]);
+        }
+        if (i > 0) samples[i - 1] = bench_now() - start;
+    }
+    double perCall = bench_median(samples, iterations);
+    
+    for (int i = 0; i <= iterations; i++) {
+        double start = bench_now();
+        windField_sampleBatch(field, positions, 3, count, velocities, NULL);
+        if (i > 0) samples[i - 1] = bench_now() - start;
+    }
+    double batch = bench_median(samples, iterations);
+    bool match = memcmp(expected, velocities, sizeof(float) * 2 * count) == 0;
+    
+    threadPool_init(pool, cores - 1);
+    memset(velocities, 0, sizeof(float) * 2 * count);
+    for (int i = 0; i <= iterations; i++) {
+        double start = bench_now();
+        windField_sampleBatch(field, positions, 3, count, velocities, pool);
+        if (i > 0) samples[i - 1] = bench_now() - start;
+    }
+    double batchParallel = bench_median(samples, iterations);
+    threadPool_cleanup(pool);
+    match = match && memcmp(expected, velocities, sizeof(float) * 2 * count) == 0;
+    
+    printf("%zu samples\n", count);
+    printf("  %-12s %8.3f ms  %6.2f ns/sample\n", "per-call", perCall, perCall * 1e6 / count);
+    printf("  %-12s %8.3f ms  %6.2f ns/sample  %5.2fx\n", "batch", batch, batch * 1e6 / count, perCall / batch);
+    printf("  %-12s %8.3f ms  %6.2f ns/sample  %5.2fx  (%d cores)\n", "batch mt", batchParallel,
+           batchParallel * 1e6 / count, perCall / batchParallel, cores);
+    
+    free(pool);
+    free(velocities);
+    free(expected);
+    free(positions);
+    return match;
+}
+
+static void printUsage(const char* program) {
+    fprintf(stderr, "Usage: %s [--cores N] [--iterations N]\n", program);
+}
+
+int main(int argc, char** argv) {
+    long onlineCores = sysconf(_SC_NPROCESSORS_ONLN);
+    int cores = onlineCores > 0 ? (int)onlineCores : 1;
+    int iterations = WIND_BENCHMARK_DEFAULT_ITERATIONS;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--cores") == 0 && i + 1 < argc) {
+            cores = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = atoi(argv[++i]);
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (cores < 1) cores = 1;
+    if (cores > THREAD_POOL_MAX_THREADS + 1) cores = THREAD_POOL_MAX_THREADS + 1;
+    if (iterations < 1) iterations = 1;
+    if (iterations > WIND_BENCHMARK_MAX_ITERATIONS) iterations = WIND_BENCHMARK_MAX_ITERATIONS;
+    
+    printf("Update, %dx%d cells of %.1f units, %d frames\n", WIND_FIELD_SIZE, WIND_FIELD_SIZE, WIND_FIELD_CELL_SIZE, WIND_BENCHMARK_FRAMES);
+    bench_update("still", 0.0f, false, false);
+    bench_update("walking", 5.0f, false, false);
+    bench_update("flying", 60.0f, false, false);
+    bench_update("coupled", 5.0f, true, false);
+    bench_update("full refill", 5.0f, false, true);
+    
+    WindField field;
+    if (!windField_init(&field, WIND_FIELD_SIZE, WIND_FIELD_CELL_SIZE, WIND_FIELD_SEED)) return 1;
+    float camera[3] = { 0.0f, 10.0f, 0.0f };
+    windField_update(&field, 0.0, camera, 1.2f, 0.6f);
+    
+    double samples[WIND_BENCHMARK_MAX_ITERATIONS];
+    bool match = bench_sample(&field, 100000, cores, iterations, samples);
+    match = bench_sample(&field, 1000000, cores, iterations, samples) && match;
+    windField_cleanup(&field);
+    if (!match) printf("Batch samples do NOT match the per-call ones\n");
+    return match ? 0 : 1;
+}